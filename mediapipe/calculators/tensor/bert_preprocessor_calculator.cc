@@ -14,10 +14,8 @@
 
 #include <algorithm>
 #include <cstdint>
-#include <cstring>
 #include <memory>
 #include <string>
-#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
@@ -25,6 +23,7 @@
 #include "absl/strings/ascii.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
 #include "mediapipe/calculators/tensor/bert_preprocessor_calculator.pb.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/api2/port.h"
@@ -92,7 +91,8 @@ constexpr absl::string_view kSeparatorToken = "[SEP]";
 //       (3): the input mask ids, which are 1 at each of the input token indices
 //            and 0 elsewhere.
 //     The Tensors will have size equal to the max sequence length for the BERT
-//     model.
+//     model. If the model has dynamic input tensors, they have the size of the
+//     input instead, rounded up to the smallest of `seq_len_buckets` if any.
 //
 // Example:
 // node {
@@ -131,16 +131,32 @@ class BertPreprocessorCalculator : public Node {
   int input_masks_tensor_index_ = 2;
   // Whether the model's input tensor shapes are dynamic.
   bool has_dynamic_input_tensors_ = false;
+  // The increasing sizes dynamic input tensors are padded to, if any.
+  std::vector<int> seq_len_buckets_;
 
-  // Applies `tokenizer_` to the `input_text` to generate a vector of tokens.
-  // This util prepends "[CLS]" and appends "[SEP]" to the input tokens and
-  // clips the vector of tokens to have length at most `bert_max_seq_len_` if
-  // the input tensors are static.
-  std::vector<std::string> TokenizeInputText(absl::string_view input_text);
-  // Processes the `input_tokens` to generate the three input tensors of size
-  // `tensor_size` for the BERT model.
-  std::vector<Tensor> GenerateInputTensors(
-      const std::vector<std::string>& input_tokens, int tensor_size);
+  // The ids of the "[CLS]" and "[SEP]" tokens.
+  int classifier_token_id_ = 0;
+  int separator_token_id_ = 0;
+  // The token ids of the input text, reused across inputs. Holds the tokens
+  // which fit in the largest input tensors, i.e. `bert_max_seq_len_ - 2` for
+  // static input tensors and the largest bucket minus 2 for bucketed ones,
+  // and grows to the longest input for other dynamic input tensors.
+  std::vector<int32_t> token_ids_;
+
+  // Whether inputs are truncated to the size of `token_ids_`.
+  bool TruncatesInput() const {
+    return !has_dynamic_input_tensors_ || !seq_len_buckets_.empty();
+  }
+  // Applies `tokenizer_` to the `input_text` to generate the ids of its
+  // tokens, clipped to the size of `token_ids_` if TruncatesInput().
+  absl::Span<const int32_t> TokenizeInputText(absl::string_view input_text);
+  // Returns the size of the input tensors for `num_tokens` tokens.
+  int GetTensorSize(int num_tokens) const;
+  // Processes the `token_ids` to generate the three input tensors of size
+  // `tensor_size` for the BERT model, prepending "[CLS]" and appending "[SEP]"
+  // to the tokens.
+  std::vector<Tensor> GenerateInputTensors(absl::Span<const int32_t> token_ids,
+                                           int tensor_size);
 
   // Enable pooling of AHWBs in Tensor instances.
   MemoryManager* memory_manager_ = nullptr;
@@ -151,6 +167,13 @@ absl::Status BertPreprocessorCalculator::UpdateContract(
   const auto& options =
       cc->Options<mediapipe::BertPreprocessorCalculatorOptions>();
   if (options.has_dynamic_input_tensors()) {
+    for (int i = 0; i < options.seq_len_buckets_size(); ++i) {
+      RET_CHECK_GE(options.seq_len_buckets(i), 2)
+          << "seq_len_buckets must be at least 2";
+      RET_CHECK(i == 0 ||
+                options.seq_len_buckets(i) > options.seq_len_buckets(i - 1))
+          << "seq_len_buckets must be in increasing order";
+    }
     return absl::OkStatus();
   } else {
     RET_CHECK(options.has_bert_max_seq_len()) << "bert_max_seq_len is required";
@@ -194,59 +217,65 @@ absl::Status BertPreprocessorCalculator::Open(CalculatorContext* cc) {
       cc->Options<mediapipe::BertPreprocessorCalculatorOptions>();
   bert_max_seq_len_ = options.bert_max_seq_len();
   has_dynamic_input_tensors_ = options.has_dynamic_input_tensors();
+  if (has_dynamic_input_tensors_) {
+    seq_len_buckets_.assign(options.seq_len_buckets().begin(),
+                            options.seq_len_buckets().end());
+  }
+  const int max_seq_len = seq_len_buckets_.empty() ? bert_max_seq_len_
+                                                   : seq_len_buckets_.back();
+  token_ids_.resize(std::max(max_seq_len - 2, 0));
+  tokenizer_->LookupId(kClassifierToken, &classifier_token_id_);
+  tokenizer_->LookupId(kSeparatorToken, &separator_token_id_);
   return absl::OkStatus();
 }
 
 absl::Status BertPreprocessorCalculator::Process(CalculatorContext* cc) {
-  int tensor_size = bert_max_seq_len_;
-  std::vector<std::string> input_tokens = TokenizeInputText(kTextIn(cc).Get());
-  if (has_dynamic_input_tensors_) {
-    tensor_size = input_tokens.size();
-  }
-  kTensorsOut(cc).Send(GenerateInputTensors(input_tokens, tensor_size));
+  absl::Span<const int32_t> token_ids = TokenizeInputText(kTextIn(cc).Get());
+  kTensorsOut(cc).Send(
+      GenerateInputTensors(token_ids, GetTensorSize(token_ids.size())));
   return absl::OkStatus();
 }
 
-std::vector<std::string> BertPreprocessorCalculator::TokenizeInputText(
+absl::Span<const int32_t> BertPreprocessorCalculator::TokenizeInputText(
     absl::string_view input_text) {
   std::string processed_input = std::string(input_text);
   absl::AsciiStrToLower(&processed_input);
 
-  tasks::text::tokenizers::TokenizerResult tokenizer_result =
-      tokenizer_->Tokenize(processed_input);
+  // Tokens missing from the vocabulary get id 0, as [UNK] tokens already
+  // replace unknown words.
+  int num_tokens = tokenizer_->TokenizeIds(processed_input, /*unknown_id=*/0,
+                                           absl::MakeSpan(token_ids_));
+  if (!TruncatesInput() && num_tokens > token_ids_.size()) {
+    token_ids_.resize(num_tokens);
+    num_tokens = tokenizer_->TokenizeIds(processed_input, /*unknown_id=*/0,
+                                         absl::MakeSpan(token_ids_));
+  }
+  // Otherwise, truncate the input tokens to the largest input tensors.
+  return absl::MakeConstSpan(token_ids_).first(
+      std::min<size_t>(num_tokens, token_ids_.size()));
+}
 
-  // Offset by 2 to account for [CLS] and [SEP]
-  int input_tokens_size =
-      static_cast<int>(tokenizer_result.subwords.size()) + 2;
-  // For static shapes, truncate the input tokens to `bert_max_seq_len_`.
+int BertPreprocessorCalculator::GetTensorSize(int num_tokens) const {
   if (!has_dynamic_input_tensors_) {
-    input_tokens_size = std::min(bert_max_seq_len_, input_tokens_size);
+    return bert_max_seq_len_;
   }
-  std::vector<std::string> input_tokens;
-  input_tokens.reserve(input_tokens_size);
-  input_tokens.push_back(std::string(kClassifierToken));
-  for (int i = 0; i < input_tokens_size - 2; ++i) {
-    input_tokens.push_back(std::move(tokenizer_result.subwords[i]));
+  // Offset by 2 to account for [CLS] and [SEP]
+  const int seq_len = num_tokens + 2;
+  if (seq_len_buckets_.empty()) {
+    return seq_len;
   }
-  input_tokens.push_back(std::string(kSeparatorToken));
-  return input_tokens;
+  // Inputs were truncated to fit in the largest bucket.
+  return *std::lower_bound(seq_len_buckets_.begin(), seq_len_buckets_.end(),
+                           seq_len);
 }
 
 std::vector<Tensor> BertPreprocessorCalculator::GenerateInputTensors(
-    const std::vector<std::string>& input_tokens, int tensor_size) {
-  std::vector<int32_t> input_ids(tensor_size, 0);
-  std::vector<int32_t> segment_ids(tensor_size, 0);
-  std::vector<int32_t> input_masks(tensor_size, 0);
-  // Convert tokens back into ids and set mask
-  for (int i = 0; i < input_tokens.size(); ++i) {
-    tokenizer_->LookupId(input_tokens[i], &input_ids[i]);
-    input_masks[i] = 1;
-  }
+    absl::Span<const int32_t> token_ids, int tensor_size) {
   //                           |<-----------tensor_size------------>|
   // input_ids                 [CLS] s1  s2...  sn [SEP]  0  0...  0
   // segment_ids                 0    0   0...  0    0    0  0...  0
   // input_masks                 1    1   1...  1    1    0  0...  0
-
+  const int num_input_tokens = token_ids.size() + 2;
   std::vector<Tensor> input_tensors;
   input_tensors.reserve(kNumInputTensorsForBert);
   for (int i = 0; i < kNumInputTensorsForBert; ++i) {
@@ -255,18 +284,24 @@ std::vector<Tensor> BertPreprocessorCalculator::GenerateInputTensors(
          Tensor::Shape({1, tensor_size}, has_dynamic_input_tensors_),
          memory_manager_});
   }
-  std::memcpy(input_tensors[input_ids_tensor_index_]
-                  .GetCpuWriteView()
-                  .buffer<int32_t>(),
-              input_ids.data(), input_ids.size() * sizeof(int32_t));
-  std::memcpy(input_tensors[segment_ids_tensor_index_]
-                  .GetCpuWriteView()
-                  .buffer<int32_t>(),
-              segment_ids.data(), segment_ids.size() * sizeof(int32_t));
-  std::memcpy(input_tensors[input_masks_tensor_index_]
-                  .GetCpuWriteView()
-                  .buffer<int32_t>(),
-              input_masks.data(), input_masks.size() * sizeof(int32_t));
+  {
+    auto view = input_tensors[input_ids_tensor_index_].GetCpuWriteView();
+    int32_t* input_ids = view.buffer<int32_t>();
+    input_ids[0] = classifier_token_id_;
+    std::copy(token_ids.begin(), token_ids.end(), input_ids + 1);
+    input_ids[num_input_tokens - 1] = separator_token_id_;
+    std::fill(input_ids + num_input_tokens, input_ids + tensor_size, 0);
+  }
+  {
+    auto view = input_tensors[segment_ids_tensor_index_].GetCpuWriteView();
+    std::fill_n(view.buffer<int32_t>(), tensor_size, 0);
+  }
+  {
+    auto view = input_tensors[input_masks_tensor_index_].GetCpuWriteView();
+    int32_t* input_masks = view.buffer<int32_t>();
+    std::fill(input_masks, input_masks + num_input_tokens, 1);
+    std::fill(input_masks + num_input_tokens, input_masks + tensor_size, 0);
+  }
   return input_tensors;
 }
 
@@ -20,6 +20,7 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -44,7 +45,8 @@ constexpr absl::string_view kTestModelPath =
 
 absl::StatusOr<std::vector<std::vector<int>>> RunBertPreprocessorCalculator(
     absl::string_view text, absl::string_view model_path,
-    bool has_dynamic_input_tensors = false, int tensor_size = kBertMaxSeqLen) {
+    bool has_dynamic_input_tensors = false, int tensor_size = kBertMaxSeqLen,
+    const std::vector<int>& seq_len_buckets = {}) {
   auto graph_config = ParseTextProtoOrDie<CalculatorGraphConfig>(
       absl::Substitute(R"(
         input_stream: "text"
@@ -58,11 +60,13 @@ absl::StatusOr<std::vector<std::vector<int>>> RunBertPreprocessorCalculator(
             [mediapipe.BertPreprocessorCalculatorOptions.ext] {
               bert_max_seq_len: $0
               has_dynamic_input_tensors: $1
+              seq_len_buckets: [ $2 ]
             }
           }
         }
       )",
-                       tensor_size, has_dynamic_input_tensors));
+                       tensor_size, has_dynamic_input_tensors,
+                       absl::StrJoin(seq_len_buckets, ", ")));
   std::vector<Packet> output_packets;
   tool::AddVectorSink("tensors", &graph_config, &output_packets);
 
@@ -153,5 +157,46 @@ TEST(BertPreprocessorCalculatorTest, LongInput) {
   EXPECT_THAT(processed_tensor_values, ElementsAreArray(expected_result));
 }
 
+TEST(BertPreprocessorCalculatorTest, DynamicInputPaddedToBucket) {
+  constexpr int kBucketSize = 16;
+  std::vector<std::vector<int>> expected_result = {
+      {101, 2009, 1005, 1055, 1037, 11951, 1998, 2411, 12473, 4990, 102}};
+  // segment_ids
+  expected_result.push_back(std::vector(kBucketSize, 0));
+  // input_masks
+  expected_result.push_back(std::vector(expected_result[0].size(), 1));
+  expected_result[2].resize(kBucketSize);
+  // padding input_ids
+  expected_result[0].resize(kBucketSize);
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::vector<int>> processed_tensor_values,
+      RunBertPreprocessorCalculator(
+          "it's a charming and often affecting journey", kTestModelPath,
+          /*has_dynamic_input_tensors=*/true, kBucketSize,
+          /*seq_len_buckets=*/{8, kBucketSize, 32}));
+  EXPECT_THAT(processed_tensor_values, ElementsAreArray(expected_result));
+}
+
+TEST(BertPreprocessorCalculatorTest, DynamicInputTruncatedToLargestBucket) {
+  constexpr int kBucketSize = 16;
+  std::vector<std::vector<int>> expected_result = {
+      {101, 2009, 1005, 1055, 1037, 11951, 1998, 2411, 12473, 4990, 1998, 2023,
+       2003, 1037, 2146, 102}};
+  // segment_ids
+  expected_result.push_back(std::vector(kBucketSize, 0));
+  // input_masks
+  expected_result.push_back(std::vector(kBucketSize, 1));
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::vector<int>> processed_tensor_values,
+      RunBertPreprocessorCalculator(
+          "it's a charming and often affecting journey and this is a long long "
+          "long movie review",
+          kTestModelPath, /*has_dynamic_input_tensors=*/true, kBucketSize,
+          /*seq_len_buckets=*/{8, kBucketSize}));
+  EXPECT_THAT(processed_tensor_values, ElementsAreArray(expected_result));
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -20,6 +21,7 @@
 #include "absl/log/absl_log.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_calculator.pb.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_yuv.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/api2/packet.h"
@@ -29,6 +31,7 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/memory_manager.h"
 #include "mediapipe/framework/memory_manager_service.h"
 #include "mediapipe/framework/port.h"
@@ -47,7 +50,11 @@
 #endif
 
 #if !MEDIAPIPE_DISABLE_GPU
+#include "mediapipe/framework/formats/frame_buffer.h"
+#include "mediapipe/gpu/frame_buffer_view.h"
 #include "mediapipe/gpu/gpu_buffer.h"
+#include "mediapipe/gpu/gpu_buffer_format.h"
+#include "mediapipe/gpu/gpu_buffer_storage_yuv_image.h"
 
 #if MEDIAPIPE_METAL_ENABLED
 #include "mediapipe/calculators/tensor/image_to_tensor_converter_metal.h"
@@ -79,14 +86,20 @@ namespace api2 {
 //           ImageFrame [ImageFormat::SRGB/SRGBA] (for backward compatibility
 //           with existing graphs that use IMAGE for ImageFrame input)
 //   IMAGE_GPU - GpuBuffer [GpuBufferFormat::kBGRA32]
+//   YUV_IMAGE - YUVImage [8-bit NV12, NV21, YV12 or I420]
 //     Image to extract from.
 //
 //   Note:
-//   - One and only one of IMAGE and IMAGE_GPU should be specified.
+//   - One and only one of IMAGE, IMAGE_GPU and YUV_IMAGE should be specified.
 //   - IMAGE input of type Image is processed on GPU if the data is already on
 //     GPU (i.e., Image::UsesGpu() returns true), or otherwise processed on CPU.
+//     A CPU Image backed by a YUV 4:2:0 buffer, or an Image wrapping a
+//     YUVImage, is handled like YUV_IMAGE.
 //   - IMAGE input of type ImageFrame is always processed on CPU.
 //   - IMAGE_GPU input (of type GpuBuffer) is always processed on GPU.
+//   - YUV_IMAGE input is always processed on CPU. Only the pixels sampled for
+//     the output tensor are converted to RGB, so there is no need for a
+//     YUVToImageCalculator in front of this calculator.
 //
 //   NORM_RECT - NormalizedRect @Optional
 //     Describes region of image to extract.
@@ -137,6 +150,7 @@ class ImageToTensorCalculator : public Node {
   static constexpr Input<
       OneOf<mediapipe::Image, mediapipe::ImageFrame>>::Optional kIn{"IMAGE"};
   static constexpr Input<GpuBuffer>::Optional kInGpu{"IMAGE_GPU"};
+  static constexpr Input<YUVImage>::Optional kInYuv{"YUV_IMAGE"};
   static constexpr Input<mediapipe::NormalizedRect>::Optional kInNormRect{
       "NORM_RECT"};
   static constexpr Output<std::vector<Tensor>>::Optional kOutTensors{"TENSORS"};
@@ -145,16 +159,19 @@ class ImageToTensorCalculator : public Node {
       "LETTERBOX_PADDING"};
   static constexpr Output<std::array<float, 16>>::Optional kOutMatrix{"MATRIX"};
 
-  MEDIAPIPE_NODE_CONTRACT(kIn, kInGpu, kInNormRect, kOutTensors, kOutTensor,
-                          kOutLetterboxPadding, kOutMatrix);
+  MEDIAPIPE_NODE_CONTRACT(kIn, kInGpu, kInYuv, kInNormRect, kOutTensors,
+                          kOutTensor, kOutLetterboxPadding, kOutMatrix);
 
   static absl::Status UpdateContract(CalculatorContract* cc) {
     const auto& options =
         cc->Options<mediapipe::ImageToTensorCalculatorOptions>();
 
     RET_CHECK_OK(ValidateOptionOutputDims(options));
-    RET_CHECK(kIn(cc).IsConnected() ^ kInGpu(cc).IsConnected())
-        << "One and only one of IMAGE and IMAGE_GPU input is expected.";
+    RET_CHECK_EQ(kIn(cc).IsConnected() + kInGpu(cc).IsConnected() +
+                     kInYuv(cc).IsConnected(),
+                 1)
+        << "One and only one of IMAGE, IMAGE_GPU and YUV_IMAGE input is "
+           "expected.";
     RET_CHECK(kOutTensors(cc).IsConnected() ^ kOutTensor(cc).IsConnected())
         << "One and only one of TENSORS and TENSOR output is supported.";
 
@@ -189,7 +206,8 @@ class ImageToTensorCalculator : public Node {
 
   absl::Status Process(CalculatorContext* cc) {
     if ((kIn(cc).IsConnected() && kIn(cc).IsEmpty()) ||
-        (kInGpu(cc).IsConnected() && kInGpu(cc).IsEmpty())) {
+        (kInGpu(cc).IsConnected() && kInGpu(cc).IsEmpty()) ||
+        (kInYuv(cc).IsConnected() && kInYuv(cc).IsEmpty())) {
       // Timestamp bound update happens automatically.
       return absl::OkStatus();
     }
@@ -213,17 +231,94 @@ class ImageToTensorCalculator : public Node {
       }
     }
 
+    if (kInYuv(cc).IsConnected()) {
+      const YUVImage& yuv_image = *kInYuv(cc);
+      return ProcessYuv(cc, norm_rect, yuv_image.width(), yuv_image.height(),
+                        [&yuv_image](YuvToTensorConverter& converter,
+                                     const RotatedRect& roi, float range_min,
+                                     float range_max, Tensor& tensor) {
+                          return converter.Convert(yuv_image, roi, range_min,
+                                                   range_max,
+                                                   /*tensor_buffer_offset=*/0,
+                                                   tensor);
+                        });
+    }
+
 #if MEDIAPIPE_DISABLE_GPU
     MP_ASSIGN_OR_RETURN(auto image, GetInputImage(kIn(cc)));
 #else
     const bool is_input_gpu = kInGpu(cc).IsConnected();
     MP_ASSIGN_OR_RETURN(auto image, is_input_gpu ? GetInputImage(kInGpu(cc))
                                                  : GetInputImage(kIn(cc)));
+    const GpuBuffer gpu_buffer = image->GetGpuBuffer(/*upload_to_gpu=*/false);
+    // An Image made from a GpuBuffer reports UsesGpu() even when the buffer
+    // wraps a YUVImage in CPU memory. Its YUVImage view is preferred over the
+    // FrameBuffer one as FrameBuffer has no color range.
+    if (gpu_buffer.internal_storage<GpuBufferStorageYuvImage>()) {
+      return ProcessYuv(
+          cc, norm_rect, image->width(), image->height(),
+          [&gpu_buffer](YuvToTensorConverter& converter, const RotatedRect& roi,
+                        float range_min, float range_max, Tensor& tensor) {
+            auto yuv_image = gpu_buffer.GetReadView<YUVImage>();
+            return converter.Convert(*yuv_image, roi, range_min, range_max,
+                                     /*tensor_buffer_offset=*/0, tensor);
+          });
+    }
+    if (!image->UsesGpu() && IsYuvFormat(image->format())) {
+      return ProcessYuv(
+          cc, norm_rect, image->width(), image->height(),
+          [&gpu_buffer](YuvToTensorConverter& converter, const RotatedRect& roi,
+                        float range_min, float range_max, Tensor& tensor) {
+            auto frame_buffer = gpu_buffer.GetReadView<FrameBuffer>();
+            return converter.Convert(*frame_buffer, roi, range_min, range_max,
+                                     /*tensor_buffer_offset=*/0, tensor);
+          });
+    }
 #endif  // MEDIAPIPE_DISABLE_GPU
 
-    RotatedRect roi = GetRoi(image->width(), image->height(), norm_rect);
-    const int tensor_width = params_.output_width.value_or(image->width());
-    const int tensor_height = params_.output_height.value_or(image->height());
+    MP_ASSIGN_OR_RETURN(RotatedRect roi,
+                        GetPaddedRoi(cc, image->width(), image->height(),
+                                     norm_rect));
+
+    // Lazy initialization of the GPU or CPU converter.
+    MP_RETURN_IF_ERROR(InitConverterIfNecessary(cc, *image.get()));
+
+    Tensor::ElementType output_tensor_type =
+        GetOutputTensorType(image->UsesGpu(), params_);
+    Tensor tensor(output_tensor_type,
+                  {1, params_.output_height.value_or(image->height()),
+                   params_.output_width.value_or(image->width()),
+                   GetNumOutputChannels(*image)},
+                  memory_manager_);
+    MP_RETURN_IF_ERROR((image->UsesGpu() ? gpu_converter_ : cpu_converter_)
+                           ->Convert(*image, roi, params_.range_min,
+                                     params_.range_max,
+                                     /*tensor_buffer_offset=*/0, tensor));
+    SendTensor(cc, std::move(tensor));
+    return absl::OkStatus();
+  }
+
+ private:
+  using YuvConvertFn = std::function<absl::Status(
+      YuvToTensorConverter& converter, const RotatedRect& roi, float range_min,
+      float range_max, Tensor& tensor)>;
+
+#if !MEDIAPIPE_DISABLE_GPU
+  static bool IsYuvFormat(GpuBufferFormat format) {
+    return format == GpuBufferFormat::kNV12 ||
+           format == GpuBufferFormat::kNV21 ||
+           format == GpuBufferFormat::kI420 || format == GpuBufferFormat::kYV12;
+  }
+#endif  // !MEDIAPIPE_DISABLE_GPU
+
+  // Computes the ROI for an image of the given size, padded according to the
+  // options, and sends the LETTERBOX_PADDING and MATRIX outputs.
+  absl::StatusOr<RotatedRect> GetPaddedRoi(
+      CalculatorContext* cc, int image_width, int image_height,
+      const absl::optional<mediapipe::NormalizedRect>& norm_rect) {
+    RotatedRect roi = GetRoi(image_width, image_height, norm_rect);
+    const int tensor_width = params_.output_width.value_or(image_width);
+    const int tensor_height = params_.output_height.value_or(image_height);
     MP_ASSIGN_OR_RETURN(auto padding,
                         PadRoi(tensor_width, tensor_height,
                                options_.keep_aspect_ratio(), &roi));
@@ -233,25 +328,38 @@ class ImageToTensorCalculator : public Node {
     if (kOutMatrix(cc).IsConnected()) {
       std::array<float, 16> matrix;
       GetRotatedSubRectToRectTransformMatrix(
-          roi, image->width(), image->height(),
+          roi, image_width, image_height,
           /*flip_horizontally=*/false, &matrix);
       kOutMatrix(cc).Send(std::move(matrix));
     }
+    return roi;
+  }
 
-    // Lazy initialization of the GPU or CPU converter.
-    MP_RETURN_IF_ERROR(InitConverterIfNecessary(cc, *image.get()));
-
-    Tensor::ElementType output_tensor_type =
-        GetOutputTensorType(image->UsesGpu(), params_);
-    Tensor tensor(
-        output_tensor_type,
-        {1, tensor_height, tensor_width, GetNumOutputChannels(*image)},
-        memory_manager_);
-    MP_RETURN_IF_ERROR((image->UsesGpu() ? gpu_converter_ : cpu_converter_)
-                           ->Convert(*image, roi, params_.range_min,
-                                     params_.range_max,
-                                     /*tensor_buffer_offset=*/0, tensor));
+  // Converts a YUV 4:2:0 image straight into an RGB tensor on CPU.
+  absl::Status ProcessYuv(
+      CalculatorContext* cc,
+      const absl::optional<mediapipe::NormalizedRect>& norm_rect,
+      int image_width, int image_height, const YuvConvertFn& convert) {
+    MP_ASSIGN_OR_RETURN(RotatedRect roi, GetPaddedRoi(cc, image_width,
+                                                      image_height, norm_rect));
+    if (!yuv_converter_) {
+      MP_ASSIGN_OR_RETURN(
+          yuv_converter_,
+          CreateYuvToTensorConverter(
+              GetBorderMode(options_.border_mode()),
+              GetOutputTensorType(/*uses_gpu=*/false, params_)));
+    }
+    Tensor tensor(GetOutputTensorType(/*uses_gpu=*/false, params_),
+                  {1, params_.output_height.value_or(image_height),
+                   params_.output_width.value_or(image_width), 3},
+                  memory_manager_);
+    MP_RETURN_IF_ERROR(convert(*yuv_converter_, roi, params_.range_min,
+                               params_.range_max, tensor));
+    SendTensor(cc, std::move(tensor));
+    return absl::OkStatus();
+  }
 
+  void SendTensor(CalculatorContext* cc, Tensor tensor) {
     if (kOutTensors(cc).IsConnected()) {
       auto result = std::make_unique<std::vector<Tensor>>();
       result->push_back(std::move(tensor));
@@ -259,10 +367,8 @@ class ImageToTensorCalculator : public Node {
     } else {
       kOutTensor(cc).Send(std::move(tensor));
     }
-    return absl::OkStatus();
   }
 
- private:
   absl::Status InitConverterIfNecessary(CalculatorContext* cc,
                                         const Image& image) {
     // Lazy initialization of the GPU or CPU converter.
@@ -338,6 +444,7 @@ class ImageToTensorCalculator : public Node {
 
   std::unique_ptr<ImageToTensorConverter> gpu_converter_;
   std::unique_ptr<ImageToTensorConverter> cpu_converter_;
+  std::unique_ptr<YuvToTensorConverter> yuv_converter_;
   mediapipe::ImageToTensorCalculatorOptions options_;
   OutputTensorParams params_;
   MemoryManager* memory_manager_ = nullptr;
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -35,11 +36,19 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/util/image_test_utils.h"
+#include "libyuv/video_common.h"
+
+#if !MEDIAPIPE_DISABLE_GPU
+#include "mediapipe/gpu/gpu_buffer.h"
+#include "mediapipe/gpu/gpu_buffer_storage_yuv_image.h"
+#endif  // !MEDIAPIPE_DISABLE_GPU
 
 #if !MEDIAPIPE_DISABLE_GPU && !MEDIAPIPE_METAL_ENABLED
 #include "mediapipe/gpu/gl_context.h"
@@ -557,6 +566,115 @@ TEST(ImageToTensorCalculatorTest, CanBeUsedWithoutGpuServiceSet) {
   MP_ASSERT_OK(graph.WaitUntilDone());
 }
 
+// Creates a 4x2 I420 image with the luma row `luma` repeated and neutral
+// chroma, so every channel of its RGB conversion is the same.
+std::unique_ptr<YUVImage> MakeGrayI420Image(const std::vector<uint8_t>& luma,
+                                            bool full_range) {
+  constexpr int kWidth = 4;
+  constexpr int kHeight = 2;
+  ABSL_CHECK_EQ(luma.size(), kWidth);
+  auto y = std::make_unique<uint8_t[]>(kWidth * kHeight);
+  for (int i = 0; i < kWidth * kHeight; ++i) y[i] = luma[i % kWidth];
+  auto u = std::make_unique<uint8_t[]>(kWidth / 2 * kHeight / 2);
+  auto v = std::make_unique<uint8_t[]>(kWidth / 2 * kHeight / 2);
+  std::fill_n(u.get(), kWidth / 2 * kHeight / 2, 128);
+  std::fill_n(v.get(), kWidth / 2 * kHeight / 2, 128);
+  auto image = std::make_unique<YUVImage>(
+      libyuv::FOURCC_I420, std::move(y), kWidth, std::move(u), kWidth / 2,
+      std::move(v), kWidth / 2, kWidth, kHeight);
+  image->set_full_range(full_range);
+  return image;
+}
+
+// Runs the calculator on `input_packet` sent to its `input_tag` input, with
+// an output range of [0, 255], and returns the channels of the output tensor.
+std::vector<uint8_t> RunWithUInt8Output(absl::string_view input_tag,
+                                        const Packet& input_packet) {
+  auto graph_config = mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(
+      absl::Substitute(R"pb(
+                         input_stream: "input_image"
+                         node {
+                           calculator: "ImageToTensorCalculator"
+                           input_stream: "$0:input_image"
+                           output_stream: "TENSORS:tensor"
+                           options {
+                             [mediapipe.ImageToTensorCalculatorOptions.ext] {
+                               output_tensor_uint_range { min: 0 max: 255 }
+                             }
+                           }
+                         }
+                       )pb",
+                       input_tag));
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor", &graph_config, &output_packets);
+  CalculatorGraph graph;
+  ABSL_CHECK_OK(graph.Initialize(graph_config));
+  ABSL_CHECK_OK(graph.StartRun({}));
+  ABSL_CHECK_OK(graph.AddPacketToInputStream("input_image",
+                                             input_packet.At(Timestamp(0))));
+  ABSL_CHECK_OK(graph.WaitUntilIdle());
+  ABSL_CHECK_EQ(output_packets.size(), 1);
+
+  const Tensor& tensor = output_packets[0].Get<std::vector<Tensor>>()[0];
+  ABSL_CHECK(tensor.element_type() == Tensor::ElementType::kUInt8);
+  auto view = tensor.GetCpuReadView();
+  const uint8_t* data = view.buffer<uint8_t>();
+  std::vector<uint8_t> channels(data, data + tensor.shape().num_elements());
+
+  ABSL_CHECK_OK(graph.CloseAllPacketSources());
+  ABSL_CHECK_OK(graph.WaitUntilDone());
+  return channels;
+}
+
+// Returns the channels of a 4x2 RGB image with the `row` gray levels repeated.
+std::vector<uint8_t> GetGrayRgbChannels(const std::vector<uint8_t>& row) {
+  std::vector<uint8_t> channels;
+  for (int y = 0; y < 2; ++y) {
+    for (uint8_t value : row) channels.insert(channels.end(), 3, value);
+  }
+  return channels;
+}
+
+TEST(ImageToTensorCalculatorTest, ConvertsFullRangeYuvImage) {
+  std::unique_ptr<YUVImage> image =
+      MakeGrayI420Image({0, 50, 100, 255}, /*full_range=*/true);
+
+  std::vector<uint8_t> channels =
+      RunWithUInt8Output("YUV_IMAGE", Adopt(image.release()));
+
+  EXPECT_THAT(channels,
+              testing::ElementsAreArray(GetGrayRgbChannels({0, 50, 100, 255})));
+}
+
+TEST(ImageToTensorCalculatorTest, ConvertsLimitedRangeYuvImage) {
+  // The BT.601 limited range maps luma [16, 235] to [0, 255].
+  std::unique_ptr<YUVImage> image =
+      MakeGrayI420Image({16, 16, 235, 235}, /*full_range=*/false);
+
+  std::vector<uint8_t> channels =
+      RunWithUInt8Output("YUV_IMAGE", Adopt(image.release()));
+
+  EXPECT_THAT(channels,
+              testing::ElementsAreArray(GetGrayRgbChannels({0, 0, 255, 255})));
+}
+
+#if !MEDIAPIPE_DISABLE_GPU
+
+TEST(ImageToTensorCalculatorTest, ConvertsImageWrappingYuvImage) {
+  // Such an Image reports UsesGpu(), but is converted on CPU with the range
+  // of its YUVImage.
+  Image image(GpuBuffer(std::make_shared<GpuBufferStorageYuvImage>(
+      MakeGrayI420Image({16, 16, 235, 235}, /*full_range=*/false))));
+
+  std::vector<uint8_t> channels =
+      RunWithUInt8Output("IMAGE", MakePacket<Image>(std::move(image)));
+
+  EXPECT_THAT(channels,
+              testing::ElementsAreArray(GetGrayRgbChannels({0, 0, 255, 255})));
+}
+
+#endif  // !MEDIAPIPE_DISABLE_GPU
+
 #if !MEDIAPIPE_DISABLE_GPU && !MEDIAPIPE_METAL_ENABLED
 
 TEST(ImageToTensorCalculatorTest,
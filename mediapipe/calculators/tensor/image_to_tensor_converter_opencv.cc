@@ -20,6 +20,7 @@
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_fused_kernel.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image.h"
@@ -130,6 +131,18 @@ class ImageToTensorOpenCvConverter : public ImageToTensorConverter {
             absl::StrCat("Unsupported tensor type: ", tensor_type_));
     }
 
+    constexpr float kInputImageRangeMin = 0.0f;
+    constexpr float kInputImageRangeMax = 255.0f;
+    MP_ASSIGN_OR_RETURN(
+        auto transform,
+        GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
+                                    range_min, range_max));
+
+    auto src = mediapipe::formats::MatView(&input);
+    if (flags_ == cv::INTER_LINEAR || flags_ == cv::INTER_NEAREST) {
+      return ConvertFused(input, *src, roi, transform, dst);
+    }
+
     const cv::RotatedRect rotated_rect(cv::Point2f(roi.center_x, roi.center_y),
                                        cv::Size2f(roi.width, roi.height),
                                        roi.rotation * 180.f / M_PI);
@@ -145,7 +158,6 @@ class ImageToTensorOpenCvConverter : public ImageToTensorConverter {
                             dst_width, dst_height};
     /* clang-format on */
 
-    auto src = mediapipe::formats::MatView(&input);
     cv::Mat dst_points = cv::Mat(4, 2, CV_32F, dst_corners);
     cv::Mat projection_matrix =
         cv::getPerspectiveTransform(src_points, dst_points);
@@ -161,18 +173,60 @@ class ImageToTensorOpenCvConverter : public ImageToTensorConverter {
       transformed = proper_channels_mat;
     }
 
-    constexpr float kInputImageRangeMin = 0.0f;
-    constexpr float kInputImageRangeMax = 255.0f;
-    MP_ASSIGN_OR_RETURN(
-        auto transform,
-        GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
-                                    range_min, range_max));
     transformed.convertTo(dst, dst_data_type, transform.scale,
                           transform.offset);
     return absl::OkStatus();
   }
 
  private:
+  // Crops, rotates, resizes and normalizes straight into the tensor buffer
+  // without intermediate images, see FusedImageToTensorKernel.
+  absl::Status ConvertFused(const mediapipe::Image& input, const cv::Mat& src,
+                            const RotatedRect& roi,
+                            const ValueTransformation& transform,
+                            cv::Mat& dst) {
+    FusedSourceImage source;
+    switch (input.image_format()) {
+      case mediapipe::ImageFormat::SRGB:
+        source.format = FusedSourceFormat::kRgb;
+        break;
+      case mediapipe::ImageFormat::SRGBA:
+        source.format = FusedSourceFormat::kRgba;
+        break;
+      default:
+        source.format = FusedSourceFormat::kGray;
+        break;
+    }
+    source.width = src.cols;
+    source.height = src.rows;
+    source.data = src.data;
+    source.row_stride = static_cast<int>(src.step[0]);
+
+    FusedOutputSpec spec;
+    spec.width = dst.cols;
+    spec.height = dst.rows;
+    spec.channels = dst.channels();
+    spec.border_mode = border_mode_ == cv::BORDER_CONSTANT
+                           ? BorderMode::kZero
+                           : BorderMode::kReplicate;
+    spec.interpolation = flags_ == cv::INTER_NEAREST
+                             ? FusedInterpolation::kNearest
+                             : FusedInterpolation::kBilinear;
+    spec.align_pixel_centers = false;
+    spec.transform = transform;
+    switch (tensor_type_) {
+      case Tensor::ElementType::kInt8:
+        return fused_kernel_.Run(source, roi, spec, dst.ptr<int8_t>());
+      case Tensor::ElementType::kFloat32:
+        return fused_kernel_.Run(source, roi, spec, dst.ptr<float>());
+      case Tensor::ElementType::kUInt8:
+        return fused_kernel_.Run(source, roi, spec, dst.ptr<uint8_t>());
+      default:
+        return absl::InvalidArgumentError(
+            absl::StrCat("Unsupported tensor type: ", tensor_type_));
+    }
+  }
+
   absl::Status ValidateTensorShape(const Tensor::Shape& output_shape) {
     RET_CHECK_EQ(output_shape.dims.size(), 4)
         << "Wrong output dims size: " << output_shape.dims.size();
@@ -188,6 +242,7 @@ class ImageToTensorOpenCvConverter : public ImageToTensorConverter {
   cv::InterpolationFlags flags_;
   int mat_type_;
   int mat_gray_type_;
+  FusedImageToTensorKernel fused_kernel_;
 };
 
 }  // namespace
@@ -0,0 +1,146 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_yuv.h"
+
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "libyuv/video_common.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_fused_kernel.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/frame_buffer.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+
+absl::StatusOr<FusedSourceImage> GetFusedSourceImage(
+    const YUVImage& yuv_image) {
+  RET_CHECK_EQ(yuv_image.bit_depth(), 8)
+      << "Only 8-bit YUVImage is supported.";
+  FusedSourceImage source;
+  source.format = FusedSourceFormat::kYuv;
+  source.width = yuv_image.width();
+  source.height = yuv_image.height();
+  source.data = yuv_image.data(0);
+  source.row_stride = yuv_image.stride(0);
+  // Decoders and libyuv based converters produce limited range samples
+  // unless told otherwise.
+  source.yuv_limited_range = !yuv_image.full_range();
+  switch (yuv_image.fourcc()) {
+    case libyuv::FOURCC_NV12:
+      // Interleaved U/V plane.
+      source.u_data = yuv_image.data(1);
+      source.v_data = yuv_image.data(1) + 1;
+      source.uv_row_stride = yuv_image.stride(1);
+      source.uv_pixel_stride = 2;
+      break;
+    case libyuv::FOURCC_NV21:
+      // Interleaved V/U plane.
+      source.u_data = yuv_image.data(1) + 1;
+      source.v_data = yuv_image.data(1);
+      source.uv_row_stride = yuv_image.stride(1);
+      source.uv_pixel_stride = 2;
+      break;
+    case libyuv::FOURCC_I420:
+      source.u_data = yuv_image.data(1);
+      source.v_data = yuv_image.data(2);
+      source.uv_row_stride = yuv_image.stride(1);
+      source.uv_pixel_stride = 1;
+      break;
+    case libyuv::FOURCC_YV12:
+      source.u_data = yuv_image.data(2);
+      source.v_data = yuv_image.data(1);
+      source.uv_row_stride = yuv_image.stride(1);
+      source.uv_pixel_stride = 1;
+      break;
+    default:
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Unsupported YUVImage format: %d. Only NV12, NV21, YV12 and I420 "
+          "(aka YV21) are supported.",
+          static_cast<int>(yuv_image.fourcc())));
+  }
+  if (source.uv_pixel_stride == 1) {
+    RET_CHECK_EQ(yuv_image.stride(1), yuv_image.stride(2))
+        << "U and V planes must have the same stride.";
+  }
+  return source;
+}
+
+absl::Status YuvToTensorConverter::Convert(const YUVImage& input,
+                                           const RotatedRect& roi,
+                                           float range_min, float range_max,
+                                           int tensor_buffer_offset,
+                                           Tensor& output_tensor) {
+  MP_ASSIGN_OR_RETURN(FusedSourceImage source, GetFusedSourceImage(input));
+  return Convert(source, roi, range_min, range_max, tensor_buffer_offset,
+                 output_tensor);
+}
+
+absl::Status YuvToTensorConverter::Convert(const FrameBuffer& input,
+                                           const RotatedRect& roi,
+                                           float range_min, float range_max,
+                                           int tensor_buffer_offset,
+                                           Tensor& output_tensor) {
+  MP_ASSIGN_OR_RETURN(FusedSourceImage source, GetFusedSourceImage(input));
+  RET_CHECK(source.format == FusedSourceFormat::kYuv)
+      << "Expected a FrameBuffer in one of the YUV 4:2:0 formats.";
+  return Convert(source, roi, range_min, range_max, tensor_buffer_offset,
+                 output_tensor);
+}
+
+absl::Status YuvToTensorConverter::Convert(const FusedSourceImage& source,
+                                           const RotatedRect& roi,
+                                           float range_min, float range_max,
+                                           int tensor_buffer_offset,
+                                           Tensor& output_tensor) {
+  RET_CHECK(output_tensor.element_type() == tensor_type_);
+  const auto& output_shape = output_tensor.shape();
+  RET_CHECK(output_shape.dims.size() == 4 &&
+            (output_shape.dims[3] == 3 || output_shape.dims[3] == 1))
+      << "Expected a BHWC tensor with 1 or 3 channels.";
+
+  constexpr float kInputImageRangeMin = 0.0f;
+  constexpr float kInputImageRangeMax = 255.0f;
+  MP_ASSIGN_OR_RETURN(
+      auto transform,
+      GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
+                                  range_min, range_max));
+  FusedOutputSpec spec;
+  spec.border_mode = border_mode_;
+  spec.transform = transform;
+  return fused_kernel_.Run(source, roi, spec, tensor_buffer_offset,
+                           output_tensor);
+}
+
+absl::StatusOr<std::unique_ptr<YuvToTensorConverter>>
+CreateYuvToTensorConverter(BorderMode border_mode,
+                           Tensor::ElementType tensor_type) {
+  if (tensor_type != Tensor::ElementType::kUInt8 &&
+      tensor_type != Tensor::ElementType::kInt8 &&
+      tensor_type != Tensor::ElementType::kFloat32) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Tensor type is currently not supported by "
+                        "YuvToTensorConverter, type: %d.",
+                        static_cast<int>(tensor_type)));
+  }
+  return std::make_unique<YuvToTensorConverter>(border_mode, tensor_type);
+}
+
+}  // namespace mediapipe
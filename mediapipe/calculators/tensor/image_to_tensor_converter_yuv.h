@@ -0,0 +1,66 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_YUV_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_YUV_H_
+
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_fused_kernel.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/frame_buffer.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+
+namespace mediapipe {
+
+// Returns a view of `yuv_image` for the fused kernel. Supports 8-bit NV12,
+// NV21, YV12 and I420 (aka YV21).
+absl::StatusOr<FusedSourceImage> GetFusedSourceImage(const YUVImage& yuv_image);
+
+// Converts YUV 4:2:0 images to tensors. Only the pixels sampled for the
+// output tensor are color converted, so no full resolution RGB image is
+// allocated or written.
+class YuvToTensorConverter {
+ public:
+  YuvToTensorConverter(BorderMode border_mode, Tensor::ElementType tensor_type)
+      : border_mode_(border_mode), tensor_type_(tensor_type) {}
+
+  // Converts image to tensor, see ImageToTensorConverter::Convert.
+  absl::Status Convert(const YUVImage& input, const RotatedRect& roi,
+                       float range_min, float range_max,
+                       int tensor_buffer_offset, Tensor& output_tensor);
+  absl::Status Convert(const FrameBuffer& input, const RotatedRect& roi,
+                       float range_min, float range_max,
+                       int tensor_buffer_offset, Tensor& output_tensor);
+
+ private:
+  absl::Status Convert(const FusedSourceImage& source, const RotatedRect& roi,
+                       float range_min, float range_max,
+                       int tensor_buffer_offset, Tensor& output_tensor);
+
+  BorderMode border_mode_;
+  Tensor::ElementType tensor_type_;
+  FusedImageToTensorKernel fused_kernel_;
+};
+
+absl::StatusOr<std::unique_ptr<YuvToTensorConverter>>
+CreateYuvToTensorConverter(BorderMode border_mode,
+                           Tensor::ElementType tensor_type);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_CONVERTER_YUV_H_
@@ -0,0 +1,102 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter_yuv.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "libyuv/video_common.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+
+constexpr int kWidth = 4;
+constexpr int kHeight = 2;
+
+// Creates a full range I420 image with a horizontal luma ramp and neutral
+// chroma, so every channel of the converted tensor equals the luma.
+std::unique_ptr<YUVImage> CreateGrayI420Image() {
+  auto y = std::make_unique<uint8_t[]>(kWidth * kHeight);
+  for (int i = 0; i < kWidth * kHeight; ++i) y[i] = (i % kWidth) * 50;
+  auto u = std::make_unique<uint8_t[]>(kWidth / 2 * kHeight / 2);
+  auto v = std::make_unique<uint8_t[]>(kWidth / 2 * kHeight / 2);
+  std::memset(u.get(), 128, kWidth / 2 * kHeight / 2);
+  std::memset(v.get(), 128, kWidth / 2 * kHeight / 2);
+  auto image = std::make_unique<YUVImage>(
+      libyuv::FOURCC_I420, std::move(y), kWidth, std::move(u), kWidth / 2,
+      std::move(v), kWidth / 2, kWidth, kHeight);
+  image->set_full_range(true);
+  return image;
+}
+
+TEST(YuvToTensorConverterTest, ConvertsI420WithoutRgbIntermediate) {
+  std::unique_ptr<YUVImage> image = CreateGrayI420Image();
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto converter, CreateYuvToTensorConverter(BorderMode::kReplicate,
+                                                 Tensor::ElementType::kUInt8));
+  Tensor tensor(Tensor::ElementType::kUInt8,
+                Tensor::Shape({1, kHeight, kWidth, 3}));
+  const RotatedRect roi = {/*center_x=*/kWidth / 2.0f,
+                           /*center_y=*/kHeight / 2.0f,
+                           /*width=*/kWidth, /*height=*/kHeight,
+                           /*rotation=*/0.0f};
+
+  MP_ASSERT_OK(converter->Convert(*image, roi, /*range_min=*/0.0f,
+                                  /*range_max=*/255.0f,
+                                  /*tensor_buffer_offset=*/0, tensor));
+
+  std::vector<uint8_t> expected;
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      expected.insert(expected.end(), 3, x * 50);
+    }
+  }
+  auto view = tensor.GetCpuReadView();
+  const uint8_t* data = view.buffer<uint8_t>();
+  EXPECT_THAT(std::vector<uint8_t>(data, data + expected.size()),
+              ElementsAreArray(expected));
+}
+
+TEST(YuvToTensorConverterTest, RejectsUnsupportedFourcc) {
+  // A valid 8-bit I420 image but for its fourcc.
+  std::unique_ptr<YUVImage> image = CreateGrayI420Image();
+  image->set_fourcc(libyuv::FOURCC_ANY);
+  ASSERT_EQ(image->bit_depth(), 8);
+
+  EXPECT_THAT(GetFusedSourceImage(*image),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unsupported YUVImage format")));
+}
+
+TEST(YuvToTensorConverterTest, RejectsUnsupportedTensorType) {
+  EXPECT_FALSE(CreateYuvToTensorConverter(BorderMode::kZero,
+                                          Tensor::ElementType::kInt32)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
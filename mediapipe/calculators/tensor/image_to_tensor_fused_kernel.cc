@@ -0,0 +1,552 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_fused_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/frame_buffer.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Source coordinates of the output pixels within one row. The source pixel
+// (i, j) has its center at (i, j), so the mapping already includes the half
+// pixel shifts on both sides.
+struct RowMapping {
+  float x0;
+  float y0;
+  float dx;
+  float dy;
+};
+
+// Returns the [begin, end) range of k in [0, n) for which
+// lo <= a + k * d < hi holds, shrunk by one element on each side so that
+// floating point error can't push a tap outside of the source.
+void ClipSpan(float a, float d, float lo, float hi, int n, int* begin,
+              int* end) {
+  constexpr float kEps = 1e-6f;
+  if (std::abs(d) < kEps) {
+    if (a >= lo && a < hi) return;
+    *end = *begin;
+    return;
+  }
+  float k_lo = (lo - a) / d;
+  float k_hi = (hi - a) / d;
+  if (d < 0) std::swap(k_lo, k_hi);
+  const float first =
+      std::max(static_cast<float>(*begin), std::ceil(k_lo) + 1);
+  const float last =
+      std::min(static_cast<float>(*end), std::floor(k_hi) - 1);
+  *begin = static_cast<int>(std::min(first, static_cast<float>(n)));
+  *end = std::max(*begin, static_cast<int>(std::max(last, 0.0f)));
+}
+
+inline int Clamp(int v, int lo, int hi) {
+  return std::min(std::max(v, lo), hi);
+}
+
+inline float Lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+// Keeps coordinates far outside of the source within int range. Anything
+// beyond two pixels from the edge samples the border only.
+inline float ClampCoordinate(float v, int max) {
+  return std::clamp(v, -2.0f, max + 2.0f);
+}
+
+// YUV to RGB conversion coefficients:
+//   R = y_scale * (Y - y_offset) + rv * (V - 128)
+//   G = y_scale * (Y - y_offset) - gu * (U - 128) - gv * (V - 128)
+//   B = y_scale * (Y - y_offset) + bu * (U - 128)
+struct YuvCoefficients {
+  float y_offset;
+  float y_scale;
+  float rv;
+  float gu;
+  float gv;
+  float bu;
+};
+
+// Full-range JFIF coefficients, see yuv_rgb_generator.cc.
+constexpr YuvCoefficients kFullRangeYuv = {0.0f,     1.0f,     1.40200f,
+                                           0.34414f, 0.71414f, 1.77200f};
+// Limited-range BT.601 coefficients, as used by libyuv's I420ToRAW & co.
+constexpr YuvCoefficients kLimitedRangeYuv = {16.0f,    1.16438f, 1.59603f,
+                                              0.39176f, 0.81297f, 2.01723f};
+
+inline float YuvToLuma(float y, const YuvCoefficients& coeffs) {
+  return std::clamp(coeffs.y_scale * (y - coeffs.y_offset), 0.0f, 255.0f);
+}
+
+inline void YuvToRgb(float y, float u, float v, const YuvCoefficients& coeffs,
+                     float* rgb) {
+  y = coeffs.y_scale * (y - coeffs.y_offset);
+  u -= 128.0f;
+  v -= 128.0f;
+  rgb[0] = std::clamp(y + coeffs.rv * v, 0.0f, 255.0f);
+  rgb[1] = std::clamp(y - coeffs.gu * u - coeffs.gv * v, 0.0f, 255.0f);
+  rgb[2] = std::clamp(y + coeffs.bu * u, 0.0f, 255.0f);
+}
+
+// Writes `src_channels` sampled values as `dst_channels` values.
+inline void PutPixel(const float* values, int src_channels, int dst_channels,
+                     float* dst) {
+  if (src_channels == 1 && dst_channels == 3) {
+    dst[0] = dst[1] = dst[2] = values[0];
+  } else {
+    for (int c = 0; c < dst_channels; ++c) dst[c] = values[c];
+  }
+}
+
+// Samples interleaved 8-bit pixels with `kChannels` channels. Only the first
+// three channels are read. `kChecked` enables border handling, which is only
+// needed outside of the row interior span.
+template <int kChannels, bool kChecked>
+void SampleInterleaved(const FusedSourceImage& src, const FusedOutputSpec& spec,
+                       const float* xs, const float* ys, int begin, int end,
+                       float* row) {
+  constexpr int kReadChannels = kChannels < 3 ? kChannels : 3;
+  const bool zero_border = spec.border_mode == BorderMode::kZero;
+  const int max_x = src.width - 1;
+  const int max_y = src.height - 1;
+  float values[3];
+  for (int k = begin; k < end; ++k) {
+    float* dst = row + k * spec.channels;
+    float sx = xs[k];
+    float sy = ys[k];
+    if (kChecked) {
+      sx = ClampCoordinate(sx, max_x);
+      sy = ClampCoordinate(sy, max_y);
+    }
+    if (spec.interpolation == FusedInterpolation::kNearest) {
+      int x = static_cast<int>(std::floor(sx + 0.5f));
+      int y = static_cast<int>(std::floor(sy + 0.5f));
+      if (kChecked) {
+        if (zero_border && (x < 0 || x > max_x || y < 0 || y > max_y)) {
+          std::fill(dst, dst + spec.channels, 0.0f);
+          continue;
+        }
+        x = Clamp(x, 0, max_x);
+        y = Clamp(y, 0, max_y);
+      }
+      const uint8_t* p = src.data + y * src.row_stride + x * kChannels;
+      for (int c = 0; c < kReadChannels; ++c) values[c] = p[c];
+      PutPixel(values, kReadChannels, spec.channels, dst);
+      continue;
+    }
+
+    const float fx = std::floor(sx);
+    const float fy = std::floor(sy);
+    const float ax = sx - fx;
+    const float ay = sy - fy;
+    int x0 = static_cast<int>(fx);
+    int y0 = static_cast<int>(fy);
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+    // Weight of each tap, zeroed for taps outside of the source when the
+    // border is zero.
+    float w0x = 1.0f, w1x = 1.0f, w0y = 1.0f, w1y = 1.0f;
+    if (kChecked) {
+      if (zero_border) {
+        if (x0 < 0 || x0 > max_x) w0x = 0.0f;
+        if (x1 < 0 || x1 > max_x) w1x = 0.0f;
+        if (y0 < 0 || y0 > max_y) w0y = 0.0f;
+        if (y1 < 0 || y1 > max_y) w1y = 0.0f;
+      }
+      x0 = Clamp(x0, 0, max_x);
+      x1 = Clamp(x1, 0, max_x);
+      y0 = Clamp(y0, 0, max_y);
+      y1 = Clamp(y1, 0, max_y);
+    }
+    const uint8_t* r0 = src.data + y0 * src.row_stride;
+    const uint8_t* r1 = src.data + y1 * src.row_stride;
+    const uint8_t* p00 = r0 + x0 * kChannels;
+    const uint8_t* p01 = r0 + x1 * kChannels;
+    const uint8_t* p10 = r1 + x0 * kChannels;
+    const uint8_t* p11 = r1 + x1 * kChannels;
+    for (int c = 0; c < kReadChannels; ++c) {
+      const float top = Lerp(p00[c] * w0x, p01[c] * w1x, ax) * w0y;
+      const float bottom = Lerp(p10[c] * w0x, p11[c] * w1x, ax) * w1y;
+      values[c] = Lerp(top, bottom, ay);
+    }
+    PutPixel(values, kReadChannels, spec.channels, dst);
+  }
+}
+
+// Samples a YUV 4:2:0 source. Luma is sampled at the requested position and
+// chroma at the matching half resolution position, then the pair is converted
+// to RGB (or just luma is emitted for single channel outputs).
+template <bool kChecked>
+void SampleYuv(const FusedSourceImage& src, const FusedOutputSpec& spec,
+               const float* xs, const float* ys, int begin, int end,
+               float* row) {
+  const bool zero_border = spec.border_mode == BorderMode::kZero;
+  const bool nearest = spec.interpolation == FusedInterpolation::kNearest;
+  const int max_x = src.width - 1;
+  const int max_y = src.height - 1;
+  const int max_uv_x = (src.width + 1) / 2 - 1;
+  const int max_uv_y = (src.height + 1) / 2 - 1;
+  const YuvCoefficients& coeffs =
+      src.yuv_limited_range ? kLimitedRangeYuv : kFullRangeYuv;
+  auto chroma = [&](const uint8_t* plane, int x, int y) -> float {
+    return plane[y * src.uv_row_stride + x * src.uv_pixel_stride];
+  };
+  for (int k = begin; k < end; ++k) {
+    float* dst = row + k * spec.channels;
+    float sx = xs[k];
+    float sy = ys[k];
+    if (kChecked) {
+      sx = ClampCoordinate(sx, max_x);
+      sy = ClampCoordinate(sy, max_y);
+    }
+    float luma;
+    float u;
+    float v;
+    // Fraction of the sample covered by the source, only below 1 next to a
+    // zero border.
+    float coverage = 1.0f;
+    if (nearest) {
+      int x = static_cast<int>(std::floor(sx + 0.5f));
+      int y = static_cast<int>(std::floor(sy + 0.5f));
+      if (kChecked) {
+        if (zero_border && (x < 0 || x > max_x || y < 0 || y > max_y)) {
+          std::fill(dst, dst + spec.channels, 0.0f);
+          continue;
+        }
+        x = Clamp(x, 0, max_x);
+        y = Clamp(y, 0, max_y);
+      }
+      luma = src.data[y * src.row_stride + x];
+      u = chroma(src.u_data, x / 2, y / 2);
+      v = chroma(src.v_data, x / 2, y / 2);
+    } else {
+      const float fx = std::floor(sx);
+      const float fy = std::floor(sy);
+      const float ax = sx - fx;
+      const float ay = sy - fy;
+      int x0 = static_cast<int>(fx);
+      int y0 = static_cast<int>(fy);
+      int x1 = x0 + 1;
+      int y1 = y0 + 1;
+      float w0x = 1.0f, w1x = 1.0f, w0y = 1.0f, w1y = 1.0f;
+      if (kChecked) {
+        if (zero_border) {
+          if (x0 < 0 || x0 > max_x) w0x = 0.0f;
+          if (x1 < 0 || x1 > max_x) w1x = 0.0f;
+          if (y0 < 0 || y0 > max_y) w0y = 0.0f;
+          if (y1 < 0 || y1 > max_y) w1y = 0.0f;
+          coverage = Lerp(w0x, w1x, ax) * Lerp(w0y, w1y, ay);
+          if (coverage <= 0.0f) {
+            std::fill(dst, dst + spec.channels, 0.0f);
+            continue;
+          }
+        }
+        x0 = Clamp(x0, 0, max_x);
+        x1 = Clamp(x1, 0, max_x);
+        y0 = Clamp(y0, 0, max_y);
+        y1 = Clamp(y1, 0, max_y);
+      }
+      const uint8_t* r0 = src.data + y0 * src.row_stride;
+      const uint8_t* r1 = src.data + y1 * src.row_stride;
+      const float top = Lerp(r0[x0] * w0x, r0[x1] * w1x, ax) * w0y;
+      const float bottom = Lerp(r1[x0] * w0x, r1[x1] * w1x, ax) * w1y;
+      // Normalize by coverage so that chroma is applied to the luma of the
+      // covered taps only; the result is scaled back down below.
+      luma = Lerp(top, bottom, ay) / coverage;
+      if (spec.channels == 1) {
+        dst[0] = YuvToLuma(luma, coeffs) * coverage;
+        continue;
+      }
+
+      // Chroma sample j covers luma pixels 2j and 2j + 1.
+      const float cx = std::max((sx - 0.5f) * 0.5f, 0.0f);
+      const float cy = std::max((sy - 0.5f) * 0.5f, 0.0f);
+      const float fcx = std::floor(cx);
+      const float fcy = std::floor(cy);
+      const float acx = cx - fcx;
+      const float acy = cy - fcy;
+      const int cx0 = std::min(static_cast<int>(fcx), max_uv_x);
+      const int cy0 = std::min(static_cast<int>(fcy), max_uv_y);
+      const int cx1 = std::min(cx0 + 1, max_uv_x);
+      const int cy1 = std::min(cy0 + 1, max_uv_y);
+      u = Lerp(Lerp(chroma(src.u_data, cx0, cy0), chroma(src.u_data, cx1, cy0),
+                    acx),
+               Lerp(chroma(src.u_data, cx0, cy1), chroma(src.u_data, cx1, cy1),
+                    acx),
+               acy);
+      v = Lerp(Lerp(chroma(src.v_data, cx0, cy0), chroma(src.v_data, cx1, cy0),
+                    acx),
+               Lerp(chroma(src.v_data, cx0, cy1), chroma(src.v_data, cx1, cy1),
+                    acx),
+               acy);
+    }
+    if (spec.channels == 1) {
+      dst[0] = YuvToLuma(luma, coeffs);
+      continue;
+    }
+    YuvToRgb(luma, u, v, coeffs, dst);
+    if (coverage < 1.0f) {
+      dst[0] *= coverage;
+      dst[1] *= coverage;
+      dst[2] *= coverage;
+    }
+  }
+}
+
+// Samples output pixels [begin, end) of a row into `row`.
+template <bool kChecked>
+void SampleSpan(const FusedSourceImage& src, const FusedOutputSpec& spec,
+                const float* xs, const float* ys, int begin, int end,
+                float* row) {
+  if (begin >= end) return;
+  switch (src.format) {
+    case FusedSourceFormat::kGray:
+      SampleInterleaved<1, kChecked>(src, spec, xs, ys, begin, end, row);
+      break;
+    case FusedSourceFormat::kRgb:
+      SampleInterleaved<3, kChecked>(src, spec, xs, ys, begin, end, row);
+      break;
+    case FusedSourceFormat::kRgba:
+      SampleInterleaved<4, kChecked>(src, spec, xs, ys, begin, end, row);
+      break;
+    case FusedSourceFormat::kYuv:
+      SampleYuv<kChecked>(src, spec, xs, ys, begin, end, row);
+      break;
+  }
+}
+
+// Normalizes a sampled row and stores it into the output. Kept free of
+// branches on the element index so that the compiler can vectorize it.
+void StoreRow(const float* row, int size, const ValueTransformation& transform,
+              float* output) {
+  const float scale = transform.scale;
+  const float offset = transform.offset;
+  for (int i = 0; i < size; ++i) {
+    output[i] = row[i] * scale + offset;
+  }
+}
+
+template <typename T>
+void StoreRow(const float* row, int size, const ValueTransformation& transform,
+              T* output) {
+  const float scale = transform.scale;
+  const float offset = transform.offset;
+  constexpr float kLowest = std::numeric_limits<T>::lowest();
+  constexpr float kMax = std::numeric_limits<T>::max();
+  for (int i = 0; i < size; ++i) {
+    const float value =
+        std::min(std::max(row[i] * scale + offset, kLowest), kMax);
+    // Round half to even, matching cv::saturate_cast, so that the outputs are
+    // bit-exact with those of the OpenCV converter.
+    output[i] = static_cast<T>(std::lrint(value));
+  }
+}
+
+absl::Status ValidateInputs(const FusedSourceImage& source,
+                            const FusedOutputSpec& spec) {
+  RET_CHECK(source.data != nullptr) << "Source pixels are missing.";
+  RET_CHECK_GT(source.width, 0);
+  RET_CHECK_GT(source.height, 0);
+  RET_CHECK_GT(spec.width, 0);
+  RET_CHECK_GT(spec.height, 0);
+  RET_CHECK(spec.channels == 1 || spec.channels == 3)
+      << "Wrong output channel: " << spec.channels;
+  if (source.format == FusedSourceFormat::kYuv) {
+    RET_CHECK(source.u_data != nullptr && source.v_data != nullptr)
+        << "Chroma planes are missing.";
+  } else if (source.format != FusedSourceFormat::kGray &&
+             spec.channels != 3) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Color source requires 3 output channels, got ",
+                     spec.channels));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<FusedSourceImage> GetFusedSourceImage(
+    const FrameBuffer& frame_buffer) {
+  FusedSourceImage source;
+  source.width = frame_buffer.dimension().width;
+  source.height = frame_buffer.dimension().height;
+  switch (frame_buffer.format()) {
+    case FrameBuffer::Format::kGRAY:
+    case FrameBuffer::Format::kRGB:
+    case FrameBuffer::Format::kRGBA: {
+      const int channels =
+          frame_buffer.format() == FrameBuffer::Format::kGRAY  ? 1
+          : frame_buffer.format() == FrameBuffer::Format::kRGB ? 3
+                                                               : 4;
+      const FrameBuffer::Plane& plane = frame_buffer.plane(0);
+      RET_CHECK_EQ(plane.stride().pixel_stride_bytes, channels)
+          << "Only tightly packed pixels are supported.";
+      source.format = channels == 1   ? FusedSourceFormat::kGray
+                      : channels == 3 ? FusedSourceFormat::kRgb
+                                      : FusedSourceFormat::kRgba;
+      source.data = plane.buffer();
+      source.row_stride = plane.stride().row_stride_bytes;
+      return source;
+    }
+    case FrameBuffer::Format::kNV12:
+    case FrameBuffer::Format::kNV21:
+    case FrameBuffer::Format::kYV12:
+    case FrameBuffer::Format::kYV21: {
+      MP_ASSIGN_OR_RETURN(FrameBuffer::YuvData yuv,
+                          FrameBuffer::GetYuvDataFromFrameBuffer(frame_buffer));
+      source.format = FusedSourceFormat::kYuv;
+      // FrameBuffer has no color range, and camera and video decoder 4:2:0
+      // frames use the BT.601 limited range.
+      source.yuv_limited_range = true;
+      source.data = yuv.y_buffer;
+      source.row_stride = yuv.y_row_stride;
+      source.u_data = yuv.u_buffer;
+      source.v_data = yuv.v_buffer;
+      source.uv_row_stride = yuv.uv_row_stride;
+      source.uv_pixel_stride = yuv.uv_pixel_stride;
+      return source;
+    }
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported FrameBuffer format: ",
+                       static_cast<int>(frame_buffer.format())));
+  }
+}
+
+template <typename T>
+absl::Status FusedImageToTensorKernel::RunImpl(const FusedSourceImage& source,
+                                               const RotatedRect& roi,
+                                               const FusedOutputSpec& spec,
+                                               T* output) {
+  MP_RETURN_IF_ERROR(ValidateInputs(source, spec));
+
+  // Output pixel (x, y) maps to the ROI point
+  //   center + R(rotation) * (((x + 0.5) / width - 0.5) * roi.width,
+  //                           ((y + 0.5) / height - 0.5) * roi.height),
+  // which is the same mapping GetRotatedSubRectToRectTransformMatrix uses.
+  const float half_pixel = spec.align_pixel_centers ? 0.5f : 0.0f;
+  const float cos_r = std::cos(roi.rotation);
+  const float sin_r = std::sin(roi.rotation);
+  const float step_u = roi.width / spec.width;
+  const float u0 = (half_pixel / spec.width - 0.5f) * roi.width;
+
+  const int row_size = spec.width * spec.channels;
+  row_.resize(row_size + 2 * spec.width);
+  float* row = row_.data();
+  float* xs = row + row_size;
+  float* ys = xs + spec.width;
+
+  for (int y = 0; y < spec.height; ++y) {
+    const float v = ((y + half_pixel) / spec.height - 0.5f) * roi.height;
+    RowMapping mapping;
+    mapping.x0 = roi.center_x + cos_r * u0 - sin_r * v - half_pixel;
+    mapping.y0 = roi.center_y + sin_r * u0 + cos_r * v - half_pixel;
+    mapping.dx = cos_r * step_u;
+    mapping.dy = sin_r * step_u;
+    for (int x = 0; x < spec.width; ++x) {
+      xs[x] = mapping.x0 + x * mapping.dx;
+      ys[x] = mapping.y0 + x * mapping.dy;
+    }
+
+    // Along a row the mapping is affine, so the pixels whose taps are all
+    // inside the source form one contiguous span.
+    int begin = 0;
+    int end = spec.width;
+    ClipSpan(mapping.x0, mapping.dx, 0.0f, source.width - 1, spec.width,
+             &begin, &end);
+    ClipSpan(mapping.y0, mapping.dy, 0.0f, source.height - 1, spec.width,
+             &begin, &end);
+    SampleSpan</*kChecked=*/true>(source, spec, xs, ys, 0, begin, row);
+    SampleSpan</*kChecked=*/false>(source, spec, xs, ys, begin, end, row);
+    SampleSpan</*kChecked=*/true>(source, spec, xs, ys, end, spec.width, row);
+
+    StoreRow(row, row_size, spec.transform, output + y * row_size);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FusedImageToTensorKernel::Run(const FusedSourceImage& source,
+                                           const RotatedRect& roi,
+                                           const FusedOutputSpec& spec,
+                                           float* output) {
+  return RunImpl(source, roi, spec, output);
+}
+
+absl::Status FusedImageToTensorKernel::Run(const FusedSourceImage& source,
+                                           const RotatedRect& roi,
+                                           const FusedOutputSpec& spec,
+                                           uint8_t* output) {
+  return RunImpl(source, roi, spec, output);
+}
+
+absl::Status FusedImageToTensorKernel::Run(const FusedSourceImage& source,
+                                           const RotatedRect& roi,
+                                           const FusedOutputSpec& spec,
+                                           int8_t* output) {
+  return RunImpl(source, roi, spec, output);
+}
+
+absl::Status FusedImageToTensorKernel::Run(const FusedSourceImage& source,
+                                           const RotatedRect& roi,
+                                           FusedOutputSpec spec,
+                                           int tensor_buffer_offset,
+                                           Tensor& output_tensor) {
+  RET_CHECK_GE(tensor_buffer_offset, 0)
+      << "The input tensor_buffer_offset needs to be non-negative.";
+  const auto& output_shape = output_tensor.shape();
+  RET_CHECK_EQ(output_shape.dims.size(), 4)
+      << "Wrong output dims size: " << output_shape.dims.size();
+  RET_CHECK_GE(output_shape.dims[0], 1)
+      << "The batch dimension needs to be equal or larger than 1.";
+  spec.height = output_shape.dims[1];
+  spec.width = output_shape.dims[2];
+  spec.channels = output_shape.dims[3];
+  const int num_elements_per_img = spec.width * spec.height * spec.channels;
+
+  const Tensor::ElementType type = output_tensor.element_type();
+  if (type != Tensor::ElementType::kFloat32 &&
+      type != Tensor::ElementType::kUInt8 &&
+      type != Tensor::ElementType::kInt8) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unsupported tensor type: ", static_cast<int>(type)));
+  }
+  const int element_size = output_tensor.element_size();
+  RET_CHECK_EQ(tensor_buffer_offset % element_size, 0)
+      << "The buffer offset must be a multiple of the element size.";
+  const int offset = tensor_buffer_offset / element_size;
+  RET_CHECK_GE(output_shape.num_elements(), offset + num_elements_per_img)
+      << "The buffer offset + the input image size is larger than the "
+         "allocated tensor buffer.";
+
+  auto view = output_tensor.GetCpuWriteView();
+  if (type == Tensor::ElementType::kFloat32) {
+    return Run(source, roi, spec, view.buffer<float>() + offset);
+  } else if (type == Tensor::ElementType::kUInt8) {
+    return Run(source, roi, spec, view.buffer<uint8_t>() + offset);
+  }
+  return Run(source, roi, spec, view.buffer<int8_t>() + offset);
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,130 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_FUSED_KERNEL_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_FUSED_KERNEL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/frame_buffer.h"
+#include "mediapipe/framework/formats/tensor.h"
+
+namespace mediapipe {
+
+// Pixel layouts the fused kernel can sample from.
+enum class FusedSourceFormat {
+  // 8-bit single channel.
+  kGray,
+  // 8-bit interleaved RGB.
+  kRgb,
+  // 8-bit interleaved RGBA. Alpha is dropped.
+  kRgba,
+  // 8-bit full resolution Y plane with 2x2 subsampled U and V planes. NV12,
+  // NV21, YV12 and YV21 are all described through the U/V pointers and
+  // strides.
+  kYuv,
+};
+
+// Non-owning view of the source pixels.
+struct FusedSourceImage {
+  FusedSourceFormat format;
+  int width;
+  int height;
+  // Interleaved pixels for kGray/kRgb/kRgba, Y plane for kYuv.
+  const uint8_t* data = nullptr;
+  int row_stride = 0;
+  // Chroma planes, kYuv only.
+  const uint8_t* u_data = nullptr;
+  const uint8_t* v_data = nullptr;
+  int uv_row_stride = 0;
+  int uv_pixel_stride = 1;
+  // kYuv only. Whether the samples use the BT.601 limited range (Y in
+  // [16, 235]) as decoders and libyuv do, rather than full-range JFIF.
+  bool yuv_limited_range = false;
+};
+
+// Returns a view of `frame_buffer` for the fused kernel. Supports RGB, RGBA,
+// GRAY and the YUV 4:2:0 formats, whose samples are taken to be in the BT.601
+// limited range as FrameBuffer does not tell.
+absl::StatusOr<FusedSourceImage> GetFusedSourceImage(
+    const FrameBuffer& frame_buffer);
+
+enum class FusedInterpolation { kBilinear, kNearest };
+
+// Describes the tensor written by the fused kernel.
+struct FusedOutputSpec {
+  int width;
+  int height;
+  // 1 or 3. A gray source is replicated into 3 channels; a color source
+  // requires 3 channels.
+  int channels;
+  BorderMode border_mode = BorderMode::kReplicate;
+  FusedInterpolation interpolation = FusedInterpolation::kBilinear;
+  // Whether output pixel centers are mapped onto the ROI. When false, output
+  // pixel (x, y) is mapped as the point (x, y) like cv::warpPerspective does,
+  // which keeps results in line with the OpenCV based converter.
+  bool align_pixel_centers = true;
+  // Applied to every sampled value in the [0, 255] range before it is
+  // stored. Integer outputs are rounded and saturated.
+  ValueTransformation transform = {1.0f, 0.0f};
+};
+
+// Crops, rotates, resizes and normalizes an image into a tensor buffer in a
+// single pass. Each output pixel is mapped through the ROI transform, sampled
+// from the source and written straight into the HWC tensor, so no
+// intermediate full-size image is ever materialized.
+//
+// Rows are processed by first generating the source coordinates, then
+// sampling into a float row buffer and finally normalizing and storing the
+// row. The interior span of each row, where every tap is inside the source,
+// skips all border handling. The row buffer is reused across calls, so a
+// kernel instance should be kept alive for the lifetime of its user.
+class FusedImageToTensorKernel {
+ public:
+  // @source image to sample from.
+  // @roi region of interest within the source (absolute values), mapped onto
+  // the whole output.
+  // @spec output tensor description.
+  // @output points at the first element of the HWC output, which must hold
+  // spec.width * spec.height * spec.channels elements.
+  absl::Status Run(const FusedSourceImage& source, const RotatedRect& roi,
+                   const FusedOutputSpec& spec, float* output);
+  absl::Status Run(const FusedSourceImage& source, const RotatedRect& roi,
+                   const FusedOutputSpec& spec, uint8_t* output);
+  absl::Status Run(const FusedSourceImage& source, const RotatedRect& roi,
+                   const FusedOutputSpec& spec, int8_t* output);
+
+  // Same as above, but writes into a float32, uint8 or int8 BHWC
+  // `output_tensor`, starting `tensor_buffer_offset` bytes into its buffer.
+  // The width, height and channels of `spec` are taken from the tensor shape.
+  absl::Status Run(const FusedSourceImage& source, const RotatedRect& roi,
+                   FusedOutputSpec spec, int tensor_buffer_offset,
+                   Tensor& output_tensor);
+
+ private:
+  template <typename T>
+  absl::Status RunImpl(const FusedSourceImage& source, const RotatedRect& roi,
+                       const FusedOutputSpec& spec, T* output);
+
+  // Sampled, not yet normalized, values of the current output row.
+  std::vector<float> row_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_FUSED_KERNEL_H_
@@ -0,0 +1,166 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Benchmark for FusedImageToTensorKernel against the cv::warpPerspective +
+// cv::Mat::convertTo pipeline it replaces, at common model input sizes.
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "benchmark/benchmark.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_fused_kernel.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kSourceWidth = 1280;
+constexpr int kSourceHeight = 720;
+
+std::vector<uint8_t> RandomPixels(int size) {
+  std::mt19937 rng(0 /*seed*/);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<uint8_t> pixels(size);
+  for (auto& pixel : pixels) pixel = dist(rng);
+  return pixels;
+}
+
+// A slightly rotated square ROI in the middle of the frame, as produced by
+// the detection-to-rect calculators.
+RotatedRect BenchmarkRoi() {
+  return {/*center_x=*/kSourceWidth * 0.5f, /*center_y=*/kSourceHeight * 0.5f,
+          /*width=*/kSourceHeight * 0.8f, /*height=*/kSourceHeight * 0.8f,
+          /*rotation=*/0.3f};
+}
+
+FusedOutputSpec BenchmarkSpec(int size) {
+  FusedOutputSpec spec{/*width=*/size, /*height=*/size, /*channels=*/3};
+  spec.transform = {/*scale=*/2.0f / 255.0f, /*offset=*/-1.0f};
+  return spec;
+}
+
+void BM_FusedRgbToFloat(benchmark::State& state) {
+  const int size = state.range(0);
+  const std::vector<uint8_t> pixels =
+      RandomPixels(kSourceWidth * kSourceHeight * 3);
+  FusedSourceImage source;
+  source.format = FusedSourceFormat::kRgb;
+  source.width = kSourceWidth;
+  source.height = kSourceHeight;
+  source.data = pixels.data();
+  source.row_stride = kSourceWidth * 3;
+  std::vector<float> output(size * size * 3);
+  FusedImageToTensorKernel kernel;
+  for (auto _ : state) {
+    ABSL_CHECK_OK(
+        kernel.Run(source, BenchmarkRoi(), BenchmarkSpec(size), output.data()));
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_FusedRgbToFloat)->Arg(128)->Arg(192)->Arg(224)->Arg(256);
+
+void BM_FusedRgbToUint8(benchmark::State& state) {
+  const int size = state.range(0);
+  const std::vector<uint8_t> pixels =
+      RandomPixels(kSourceWidth * kSourceHeight * 3);
+  FusedSourceImage source;
+  source.format = FusedSourceFormat::kRgb;
+  source.width = kSourceWidth;
+  source.height = kSourceHeight;
+  source.data = pixels.data();
+  source.row_stride = kSourceWidth * 3;
+  FusedOutputSpec spec{/*width=*/size, /*height=*/size, /*channels=*/3};
+  std::vector<uint8_t> output(size * size * 3);
+  FusedImageToTensorKernel kernel;
+  for (auto _ : state) {
+    ABSL_CHECK_OK(kernel.Run(source, BenchmarkRoi(), spec, output.data()));
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_FusedRgbToUint8)->Arg(128)->Arg(192)->Arg(224)->Arg(256);
+
+void BM_FusedNv12ToFloat(benchmark::State& state) {
+  const int size = state.range(0);
+  const std::vector<uint8_t> pixels =
+      RandomPixels(kSourceWidth * kSourceHeight * 3 / 2);
+  FusedSourceImage source;
+  source.format = FusedSourceFormat::kYuv;
+  source.width = kSourceWidth;
+  source.height = kSourceHeight;
+  source.data = pixels.data();
+  source.row_stride = kSourceWidth;
+  source.u_data = pixels.data() + kSourceWidth * kSourceHeight;
+  source.v_data = source.u_data + 1;
+  source.uv_row_stride = kSourceWidth;
+  source.uv_pixel_stride = 2;
+  std::vector<float> output(size * size * 3);
+  FusedImageToTensorKernel kernel;
+  for (auto _ : state) {
+    ABSL_CHECK_OK(
+        kernel.Run(source, BenchmarkRoi(), BenchmarkSpec(size), output.data()));
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_FusedNv12ToFloat)->Arg(128)->Arg(192)->Arg(224)->Arg(256);
+
+// Baseline: the multi-pass path of ImageToTensorOpenCvConverter.
+void BM_OpenCvWarpAndConvertRgbToFloat(benchmark::State& state) {
+  const int size = state.range(0);
+  std::vector<uint8_t> pixels = RandomPixels(kSourceWidth * kSourceHeight * 3);
+  cv::Mat src(kSourceHeight, kSourceWidth, CV_8UC3, pixels.data());
+  std::vector<float> output(size * size * 3);
+  cv::Mat dst(size, size, CV_32FC3, output.data());
+  const RotatedRect roi = BenchmarkRoi();
+  for (auto _ : state) {
+    const cv::RotatedRect rotated_rect(cv::Point2f(roi.center_x, roi.center_y),
+                                       cv::Size2f(roi.width, roi.height),
+                                       roi.rotation * 180.f / M_PI);
+    cv::Mat src_points;
+    cv::boxPoints(rotated_rect, src_points);
+    const float dst_size = size;
+    /* clang-format off */
+    float dst_corners[8] = {0.0f,     dst_size,
+                            0.0f,     0.0f,
+                            dst_size, 0.0f,
+                            dst_size, dst_size};
+    /* clang-format on */
+    cv::Mat dst_points = cv::Mat(4, 2, CV_32F, dst_corners);
+    cv::Mat projection_matrix =
+        cv::getPerspectiveTransform(src_points, dst_points);
+    cv::Mat transformed;
+    cv::warpPerspective(src, transformed, projection_matrix,
+                        cv::Size(size, size), cv::INTER_LINEAR,
+                        cv::BORDER_REPLICATE);
+    transformed.convertTo(dst, CV_32FC3, 2.0f / 255.0f, -1.0f);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_OpenCvWarpAndConvertRgbToFloat)
+    ->Arg(128)
+    ->Arg(192)
+    ->Arg(224)
+    ->Arg(256);
+
+}  // namespace
+}  // namespace mediapipe
+
+BENCHMARK_MAIN();
@@ -0,0 +1,317 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_fused_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/framework/formats/frame_buffer.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::FloatNear;
+using ::testing::Pointwise;
+
+FusedSourceImage MakeSource(FusedSourceFormat format, int width, int height,
+                            int channels, const std::vector<uint8_t>& data) {
+  FusedSourceImage source;
+  source.format = format;
+  source.width = width;
+  source.height = height;
+  source.data = data.data();
+  source.row_stride = width * channels;
+  return source;
+}
+
+RotatedRect WholeImage(int width, int height) {
+  return {/*center_x=*/width / 2.0f, /*center_y=*/height / 2.0f,
+          /*width=*/static_cast<float>(width),
+          /*height=*/static_cast<float>(height), /*rotation=*/0.0f};
+}
+
+TEST(FusedImageToTensorKernelTest, IdentityRgbToUint8) {
+  const std::vector<uint8_t> pixels = {1,  2,  3,  4,  5,  6,  7,  8,  9,
+                                       10, 11, 12, 13, 14, 15, 16, 17, 18};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kRgb, 3, 2, 3, pixels);
+  FusedOutputSpec spec{/*width=*/3, /*height=*/2, /*channels=*/3};
+  std::vector<uint8_t> output(18);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(3, 2), spec, output.data()));
+
+  EXPECT_THAT(output, ElementsAreArray(pixels));
+}
+
+TEST(FusedImageToTensorKernelTest, RgbaDropsAlpha) {
+  const std::vector<uint8_t> pixels = {10, 20, 30, 255, 40, 50, 60, 0};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kRgba, 2, 1, 4, pixels);
+  FusedOutputSpec spec{/*width=*/2, /*height=*/1, /*channels=*/3};
+  std::vector<uint8_t> output(6);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(2, 1), spec, output.data()));
+
+  EXPECT_THAT(output, ElementsAre(10, 20, 30, 40, 50, 60));
+}
+
+TEST(FusedImageToTensorKernelTest, GrayIsReplicatedToRgb) {
+  const std::vector<uint8_t> pixels = {7, 9};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 2, 1, 1, pixels);
+  FusedOutputSpec spec{/*width=*/2, /*height=*/1, /*channels=*/3};
+  std::vector<uint8_t> output(6);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(2, 1), spec, output.data()));
+
+  EXPECT_THAT(output, ElementsAre(7, 7, 7, 9, 9, 9));
+}
+
+TEST(FusedImageToTensorKernelTest, RotatesBy90Degrees) {
+  // 3x2 gray image:
+  //   0 1 2
+  //   3 4 5
+  const std::vector<uint8_t> pixels = {0, 1, 2, 3, 4, 5};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 3, 2, 1, pixels);
+  const RotatedRect roi = {/*center_x=*/1.5f, /*center_y=*/1.0f,
+                           /*width=*/2.0f, /*height=*/3.0f,
+                           /*rotation=*/static_cast<float>(M_PI / 2)};
+
+  for (auto interpolation :
+       {FusedInterpolation::kBilinear, FusedInterpolation::kNearest}) {
+    FusedOutputSpec spec{/*width=*/2, /*height=*/3, /*channels=*/1};
+    spec.interpolation = interpolation;
+    std::vector<uint8_t> output(6);
+
+    FusedImageToTensorKernel kernel;
+    MP_ASSERT_OK(kernel.Run(source, roi, spec, output.data()));
+
+    EXPECT_THAT(output, ElementsAre(2, 5, 1, 4, 0, 3));
+  }
+}
+
+TEST(FusedImageToTensorKernelTest, BilinearDownscale) {
+  const std::vector<uint8_t> pixels = {0, 100, 200, 250};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 4, 1, 1, pixels);
+  FusedOutputSpec spec{/*width=*/2, /*height=*/1, /*channels=*/1};
+  std::vector<float> output(2);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(4, 1), spec, output.data()));
+
+  EXPECT_THAT(output, Pointwise(FloatNear(1e-4), {50.0f, 225.0f}));
+}
+
+TEST(FusedImageToTensorKernelTest, NormalizesFloatOutput) {
+  const std::vector<uint8_t> pixels = {0, 255};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 2, 1, 1, pixels);
+  FusedOutputSpec spec{/*width=*/2, /*height=*/1, /*channels=*/1};
+  spec.transform = {/*scale=*/2.0f / 255.0f, /*offset=*/-1.0f};
+  std::vector<float> output(2);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(2, 1), spec, output.data()));
+
+  EXPECT_THAT(output, Pointwise(FloatNear(1e-5), {-1.0f, 1.0f}));
+}
+
+TEST(FusedImageToTensorKernelTest, SaturatesInt8Output) {
+  const std::vector<uint8_t> pixels = {0, 128, 255};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 3, 1, 1, pixels);
+  FusedOutputSpec spec{/*width=*/3, /*height=*/1, /*channels=*/1};
+  spec.transform = {/*scale=*/1.0f, /*offset=*/-100.0f};
+  std::vector<int8_t> output(3);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(3, 1), spec, output.data()));
+
+  EXPECT_THAT(output, ElementsAre(-100, 28, 127));
+}
+
+TEST(FusedImageToTensorKernelTest, RoundsHalfToEven) {
+  const std::vector<uint8_t> pixels = {1, 3, 5, 7};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 4, 1, 1, pixels);
+  FusedOutputSpec spec{/*width=*/4, /*height=*/1, /*channels=*/1};
+  spec.transform = {/*scale=*/0.5f, /*offset=*/0.0f};
+  std::vector<uint8_t> output(4);
+
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(4, 1), spec, output.data()));
+
+  // As cv::saturate_cast, which the OpenCV converter uses.
+  EXPECT_THAT(output, ElementsAre(0, 2, 2, 4));
+}
+
+TEST(FusedImageToTensorKernelTest, BorderModes) {
+  const std::vector<uint8_t> pixels = {10, 20};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 2, 1, 1, pixels);
+  // Twice as wide as the image, so one output pixel on each side falls
+  // outside of the source.
+  const RotatedRect roi = {/*center_x=*/1.0f, /*center_y=*/0.5f,
+                           /*width=*/4.0f, /*height=*/1.0f, /*rotation=*/0.0f};
+  FusedOutputSpec spec{/*width=*/4, /*height=*/1, /*channels=*/1};
+  std::vector<uint8_t> output(4);
+  FusedImageToTensorKernel kernel;
+
+  spec.border_mode = BorderMode::kZero;
+  MP_ASSERT_OK(kernel.Run(source, roi, spec, output.data()));
+  EXPECT_THAT(output, ElementsAre(0, 10, 20, 0));
+
+  spec.border_mode = BorderMode::kReplicate;
+  MP_ASSERT_OK(kernel.Run(source, roi, spec, output.data()));
+  EXPECT_THAT(output, ElementsAre(10, 10, 20, 20));
+}
+
+TEST(FusedImageToTensorKernelTest, SamplesNv12) {
+  constexpr int kWidth = 4;
+  constexpr int kHeight = 2;
+  constexpr uint8_t kY = 81, kU = 90, kV = 240;
+  std::vector<uint8_t> y_plane(kWidth * kHeight, kY);
+  std::vector<uint8_t> uv_plane;
+  for (int i = 0; i < kWidth / 2; ++i) {
+    uv_plane.push_back(kU);
+    uv_plane.push_back(kV);
+  }
+  FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kYuv, kWidth, kHeight, 1, y_plane);
+  source.u_data = uv_plane.data();
+  source.v_data = uv_plane.data() + 1;
+  source.uv_row_stride = kWidth;
+  source.uv_pixel_stride = 2;
+
+  FusedOutputSpec spec{/*width=*/2, /*height=*/1, /*channels=*/3};
+  std::vector<float> output(6);
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(
+      kernel.Run(source, WholeImage(kWidth, kHeight), spec, output.data()));
+
+  const float r = kY + 1.402f * (kV - 128);
+  const float g = kY - 0.34414f * (kU - 128) - 0.71414f * (kV - 128);
+  const float b = kY + 1.772f * (kU - 128);
+  EXPECT_THAT(output, Pointwise(FloatNear(1e-3), {r, g, b, r, g, b}));
+
+  spec.channels = 1;
+  MP_ASSERT_OK(
+      kernel.Run(source, WholeImage(kWidth, kHeight), spec, output.data()));
+  EXPECT_THAT(output[0], FloatNear(kY, 1e-3));
+  EXPECT_THAT(output[1], FloatNear(kY, 1e-3));
+}
+
+TEST(FusedImageToTensorKernelTest, SamplesLimitedRangeYuv) {
+  constexpr int kWidth = 2;
+  constexpr int kHeight = 2;
+  constexpr uint8_t kY = 100, kU = 60, kV = 200;
+  std::vector<uint8_t> y_plane(kWidth * kHeight, kY);
+  std::vector<uint8_t> u_plane = {kU};
+  std::vector<uint8_t> v_plane = {kV};
+  FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kYuv, kWidth, kHeight, 1, y_plane);
+  source.u_data = u_plane.data();
+  source.v_data = v_plane.data();
+  source.uv_row_stride = 1;
+  source.yuv_limited_range = true;
+
+  FusedOutputSpec spec{/*width=*/1, /*height=*/1, /*channels=*/3};
+  std::vector<float> output(3);
+  FusedImageToTensorKernel kernel;
+  MP_ASSERT_OK(
+      kernel.Run(source, WholeImage(kWidth, kHeight), spec, output.data()));
+
+  const float y = 1.16438f * (kY - 16);
+  const float r = std::clamp(y + 1.59603f * (kV - 128), 0.0f, 255.0f);
+  const float g = std::clamp(
+      y - 0.39176f * (kU - 128) - 0.81297f * (kV - 128), 0.0f, 255.0f);
+  const float b = std::clamp(y + 2.01723f * (kU - 128), 0.0f, 255.0f);
+  EXPECT_THAT(output, Pointwise(FloatNear(1e-2), {r, g, b}));
+}
+
+TEST(FusedImageToTensorKernelTest, ReadsNv21FrameBuffer) {
+  constexpr int kWidth = 2;
+  constexpr int kHeight = 2;
+  std::vector<uint8_t> y_plane = {10, 20, 30, 40};
+  // NV21 stores V before U.
+  std::vector<uint8_t> vu_plane = {200, 100};
+  FrameBuffer frame_buffer(
+      {FrameBuffer::Plane(y_plane.data(), {/*row_stride_bytes=*/kWidth,
+                                           /*pixel_stride_bytes=*/1}),
+       FrameBuffer::Plane(vu_plane.data(), {/*row_stride_bytes=*/kWidth,
+                                            /*pixel_stride_bytes=*/2})},
+      {kWidth, kHeight}, FrameBuffer::Format::kNV21);
+
+  MP_ASSERT_OK_AND_ASSIGN(FusedSourceImage source,
+                          GetFusedSourceImage(frame_buffer));
+
+  EXPECT_EQ(source.format, FusedSourceFormat::kYuv);
+  EXPECT_EQ(source.data, y_plane.data());
+  EXPECT_EQ(*source.u_data, 100);
+  EXPECT_EQ(*source.v_data, 200);
+  EXPECT_EQ(source.uv_pixel_stride, 2);
+  EXPECT_TRUE(source.yuv_limited_range);
+}
+
+TEST(FusedImageToTensorKernelTest, WritesIntoTensorAtOffset) {
+  const std::vector<uint8_t> pixels = {10, 20, 30, 40};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kGray, 2, 2, 1, pixels);
+  Tensor tensor(Tensor::ElementType::kUInt8,
+                Tensor::Shape({/*batch=*/2, /*height=*/2, /*width=*/2,
+                               /*channels=*/1}));
+
+  FusedImageToTensorKernel kernel;
+  // Writing past the end of the tensor is rejected.
+  EXPECT_FALSE(kernel
+                   .Run(source, WholeImage(2, 2), FusedOutputSpec{},
+                        /*tensor_buffer_offset=*/5, tensor)
+                   .ok());
+  MP_ASSERT_OK(kernel.Run(source, WholeImage(2, 2), FusedOutputSpec{},
+                          /*tensor_buffer_offset=*/4, tensor));
+
+  auto view = tensor.GetCpuReadView();
+  const uint8_t* data = view.buffer<uint8_t>();
+  EXPECT_THAT(std::vector<uint8_t>(data + 4, data + 8),
+              ElementsAre(10, 20, 30, 40));
+}
+
+TEST(FusedImageToTensorKernelTest, RejectsSingleChannelOutputForColor) {
+  const std::vector<uint8_t> pixels = {1, 2, 3};
+  const FusedSourceImage source =
+      MakeSource(FusedSourceFormat::kRgb, 1, 1, 3, pixels);
+  FusedOutputSpec spec{/*width=*/1, /*height=*/1, /*channels=*/1};
+  std::vector<uint8_t> output(1);
+
+  FusedImageToTensorKernel kernel;
+  EXPECT_FALSE(kernel.Run(source, WholeImage(1, 1), spec, output.data()).ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -12,12 +12,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/str_format.h"
 #include "absl/types/span.h"
 #include "mediapipe/calculators/tensor/tensors_to_detections_calculator.pb.h"
+#include "mediapipe/calculators/util/non_max_suppression_engine.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/deps/file_path.h"
@@ -27,6 +33,7 @@
 #include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/threadpool.h"
 
 // Note: On Apple platforms MEDIAPIPE_DISABLE_GL_COMPUTE is automatically
 // defined in mediapipe/framework/port.h. Therefore,
@@ -128,6 +135,36 @@ absl::Status CheckCustomTensorMapping(
   return absl::OkStatus();
 }
 
+// Returns the index of the first largest value in `values`, or -1 if none is
+// larger than the lowest finite float (e.g. all are NaN). The loops are kept
+// free of early exits so they can be vectorized.
+int ArgMax(const float* values, int size, float* max_value) {
+  float max = std::numeric_limits<float>::lowest();
+  for (int i = 0; i < size; ++i) {
+    max = values[i] > max ? values[i] : max;
+  }
+  *max_value = max;
+  if (max == std::numeric_limits<float>::lowest()) {
+    return -1;
+  }
+  int index = 0;
+  while (values[index] != max) ++index;
+  return index;
+}
+
+// Lower bound for the raw score of a box passing `min_score_thresh` after the
+// sigmoid, so that most boxes can be rejected before the exp(). The margin
+// only has to cover rounding; the exact threshold is applied afterwards.
+float SigmoidScoreLowerBound(float min_score_thresh) {
+  if (min_score_thresh <= 0.0f) {
+    return -std::numeric_limits<float>::infinity();
+  }
+  constexpr float kEpsilon = 1e-6f;
+  constexpr float kMargin = 1e-3f;
+  const float p = std::min(min_score_thresh, 1.0f - kEpsilon);
+  return std::log(p / (1.0f - p)) - kMargin;
+}
+
 BoxFormat GetBoxFormat(const TensorsToDetectionsCalculatorOptions& options) {
   if (options.has_box_format()) {
     return options.box_format();
@@ -206,13 +243,26 @@ class TensorsToDetectionsCalculator : public Node {
 
   absl::Status LoadOptions(CalculatorContext* cc);
   absl::Status GpuInit(CalculatorContext* cc);
-  absl::Status DecodeBoxes(const float* raw_boxes,
-                           const std::vector<Anchor>& anchors,
-                           std::vector<float>* boxes);
+  // Finds the best allowed class of every box and keeps the boxes that pass
+  // `min_score_thresh` in the candidate_* buffers, in box order.
+  void SelectCandidates(const float* raw_scores);
+  // Decodes box `i` into `num_coords_` values at `box`.
+  void DecodeBox(const float* raw_boxes, const std::vector<Anchor>& anchors,
+                 int i, float* box);
   absl::Status ConvertToDetections(const float* detection_boxes,
                                    const float* detection_scores,
-                                   const int* detection_classes,
+                                   const int* detection_classes, int num_boxes,
                                    std::vector<Detection>* output_detections);
+  // Same as ConvertToDetections(), but runs `nms_` on the decoded boxes and
+  // only builds the Detections that survive the suppression.
+  absl::Status ConvertToSuppressedDetections(
+      const float* detection_boxes, const float* detection_scores,
+      const int* detection_classes, int num_boxes,
+      std::vector<Detection>* output_detections);
+  // Adds the keypoints of the box at `box_offset`, or their score weighted
+  // average over the `cluster` boxes when it isn't empty.
+  void AddKeypoints(const float* detection_boxes, int box_offset,
+                    absl::Span<const int> cluster, Detection* detection);
   Detection ConvertToDetection(float box_ymin, float box_xmin, float box_ymax,
                                float box_xmax, absl::Span<const float> scores,
                                absl::Span<const int> class_ids,
@@ -235,6 +285,9 @@ class TensorsToDetectionsCalculator : public Node {
   // Allowed or ignored class indices based on provided options or side packet.
   // These are used to filter out the output detection results.
   ClassIndexSet class_index_set_;
+  // Class indices in [0, num_classes_) that pass `class_index_set_`.
+  std::vector<int> allowed_class_indices_;
+  bool all_classes_allowed_ = true;
 
   TensorsToDetectionsCalculatorOptions options_;
   bool scores_tensor_index_is_set_ = false;
@@ -243,6 +296,23 @@ class TensorsToDetectionsCalculator : public Node {
   bool has_custom_box_indices_ = false;
   std::vector<Anchor> anchors_;
 
+  // Scratch buffers reused across Process() calls.
+  std::vector<int> candidate_indices_;
+  std::vector<float> candidate_scores_;
+  std::vector<int> candidate_classes_;
+  std::vector<float> candidate_boxes_;
+  std::vector<float> gathered_scores_;
+
+  // Set when `options_.nms` is. `nms_boxes_` holds the boxes to suppress,
+  // and `nms_box_offsets_` and `nms_box_labels_` the offset of each box in
+  // the detection buffers and the index of its best scoring label there.
+  std::unique_ptr<NonMaxSuppressionEngine> nms_;
+  std::unique_ptr<ThreadPool> nms_thread_pool_;
+  NmsBoxes nms_boxes_;
+  std::vector<int> nms_box_offsets_;
+  std::vector<int> nms_box_labels_;
+  NmsResult nms_result_;
+
 #ifndef MEDIAPIPE_DISABLE_GL_COMPUTE
   mediapipe::GlCalculatorHelper gpu_helper_;
   GLuint decode_program_;
@@ -416,44 +486,20 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
       }
       anchors_init_ = true;
     }
-    std::vector<float> boxes(num_boxes_ * num_coords_);
-    MP_RETURN_IF_ERROR(DecodeBoxes(raw_boxes, anchors_, &boxes));
-
-    std::vector<float> detection_scores(num_boxes_);
-    std::vector<int> detection_classes(num_boxes_);
-
-    // Filter classes by scores.
-    for (int i = 0; i < num_boxes_; ++i) {
-      int class_id = -1;
-      float max_score = -std::numeric_limits<float>::max();
-      // Find the top score for box i.
-      for (int score_idx = 0; score_idx < num_classes_; ++score_idx) {
-        if (IsClassIndexAllowed(score_idx)) {
-          auto score = raw_scores[i * num_classes_ + score_idx];
-          if (options_.sigmoid_score()) {
-            if (options_.has_score_clipping_thresh()) {
-              score = score < -options_.score_clipping_thresh()
-                          ? -options_.score_clipping_thresh()
-                          : score;
-              score = score > options_.score_clipping_thresh()
-                          ? options_.score_clipping_thresh()
-                          : score;
-            }
-            score = 1.0f / (1.0f + std::exp(-score));
-          }
-          if (max_score < score) {
-            max_score = score;
-            class_id = score_idx;
-          }
-        }
-      }
-      detection_scores[i] = max_score;
-      detection_classes[i] = class_id;
+    RET_CHECK_GE(anchors_.size(), num_boxes_);
+
+    // Score boxes first, so that only the boxes passing the score threshold
+    // are decoded and converted to Detection protos.
+    SelectCandidates(raw_scores);
+    const int num_candidates = candidate_indices_.size();
+    candidate_boxes_.resize(num_candidates * num_coords_);
+    for (int i = 0; i < num_candidates; ++i) {
+      DecodeBox(raw_boxes, anchors_, candidate_indices_[i],
+                &candidate_boxes_[i * num_coords_]);
     }
-
-    MP_RETURN_IF_ERROR(
-        ConvertToDetections(boxes.data(), detection_scores.data(),
-                            detection_classes.data(), output_detections));
+    MP_RETURN_IF_ERROR(ConvertToDetections(
+        candidate_boxes_.data(), candidate_scores_.data(),
+        candidate_classes_.data(), num_candidates, output_detections));
   } else {
     // Postprocessing on CPU with postprocessing op (e.g. anchor decoding and
     // non-maximum suppression) within the model.
@@ -503,13 +549,13 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
 
     auto detection_classes_view = detection_classes_tensor->GetCpuReadView();
     auto detection_classes_ptr = detection_classes_view.buffer<float>();
-    std::vector<int> detection_classes(num_boxes_ * classes_per_detection_);
-    for (int i = 0; i < detection_classes.size(); ++i) {
-      detection_classes[i] = static_cast<int>(detection_classes_ptr[i]);
+    candidate_classes_.resize(num_boxes_ * classes_per_detection_);
+    for (int i = 0; i < candidate_classes_.size(); ++i) {
+      candidate_classes_[i] = static_cast<int>(detection_classes_ptr[i]);
     }
-    MP_RETURN_IF_ERROR(ConvertToDetections(detection_boxes, detection_scores,
-                                           detection_classes.data(),
-                                           output_detections));
+    MP_RETURN_IF_ERROR(ConvertToDetections(
+        detection_boxes, detection_scores, candidate_classes_.data(),
+        num_boxes_, output_detections));
   }
   return absl::OkStatus();
 }
@@ -574,21 +620,21 @@ absl::Status TensorsToDetectionsCalculator::ProcessGPU(
 
   // TODO: b/138851969. Is it possible to output a float vector
   // for score and an int vector for class so that we can avoid copying twice?
-  std::vector<float> detection_scores(num_boxes_);
-  std::vector<int> detection_classes(num_boxes_);
+  candidate_scores_.resize(num_boxes_);
+  candidate_classes_.resize(num_boxes_);
   // The order of requesting of CpuViews must be the same as the order of
   // requesting OpenGlViews above to avoid 'Potential mutex deadlock' message
   // when compiled without '-c opt' option.
   auto scored_boxes_view = scored_boxes_buffer_->GetCpuReadView();
   auto score_class_id_pairs = scored_boxes_view.buffer<float>();
   for (int i = 0; i < num_boxes_; ++i) {
-    detection_scores[i] = score_class_id_pairs[i * 2];
-    detection_classes[i] = static_cast<int>(score_class_id_pairs[i * 2 + 1]);
+    candidate_scores_[i] = score_class_id_pairs[i * 2];
+    candidate_classes_[i] = static_cast<int>(score_class_id_pairs[i * 2 + 1]);
   }
   auto decoded_boxes_view = decoded_boxes_buffer_->GetCpuReadView();
   auto boxes = decoded_boxes_view.buffer<float>();
-  MP_RETURN_IF_ERROR(ConvertToDetections(boxes, detection_scores.data(),
-                                         detection_classes.data(),
+  MP_RETURN_IF_ERROR(ConvertToDetections(boxes, candidate_scores_.data(),
+                                         candidate_classes_.data(), num_boxes_,
                                          output_detections));
 #elif MEDIAPIPE_METAL_ENABLED
   if (!anchors_init_) {
@@ -662,20 +708,21 @@ absl::Status TensorsToDetectionsCalculator::ProcessGPU(
 
   // Output detections.
   // TODO Adjust shader to avoid copying shader output twice.
-  std::vector<float> detection_scores(num_boxes_);
-  std::vector<int> detection_classes(num_boxes_);
+  candidate_scores_.resize(num_boxes_);
+  candidate_classes_.resize(num_boxes_);
   {
     auto scored_boxes_view = scored_boxes_buffer_->GetCpuReadView();
     auto score_class_id_pairs = scored_boxes_view.buffer<float>();
     for (int i = 0; i < num_boxes_; ++i) {
-      detection_scores[i] = score_class_id_pairs[i * 2];
-      detection_classes[i] = static_cast<int>(score_class_id_pairs[i * 2 + 1]);
+      candidate_scores_[i] = score_class_id_pairs[i * 2];
+      candidate_classes_[i] =
+          static_cast<int>(score_class_id_pairs[i * 2 + 1]);
     }
   }
   auto decoded_boxes_view = decoded_boxes_buffer_->GetCpuReadView();
   auto boxes = decoded_boxes_view.buffer<float>();
-  MP_RETURN_IF_ERROR(ConvertToDetections(boxes, detection_scores.data(),
-                                         detection_classes.data(),
+  MP_RETURN_IF_ERROR(ConvertToDetections(boxes, candidate_scores_.data(),
+                                         candidate_classes_.data(), num_boxes_,
                                          output_detections));
 
 #else
@@ -749,6 +796,14 @@ absl::Status TensorsToDetectionsCalculator::LoadOptions(CalculatorContext* cc) {
     }
   }
 
+  allowed_class_indices_.clear();
+  for (int i = 0; i < num_classes_; ++i) {
+    if (IsClassIndexAllowed(i)) {
+      allowed_class_indices_.push_back(i);
+    }
+  }
+  all_classes_allowed_ = allowed_class_indices_.size() == num_classes_;
+
   if (options_.has_tensor_mapping()) {
     RET_CHECK_OK(CheckCustomTensorMapping(options_.tensor_mapping()));
     tensor_mapping_ = options_.tensor_mapping();
@@ -780,100 +835,177 @@ absl::Status TensorsToDetectionsCalculator::LoadOptions(CalculatorContext* cc) {
     has_custom_box_indices_ = true;
   }
 
+  if (options_.has_nms()) {
+    const NonMaxSuppressionCalculatorOptions& nms_options = options_.nms();
+    RET_CHECK_NE(nms_options.max_num_detections(), 0);
+    nms_ = std::make_unique<NonMaxSuppressionEngine>(nms_options);
+    if (nms_options.multiclass_nms() && nms_options.num_threads() > 1) {
+      nms_thread_pool_ = std::make_unique<ThreadPool>(
+          "TensorsToDetectionsNms", nms_options.num_threads());
+      nms_thread_pool_->StartWorkers();
+    }
+  }
+
   return absl::OkStatus();
 }
 
-absl::Status TensorsToDetectionsCalculator::DecodeBoxes(
-    const float* raw_boxes, const std::vector<Anchor>& anchors,
-    std::vector<float>* boxes) {
+void TensorsToDetectionsCalculator::SelectCandidates(const float* raw_scores) {
+  candidate_indices_.clear();
+  candidate_scores_.clear();
+  candidate_classes_.clear();
+
+  const bool sigmoid = options_.sigmoid_score();
+  const bool clip = sigmoid && options_.has_score_clipping_thresh();
+  const float clip_thresh = options_.score_clipping_thresh();
+  const bool has_min_score = options_.has_min_score_thresh();
+  const float min_score = options_.min_score_thresh();
+  // Sigmoid and clipping are monotonic, so the best class can be found on the
+  // raw scores and boxes far below the threshold rejected without any exp().
+  // Only ties introduced by clipping need to be resolved separately.
+  float raw_lower_bound = -std::numeric_limits<float>::infinity();
+  if (has_min_score) {
+    raw_lower_bound = sigmoid ? SigmoidScoreLowerBound(min_score) : min_score;
+  }
+
+  const int num_allowed = allowed_class_indices_.size();
+  gathered_scores_.resize(num_allowed);
   for (int i = 0; i < num_boxes_; ++i) {
-    const int box_offset = i * num_coords_ + options_.box_coord_offset();
-
-    float y_center = 0.0;
-    float x_center = 0.0;
-    float h = 0.0;
-    float w = 0.0;
-    // TODO
-    switch (box_output_format_) {
-      case mediapipe::TensorsToDetectionsCalculatorOptions::UNSPECIFIED:
-      case mediapipe::TensorsToDetectionsCalculatorOptions::YXHW:
-        y_center = raw_boxes[box_offset];
-        x_center = raw_boxes[box_offset + 1];
-        h = raw_boxes[box_offset + 2];
-        w = raw_boxes[box_offset + 3];
-        break;
-      case mediapipe::TensorsToDetectionsCalculatorOptions::XYWH:
-        x_center = raw_boxes[box_offset];
-        y_center = raw_boxes[box_offset + 1];
-        w = raw_boxes[box_offset + 2];
-        h = raw_boxes[box_offset + 3];
-        break;
-      case mediapipe::TensorsToDetectionsCalculatorOptions::XYXY:
-        x_center = (-raw_boxes[box_offset] + raw_boxes[box_offset + 2]) / 2;
-        y_center = (-raw_boxes[box_offset + 1] + raw_boxes[box_offset + 3]) / 2;
-        w = raw_boxes[box_offset + 2] + raw_boxes[box_offset];
-        h = raw_boxes[box_offset + 3] + raw_boxes[box_offset + 1];
-        break;
-    }
-    x_center =
-        x_center / options_.x_scale() * anchors[i].w() + anchors[i].x_center();
-    y_center =
-        y_center / options_.y_scale() * anchors[i].h() + anchors[i].y_center();
-
-    if (options_.apply_exponential_on_box_size()) {
-      h = std::exp(h / options_.h_scale()) * anchors[i].h();
-      w = std::exp(w / options_.w_scale()) * anchors[i].w();
+    const float* box_scores = raw_scores + i * num_classes_;
+    float max_score;
+    int class_id;
+    if (all_classes_allowed_) {
+      class_id = ArgMax(box_scores, num_classes_, &max_score);
     } else {
-      h = h / options_.h_scale() * anchors[i].h();
-      w = w / options_.w_scale() * anchors[i].w();
+      for (int j = 0; j < num_allowed; ++j) {
+        gathered_scores_[j] = box_scores[allowed_class_indices_[j]];
+      }
+      class_id = ArgMax(gathered_scores_.data(), num_allowed, &max_score);
+      if (class_id >= 0) class_id = allowed_class_indices_[class_id];
     }
-
-    const float ymin = y_center - h / 2.f;
-    const float xmin = x_center - w / 2.f;
-    const float ymax = y_center + h / 2.f;
-    const float xmax = x_center + w / 2.f;
-
-    (*boxes)[i * num_coords_ + 0] = ymin;
-    (*boxes)[i * num_coords_ + 1] = xmin;
-    (*boxes)[i * num_coords_ + 2] = ymax;
-    (*boxes)[i * num_coords_ + 3] = xmax;
-
-    if (options_.num_keypoints()) {
-      for (int k = 0; k < options_.num_keypoints(); ++k) {
-        const int offset = i * num_coords_ + options_.keypoint_coord_offset() +
-                           k * options_.num_values_per_keypoint();
-
-        float keypoint_y = 0.0;
-        float keypoint_x = 0.0;
-        switch (box_output_format_) {
-          case mediapipe::TensorsToDetectionsCalculatorOptions::UNSPECIFIED:
-          case mediapipe::TensorsToDetectionsCalculatorOptions::YXHW:
-            keypoint_y = raw_boxes[offset];
-            keypoint_x = raw_boxes[offset + 1];
-            break;
-          case mediapipe::TensorsToDetectionsCalculatorOptions::XYWH:
-          case mediapipe::TensorsToDetectionsCalculatorOptions::XYXY:
-            keypoint_x = raw_boxes[offset];
-            keypoint_y = raw_boxes[offset + 1];
+    if (class_id < 0) {
+      // No allowed class has a usable score.
+      if (has_min_score) continue;
+      max_score = std::numeric_limits<float>::lowest();
+    } else {
+      if (clip && (max_score > clip_thresh || max_score <= -clip_thresh)) {
+        // Clipping ties all the scores beyond the threshold, and the first
+        // class with a tied score wins.
+        // A non-positive threshold clips every score to the threshold itself.
+        const bool above = max_score > clip_thresh && clip_thresh > 0;
+        max_score = above || clip_thresh <= 0 ? clip_thresh : -clip_thresh;
+        for (int index : allowed_class_indices_) {
+          const float score = box_scores[index];
+          if (above ? score >= clip_thresh : !std::isnan(score)) {
+            class_id = index;
             break;
+          }
         }
-
-        (*boxes)[offset] = keypoint_x / options_.x_scale() * anchors[i].w() +
-                           anchors[i].x_center();
-        (*boxes)[offset + 1] =
-            keypoint_y / options_.y_scale() * anchors[i].h() +
-            anchors[i].y_center();
       }
+      if (has_min_score && !(max_score >= raw_lower_bound)) continue;
+      if (sigmoid) {
+        max_score = 1.0f / (1.0f + std::exp(-max_score));
+      }
+      if (has_min_score && max_score < min_score) continue;
     }
+    candidate_indices_.push_back(i);
+    candidate_scores_.push_back(max_score);
+    candidate_classes_.push_back(class_id);
   }
+}
 
-  return absl::OkStatus();
+void TensorsToDetectionsCalculator::DecodeBox(
+    const float* raw_boxes, const std::vector<Anchor>& anchors, int i,
+    float* box) {
+  const int box_offset = i * num_coords_ + options_.box_coord_offset();
+
+  float y_center = 0.0;
+  float x_center = 0.0;
+  float h = 0.0;
+  float w = 0.0;
+  // TODO
+  switch (box_output_format_) {
+    case mediapipe::TensorsToDetectionsCalculatorOptions::UNSPECIFIED:
+    case mediapipe::TensorsToDetectionsCalculatorOptions::YXHW:
+      y_center = raw_boxes[box_offset];
+      x_center = raw_boxes[box_offset + 1];
+      h = raw_boxes[box_offset + 2];
+      w = raw_boxes[box_offset + 3];
+      break;
+    case mediapipe::TensorsToDetectionsCalculatorOptions::XYWH:
+      x_center = raw_boxes[box_offset];
+      y_center = raw_boxes[box_offset + 1];
+      w = raw_boxes[box_offset + 2];
+      h = raw_boxes[box_offset + 3];
+      break;
+    case mediapipe::TensorsToDetectionsCalculatorOptions::XYXY:
+      x_center = (-raw_boxes[box_offset] + raw_boxes[box_offset + 2]) / 2;
+      y_center = (-raw_boxes[box_offset + 1] + raw_boxes[box_offset + 3]) / 2;
+      w = raw_boxes[box_offset + 2] + raw_boxes[box_offset];
+      h = raw_boxes[box_offset + 3] + raw_boxes[box_offset + 1];
+      break;
+  }
+  x_center =
+      x_center / options_.x_scale() * anchors[i].w() + anchors[i].x_center();
+  y_center =
+      y_center / options_.y_scale() * anchors[i].h() + anchors[i].y_center();
+
+  if (options_.apply_exponential_on_box_size()) {
+    h = std::exp(h / options_.h_scale()) * anchors[i].h();
+    w = std::exp(w / options_.w_scale()) * anchors[i].w();
+  } else {
+    h = h / options_.h_scale() * anchors[i].h();
+    w = w / options_.w_scale() * anchors[i].w();
+  }
+
+  const float ymin = y_center - h / 2.f;
+  const float xmin = x_center - w / 2.f;
+  const float ymax = y_center + h / 2.f;
+  const float xmax = x_center + w / 2.f;
+
+  box[0] = ymin;
+  box[1] = xmin;
+  box[2] = ymax;
+  box[3] = xmax;
+
+  if (options_.num_keypoints()) {
+    for (int k = 0; k < options_.num_keypoints(); ++k) {
+      const int offset = options_.keypoint_coord_offset() +
+                         k * options_.num_values_per_keypoint();
+      const int raw_offset = i * num_coords_ + offset;
+
+      float keypoint_y = 0.0;
+      float keypoint_x = 0.0;
+      switch (box_output_format_) {
+        case mediapipe::TensorsToDetectionsCalculatorOptions::UNSPECIFIED:
+        case mediapipe::TensorsToDetectionsCalculatorOptions::YXHW:
+          keypoint_y = raw_boxes[raw_offset];
+          keypoint_x = raw_boxes[raw_offset + 1];
+          break;
+        case mediapipe::TensorsToDetectionsCalculatorOptions::XYWH:
+        case mediapipe::TensorsToDetectionsCalculatorOptions::XYXY:
+          keypoint_x = raw_boxes[raw_offset];
+          keypoint_y = raw_boxes[raw_offset + 1];
+          break;
+      }
+
+      box[offset] = keypoint_x / options_.x_scale() * anchors[i].w() +
+                    anchors[i].x_center();
+      box[offset + 1] = keypoint_y / options_.y_scale() * anchors[i].h() +
+                        anchors[i].y_center();
+    }
+  }
 }
 
 absl::Status TensorsToDetectionsCalculator::ConvertToDetections(
     const float* detection_boxes, const float* detection_scores,
-    const int* detection_classes, std::vector<Detection>* output_detections) {
-  for (int i = 0; i < num_boxes_ * classes_per_detection_;
+    const int* detection_classes, int num_boxes,
+    std::vector<Detection>* output_detections) {
+  if (nms_) {
+    return ConvertToSuppressedDetections(detection_boxes, detection_scores,
+                                         detection_classes, num_boxes,
+                                         output_detections);
+  }
+  for (int i = 0; i < num_boxes * classes_per_detection_;
        i += classes_per_detection_) {
     if (max_results_ > 0 && output_detections->size() == max_results_) {
       break;
@@ -915,11 +1047,143 @@ absl::Status TensorsToDetectionsCalculator::ConvertToDetections(
                             : detection_boxes[keypoint_index + 1]);
       }
     }
-    output_detections->emplace_back(detection);
+    output_detections->push_back(std::move(detection));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TensorsToDetectionsCalculator::ConvertToSuppressedDetections(
+    const float* detection_boxes, const float* detection_scores,
+    const int* detection_classes, int num_boxes,
+    std::vector<Detection>* output_detections) {
+  const bool flip_vertically = options_.flip_vertically();
+  const bool multiclass = options_.nms().multiclass_nms();
+  nms_boxes_.Clear();
+  nms_box_offsets_.clear();
+  nms_box_labels_.clear();
+  for (int i = 0; i < num_boxes * classes_per_detection_;
+       i += classes_per_detection_) {
+    // Same filtering as ConvertToDetection(), but only the best label is
+    // kept, as NonMaxSuppressionCalculator does.
+    int best_label = -1;
+    for (int k = i; k < i + classes_per_detection_; ++k) {
+      if (!IsClassIndexAllowed(detection_classes[k])) continue;
+      if (options_.has_min_score_thresh() &&
+          detection_scores[k] < options_.min_score_thresh()) {
+        continue;
+      }
+      if (best_label < 0 ||
+          detection_scores[k] > detection_scores[best_label]) {
+        best_label = k;
+      }
+    }
+    if (best_label < 0) continue;
+    const int box_offset = i * num_coords_;
+    const float ymin = detection_boxes[box_offset + box_indices_[0]];
+    const float xmin = detection_boxes[box_offset + box_indices_[1]];
+    const float ymax = detection_boxes[box_offset + box_indices_[2]];
+    const float xmax = detection_boxes[box_offset + box_indices_[3]];
+    const float width = xmax - xmin;
+    const float height = ymax - ymin;
+    if (width < 0 || height < 0 || std::isnan(width) || std::isnan(height)) {
+      continue;
+    }
+    const float box_ymin = flip_vertically ? 1.f - ymax : ymin;
+    const float score = detection_scores[best_label];
+    // With multiclass NMS, a box takes part in the suppression of each of
+    // its labels.
+    for (int k = i; k < i + classes_per_detection_; ++k) {
+      if (multiclass) {
+        if (!IsClassIndexAllowed(detection_classes[k])) continue;
+        if (options_.has_min_score_thresh() &&
+            detection_scores[k] < options_.min_score_thresh()) {
+          continue;
+        }
+      } else if (k != best_label) {
+        continue;
+      }
+      nms_boxes_.Add(xmin, box_ymin, xmin + width, box_ymin + height, score,
+                     detection_classes[k]);
+      nms_box_offsets_.push_back(box_offset);
+      nms_box_labels_.push_back(best_label);
+    }
+  }
+
+  nms_->Run(nms_boxes_, &nms_result_, nms_thread_pool_.get());
+  const bool weighted = options_.nms().algorithm() ==
+                        NonMaxSuppressionCalculatorOptions::WEIGHTED;
+  for (int i = 0; i < nms_result_.indices.size(); ++i) {
+    if (max_results_ > 0 && output_detections->size() == max_results_) {
+      break;
+    }
+    const int index = nms_result_.indices[i];
+    const int box_offset = nms_box_offsets_[index];
+    const int label = nms_box_labels_[index];
+    const absl::Span<const int> cluster =
+        weighted ? nms_result_.Cluster(i) : absl::Span<const int>();
+    Detection detection;
+    detection.add_score(detection_scores[label]);
+    detection.add_label_id(detection_classes[label]);
+    LocationData* location_data = detection.mutable_location_data();
+    location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+    LocationData::RelativeBoundingBox* relative_bbox =
+        location_data->mutable_relative_bounding_box();
+    if (cluster.empty()) {
+      const float ymin = detection_boxes[box_offset + box_indices_[0]];
+      const float xmin = detection_boxes[box_offset + box_indices_[1]];
+      const float ymax = detection_boxes[box_offset + box_indices_[2]];
+      const float xmax = detection_boxes[box_offset + box_indices_[3]];
+      relative_bbox->set_xmin(xmin);
+      relative_bbox->set_ymin(flip_vertically ? 1.f - ymax : ymin);
+      relative_bbox->set_width(xmax - xmin);
+      relative_bbox->set_height(ymax - ymin);
+    } else {
+      const NmsWeightedBox box = GetWeightedBox(nms_boxes_, cluster);
+      relative_bbox->set_xmin(box.xmin);
+      relative_bbox->set_ymin(box.ymin);
+      relative_bbox->set_width(box.xmax - box.xmin);
+      relative_bbox->set_height(box.ymax - box.ymin);
+    }
+    if (options_.num_keypoints() > 0) {
+      AddKeypoints(detection_boxes, box_offset, cluster, &detection);
+    }
+    output_detections->push_back(std::move(detection));
   }
   return absl::OkStatus();
 }
 
+void TensorsToDetectionsCalculator::AddKeypoints(const float* detection_boxes,
+                                                 int box_offset,
+                                                 absl::Span<const int> cluster,
+                                                 Detection* detection) {
+  auto* location_data = detection->mutable_location_data();
+  for (int kp_id = 0;
+       kp_id < options_.num_keypoints() * options_.num_values_per_keypoint();
+       kp_id += options_.num_values_per_keypoint()) {
+    const int keypoint_offset = options_.keypoint_coord_offset() + kp_id;
+    float x = 0.0f;
+    float y = 0.0f;
+    if (cluster.empty()) {
+      x = detection_boxes[box_offset + keypoint_offset];
+      y = detection_boxes[box_offset + keypoint_offset + 1];
+    } else {
+      float total_score = 0.0f;
+      for (int index : cluster) {
+        const float score = nms_boxes_.score[index];
+        const int offset = nms_box_offsets_[index] + keypoint_offset;
+        total_score += score;
+        x += detection_boxes[offset] * score;
+        y += detection_boxes[offset + 1] * score;
+      }
+      x /= total_score;
+      y /= total_score;
+    }
+    auto* keypoint = location_data->add_relative_keypoints();
+    keypoint->set_x(x);
+    keypoint->set_y(options_.flip_vertically() ? 1.f - y : y);
+  }
+}
+
 Detection TensorsToDetectionsCalculator::ConvertToDetection(
     float box_ymin, float box_xmin, float box_ymax, float box_xmax,
     absl::Span<const float> scores, absl::Span<const int> class_ids,
@@ -0,0 +1,181 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/substitute.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+using Node = ::mediapipe::CalculatorGraphConfig::Node;
+
+constexpr int kNumBoxes = 3;
+constexpr int kNumClasses = 2;
+
+float Sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+Tensor CreateTensor(const std::vector<int>& dims,
+                    const std::vector<float>& values) {
+  Tensor tensor(Tensor::ElementType::kFloat32, Tensor::Shape(dims));
+  auto view = tensor.GetCpuWriteView();
+  float* buffer = view.buffer<float>();
+  for (int i = 0; i < values.size(); ++i) {
+    buffer[i] = values[i];
+  }
+  return tensor;
+}
+
+// Runs the calculator on `raw_boxes`, `scores` and anchors. Raw boxes default
+// to zero, so that box i decodes to the anchor i: centered at
+// (0.1 + 0.3 * i, 0.5) with a size of 0.2.
+std::vector<Detection> RunCalculator(
+    const std::string& extra_options, const std::vector<float>& scores,
+    const std::vector<float>& raw_boxes = std::vector<float>(kNumBoxes * 4,
+                                                             0.0f)) {
+  CalculatorRunner runner(ParseTextProtoOrDie<Node>(absl::Substitute(
+      R"pb(
+        calculator: "TensorsToDetectionsCalculator"
+        input_stream: "TENSORS:tensors"
+        output_stream: "DETECTIONS:detections"
+        options {
+          [mediapipe.TensorsToDetectionsCalculatorOptions.ext] {
+            num_classes: $0
+            num_boxes: $1
+            num_coords: 4
+            x_scale: 1.0
+            y_scale: 1.0
+            w_scale: 1.0
+            h_scale: 1.0
+            $2
+          }
+        }
+      )pb",
+      kNumClasses, kNumBoxes, extra_options)));
+
+  std::vector<float> anchors;
+  for (int i = 0; i < kNumBoxes; ++i) {
+    anchors.insert(anchors.end(), {/*y_center=*/0.5f,
+                                   /*x_center=*/0.1f + 0.3f * i, /*h=*/0.2f,
+                                   /*w=*/0.2f});
+  }
+  auto tensors = std::make_unique<std::vector<Tensor>>();
+  tensors->push_back(CreateTensor({1, kNumBoxes, 4}, raw_boxes));
+  tensors->push_back(CreateTensor({1, kNumBoxes, kNumClasses}, scores));
+  tensors->push_back(CreateTensor({kNumBoxes, 4}, anchors));
+  runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+      Adopt(tensors.release()).At(Timestamp(0)));
+  ABSL_CHECK_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag("DETECTIONS").packets;
+  ABSL_CHECK_EQ(packets.size(), 1);
+  return packets[0].Get<std::vector<Detection>>();
+}
+
+TEST(TensorsToDetectionsCalculatorTest, KeepsBoxesAboveSigmoidThreshold) {
+  const std::vector<Detection> detections = RunCalculator(
+      "sigmoid_score: true min_score_thresh: 0.5",
+      {/*box 0*/ -5.0f, -4.0f, /*box 1*/ 1.0f, 3.0f, /*box 2*/ 2.0f, -1.0f});
+
+  ASSERT_EQ(detections.size(), 2);
+  EXPECT_EQ(detections[0].label_id(0), 1);
+  EXPECT_FLOAT_EQ(detections[0].score(0), Sigmoid(3.0f));
+  const auto& box = detections[0].location_data().relative_bounding_box();
+  EXPECT_NEAR(box.xmin(), 0.3f, 1e-6f);
+  EXPECT_NEAR(box.ymin(), 0.4f, 1e-6f);
+  EXPECT_NEAR(box.width(), 0.2f, 1e-6f);
+  EXPECT_NEAR(box.height(), 0.2f, 1e-6f);
+  EXPECT_EQ(detections[1].label_id(0), 0);
+  EXPECT_FLOAT_EQ(detections[1].score(0), Sigmoid(2.0f));
+  EXPECT_NEAR(detections[1].location_data().relative_bounding_box().xmin(),
+              0.6f, 1e-6f);
+}
+
+TEST(TensorsToDetectionsCalculatorTest, SkipsIgnoredClasses) {
+  const std::vector<Detection> detections = RunCalculator(
+      "sigmoid_score: true min_score_thresh: 0.5 ignore_classes: 1",
+      {/*box 0*/ -5.0f, -4.0f, /*box 1*/ 1.0f, 3.0f, /*box 2*/ -2.0f, 4.0f});
+
+  ASSERT_EQ(detections.size(), 1);
+  EXPECT_EQ(detections[0].label_id(0), 0);
+  EXPECT_FLOAT_EQ(detections[0].score(0), Sigmoid(1.0f));
+}
+
+TEST(TensorsToDetectionsCalculatorTest, StopsAtMaxResults) {
+  const std::vector<Detection> detections = RunCalculator(
+      "min_score_thresh: 0.5 max_results: 1",
+      {/*box 0*/ 0.1f, 0.2f, /*box 1*/ 0.7f, 0.6f, /*box 2*/ 0.9f, 0.8f});
+
+  ASSERT_EQ(detections.size(), 1);
+  EXPECT_EQ(detections[0].label_id(0), 0);
+  EXPECT_FLOAT_EQ(detections[0].score(0), 0.7f);
+}
+
+TEST(TensorsToDetectionsCalculatorTest, ClippedScoresPickFirstClass) {
+  const std::vector<Detection> detections = RunCalculator(
+      "sigmoid_score: true score_clipping_thresh: 1.0 min_score_thresh: 0.5",
+      {/*box 0*/ 2.0f, 3.0f, /*box 1*/ -3.0f, -2.0f, /*box 2*/ -3.0f, -2.0f});
+
+  ASSERT_EQ(detections.size(), 1);
+  EXPECT_EQ(detections[0].label_id(0), 0);
+  EXPECT_FLOAT_EQ(detections[0].score(0), Sigmoid(1.0f));
+}
+
+TEST(TensorsToDetectionsCalculatorTest, KeepsAllBoxesWithoutThreshold) {
+  const std::vector<Detection> detections = RunCalculator(
+      "", {/*box 0*/ 0.1f, 0.2f, /*box 1*/ 0.7f, 0.6f, /*box 2*/ 0.9f, 0.8f});
+
+  ASSERT_EQ(detections.size(), kNumBoxes);
+  EXPECT_EQ(detections[0].label_id(0), 1);
+  EXPECT_EQ(detections[1].label_id(0), 0);
+  EXPECT_EQ(detections[2].label_id(0), 0);
+}
+
+TEST(TensorsToDetectionsCalculatorTest, SuppressesOverlappingBoxes) {
+  // Box 1 is moved onto box 0.
+  const std::vector<Detection> detections = RunCalculator(
+      R"pb(nms {
+             min_suppression_threshold: 0.3
+             overlap_type: INTERSECTION_OVER_UNION
+           })pb",
+      {/*box 0*/ 0.1f, 0.6f, /*box 1*/ 0.9f, 0.2f, /*box 2*/ 0.7f, 0.3f},
+      {/*box 0*/ 0.0f, 0.0f, 0.0f, 0.0f, /*box 1*/ 0.0f, -1.5f, 0.0f, 0.0f,
+       /*box 2*/ 0.0f, 0.0f, 0.0f, 0.0f});
+
+  ASSERT_EQ(detections.size(), 2);
+  EXPECT_EQ(detections[0].label_id(0), 0);
+  EXPECT_FLOAT_EQ(detections[0].score(0), 0.9f);
+  EXPECT_NEAR(detections[0].location_data().relative_bounding_box().xmin(),
+              0.0f, 1e-6f);
+  EXPECT_EQ(detections[1].label_id(0), 0);
+  EXPECT_FLOAT_EQ(detections[1].score(0), 0.7f);
+  EXPECT_NEAR(detections[1].location_data().relative_bounding_box().xmin(),
+              0.6f, 1e-6f);
+}
+
+}  // namespace
+}  // namespace mediapipe
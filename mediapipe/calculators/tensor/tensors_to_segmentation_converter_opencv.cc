@@ -14,15 +14,13 @@
 
 #include "mediapipe/calculators/tensor/tensors_to_segmentation_converter_opencv.h"
 
-#include <algorithm>
-#include <cmath>
 #include <memory>
-#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
 #include "mediapipe/calculators/tensor/tensors_to_segmentation_converter.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_cpu_utils.h"
 #include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
 #include "mediapipe/framework/formats/image.h"
 #include "mediapipe/framework/formats/image_frame.h"
@@ -36,7 +34,10 @@
 namespace mediapipe {
 namespace {
 
+using ::mediapipe::tensors_to_segmentation_utils::ActivateChannel;
 using ::mediapipe::tensors_to_segmentation_utils::GetHwcFromDims;
+using ::mediapipe::tensors_to_segmentation_utils::SegmentationActivation;
+using ::mediapipe::tensors_to_segmentation_utils::SegmentationTensor;
 
 class TensorsToSegmentationOpenCvConverter
     : public TensorsToSegmentationConverter {
@@ -51,9 +52,6 @@ class TensorsToSegmentationOpenCvConverter
                                                  int output_height) override;
 
  private:
-  template <class T>
-  absl::Status ApplyActivation(cv::Mat& tensor_mat, cv::Mat* small_mask_mat);
-
   TensorsToSegmentationCalculatorOptions options_;
 };
 
@@ -66,29 +64,41 @@ TensorsToSegmentationOpenCvConverter::Convert(const Tensor& input_tensor,
   // Create initial working mask.
   cv::Mat small_mask_mat(cv::Size(tensor_width, tensor_height), CV_32FC1);
 
-  // Wrap input tensor.
-  auto raw_input_tensor = &input_tensor;
-  auto raw_input_view = raw_input_tensor->GetCpuReadView();
-  const float* raw_input_data = raw_input_view.buffer<float>();
-  cv::Mat tensor_mat(cv::Size(tensor_width, tensor_height),
-                     CV_MAKETYPE(CV_32F, tensor_channels),
-                     const_cast<float*>(raw_input_data));
+  auto raw_input_view = input_tensor.GetCpuReadView();
+  const SegmentationTensor tensor = {raw_input_view.buffer<float>(),
+                                     tensor_height, tensor_width,
+                                     tensor_channels};
 
   // Process mask tensor and apply activation function.
+  using Options = ::mediapipe::TensorsToSegmentationCalculatorOptions;
+  SegmentationActivation activation = SegmentationActivation::kNone;
+  int channel = 0;
   if (tensor_channels == 2) {
-    MP_RETURN_IF_ERROR(ApplyActivation<cv::Vec2f>(tensor_mat, &small_mask_mat));
+    switch (options_.activation()) {
+      case Options::NONE:
+        break;
+      case Options::SIGMOID:
+        activation = SegmentationActivation::kSigmoid;
+        break;
+      case Options::SOFTMAX:
+        activation = SegmentationActivation::kSoftmax;
+        channel = options_.output_layer_index();
+        RET_CHECK(channel == 0 || channel == 1)
+            << "Invalid output_layer_index " << channel;
+        break;
+    }
   } else if (tensor_channels == 1) {
-    RET_CHECK(mediapipe::TensorsToSegmentationCalculatorOptions::SOFTMAX !=
-              options_.activation());  // Requires 2 channels.
-    if (mediapipe::TensorsToSegmentationCalculatorOptions::NONE ==
-        options_.activation())  // Pass-through optimization.
-      tensor_mat.copyTo(small_mask_mat);
-    else
-      MP_RETURN_IF_ERROR(ApplyActivation<float>(tensor_mat, &small_mask_mat));
+    // SOFTMAX requires 2 channels.
+    RET_CHECK(Options::SOFTMAX != options_.activation());
+    if (Options::SIGMOID == options_.activation()) {
+      activation = SegmentationActivation::kSigmoid;
+    }
   } else {
     RET_CHECK_FAIL() << "Unsupported number of tensor channels "
                      << tensor_channels;
   }
+  ActivateChannel(tensor, activation, channel, small_mask_mat.ptr<float>(),
+                  small_mask_mat.step1());
 
   // Send out image as CPU packet.
   std::shared_ptr<ImageFrame> mask_frame = std::make_shared<ImageFrame>(
@@ -101,54 +111,6 @@ TensorsToSegmentationOpenCvConverter::Convert(const Tensor& input_tensor,
   return output_mask;
 }
 
-template <class T>
-absl::Status TensorsToSegmentationOpenCvConverter::ApplyActivation(
-    cv::Mat& tensor_mat, cv::Mat* small_mask_mat) {
-  // Configure activation function.
-  const int output_layer_index = options_.output_layer_index();
-  using Options = ::mediapipe::TensorsToSegmentationCalculatorOptions;
-  const auto activation_fn = [&](const cv::Vec2f& mask_value) {
-    float new_mask_value = 0;
-    // TODO consider moving switch out of the loop,
-    // and also avoid float/Vec2f casting.
-    switch (options_.activation()) {
-      case Options::NONE: {
-        new_mask_value = mask_value[0];
-        break;
-      }
-      case Options::SIGMOID: {
-        const float pixel0 = mask_value[0];
-        new_mask_value = 1.0 / (std::exp(-pixel0) + 1.0);
-        break;
-      }
-      case Options::SOFTMAX: {
-        const float pixel0 = mask_value[0];
-        const float pixel1 = mask_value[1];
-        const float max_pixel = std::max(pixel0, pixel1);
-        const float min_pixel = std::min(pixel0, pixel1);
-        const float softmax_denom =
-            /*exp(max_pixel - max_pixel)=*/1.0f +
-            std::exp(min_pixel - max_pixel);
-        new_mask_value = std::exp(mask_value[output_layer_index] - max_pixel) /
-                         softmax_denom;
-        break;
-      }
-    }
-    return new_mask_value;
-  };
-
-  // Process mask tensor.
-  for (int i = 0; i < tensor_mat.rows; ++i) {
-    for (int j = 0; j < tensor_mat.cols; ++j) {
-      const T& input_pix = tensor_mat.at<T>(i, j);
-      const float mask_value = activation_fn(input_pix);
-      small_mask_mat->at<float>(i, j) = mask_value;
-    }
-  }
-
-  return absl::OkStatus();
-}
-
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<TensorsToSegmentationConverter>>
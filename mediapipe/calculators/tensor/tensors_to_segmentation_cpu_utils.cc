@@ -0,0 +1,224 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_cpu_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+
+namespace mediapipe {
+namespace tensors_to_segmentation_utils {
+namespace {
+
+constexpr uint8_t kForegroundPixelValue = 0;
+constexpr uint8_t kUnLabeledPixelValue = 255;
+// Output rows per parallel task of ComputeCategoryMask().
+constexpr int kRowsPerStripe = 16;
+
+float Sigmoid(float value) { return 1.0f / (1.0f + std::exp(-value)); }
+
+// Numerically stable softmax of `values[channel]` over `num_channels` values.
+float Softmax(const float* values, int num_channels, int channel) {
+  const float max_value = *std::max_element(values, values + num_channels);
+  float denominator = 0.0f;
+  for (int c = 0; c < num_channels; ++c) {
+    denominator += std::exp(values[c] - max_value);
+  }
+  return std::exp(values[channel] - max_value) / denominator;
+}
+
+// Whether Sigmoid(value) > 0.5. Sigmoid() is monotonic, so it only needs to
+// be evaluated close to 0, where rounding decides.
+bool SigmoidAboveHalf(float value) {
+  if (value > 1e-3f) return true;
+  if (value <= 0.0f) return false;
+  return Sigmoid(value) > 0.5f;
+}
+
+// Index of the first largest value, as std::max_element() finds it.
+int ArgMax(const float* values, int num_channels) {
+  int best = 0;
+  for (int c = 1; c < num_channels; ++c) {
+    if (values[best] < values[c]) best = c;
+  }
+  return best;
+}
+
+// ArgMax() of the sigmoid of `values`. Sigmoid() is monotonic but can map
+// distinct values to the same float, in which case the first one wins, so
+// only channels before the raw ArgMax() need to be activated.
+int SigmoidArgMax(const float* values, int num_channels, float* activated) {
+  const int best = ArgMax(values, num_channels);
+  bool has_nan = false;
+  for (int c = 0; c < num_channels; ++c) has_nan |= std::isnan(values[c]);
+  if (has_nan) {
+    // Comparisons with NaN don't order, so follow std::max_element() exactly.
+    for (int c = 0; c < num_channels; ++c) activated[c] = Sigmoid(values[c]);
+    return ArgMax(activated, num_channels);
+  }
+  const float best_score = Sigmoid(values[best]);
+  for (int c = 0; c < best; ++c) {
+    if (Sigmoid(values[c]) == best_score) return c;
+  }
+  return best;
+}
+
+// Interpolation source and weight of one output coordinate, as in
+// (x0, x1, t) -> v[x0] + (v[x1] - v[x0]) * t.
+struct Sample {
+  int x0;
+  int x1;
+  float t;
+};
+
+// Aligned corners sampling of `input_size` values at `output_size` points.
+std::vector<Sample> GetSamples(int input_size, int output_size) {
+  const float scale = (input_size - 1) / static_cast<float>(output_size - 1);
+  std::vector<Sample> samples(output_size);
+  for (int i = 0; i < output_size; ++i) {
+    const float position = i * scale;
+    Sample& sample = samples[i];
+    sample.x0 = static_cast<int>(std::max(std::floor(position), 0.f));
+    sample.x1 = static_cast<int>(
+        std::min(std::ceil(position), input_size - 1.f));
+    sample.t = std::max(std::min(position - sample.x0, 1.f), 0.f);
+  }
+  return samples;
+}
+
+}  // namespace
+
+void ActivateChannel(const SegmentationTensor& tensor,
+                     SegmentationActivation activation, int channel,
+                     float* output, int output_stride) {
+  const int channels = tensor.channels;
+  const int row_size = tensor.width * channels;
+  for (int y = 0; y < tensor.height; ++y) {
+    const float* input = tensor.data + y * row_size + channel;
+    float* output_row = output + y * output_stride;
+    switch (activation) {
+      case SegmentationActivation::kNone:
+        for (int x = 0; x < tensor.width; ++x) {
+          output_row[x] = input[x * channels];
+        }
+        break;
+      case SegmentationActivation::kSigmoid:
+        for (int x = 0; x < tensor.width; ++x) {
+          output_row[x] = Sigmoid(input[x * channels]);
+        }
+        break;
+      case SegmentationActivation::kSoftmax:
+        input -= channel;
+        for (int x = 0; x < tensor.width; ++x) {
+          output_row[x] = Softmax(input + x * channels, channels, channel);
+        }
+        break;
+    }
+  }
+}
+
+void ActivateChannels(const SegmentationTensor& tensor,
+                      SegmentationActivation activation,
+                      absl::Span<float* const> outputs, int output_stride) {
+  const int channels = tensor.channels;
+  if (activation != SegmentationActivation::kSoftmax) {
+    for (int c = 0; c < channels; ++c) {
+      ActivateChannel(tensor, activation, c, outputs[c], output_stride);
+    }
+    return;
+  }
+  std::vector<float> exps(channels);
+  for (int y = 0; y < tensor.height; ++y) {
+    const float* input = tensor.data + y * tensor.width * channels;
+    const int offset = y * output_stride;
+    for (int x = 0; x < tensor.width; ++x, input += channels) {
+      const float max_value = *std::max_element(input, input + channels);
+      float denominator = 0.0f;
+      for (int c = 0; c < channels; ++c) {
+        exps[c] = std::exp(input[c] - max_value);
+        denominator += exps[c];
+      }
+      for (int c = 0; c < channels; ++c) {
+        outputs[c][offset + x] = exps[c] / denominator;
+      }
+    }
+  }
+}
+
+void ComputeCategoryMask(const SegmentationTensor& tensor,
+                         SegmentationActivation activation, int output_width,
+                         int output_height, uint8_t* output,
+                         int output_stride) {
+  const int channels = tensor.channels;
+  const bool sigmoid = activation == SegmentationActivation::kSigmoid;
+  const std::vector<Sample> columns = GetSamples(tensor.width, output_width);
+  const std::vector<Sample> rows = GetSamples(tensor.height, output_height);
+  const int num_stripes =
+      (output_height + kRowsPerStripe - 1) / kRowsPerStripe;
+
+  cv::parallel_for_(cv::Range(0, num_stripes), [&](const cv::Range& range) {
+    // The tensor row interpolated at the current output row, and the scores
+    // of the current pixel.
+    std::vector<float> row_scores(tensor.width * channels);
+    std::vector<float> scores(channels);
+    std::vector<float> activated(channels);
+    const Sample* last_row = nullptr;
+    const int begin = range.start * kRowsPerStripe;
+    const int end = std::min(range.end * kRowsPerStripe, output_height);
+    for (int y = begin; y < end; ++y) {
+      const Sample& row = rows[y];
+      if (last_row == nullptr || row.x0 != last_row->x0 ||
+          row.x1 != last_row->x1 || row.t != last_row->t) {
+        const int row_size = tensor.width * channels;
+        const float* top = tensor.data + row.x0 * row_size;
+        const float* bottom = tensor.data + row.x1 * row_size;
+        for (int i = 0; i < row_size; ++i) {
+          row_scores[i] = top[i] + (bottom[i] - top[i]) * row.t;
+        }
+        last_row = &row;
+      }
+      uint8_t* mask = output + y * output_stride;
+      if (channels == 1) {
+        for (int x = 0; x < output_width; ++x) {
+          const Sample& column = columns[x];
+          const float left = row_scores[column.x0];
+          const float score = left + (row_scores[column.x1] - left) * column.t;
+          const bool foreground =
+              sigmoid ? SigmoidAboveHalf(score) : score > 0.5f;
+          mask[x] = foreground ? kForegroundPixelValue : kUnLabeledPixelValue;
+        }
+        continue;
+      }
+      for (int x = 0; x < output_width; ++x) {
+        const Sample& column = columns[x];
+        const float* left = row_scores.data() + column.x0 * channels;
+        const float* right = row_scores.data() + column.x1 * channels;
+        for (int c = 0; c < channels; ++c) {
+          scores[c] = left[c] + (right[c] - left[c]) * column.t;
+        }
+        mask[x] = sigmoid ? SigmoidArgMax(scores.data(), channels,
+                                          activated.data())
+                          : ArgMax(scores.data(), channels);
+      }
+    }
+  });
+}
+
+}  // namespace tensors_to_segmentation_utils
+}  // namespace mediapipe
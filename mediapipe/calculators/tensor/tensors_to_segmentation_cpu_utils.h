@@ -0,0 +1,66 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_CPU_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_CPU_UTILS_H_
+
+#include <cstdint>
+
+#include "absl/types/span.h"
+
+// CPU kernels shared by the segmentation postprocessing calculators. They
+// work on float HWC tensors and write to caller owned masks, so that results
+// can go straight into ImageFrame buffers.
+namespace mediapipe {
+namespace tensors_to_segmentation_utils {
+
+enum class SegmentationActivation { kNone, kSigmoid, kSoftmax };
+
+// A float tensor in HWC layout.
+struct SegmentationTensor {
+  const float* data;
+  int height;
+  int width;
+  int channels;
+};
+
+// Writes the activated values of `channel` to `output`, a tensor sized mask
+// with rows `output_stride` floats apart. SOFTMAX is taken over all the
+// channels of a pixel.
+void ActivateChannel(const SegmentationTensor& tensor,
+                     SegmentationActivation activation, int channel,
+                     float* output, int output_stride);
+
+// Same as ActivateChannel() for all the channels at once: `outputs[c]`
+// receives channel c. Each pixel is read, and its softmax computed, once.
+void ActivateChannels(const SegmentationTensor& tensor,
+                      SegmentationActivation activation,
+                      absl::Span<float* const> outputs, int output_stride);
+
+// Fills the `output_width` x `output_height` category mask `output`, with rows
+// `output_stride` bytes apart, in a single pass over the tensor. Scores are
+// bilinearly interpolated with aligned corners, and each pixel is set to the
+// index of its highest scoring channel. A single channel tensor is treated as
+// a foreground mask instead: pixels with an activated score above 0.5 are set
+// to 0, and the others to 255. Only SIGMOID changes the result, as SOFTMAX
+// preserves the highest scoring channel. Rows are processed in parallel.
+void ComputeCategoryMask(const SegmentationTensor& tensor,
+                         SegmentationActivation activation, int output_width,
+                         int output_height, uint8_t* output,
+                         int output_stride);
+
+}  // namespace tensors_to_segmentation_utils
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_CPU_UTILS_H_
@@ -0,0 +1,176 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_cpu_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe::tensors_to_segmentation_utils {
+namespace {
+
+using ::testing::Each;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::FloatNear;
+using ::testing::Pointwise;
+
+std::vector<float> RandomValues(int size) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> distribution(-4.0f, 4.0f);
+  std::vector<float> values(size);
+  for (float& value : values) value = distribution(rng);
+  return values;
+}
+
+// Per pixel reference of ComputeCategoryMask().
+std::vector<uint8_t> GetCategoryMask(const SegmentationTensor& tensor,
+                                     bool sigmoid, int output_width,
+                                     int output_height) {
+  const float width_scale =
+      (tensor.width - 1) / static_cast<float>(output_width - 1);
+  const float height_scale =
+      (tensor.height - 1) / static_cast<float>(output_height - 1);
+  auto value = [&tensor](int x, int y, int c) {
+    return tensor.data[(y * tensor.width + x) * tensor.channels + c];
+  };
+  std::vector<uint8_t> mask;
+  std::vector<float> scores(tensor.channels);
+  for (int i = 0; i < output_height; ++i) {
+    for (int j = 0; j < output_width; ++j) {
+      const float y = i * height_scale;
+      const float x = j * width_scale;
+      const int y0 = std::max(std::floor(y), 0.f);
+      const int x0 = std::max(std::floor(x), 0.f);
+      const int y1 = std::min(std::ceil(y), tensor.height - 1.f);
+      const int x1 = std::min(std::ceil(x), tensor.width - 1.f);
+      const float ty = std::max(std::min(y - y0, 1.f), 0.f);
+      const float tx = std::max(std::min(x - x0, 1.f), 0.f);
+      for (int c = 0; c < tensor.channels; ++c) {
+        const float left =
+            value(x0, y0, c) + (value(x0, y1, c) - value(x0, y0, c)) * ty;
+        const float right =
+            value(x1, y0, c) + (value(x1, y1, c) - value(x1, y0, c)) * ty;
+        scores[c] = left + (right - left) * tx;
+        if (sigmoid) scores[c] = 1.0f / (1.0f + std::exp(-scores[c]));
+      }
+      if (tensor.channels == 1) {
+        mask.push_back(scores[0] > 0.5f ? 0 : 255);
+      } else {
+        mask.push_back(std::max_element(scores.begin(), scores.end()) -
+                       scores.begin());
+      }
+    }
+  }
+  return mask;
+}
+
+TEST(TensorsToSegmentationCpuUtilsTest, ActivatesChannel) {
+  const std::vector<float> values = {0.2f, 1.5f, -0.6f, 3.4f};
+  const SegmentationTensor tensor = {values.data(), /*height=*/1,
+                                     /*width=*/2, /*channels=*/2};
+  std::vector<float> mask(2);
+
+  ActivateChannel(tensor, SegmentationActivation::kNone, 1, mask.data(), 2);
+  EXPECT_THAT(mask, ElementsAre(1.5f, 3.4f));
+  ActivateChannel(tensor, SegmentationActivation::kSigmoid, 0, mask.data(), 2);
+  EXPECT_THAT(mask, Pointwise(FloatNear(1e-5f), {0.54983f, 0.35434f}));
+  ActivateChannel(tensor, SegmentationActivation::kSoftmax, 1, mask.data(), 2);
+  EXPECT_THAT(mask, Pointwise(FloatNear(1e-5f), {0.78583f, 0.98201f}));
+}
+
+TEST(TensorsToSegmentationCpuUtilsTest, ActivatesAllChannels) {
+  const std::vector<float> values = RandomValues(3 * 5 * 4);
+  const SegmentationTensor tensor = {values.data(), /*height=*/3,
+                                     /*width=*/5, /*channels=*/4};
+  std::vector<std::vector<float>> masks(4, std::vector<float>(15));
+  std::vector<float*> outputs;
+  for (auto& mask : masks) outputs.push_back(mask.data());
+
+  ActivateChannels(tensor, SegmentationActivation::kSoftmax, outputs,
+                   /*output_stride=*/5);
+
+  std::vector<float> expected(15);
+  for (int c = 0; c < 4; ++c) {
+    ActivateChannel(tensor, SegmentationActivation::kSoftmax, c,
+                    expected.data(), /*output_stride=*/5);
+    EXPECT_THAT(masks[c], ElementsAreArray(expected));
+  }
+}
+
+TEST(TensorsToSegmentationCpuUtilsTest, ComputesUpsampledCategoryMask) {
+  const std::vector<float> values = RandomValues(7 * 5 * 3);
+  const SegmentationTensor tensor = {values.data(), /*height=*/7,
+                                     /*width=*/5, /*channels=*/3};
+  constexpr int kWidth = 23;
+  constexpr int kHeight = 41;
+  std::vector<uint8_t> mask(kWidth * kHeight);
+
+  ComputeCategoryMask(tensor, SegmentationActivation::kSoftmax, kWidth,
+                      kHeight, mask.data(), kWidth);
+  EXPECT_EQ(mask, GetCategoryMask(tensor, /*sigmoid=*/false, kWidth, kHeight));
+
+  ComputeCategoryMask(tensor, SegmentationActivation::kSigmoid, kWidth,
+                      kHeight, mask.data(), kWidth);
+  EXPECT_EQ(mask, GetCategoryMask(tensor, /*sigmoid=*/true, kWidth, kHeight));
+}
+
+TEST(TensorsToSegmentationCpuUtilsTest, ComputesForegroundMask) {
+  const std::vector<float> values = RandomValues(6 * 6);
+  const SegmentationTensor tensor = {values.data(), /*height=*/6,
+                                     /*width=*/6, /*channels=*/1};
+  constexpr int kSize = 17;
+  // Rows are padded.
+  constexpr int kStride = 20;
+  std::vector<uint8_t> mask(kSize * kStride);
+
+  for (bool sigmoid : {false, true}) {
+    ComputeCategoryMask(tensor,
+                        sigmoid ? SegmentationActivation::kSigmoid
+                                : SegmentationActivation::kNone,
+                        kSize, kSize, mask.data(), kStride);
+    const std::vector<uint8_t> expected =
+        GetCategoryMask(tensor, sigmoid, kSize, kSize);
+    for (int y = 0; y < kSize; ++y) {
+      EXPECT_TRUE(std::equal(expected.begin() + y * kSize,
+                             expected.begin() + (y + 1) * kSize,
+                             mask.begin() + y * kStride));
+    }
+  }
+}
+
+TEST(TensorsToSegmentationCpuUtilsTest, SaturatedSigmoidPicksFirstCategory) {
+  // Both scores of every pixel have a sigmoid of 1.
+  const std::vector<float> values = {30.0f, 40.0f, 30.0f, 40.0f,
+                                     30.0f, 40.0f, 30.0f, 40.0f};
+  const SegmentationTensor tensor = {values.data(), /*height=*/2,
+                                     /*width=*/2, /*channels=*/2};
+  std::vector<uint8_t> mask(9);
+
+  ComputeCategoryMask(tensor, SegmentationActivation::kNone, 3, 3,
+                      mask.data(), 3);
+  EXPECT_THAT(mask, Each(1));
+  ComputeCategoryMask(tensor, SegmentationActivation::kSigmoid, 3, 3,
+                      mask.data(), 3);
+  EXPECT_THAT(mask, Each(0));
+}
+
+}  // namespace
+}  // namespace mediapipe::tensors_to_segmentation_utils
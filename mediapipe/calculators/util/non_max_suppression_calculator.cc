@@ -18,21 +18,21 @@
 #include <utility>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
-#include "absl/log/absl_log.h"
+#include "absl/types/span.h"
 #include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/calculators/util/non_max_suppression_engine.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/detection.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/location.h"
 #include "mediapipe/framework/port/rectangle.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 
 namespace mediapipe {
 
 typedef std::vector<Detection> Detections;
-typedef std::vector<std::pair<int, float>> IndexedScores;
 
 namespace {
 
@@ -75,68 +75,6 @@ bool RetainMaxScoringLabelOnly(Detection* detection) {
   return true;
 }
 
-// Computes an overlap similarity between two rectangles. Similarity measure is
-// defined by overlap_type parameter.
-float OverlapSimilarity(
-    const NonMaxSuppressionCalculatorOptions::OverlapType overlap_type,
-    const Rectangle_f& rect1, const Rectangle_f& rect2) {
-  if (!rect1.Intersects(rect2)) return 0.0f;
-  const float intersection_area = Rectangle_f(rect1).Intersect(rect2).Area();
-  float normalization;
-  switch (overlap_type) {
-    case NonMaxSuppressionCalculatorOptions::JACCARD:
-      normalization = Rectangle_f(rect1).Union(rect2).Area();
-      break;
-    case NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD:
-      normalization = rect2.Area();
-      break;
-    case NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION:
-      normalization = rect1.Area() + rect2.Area() - intersection_area;
-      break;
-    default:
-      ABSL_LOG(FATAL) << "Unrecognized overlap type: " << overlap_type;
-  }
-  return normalization > 0.0f ? intersection_area / normalization : 0.0f;
-}
-
-// Computes an overlap similarity between two locations by first extracting the
-// relative box (dimension normalized by frame width/height) from the location.
-float OverlapSimilarity(
-    const int frame_width, const int frame_height,
-    const NonMaxSuppressionCalculatorOptions::OverlapType overlap_type,
-    const Location& location1, const Location& location2) {
-  const auto rect1 = location1.ConvertToRelativeBBox(frame_width, frame_height);
-  const auto rect2 = location2.ConvertToRelativeBBox(frame_width, frame_height);
-  return OverlapSimilarity(overlap_type, rect1, rect2);
-}
-
-// Computes an overlap similarity between two locations by first extracting the
-// relative box from the location. It assumes that a relative-box representation
-// is already available in the location, and therefore frame width and height
-// are not needed for further normalization.
-float OverlapSimilarity(
-    const NonMaxSuppressionCalculatorOptions::OverlapType overlap_type,
-    const Location& location1, const Location& location2) {
-  const auto rect1 = location1.GetRelativeBBox();
-  const auto rect2 = location2.GetRelativeBBox();
-  return OverlapSimilarity(overlap_type, rect1, rect2);
-}
-
-// Copy all the scores (there is a single score in each detection after
-// pruning detections) to an indexed vector for sorting. The first value is
-// the index of the detection in the original vector from which the score
-// stems, while the second is the actual score.
-IndexedScores GetIndexedScores(const Detections& detections) {
-  IndexedScores indexed_scores;
-  indexed_scores.reserve(detections.size());
-  for (int index = 0; index < detections.size(); ++index) {
-    indexed_scores.push_back(
-        std::make_pair(index, detections.at(index).score(0)));
-  }
-  std::sort(indexed_scores.begin(), indexed_scores.end(), SortBySecond);
-  return indexed_scores;
-}
-
 }  // namespace
 
 // A calculator performing non-maximum suppression on a set of detections.
@@ -194,6 +132,12 @@ class NonMaxSuppressionCalculator : public CalculatorBase {
         << "max_num_detections=0 is not a valid value. Please choose a "
         << "positive number of you want to limit the number of output "
         << "detections, or set -1 if you do not want any limit.";
+    nms_ = std::make_unique<NonMaxSuppressionEngine>(options_);
+    if (options_.multiclass_nms() && options_.num_threads() > 1) {
+      thread_pool_ = std::make_unique<ThreadPool>("NonMaxSuppression",
+                                                  options_.num_threads());
+      thread_pool_->StartWorkers();
+    }
     return absl::OkStatus();
   }
 
@@ -219,40 +163,60 @@ class NonMaxSuppressionCalculator : public CalculatorBase {
       }
       return absl::OkStatus();
     }
-    auto retained_detections = std::make_unique<Detections>();
-    if (options_.multiclass_nms()) {
-      absl::flat_hash_map<int, Detections> category_index_to_detections;
-      for (const auto& detection : input_detections) {
-        for (int index : detection.label_id()) {
-          category_index_to_detections[index].push_back(detection);
-        }
+    // Remove all but the maximum scoring label from each input detection. This
+    // corresponds to non-maximum suppression among detections which have
+    // identical locations. Boxes are extracted once per detection, so that
+    // the suppression itself doesn't touch the protos.
+    const bool weighted =
+        options_.algorithm() == NonMaxSuppressionCalculatorOptions::WEIGHTED;
+    // Weighted NMS only supports relative bounding boxes.
+    const ImageFrame* frame = nullptr;
+    if (cc->Inputs().HasTag(kImageTag) && !weighted) {
+      frame = &cc->Inputs().Tag(kImageTag).Get<ImageFrame>();
+    }
+    Detections pruned_detections;
+    pruned_detections.reserve(input_detections.size());
+    boxes_.Clear();
+    box_detections_.clear();
+    for (auto& detection : input_detections) {
+      label_ids_.assign(detection.label_id().begin(),
+                        detection.label_id().end());
+      if (!RetainMaxScoringLabelOnly(&detection)) {
+        continue;
       }
-      // For each category, do non-maximum suppression separately.
-      Detections detections_nms;
-      for (auto& [index, detections] : category_index_to_detections) {
-        auto retained_detections_per_category = std::make_unique<Detections>();
-        DoNonMaxSuppression(detections, cc,
-                            retained_detections_per_category.get());
-        detections_nms.insert(detections_nms.end(),
-                              retained_detections_per_category->begin(),
-                              retained_detections_per_category->end());
+      const Location location(detection.location_data());
+      const Rectangle_f rect =
+          frame != nullptr
+              ? location.ConvertToRelativeBBox(frame->Width(), frame->Height())
+              : location.GetRelativeBBox();
+      // With multiclass NMS, a detection takes part in the suppression of
+      // each of its classes.
+      if (options_.multiclass_nms()) {
+        for (int label_id : label_ids_) {
+          boxes_.Add(rect.xmin(), rect.ymin(), rect.xmax(), rect.ymax(),
+                     detection.score(0), label_id);
+          box_detections_.push_back(pruned_detections.size());
+        }
+      } else {
+        boxes_.Add(rect.xmin(), rect.ymin(), rect.xmax(), rect.ymax(),
+                   detection.score(0));
+        box_detections_.push_back(pruned_detections.size());
       }
+      pruned_detections.push_back(std::move(detection));
+    }
 
-      // Descending sort and shrink the collected detections according to max
-      // num detections.
-      IndexedScores indexed_scores = GetIndexedScores(detections_nms);
-      int max_num_detections = static_cast<int>(indexed_scores.size());
-      if (options_.max_num_detections() > -1) {
-        max_num_detections =
-            std::min(max_num_detections, options_.max_num_detections());
-      }
-      retained_detections->reserve(max_num_detections);
-      for (int i = 0; i < max_num_detections; i++) {
-        retained_detections->push_back(
-            detections_nms.at(indexed_scores.at(i).first));
+    nms_->Run(boxes_, &nms_result_, thread_pool_.get());
+    auto retained_detections = std::make_unique<Detections>();
+    retained_detections->reserve(nms_result_.indices.size());
+    for (int i = 0; i < nms_result_.indices.size(); ++i) {
+      const Detection& detection =
+          pruned_detections[box_detections_[nms_result_.indices[i]]];
+      if (weighted) {
+        retained_detections->push_back(GetWeightedDetection(
+            detection, nms_result_.Cluster(i), pruned_detections));
+      } else {
+        retained_detections->push_back(detection);
       }
-    } else {
-      DoNonMaxSuppression(input_detections, cc, retained_detections.get());
     }
     cc->Outputs().Index(0).Add(retained_detections.release(),
                                cc->InputTimestamp());
@@ -260,166 +224,58 @@ class NonMaxSuppressionCalculator : public CalculatorBase {
   }
 
  private:
-  void DoNonMaxSuppression(Detections& input_detections, CalculatorContext* cc,
-                           Detections* output_detections) {
-    // Remove all but the maximum scoring label from each input detection. This
-    // corresponds to non-maximum suppression among detections which have
-    // identical locations.
-    Detections pruned_detections;
-    pruned_detections.reserve(input_detections.size());
-    for (auto& detection : input_detections) {
-      if (RetainMaxScoringLabelOnly(&detection)) {
-        pruned_detections.push_back(detection);
-      }
+  // Averages the box and keypoints of the `cluster` detections, weighted by
+  // their scores.
+  Detection GetWeightedDetection(const Detection& detection,
+                                 absl::Span<const int> cluster,
+                                 const Detections& detections) {
+    auto weighted_detection = detection;
+    if (cluster.empty()) {
+      return weighted_detection;
     }
-    IndexedScores indexed_scores = GetIndexedScores(pruned_detections);
-    const int max_num_detections =
-        (options_.max_num_detections() > -1)
-            ? options_.max_num_detections()
-            : static_cast<int>(indexed_scores.size());
-    // A set of detections and locations, wrapping the location data from each
-    // detection, which are retained after the non-maximum suppression.
-    output_detections->reserve(max_num_detections);
-
-    if (options_.algorithm() == NonMaxSuppressionCalculatorOptions::WEIGHTED) {
-      WeightedNonMaxSuppression(indexed_scores, pruned_detections,
-                                max_num_detections, cc, output_detections);
-    } else {
-      NonMaxSuppression(indexed_scores, pruned_detections, max_num_detections,
-                        cc, output_detections);
+    const NmsWeightedBox box = GetWeightedBox(boxes_, cluster);
+    auto* weighted_location = weighted_detection.mutable_location_data()
+                                  ->mutable_relative_bounding_box();
+    weighted_location->set_xmin(box.xmin);
+    weighted_location->set_ymin(box.ymin);
+    weighted_location->set_width(box.xmax - weighted_location->xmin());
+    weighted_location->set_height(box.ymax - weighted_location->ymin());
+
+    const int num_keypoints =
+        detection.location_data().relative_keypoints_size();
+    if (num_keypoints == 0) {
+      return weighted_detection;
     }
-  }
-
-  void NonMaxSuppression(const IndexedScores& indexed_scores,
-                         const Detections& detections, int max_num_detections,
-                         CalculatorContext* cc, Detections* output_detections) {
-    std::vector<Location> retained_locations;
-    retained_locations.reserve(max_num_detections);
-    // We traverse the detections by decreasing score.
-    for (const auto& indexed_score : indexed_scores) {
-      const auto& detection = detections[indexed_score.first];
-      if (options_.min_score_threshold() > 0 &&
-          detection.score(0) < options_.min_score_threshold()) {
-        break;
-      }
-      const Location location(detection.location_data());
-      bool suppressed = false;
-      // The current detection is suppressed iff there exists a retained
-      // detection, whose location overlaps more than the specified
-      // threshold with the location of the current detection.
-      for (const auto& retained_location : retained_locations) {
-        float similarity;
-        if (cc->Inputs().HasTag(kImageTag)) {
-          const auto& frame = cc->Inputs().Tag(kImageTag).Get<ImageFrame>();
-          similarity = OverlapSimilarity(frame.Width(), frame.Height(),
-                                         options_.overlap_type(),
-                                         retained_location, location);
-        } else {
-          similarity = OverlapSimilarity(options_.overlap_type(),
-                                         retained_location, location);
-        }
-        if (similarity > options_.min_suppression_threshold()) {
-          suppressed = true;
-          break;
-        }
-      }
-      if (!suppressed) {
-        output_detections->push_back(detection);
-        retained_locations.push_back(location);
-      }
-      if (output_detections->size() >= max_num_detections) {
-        break;
+    std::vector<float> keypoints(num_keypoints * 2);
+    float total_score = 0.0f;
+    for (int index : cluster) {
+      const float score = boxes_.score[index];
+      total_score += score;
+      const auto& location_data =
+          detections[box_detections_[index]].location_data();
+      for (int i = 0; i < num_keypoints; ++i) {
+        keypoints[i * 2] += location_data.relative_keypoints(i).x() * score;
+        keypoints[i * 2 + 1] += location_data.relative_keypoints(i).y() * score;
       }
     }
-  }
-
-  void WeightedNonMaxSuppression(const IndexedScores& indexed_scores,
-                                 const Detections& detections,
-                                 int max_num_detections, CalculatorContext* cc,
-                                 Detections* output_detections) {
-    IndexedScores remained_indexed_scores;
-    remained_indexed_scores.assign(indexed_scores.begin(),
-                                   indexed_scores.end());
-
-    IndexedScores remained;
-    IndexedScores candidates;
-    output_detections->clear();
-    while (!remained_indexed_scores.empty()) {
-      const int original_indexed_scores_size = remained_indexed_scores.size();
-      const auto& detection = detections[remained_indexed_scores[0].first];
-      if (options_.min_score_threshold() > 0 &&
-          detection.score(0) < options_.min_score_threshold()) {
-        break;
-      }
-      remained.clear();
-      candidates.clear();
-      const Location location(detection.location_data());
-      // This includes the first box.
-      for (const auto& indexed_score : remained_indexed_scores) {
-        Location rest_location(detections[indexed_score.first].location_data());
-        float similarity =
-            OverlapSimilarity(options_.overlap_type(), rest_location, location);
-        if (similarity > options_.min_suppression_threshold()) {
-          candidates.push_back(indexed_score);
-        } else {
-          remained.push_back(indexed_score);
-        }
-      }
-      auto weighted_detection = detection;
-      if (!candidates.empty()) {
-        const int num_keypoints =
-            detection.location_data().relative_keypoints_size();
-        std::vector<float> keypoints(num_keypoints * 2);
-        float w_xmin = 0.0f;
-        float w_ymin = 0.0f;
-        float w_xmax = 0.0f;
-        float w_ymax = 0.0f;
-        float total_score = 0.0f;
-        for (const auto& candidate : candidates) {
-          total_score += candidate.second;
-          const auto& location_data =
-              detections[candidate.first].location_data();
-          const auto& bbox = location_data.relative_bounding_box();
-          w_xmin += bbox.xmin() * candidate.second;
-          w_ymin += bbox.ymin() * candidate.second;
-          w_xmax += (bbox.xmin() + bbox.width()) * candidate.second;
-          w_ymax += (bbox.ymin() + bbox.height()) * candidate.second;
-
-          for (int i = 0; i < num_keypoints; ++i) {
-            keypoints[i * 2] +=
-                location_data.relative_keypoints(i).x() * candidate.second;
-            keypoints[i * 2 + 1] +=
-                location_data.relative_keypoints(i).y() * candidate.second;
-          }
-        }
-        auto* weighted_location = weighted_detection.mutable_location_data()
-                                      ->mutable_relative_bounding_box();
-        weighted_location->set_xmin(w_xmin / total_score);
-        weighted_location->set_ymin(w_ymin / total_score);
-        weighted_location->set_width((w_xmax / total_score) -
-                                     weighted_location->xmin());
-        weighted_location->set_height((w_ymax / total_score) -
-                                      weighted_location->ymin());
-        for (int i = 0; i < num_keypoints; ++i) {
-          auto* keypoint = weighted_detection.mutable_location_data()
-                               ->mutable_relative_keypoints(i);
-          keypoint->set_x(keypoints[i * 2] / total_score);
-          keypoint->set_y(keypoints[i * 2 + 1] / total_score);
-        }
-      }
-
-      output_detections->push_back(weighted_detection);
-      // Breaks the loop if the size of indexed scores doesn't change after an
-      // iteration.
-      if (original_indexed_scores_size == remained.size()) {
-        break;
-      } else {
-        remained_indexed_scores = std::move(remained);
-      }
+    for (int i = 0; i < num_keypoints; ++i) {
+      auto* keypoint = weighted_detection.mutable_location_data()
+                           ->mutable_relative_keypoints(i);
+      keypoint->set_x(keypoints[i * 2] / total_score);
+      keypoint->set_y(keypoints[i * 2 + 1] / total_score);
     }
+    return weighted_detection;
   }
 
   NonMaxSuppressionCalculatorOptions options_;
+  std::unique_ptr<NonMaxSuppressionEngine> nms_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  // Buffers reused across Process() calls. `box_detections_` maps each box
+  // to its pruned detection.
+  NmsBoxes boxes_;
+  std::vector<int> box_detections_;
+  std::vector<int> label_ids_;
+  NmsResult nms_result_;
 };
 REGISTER_CALCULATOR(NonMaxSuppressionCalculator);
 
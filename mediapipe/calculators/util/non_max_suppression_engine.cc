@@ -0,0 +1,724 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/util/non_max_suppression_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_log.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
+#include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/framework/port/rectangle.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+
+namespace {
+
+using OverlapType = NonMaxSuppressionCalculatorOptions::OverlapType;
+using IndexedScores = std::vector<std::pair<int, float>>;
+
+// Below this number of boxes, comparing every pair is cheaper than building
+// the grid.
+constexpr int kMinBoxesForGrid = 64;
+// Orders indexed scores like SortBySecond in the calculator. A functor lets
+// std::sort inline the comparison.
+struct SortBySecond {
+  bool operator()(const std::pair<int, float>& indexed_score_0,
+                  const std::pair<int, float>& indexed_score_1) const {
+    return (indexed_score_0.second > indexed_score_1.second);
+  }
+};
+
+// Computes an overlap similarity between two rectangles. Similarity measure is
+// defined by overlap_type parameter.
+float OverlapSimilarity(const OverlapType overlap_type,
+                        const Rectangle_f& rect1, const Rectangle_f& rect2) {
+  if (!rect1.Intersects(rect2)) return 0.0f;
+  const float intersection_area = Rectangle_f(rect1).Intersect(rect2).Area();
+  float normalization;
+  switch (overlap_type) {
+    case NonMaxSuppressionCalculatorOptions::JACCARD:
+      normalization = Rectangle_f(rect1).Union(rect2).Area();
+      break;
+    case NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD:
+      normalization = rect2.Area();
+      break;
+    case NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION:
+      normalization = rect1.Area() + rect2.Area() - intersection_area;
+      break;
+    default:
+      ABSL_LOG(FATAL) << "Unrecognized overlap type: " << overlap_type;
+  }
+  return normalization > 0.0f ? intersection_area / normalization : 0.0f;
+}
+
+// Same as OverlapSimilarity for rectangles with finite coordinates, written
+// without branches so that loops over it can be vectorized.
+template <OverlapType kOverlapType>
+inline float FiniteOverlapSimilarity(float ax0, float ay0, float ax1, float ay1,
+                                     float bx0, float by0, float bx1,
+                                     float by1) {
+  const bool intersects = !((bx0 > bx1) | (by0 > by1) | (ax0 > ax1) |
+                            (ay0 > ay1) | (bx1 < ax0) | (ax1 < bx0) |
+                            (by1 < ay0) | (ay1 < by0));
+  const float intersection_area = (std::min(ax1, bx1) - std::max(ax0, bx0)) *
+                                  (std::min(ay1, by1) - std::max(ay0, by0));
+  float normalization;
+  if constexpr (kOverlapType == NonMaxSuppressionCalculatorOptions::JACCARD) {
+    normalization = (std::max(ax1, bx1) - std::min(ax0, bx0)) *
+                    (std::max(ay1, by1) - std::min(ay0, by0));
+  } else if constexpr (kOverlapType ==
+                       NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD) {
+    normalization = (bx1 - bx0) * (by1 - by0);
+  } else {
+    normalization = (ax1 - ax0) * (ay1 - ay0) + (bx1 - bx0) * (by1 - by0) -
+                    intersection_area;
+  }
+  const bool valid = intersects & (normalization > 0.0f);
+  const float ratio = intersection_area / (valid ? normalization : 1.0f);
+  return valid ? ratio : 0.0f;
+}
+
+// Computes OverlapSimilarity(overlap_type, rect1[j], rect2) for the `count`
+// finite rectangles described by x0/y0/x1/y1.
+template <OverlapType kOverlapType>
+void BatchOverlapSimilarity(const float* x0, const float* y0, const float* x1,
+                            const float* y1, int count,
+                            const Rectangle_f& rect2, float* similarity) {
+  const float bx0 = rect2.xmin();
+  const float by0 = rect2.ymin();
+  const float bx1 = rect2.xmax();
+  const float by1 = rect2.ymax();
+  for (int j = 0; j < count; ++j) {
+    similarity[j] = FiniteOverlapSimilarity<kOverlapType>(
+        x0[j], y0[j], x1[j], y1[j], bx0, by0, bx1, by1);
+  }
+}
+
+// Whether OverlapSimilarity(overlap_type, rect1[j], rect2) exceeds `threshold`
+// for any of the `count` finite rectangles described by x0/y0/x1/y1.
+template <OverlapType kOverlapType>
+bool AnyOverlapAbove(const float* x0, const float* y0, const float* x1,
+                     const float* y1, int count, const Rectangle_f& rect2,
+                     float threshold) {
+  const float bx0 = rect2.xmin();
+  const float by0 = rect2.ymin();
+  const float bx1 = rect2.xmax();
+  const float by1 = rect2.ymax();
+  int any = 0;
+  for (int j = 0; j < count; ++j) {
+    any |= FiniteOverlapSimilarity<kOverlapType>(x0[j], y0[j], x1[j], y1[j],
+                                                 bx0, by0, bx1, by1) >
+           threshold;
+  }
+  return any != 0;
+}
+
+bool AnyOverlapAbove(const OverlapType overlap_type, const float* x0,
+                     const float* y0, const float* x1, const float* y1,
+                     int count, const Rectangle_f& rect2, float threshold) {
+  switch (overlap_type) {
+    case NonMaxSuppressionCalculatorOptions::JACCARD:
+      return AnyOverlapAbove<NonMaxSuppressionCalculatorOptions::JACCARD>(
+          x0, y0, x1, y1, count, rect2, threshold);
+    case NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD:
+      return AnyOverlapAbove<
+          NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD>(
+          x0, y0, x1, y1, count, rect2, threshold);
+    case NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION:
+      return AnyOverlapAbove<
+          NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION>(
+          x0, y0, x1, y1, count, rect2, threshold);
+    default:
+      ABSL_LOG(FATAL) << "Unrecognized overlap type: " << overlap_type;
+  }
+}
+
+float FiniteOverlapSimilarity(const OverlapType overlap_type,
+                              const Rectangle_f& rect1,
+                              const Rectangle_f& rect2) {
+  switch (overlap_type) {
+    case NonMaxSuppressionCalculatorOptions::JACCARD:
+      return FiniteOverlapSimilarity<
+          NonMaxSuppressionCalculatorOptions::JACCARD>(
+          rect1.xmin(), rect1.ymin(), rect1.xmax(), rect1.ymax(),
+          rect2.xmin(), rect2.ymin(), rect2.xmax(), rect2.ymax());
+    case NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD:
+      return FiniteOverlapSimilarity<
+          NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD>(
+          rect1.xmin(), rect1.ymin(), rect1.xmax(), rect1.ymax(),
+          rect2.xmin(), rect2.ymin(), rect2.xmax(), rect2.ymax());
+    case NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION:
+      return FiniteOverlapSimilarity<
+          NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION>(
+          rect1.xmin(), rect1.ymin(), rect1.xmax(), rect1.ymax(),
+          rect2.xmin(), rect2.ymin(), rect2.xmax(), rect2.ymax());
+    default:
+      ABSL_LOG(FATAL) << "Unrecognized overlap type: " << overlap_type;
+  }
+}
+
+void BatchOverlapSimilarity(const OverlapType overlap_type, const float* x0,
+                            const float* y0, const float* x1, const float* y1,
+                            int count, const Rectangle_f& rect2,
+                            float* similarity) {
+  switch (overlap_type) {
+    case NonMaxSuppressionCalculatorOptions::JACCARD:
+      BatchOverlapSimilarity<NonMaxSuppressionCalculatorOptions::JACCARD>(
+          x0, y0, x1, y1, count, rect2, similarity);
+      break;
+    case NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD:
+      BatchOverlapSimilarity<
+          NonMaxSuppressionCalculatorOptions::MODIFIED_JACCARD>(
+          x0, y0, x1, y1, count, rect2, similarity);
+      break;
+    case NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION:
+      BatchOverlapSimilarity<
+          NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION>(
+          x0, y0, x1, y1, count, rect2, similarity);
+      break;
+    default:
+      ABSL_LOG(FATAL) << "Unrecognized overlap type: " << overlap_type;
+  }
+}
+
+}  // namespace
+
+void NmsBoxes::Clear() {
+  xmin.clear();
+  ymin.clear();
+  xmax.clear();
+  ymax.clear();
+  score.clear();
+  class_id.clear();
+}
+
+void NmsBoxes::Reserve(int size) {
+  xmin.reserve(size);
+  ymin.reserve(size);
+  xmax.reserve(size);
+  ymax.reserve(size);
+  score.reserve(size);
+  class_id.reserve(size);
+}
+
+void NmsBoxes::Add(float box_xmin, float box_ymin, float box_xmax,
+                   float box_ymax, float box_score, int box_class_id) {
+  xmin.push_back(box_xmin);
+  ymin.push_back(box_ymin);
+  xmax.push_back(box_xmax);
+  ymax.push_back(box_ymax);
+  score.push_back(box_score);
+  class_id.push_back(box_class_id);
+}
+
+NmsWeightedBox GetWeightedBox(const NmsBoxes& boxes,
+                              absl::Span<const int> members) {
+  float w_xmin = 0.0f;
+  float w_ymin = 0.0f;
+  float w_xmax = 0.0f;
+  float w_ymax = 0.0f;
+  float total_score = 0.0f;
+  for (int i : members) {
+    const float score = boxes.score[i];
+    total_score += score;
+    w_xmin += boxes.xmin[i] * score;
+    w_ymin += boxes.ymin[i] * score;
+    w_xmax += boxes.xmax[i] * score;
+    w_ymax += boxes.ymax[i] * score;
+  }
+  return {w_xmin / total_score, w_ymin / total_score, w_xmax / total_score,
+          w_ymax / total_score};
+}
+
+// Suppresses a single group of boxes. Boxes are first sorted by decreasing
+// score and copied into rank ordered arrays, so that all later passes work
+// on contiguous memory and on ranks rather than box indices.
+class NonMaxSuppressionEngine::Suppressor {
+ public:
+  explicit Suppressor(const NonMaxSuppressionCalculatorOptions& options)
+      : options_(options) {}
+
+  // Suppresses the boxes listed in `members`. Ties in score are broken the
+  // same way as the calculator does for detections listed in that order.
+  void Run(const NmsBoxes& boxes, absl::Span<const int> members);
+
+  // Retained boxes and their clusters, see NmsResult.
+  const std::vector<int>& indices() const { return indices_; }
+  const std::vector<int>& cluster_offsets() const { return cluster_offsets_; }
+  const std::vector<int>& cluster_members() const { return cluster_members_; }
+
+ private:
+  void RunDefault();
+  void RunWeighted();
+
+  Rectangle_f GetRect(int rank) const {
+    Rectangle_f rect;
+    rect.set_xmin(x0_[rank]);
+    rect.set_ymin(y0_[rank]);
+    rect.set_xmax(x1_[rank]);
+    rect.set_ymax(y1_[rank]);
+    return rect;
+  }
+  float Similarity(int rank1, int rank2) const {
+    if (finite_[rank1] && finite_[rank2]) {
+      return FiniteOverlapSimilarity(options_.overlap_type(), GetRect(rank1),
+                                     GetRect(rank2));
+    }
+    return OverlapSimilarity(options_.overlap_type(), GetRect(rank1),
+                             GetRect(rank2));
+  }
+  bool SkipByScore(int rank) const {
+    return options_.min_score_threshold() > 0 &&
+           score_[rank] < options_.min_score_threshold();
+  }
+
+  // Whether the grid should be used for `num_boxes` boxes.
+  bool UseGrid(int num_boxes) const {
+    return num_boxes >= kMinBoxesForGrid &&
+           options_.min_suppression_threshold() >= 0.0f;
+  }
+  // Sizes the grid to the finite boxes and clears its cells.
+  void ResetGrid();
+  void AddToGrid(int rank);
+  // Calls `fn(rank)` once for every box in the cells covered by `rank`.
+  template <typename Fn>
+  void ForEachNeighbor(int rank, Fn fn);
+  int CellX(float x) const;
+  int CellY(float y) const;
+
+  const NonMaxSuppressionCalculatorOptions& options_;
+
+  // Box index and coordinates, by decreasing score.
+  IndexedScores indexed_scores_;
+  std::vector<int> box_index_;
+  std::vector<float> x0_, y0_, x1_, y1_, score_;
+  std::vector<uint8_t> finite_;
+
+  // Compacted coordinates of the boxes to compare against, their ranks and
+  // their similarities with the current box. Used without the grid.
+  std::vector<float> cx0_, cy0_, cx1_, cy1_;
+  std::vector<int> compare_ranks_;
+  std::vector<float> similarities_;
+  // Ranks of the non-finite boxes to compare against.
+  std::vector<int> loose_ranks_;
+
+  // Grid of box ranks.
+  int grid_cols_ = 1;
+  int grid_rows_ = 1;
+  float grid_x0_ = 0.0f;
+  float grid_y0_ = 0.0f;
+  float inv_cell_width_ = 0.0f;
+  float inv_cell_height_ = 0.0f;
+  std::vector<std::vector<int>> cells_;
+  // Last query that visited each rank, to visit boxes spanning several cells
+  // once.
+  std::vector<int> visited_;
+  int query_ = 0;
+  // WEIGHTED only. Whether a rank is still waiting to be clustered.
+  std::vector<uint8_t> alive_;
+  std::vector<int> found_;
+
+  std::vector<int> indices_;
+  std::vector<int> cluster_offsets_;
+  std::vector<int> cluster_members_;
+};
+
+void NonMaxSuppressionEngine::Suppressor::Run(const NmsBoxes& boxes,
+                                              absl::Span<const int> members) {
+  const int num_boxes = members.size();
+  indexed_scores_.clear();
+  indexed_scores_.reserve(num_boxes);
+  for (int i = 0; i < num_boxes; ++i) {
+    indexed_scores_.push_back(std::make_pair(i, boxes.score[members[i]]));
+  }
+  std::sort(indexed_scores_.begin(), indexed_scores_.end(), SortBySecond());
+
+  box_index_.resize(num_boxes);
+  x0_.resize(num_boxes);
+  y0_.resize(num_boxes);
+  x1_.resize(num_boxes);
+  y1_.resize(num_boxes);
+  score_.resize(num_boxes);
+  finite_.resize(num_boxes);
+  for (int rank = 0; rank < num_boxes; ++rank) {
+    const int i = members[indexed_scores_[rank].first];
+    box_index_[rank] = i;
+    x0_[rank] = boxes.xmin[i];
+    y0_[rank] = boxes.ymin[i];
+    x1_[rank] = boxes.xmax[i];
+    y1_[rank] = boxes.ymax[i];
+    score_[rank] = indexed_scores_[rank].second;
+    finite_[rank] = std::isfinite(x0_[rank]) && std::isfinite(y0_[rank]) &&
+                    std::isfinite(x1_[rank]) && std::isfinite(y1_[rank]);
+  }
+
+  indices_.clear();
+  cluster_offsets_.clear();
+  cluster_members_.clear();
+  if (options_.algorithm() == NonMaxSuppressionCalculatorOptions::WEIGHTED) {
+    RunWeighted();
+  } else {
+    RunDefault();
+  }
+}
+
+void NonMaxSuppressionEngine::Suppressor::RunDefault() {
+  const int num_boxes = box_index_.size();
+  const int max_num_detections = (options_.max_num_detections() > -1)
+                                     ? options_.max_num_detections()
+                                     : num_boxes;
+  const float threshold = options_.min_suppression_threshold();
+  const bool use_grid = UseGrid(num_boxes);
+  if (use_grid) ResetGrid();
+  // Retained boxes that are compared without the grid.
+  cx0_.clear();
+  cy0_.clear();
+  cx1_.clear();
+  cy1_.clear();
+  compare_ranks_.clear();
+  loose_ranks_.clear();
+
+  // We traverse the boxes by decreasing score.
+  for (int rank = 0; rank < num_boxes; ++rank) {
+    if (SkipByScore(rank)) break;
+    // The current box is suppressed iff there exists a retained box whose
+    // overlap with the current box is more than the threshold.
+    bool suppressed = false;
+    if (!finite_[rank]) {
+      for (int retained : compare_ranks_) {
+        if (Similarity(retained, rank) > threshold) {
+          suppressed = true;
+          break;
+        }
+      }
+    } else if (use_grid) {
+      ForEachNeighbor(rank, [&](int retained) {
+        suppressed = suppressed || Similarity(retained, rank) > threshold;
+      });
+    } else {
+      suppressed = AnyOverlapAbove(options_.overlap_type(), cx0_.data(),
+                                   cy0_.data(), cx1_.data(), cy1_.data(),
+                                   cx0_.size(), GetRect(rank), threshold);
+    }
+    for (int j = 0; finite_[rank] && !suppressed && j < loose_ranks_.size();
+         ++j) {
+      suppressed = Similarity(loose_ranks_[j], rank) > threshold;
+    }
+
+    if (!suppressed) {
+      indices_.push_back(box_index_[rank]);
+      if (!finite_[rank]) {
+        loose_ranks_.push_back(rank);
+      } else if (use_grid) {
+        AddToGrid(rank);
+      } else {
+        cx0_.push_back(x0_[rank]);
+        cy0_.push_back(y0_[rank]);
+        cx1_.push_back(x1_[rank]);
+        cy1_.push_back(y1_[rank]);
+      }
+      // Non-finite boxes are compared against every retained box, in
+      // whichever way the finite ones are stored.
+      compare_ranks_.push_back(rank);
+    }
+    if (static_cast<int>(indices_.size()) >= max_num_detections) break;
+  }
+}
+
+void NonMaxSuppressionEngine::Suppressor::RunWeighted() {
+  const int num_boxes = box_index_.size();
+  const float threshold = options_.min_suppression_threshold();
+  cluster_offsets_.push_back(0);
+
+  if (!UseGrid(num_boxes)) {
+    // Compact the remaining boxes after every cluster, so that the overlap
+    // with the head of the next cluster is a single pass over flat arrays.
+    cx0_.assign(x0_.begin(), x0_.end());
+    cy0_.assign(y0_.begin(), y0_.end());
+    cx1_.assign(x1_.begin(), x1_.end());
+    cy1_.assign(y1_.begin(), y1_.end());
+    compare_ranks_.resize(num_boxes);
+    for (int rank = 0; rank < num_boxes; ++rank) compare_ranks_[rank] = rank;
+    while (!compare_ranks_.empty()) {
+      const int head = compare_ranks_[0];
+      if (SkipByScore(head)) break;
+      const int num_remaining = compare_ranks_.size();
+      similarities_.resize(num_remaining);
+      BatchOverlapSimilarity(options_.overlap_type(), cx0_.data(), cy0_.data(),
+                             cx1_.data(), cy1_.data(), num_remaining,
+                             GetRect(head), similarities_.data());
+      for (int j = 0; j < num_remaining; ++j) {
+        if (!finite_[head] || !finite_[compare_ranks_[j]]) {
+          similarities_[j] = Similarity(compare_ranks_[j], head);
+        }
+      }
+      // This includes the head box.
+      int num_remained = 0;
+      for (int j = 0; j < num_remaining; ++j) {
+        if (similarities_[j] > threshold) {
+          cluster_members_.push_back(box_index_[compare_ranks_[j]]);
+        } else {
+          compare_ranks_[num_remained] = compare_ranks_[j];
+          cx0_[num_remained] = cx0_[j];
+          cy0_[num_remained] = cy0_[j];
+          cx1_[num_remained] = cx1_[j];
+          cy1_[num_remained] = cy1_[j];
+          ++num_remained;
+        }
+      }
+      indices_.push_back(box_index_[head]);
+      cluster_offsets_.push_back(cluster_members_.size());
+      // Stop once an iteration doesn't cluster any box.
+      if (num_remained == num_remaining) break;
+      compare_ranks_.resize(num_remained);
+      cx0_.resize(num_remained);
+      cy0_.resize(num_remained);
+      cx1_.resize(num_remained);
+      cy1_.resize(num_remained);
+    }
+    return;
+  }
+
+  ResetGrid();
+  loose_ranks_.clear();
+  alive_.assign(num_boxes, true);
+  for (int rank = 0; rank < num_boxes; ++rank) {
+    if (finite_[rank]) {
+      AddToGrid(rank);
+    } else {
+      loose_ranks_.push_back(rank);
+    }
+  }
+  int head = 0;
+  while (true) {
+    while (head < num_boxes && !alive_[head]) ++head;
+    if (head == num_boxes || SkipByScore(head)) break;
+    found_.clear();
+    const auto visit = [&](int rank) {
+      if (alive_[rank] && Similarity(rank, head) > threshold) {
+        found_.push_back(rank);
+      }
+    };
+    if (finite_[head]) {
+      ForEachNeighbor(head, visit);
+      for (int rank : loose_ranks_) visit(rank);
+    } else {
+      for (int rank = head; rank < num_boxes; ++rank) visit(rank);
+    }
+    // Cluster members are listed by decreasing score, like the boxes they
+    // are taken from.
+    std::sort(found_.begin(), found_.end());
+    for (int rank : found_) {
+      alive_[rank] = false;
+      cluster_members_.push_back(box_index_[rank]);
+    }
+    indices_.push_back(box_index_[head]);
+    cluster_offsets_.push_back(cluster_members_.size());
+    // Stop once an iteration doesn't cluster any box.
+    if (found_.empty()) break;
+  }
+}
+
+void NonMaxSuppressionEngine::Suppressor::ResetGrid() {
+  const int num_boxes = box_index_.size();
+  float xmin = 0.0f, ymin = 0.0f, xmax = 0.0f, ymax = 0.0f;
+  float sum_width = 0.0f, sum_height = 0.0f;
+  int num_finite = 0;
+  for (int rank = 0; rank < num_boxes; ++rank) {
+    if (!finite_[rank]) continue;
+    if (num_finite == 0) {
+      xmin = x0_[rank];
+      ymin = y0_[rank];
+      xmax = x1_[rank];
+      ymax = y1_[rank];
+    }
+    xmin = std::min(xmin, x0_[rank]);
+    ymin = std::min(ymin, y0_[rank]);
+    xmax = std::max(xmax, x1_[rank]);
+    ymax = std::max(ymax, y1_[rank]);
+    sum_width += std::max(x1_[rank] - x0_[rank], 0.0f);
+    sum_height += std::max(y1_[rank] - y0_[rank], 0.0f);
+    ++num_finite;
+  }
+  // Cells about the size of an average box, so that boxes cover few cells
+  // and cells hold few boxes, with at most about one cell per box.
+  const int max_cells = std::max(1, static_cast<int>(std::sqrt(num_boxes)));
+  const auto num_cells = [max_cells](float extent, float mean_size) {
+    if (!(mean_size > 0.0f) || !std::isfinite(mean_size)) return max_cells;
+    return static_cast<int>(
+        std::clamp(extent / mean_size, 1.0f, static_cast<float>(max_cells)));
+  };
+  grid_x0_ = xmin;
+  grid_y0_ = ymin;
+  grid_cols_ = num_cells(xmax - xmin, sum_width / num_finite);
+  grid_rows_ = num_cells(ymax - ymin, sum_height / num_finite);
+  inv_cell_width_ = grid_cols_ / (xmax - xmin);
+  inv_cell_height_ = grid_rows_ / (ymax - ymin);
+  // Degenerate extents collapse to a single column or row.
+  if (!std::isfinite(inv_cell_width_) || !(inv_cell_width_ > 0.0f)) {
+    grid_cols_ = 1;
+    inv_cell_width_ = 0.0f;
+  }
+  if (!std::isfinite(inv_cell_height_) || !(inv_cell_height_ > 0.0f)) {
+    grid_rows_ = 1;
+    inv_cell_height_ = 0.0f;
+  }
+  cells_.resize(grid_cols_ * grid_rows_);
+  for (auto& cell : cells_) cell.clear();
+  visited_.assign(num_boxes, -1);
+  query_ = 0;
+}
+
+int NonMaxSuppressionEngine::Suppressor::CellX(float x) const {
+  return std::clamp(static_cast<int>((x - grid_x0_) * inv_cell_width_), 0,
+                    grid_cols_ - 1);
+}
+
+int NonMaxSuppressionEngine::Suppressor::CellY(float y) const {
+  return std::clamp(static_cast<int>((y - grid_y0_) * inv_cell_height_), 0,
+                    grid_rows_ - 1);
+}
+
+void NonMaxSuppressionEngine::Suppressor::AddToGrid(int rank) {
+  // Empty boxes cover no cell and can't overlap any box.
+  for (int y = CellY(y0_[rank]); y <= CellY(y1_[rank]); ++y) {
+    for (int x = CellX(x0_[rank]); x <= CellX(x1_[rank]); ++x) {
+      cells_[y * grid_cols_ + x].push_back(rank);
+    }
+  }
+}
+
+template <typename Fn>
+void NonMaxSuppressionEngine::Suppressor::ForEachNeighbor(int rank, Fn fn) {
+  // Two boxes overlap by more than a non-negative threshold only if their
+  // interiors share a point, which lies in a cell covered by both boxes.
+  ++query_;
+  for (int y = CellY(y0_[rank]); y <= CellY(y1_[rank]); ++y) {
+    for (int x = CellX(x0_[rank]); x <= CellX(x1_[rank]); ++x) {
+      for (int neighbor : cells_[y * grid_cols_ + x]) {
+        if (visited_[neighbor] == query_) continue;
+        visited_[neighbor] = query_;
+        fn(neighbor);
+      }
+    }
+  }
+}
+
+NonMaxSuppressionEngine::NonMaxSuppressionEngine(
+    const NonMaxSuppressionCalculatorOptions& options)
+    : options_(options) {}
+
+NonMaxSuppressionEngine::~NonMaxSuppressionEngine() = default;
+
+void NonMaxSuppressionEngine::Run(const NmsBoxes& boxes, NmsResult* result,
+                                  ThreadPool* thread_pool) {
+  const int num_boxes = boxes.size();
+  grouped_indices_.resize(num_boxes);
+  for (int i = 0; i < num_boxes; ++i) grouped_indices_[i] = i;
+  group_offsets_.clear();
+  group_offsets_.push_back(0);
+  if (options_.multiclass_nms()) {
+    // Boxes keep their relative order within a class.
+    std::stable_sort(grouped_indices_.begin(), grouped_indices_.end(),
+                     [&boxes](int a, int b) {
+                       return boxes.class_id[a] < boxes.class_id[b];
+                     });
+    for (int i = 1; i < num_boxes; ++i) {
+      if (boxes.class_id[grouped_indices_[i]] !=
+          boxes.class_id[grouped_indices_[i - 1]]) {
+        group_offsets_.push_back(i);
+      }
+    }
+  }
+  group_offsets_.push_back(num_boxes);
+  const int num_groups = group_offsets_.size() - 1;
+  while (suppressors_.size() < num_groups) {
+    suppressors_.push_back(std::make_unique<Suppressor>(options_));
+  }
+  const auto run_group = [this, &boxes](int group) {
+    suppressors_[group]->Run(
+        boxes, absl::MakeConstSpan(grouped_indices_)
+                   .subspan(group_offsets_[group],
+                            group_offsets_[group + 1] - group_offsets_[group]));
+  };
+  if (thread_pool != nullptr && num_groups > 1) {
+    absl::BlockingCounter counter(num_groups);
+    for (int group = 0; group < num_groups; ++group) {
+      thread_pool->Schedule([&run_group, &counter, group] {
+        run_group(group);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  } else {
+    for (int group = 0; group < num_groups; ++group) run_group(group);
+  }
+
+  result->indices.clear();
+  result->cluster_offsets.clear();
+  result->cluster_members.clear();
+  const bool weighted =
+      options_.algorithm() == NonMaxSuppressionCalculatorOptions::WEIGHTED;
+  if (weighted) result->cluster_offsets.push_back(0);
+  const auto append = [&](const Suppressor& suppressor, int k) {
+    result->indices.push_back(suppressor.indices()[k]);
+    if (!weighted) return;
+    const auto& offsets = suppressor.cluster_offsets();
+    result->cluster_members.insert(
+        result->cluster_members.end(),
+        suppressor.cluster_members().begin() + offsets[k],
+        suppressor.cluster_members().begin() + offsets[k + 1]);
+    result->cluster_offsets.push_back(result->cluster_members.size());
+  };
+  if (!options_.multiclass_nms()) {
+    const Suppressor& suppressor = *suppressors_[0];
+    for (int k = 0; k < suppressor.indices().size(); ++k) {
+      append(suppressor, k);
+    }
+    return;
+  }
+
+  // Descending sort and shrink the boxes retained by all classes according
+  // to max num detections.
+  IndexedScores indexed_scores;
+  std::vector<std::pair<int, int>> retained;
+  for (int group = 0; group < num_groups; ++group) {
+    const auto& indices = suppressors_[group]->indices();
+    for (int k = 0; k < indices.size(); ++k) {
+      indexed_scores.push_back(
+          std::make_pair(retained.size(), boxes.score[indices[k]]));
+      retained.push_back(std::make_pair(group, k));
+    }
+  }
+  std::sort(indexed_scores.begin(), indexed_scores.end(), SortBySecond());
+  int max_num_detections = static_cast<int>(indexed_scores.size());
+  if (options_.max_num_detections() > -1) {
+    max_num_detections =
+        std::min(max_num_detections, options_.max_num_detections());
+  }
+  for (int i = 0; i < max_num_detections; ++i) {
+    const auto& [group, k] = retained[indexed_scores[i].first];
+    append(*suppressors_[group], k);
+  }
+}
+
+}  // namespace mediapipe
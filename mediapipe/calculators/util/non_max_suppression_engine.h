@@ -0,0 +1,113 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_UTIL_NON_MAX_SUPPRESSION_ENGINE_H_
+#define MEDIAPIPE_CALCULATORS_UTIL_NON_MAX_SUPPRESSION_ENGINE_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+
+// Relative boxes to run non-maximum suppression on, stored as one array per
+// field so the overlap computations run over flat float arrays.
+struct NmsBoxes {
+  std::vector<float> xmin;
+  std::vector<float> ymin;
+  std::vector<float> xmax;
+  std::vector<float> ymax;
+  std::vector<float> score;
+  // Boxes are only suppressed by boxes of the same class when
+  // `multiclass_nms` is enabled. Ignored otherwise.
+  std::vector<int> class_id;
+
+  int size() const { return static_cast<int>(score.size()); }
+  void Clear();
+  void Reserve(int size);
+  void Add(float box_xmin, float box_ymin, float box_xmax, float box_ymax,
+           float box_score, int box_class_id = 0);
+};
+
+struct NmsResult {
+  // Indices of the retained boxes, by decreasing score. For WEIGHTED NMS,
+  // these are the highest scoring boxes of each cluster.
+  std::vector<int> indices;
+  // WEIGHTED NMS only. The boxes merged into `indices[i]`, by decreasing
+  // score, are cluster_members[cluster_offsets[i]] up to (excluding)
+  // cluster_members[cluster_offsets[i + 1]].
+  std::vector<int> cluster_offsets;
+  std::vector<int> cluster_members;
+
+  // An empty cluster means that the box was not merged with any box,
+  // including itself, and is reported unchanged.
+  absl::Span<const int> Cluster(int i) const {
+    return absl::MakeConstSpan(cluster_members)
+        .subspan(cluster_offsets[i],
+                 cluster_offsets[i + 1] - cluster_offsets[i]);
+  }
+};
+
+// Score weighted average of the `members` boxes, as WEIGHTED NMS reports for
+// a non-empty cluster.
+struct NmsWeightedBox {
+  float xmin;
+  float ymin;
+  float xmax;
+  float ymax;
+};
+NmsWeightedBox GetWeightedBox(const NmsBoxes& boxes,
+                              absl::Span<const int> members);
+
+// Non-maximum suppression on packed boxes, following the semantics of
+// NonMaxSuppressionCalculatorOptions (overlap type, thresholds, max number of
+// detections, DEFAULT and WEIGHTED algorithms, multiclass NMS).
+//
+// When the suppression threshold is non-negative only boxes with overlapping
+// interiors can suppress each other, so boxes are bucketed into a uniform grid
+// and each box is only compared with the boxes sharing one of its cells.
+// Small inputs and negative thresholds fall back to comparing against all
+// boxes. With `multiclass_nms`, classes are suppressed independently and can
+// be spread over a thread pool.
+//
+// Scratch buffers are reused across calls, so an instance should be kept alive
+// for the lifetime of its user. Run() is not thread-safe.
+class NonMaxSuppressionEngine {
+ public:
+  explicit NonMaxSuppressionEngine(
+      const NonMaxSuppressionCalculatorOptions& options);
+  ~NonMaxSuppressionEngine();
+
+  // Runs the suppression on `boxes` and stores the retained boxes in
+  // `result`. With multiclass NMS, classes are processed on `thread_pool`
+  // when one is given.
+  void Run(const NmsBoxes& boxes, NmsResult* result,
+           ThreadPool* thread_pool = nullptr);
+
+ private:
+  class Suppressor;
+
+  NonMaxSuppressionCalculatorOptions options_;
+  // Box indices grouped by class, and the start of each class group.
+  std::vector<int> grouped_indices_;
+  std::vector<int> group_offsets_;
+  std::vector<std::unique_ptr<Suppressor>> suppressors_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_UTIL_NON_MAX_SUPPRESSION_ENGINE_H_
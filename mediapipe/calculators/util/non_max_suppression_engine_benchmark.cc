@@ -0,0 +1,139 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmark for NonMaxSuppressionEngine against the all-pairs greedy loop the
+// calculator used, on crowded scenes of small boxes.
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/calculators/util/non_max_suppression_engine.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr float kThreshold = 0.3f;
+
+NmsBoxes RandomBoxes(int num_boxes, int num_classes) {
+  std::mt19937 rng(0 /*seed*/);
+  std::uniform_real_distribution<float> position(0.0f, 0.95f);
+  std::uniform_real_distribution<float> size(0.01f, 0.05f);
+  std::uniform_real_distribution<float> score(0.0f, 1.0f);
+  NmsBoxes boxes;
+  boxes.Reserve(num_boxes);
+  for (int i = 0; i < num_boxes; ++i) {
+    const float x = position(rng);
+    const float y = position(rng);
+    boxes.Add(x, y, x + size(rng), y + size(rng), score(rng),
+              i % num_classes);
+  }
+  return boxes;
+}
+
+float IntersectionOverUnion(const NmsBoxes& boxes, int a, int b) {
+  const float width = std::min(boxes.xmax[a], boxes.xmax[b]) -
+                      std::max(boxes.xmin[a], boxes.xmin[b]);
+  const float height = std::min(boxes.ymax[a], boxes.ymax[b]) -
+                       std::max(boxes.ymin[a], boxes.ymin[b]);
+  if (width < 0 || height < 0) return 0.0f;
+  const float intersection = width * height;
+  const float normalization =
+      (boxes.xmax[a] - boxes.xmin[a]) * (boxes.ymax[a] - boxes.ymin[a]) +
+      (boxes.xmax[b] - boxes.xmin[b]) * (boxes.ymax[b] - boxes.ymin[b]) -
+      intersection;
+  return normalization > 0.0f ? intersection / normalization : 0.0f;
+}
+
+void BM_NonMaxSuppressionEngine(benchmark::State& state) {
+  const NmsBoxes boxes = RandomBoxes(state.range(0), /*num_classes=*/1);
+  NonMaxSuppressionCalculatorOptions options;
+  options.set_overlap_type(
+      NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION);
+  options.set_min_suppression_threshold(kThreshold);
+  NonMaxSuppressionEngine engine(options);
+  NmsResult result;
+  for (auto s : state) {
+    engine.Run(boxes, &result);
+    benchmark::DoNotOptimize(result.indices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_NonMaxSuppressionEngine)
+    ->Arg(32)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(2048);
+
+void BM_NonMaxSuppressionEngineMulticlass(benchmark::State& state) {
+  const NmsBoxes boxes = RandomBoxes(state.range(0), /*num_classes=*/8);
+  NonMaxSuppressionCalculatorOptions options;
+  options.set_overlap_type(
+      NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION);
+  options.set_min_suppression_threshold(kThreshold);
+  options.set_multiclass_nms(true);
+  NonMaxSuppressionEngine engine(options);
+  ThreadPool thread_pool("nms_benchmark", 4);
+  thread_pool.StartWorkers();
+  NmsResult result;
+  for (auto s : state) {
+    engine.Run(boxes, &result, &thread_pool);
+    benchmark::DoNotOptimize(result.indices.data());
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_NonMaxSuppressionEngineMulticlass)->Arg(512)->Arg(2048);
+
+void BM_AllPairsNonMaxSuppression(benchmark::State& state) {
+  const NmsBoxes boxes = RandomBoxes(state.range(0), /*num_classes=*/1);
+  std::vector<std::pair<int, float>> indexed_scores;
+  std::vector<int> retained;
+  for (auto s : state) {
+    indexed_scores.clear();
+    for (int i = 0; i < boxes.size(); ++i) {
+      indexed_scores.push_back(std::make_pair(i, boxes.score[i]));
+    }
+    std::sort(indexed_scores.begin(), indexed_scores.end(),
+              [](const std::pair<int, float>& a,
+                 const std::pair<int, float>& b) {
+                return a.second > b.second;
+              });
+    retained.clear();
+    for (const auto& indexed_score : indexed_scores) {
+      bool suppressed = false;
+      for (int i : retained) {
+        if (IntersectionOverUnion(boxes, i, indexed_score.first) >
+            kThreshold) {
+          suppressed = true;
+          break;
+        }
+      }
+      if (!suppressed) retained.push_back(indexed_score.first);
+    }
+    benchmark::DoNotOptimize(retained.data());
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_AllPairsNonMaxSuppression)
+    ->Arg(32)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(2048);
+
+}  // namespace
+}  // namespace mediapipe
+
+BENCHMARK_MAIN();
@@ -0,0 +1,169 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/util/non_max_suppression_engine.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "mediapipe/calculators/util/non_max_suppression_calculator.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::ElementsAre;
+
+float IntersectionOverUnion(const NmsBoxes& boxes, int a, int b) {
+  const float width = std::min(boxes.xmax[a], boxes.xmax[b]) -
+                      std::max(boxes.xmin[a], boxes.xmin[b]);
+  const float height = std::min(boxes.ymax[a], boxes.ymax[b]) -
+                       std::max(boxes.ymin[a], boxes.ymin[b]);
+  if (width < 0 || height < 0) return 0.0f;
+  const float intersection = width * height;
+  const float area_a =
+      (boxes.xmax[a] - boxes.xmin[a]) * (boxes.ymax[a] - boxes.ymin[a]);
+  const float area_b =
+      (boxes.xmax[b] - boxes.xmin[b]) * (boxes.ymax[b] - boxes.ymin[b]);
+  const float normalization = area_a + area_b - intersection;
+  return normalization > 0.0f ? intersection / normalization : 0.0f;
+}
+
+NonMaxSuppressionCalculatorOptions GetOptions(float threshold) {
+  NonMaxSuppressionCalculatorOptions options;
+  options.set_overlap_type(
+      NonMaxSuppressionCalculatorOptions::INTERSECTION_OVER_UNION);
+  options.set_min_suppression_threshold(threshold);
+  return options;
+}
+
+TEST(NonMaxSuppressionEngineTest, SuppressesOverlappingBoxes) {
+  NmsBoxes boxes;
+  boxes.Add(0.0f, 0.0f, 0.4f, 0.4f, /*box_score=*/0.8f);
+  boxes.Add(0.05f, 0.05f, 0.45f, 0.45f, /*box_score=*/0.9f);
+  boxes.Add(0.5f, 0.5f, 0.9f, 0.9f, /*box_score=*/0.7f);
+  // Touches box 2 without overlapping its interior.
+  boxes.Add(0.9f, 0.5f, 1.0f, 0.9f, /*box_score=*/0.6f);
+
+  NonMaxSuppressionEngine engine(GetOptions(0.3f));
+  NmsResult result;
+  engine.Run(boxes, &result);
+
+  EXPECT_THAT(result.indices, ElementsAre(1, 2, 3));
+}
+
+TEST(NonMaxSuppressionEngineTest, StopsAtMaxNumDetectionsAndMinScore) {
+  NmsBoxes boxes;
+  for (int i = 0; i < 5; ++i) {
+    boxes.Add(0.2f * i, 0.0f, 0.2f * i + 0.1f, 0.1f,
+              /*box_score=*/0.9f - 0.2f * i);
+  }
+  auto options = GetOptions(0.3f);
+  options.set_min_score_threshold(0.4f);
+  NonMaxSuppressionEngine engine(options);
+  NmsResult result;
+
+  engine.Run(boxes, &result);
+  EXPECT_THAT(result.indices, ElementsAre(0, 1, 2));
+
+  options.set_max_num_detections(2);
+  NonMaxSuppressionEngine limited_engine(options);
+  limited_engine.Run(boxes, &result);
+  EXPECT_THAT(result.indices, ElementsAre(0, 1));
+}
+
+TEST(NonMaxSuppressionEngineTest, CrowdedSceneMatchesAllPairs) {
+  // Enough boxes for the grid to be used.
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> position(0.0f, 0.9f);
+  std::uniform_real_distribution<float> size(0.01f, 0.1f);
+  std::uniform_real_distribution<float> score(0.0f, 1.0f);
+  NmsBoxes boxes;
+  for (int i = 0; i < 500; ++i) {
+    const float x = position(rng);
+    const float y = position(rng);
+    boxes.Add(x, y, x + size(rng), y + size(rng), score(rng));
+  }
+  constexpr float kThreshold = 0.2f;
+
+  std::vector<int> order(boxes.size());
+  for (int i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&boxes](int a, int b) {
+    return boxes.score[a] > boxes.score[b];
+  });
+  std::vector<int> expected;
+  for (int i : order) {
+    const bool suppressed =
+        std::any_of(expected.begin(), expected.end(), [&](int retained) {
+          return IntersectionOverUnion(boxes, retained, i) > kThreshold;
+        });
+    if (!suppressed) expected.push_back(i);
+  }
+
+  NonMaxSuppressionEngine engine(GetOptions(kThreshold));
+  NmsResult result;
+  engine.Run(boxes, &result);
+
+  EXPECT_EQ(result.indices, expected);
+}
+
+TEST(NonMaxSuppressionEngineTest, WeightedClustersOverlappingBoxes) {
+  NmsBoxes boxes;
+  boxes.Add(0.0f, 0.0f, 0.4f, 0.4f, /*box_score=*/0.9f);
+  boxes.Add(0.5f, 0.5f, 0.9f, 0.9f, /*box_score=*/0.8f);
+  boxes.Add(0.1f, 0.1f, 0.5f, 0.5f, /*box_score=*/0.3f);
+  auto options = GetOptions(0.3f);
+  options.set_algorithm(NonMaxSuppressionCalculatorOptions::WEIGHTED);
+  NonMaxSuppressionEngine engine(options);
+  NmsResult result;
+
+  engine.Run(boxes, &result);
+
+  ASSERT_THAT(result.indices, ElementsAre(0, 1));
+  EXPECT_THAT(result.Cluster(0), ElementsAre(0, 2));
+  EXPECT_THAT(result.Cluster(1), ElementsAre(1));
+  const NmsWeightedBox box = GetWeightedBox(boxes, result.Cluster(0));
+  EXPECT_NEAR(box.xmin, 0.025f, 1e-6f);
+  EXPECT_NEAR(box.ymin, 0.025f, 1e-6f);
+  EXPECT_NEAR(box.xmax, 0.425f, 1e-6f);
+  EXPECT_NEAR(box.ymax, 0.425f, 1e-6f);
+}
+
+TEST(NonMaxSuppressionEngineTest, MulticlassSuppressesWithinClasses) {
+  NmsBoxes boxes;
+  boxes.Add(0.0f, 0.0f, 0.4f, 0.4f, /*box_score=*/0.9f, /*box_class_id=*/0);
+  boxes.Add(0.0f, 0.0f, 0.4f, 0.4f, /*box_score=*/0.7f, /*box_class_id=*/1);
+  boxes.Add(0.0f, 0.0f, 0.4f, 0.4f, /*box_score=*/0.8f, /*box_class_id=*/0);
+  boxes.Add(0.5f, 0.5f, 0.9f, 0.9f, /*box_score=*/0.6f, /*box_class_id=*/2);
+  auto options = GetOptions(0.3f);
+  options.set_multiclass_nms(true);
+  NonMaxSuppressionEngine engine(options);
+  ThreadPool thread_pool("nms_test", 2);
+  thread_pool.StartWorkers();
+  NmsResult result;
+
+  engine.Run(boxes, &result, &thread_pool);
+  EXPECT_THAT(result.indices, ElementsAre(0, 1, 3));
+
+  options.set_max_num_detections(2);
+  NonMaxSuppressionEngine limited_engine(options);
+  limited_engine.Run(boxes, &result);
+  EXPECT_THAT(result.indices, ElementsAre(0, 1));
+}
+
+}  // namespace
+}  // namespace mediapipe
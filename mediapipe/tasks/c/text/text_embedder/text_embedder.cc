@@ -15,8 +15,12 @@ limitations under the License.
 
 #include "mediapipe/tasks/c/text/text_embedder/text_embedder.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
@@ -25,6 +29,7 @@ limitations under the License.
 #include "mediapipe/tasks/c/components/processors/embedder_options_converter.h"
 #include "mediapipe/tasks/c/core/base_options_converter.h"
 #include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/components/utils/embedding_matrix.h"
 #include "mediapipe/tasks/cc/text/text_embedder/text_embedder.h"
 
 namespace mediapipe::tasks::c::text::text_embedder {
@@ -39,6 +44,7 @@ using ::mediapipe::tasks::c::components::processors::
     CppConvertToEmbedderOptions;
 using ::mediapipe::tasks::c::core::CppConvertToBaseOptions;
 using ::mediapipe::tasks::text::text_embedder::TextEmbedder;
+using ::mediapipe::tasks::components::utils::EmbeddingMatrix;
 typedef ::mediapipe::tasks::components::containers::Embedding CppEmbedding;
 
 int CppProcessError(absl::Status status, char** error_msg) {
@@ -113,6 +119,46 @@ int CppTextEmbedderCosineSimilarity(const Embedding* u, const Embedding* v,
   return 0;
 }
 
+void* CppTextEmbedderCreateEmbeddingMatrix(const Embedding* embeddings,
+                                           uint32_t embeddings_count,
+                                           int num_threads, char** error_msg) {
+  std::vector<CppEmbedding> cpp_embeddings(embeddings_count);
+  for (uint32_t i = 0; i < embeddings_count; ++i) {
+    CppConvertToCppEmbedding(embeddings[i], &cpp_embeddings[i]);
+  }
+  auto matrix = EmbeddingMatrix::Create(cpp_embeddings, num_threads);
+  if (!matrix.ok()) {
+    ABSL_LOG(ERROR) << "Failed to create embedding matrix: "
+                    << matrix.status();
+    CppProcessError(matrix.status(), error_msg);
+    return nullptr;
+  }
+  return matrix->release();
+}
+
+int CppTextEmbedderTopKSimilar(void* matrix, const Embedding* query, uint32_t k,
+                               uint32_t* indices, float* similarities,
+                               uint32_t* matches_count, char** error_msg) {
+  CppEmbedding cpp_query;
+  CppConvertToCppEmbedding(*query, &cpp_query);
+  auto matches = static_cast<EmbeddingMatrix*>(matrix)->TopK(
+      cpp_query, std::min<uint32_t>(k, std::numeric_limits<int>::max()));
+  if (!matches.ok()) {
+    ABSL_LOG(ERROR) << "Cannot find the most similar embeddings.";
+    return CppProcessError(matches.status(), error_msg);
+  }
+  for (int i = 0; i < matches->size(); ++i) {
+    indices[i] = (*matches)[i].index;
+    similarities[i] = (*matches)[i].similarity;
+  }
+  *matches_count = matches->size();
+  return 0;
+}
+
+void CppTextEmbedderCloseEmbeddingMatrix(void* matrix) {
+  delete static_cast<EmbeddingMatrix*>(matrix);
+}
+
 }  // namespace mediapipe::tasks::c::text::text_embedder
 
 extern "C" {
@@ -144,4 +190,26 @@ int text_embedder_cosine_similarity(const Embedding* u, const Embedding* v,
       CppTextEmbedderCosineSimilarity(u, v, similarity, error_msg);
 }
 
+void* text_embedder_create_embedding_matrix(const Embedding* embeddings,
+                                            uint32_t embeddings_count,
+                                            int num_threads, char** error_msg) {
+  return mediapipe::tasks::c::text::text_embedder::
+      CppTextEmbedderCreateEmbeddingMatrix(embeddings, embeddings_count,
+                                           num_threads, error_msg);
+}
+
+int text_embedder_top_k_similar(void* matrix, const Embedding* query,
+                                uint32_t k, uint32_t* indices,
+                                float* similarities, uint32_t* matches_count,
+                                char** error_msg) {
+  return mediapipe::tasks::c::text::text_embedder::
+      CppTextEmbedderTopKSimilar(matrix, query, k, indices, similarities,
+                                 matches_count, error_msg);
+}
+
+void text_embedder_close_embedding_matrix(void* matrix) {
+  mediapipe::tasks::c::text::text_embedder::
+      CppTextEmbedderCloseEmbeddingMatrix(matrix);
+}
+
 }  // extern "C"
@@ -77,6 +77,37 @@ MP_EXPORT int text_embedder_cosine_similarity(const struct Embedding* u,
                                               double* similarity,
                                               char** error_msg);
 
+// Creates a matrix of `embeddings_count` embeddings, e.g. of a collection to
+// search, against which queries are ranked with text_embedder_top_k_similar().
+// The embeddings are copied, and must be either all float or all quantized,
+// of the same size. Large matrices are scanned with up to `num_threads`
+// threads. Returns a pointer to the matrix on success.
+// If an error occurs, returns `nullptr` and sets the error parameter to an
+// an error message (if `error_msg` is not `nullptr`). You must free the memory
+// allocated for the error message.
+MP_EXPORT void* text_embedder_create_embedding_matrix(
+    const struct Embedding* embeddings, uint32_t embeddings_count,
+    int num_threads, char** error_msg);
+
+// Finds the `k` embeddings of `matrix` with the highest cosine similarity to
+// `query`, or all of them if there are fewer. Writes their indices and
+// similarities, by decreasing similarity, to `indices` and `similarities`,
+// which must hold `k` values each, and their count to `matches_count`.
+// Returns `0` on success.
+// If an error occurs, returns an error code and sets the error parameter to an
+// an error message (if `error_msg` is not `nullptr`). You must free the memory
+// allocated for the error message.
+MP_EXPORT int text_embedder_top_k_similar(void* matrix,
+                                          const struct Embedding* query,
+                                          uint32_t k, uint32_t* indices,
+                                          float* similarities,
+                                          uint32_t* matches_count,
+                                          char** error_msg);
+
+// Frees the memory of a matrix created by
+// text_embedder_create_embedding_matrix().
+MP_EXPORT void text_embedder_close_embedding_matrix(void* matrix);
+
 #ifdef __cplusplus
 }  // extern C
 #endif
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "mediapipe/tasks/c/text/text_embedder/text_embedder.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <string>
 
@@ -99,6 +100,52 @@ TEST(TextEmbedderTest, SucceedsWithCosineSimilarity) {
   text_embedder_close(embedder, /* error_msg */ nullptr);
 }
 
+TEST(TextEmbedderTest, SucceedsWithTopKSimilar) {
+  std::string model_path = GetFullPath(kTestBertModelPath);
+  TextEmbedderOptions options = {
+      /* base_options= */ {/* model_asset_buffer= */ nullptr,
+                           /* model_asset_buffer_count= */ 0,
+                           /* model_asset_path= */ model_path.c_str()},
+      /* embedder_options= */
+      {/* l2_normalize= */ false,
+       /* quantize= */ false}};
+
+  void* embedder = text_embedder_create(&options,
+                                        /* error_msg */ nullptr);
+  EXPECT_NE(embedder, nullptr);
+
+  TextEmbedderResult result0;
+  text_embedder_embed(embedder, kTestString0, &result0,
+                      /* error_msg */ nullptr);
+  TextEmbedderResult result1;
+  text_embedder_embed(embedder, kTestString1, &result1,
+                      /* error_msg */ nullptr);
+
+  // Rank both embeddings against the second one.
+  Embedding embeddings[] = {result0.embeddings[0], result1.embeddings[0]};
+  void* matrix = text_embedder_create_embedding_matrix(
+      embeddings, /* embeddings_count= */ 2, /* num_threads= */ 1,
+      /* error_msg */ nullptr);
+  ASSERT_NE(matrix, nullptr);
+  uint32_t indices[3];
+  float similarities[3];
+  uint32_t matches_count;
+  EXPECT_EQ(text_embedder_top_k_similar(
+                matrix, &result1.embeddings[0], /* k= */ 3, indices,
+                similarities, &matches_count, /* error_msg */ nullptr),
+            0);
+  ASSERT_EQ(matches_count, 2);
+  EXPECT_EQ(indices[0], 1);
+  EXPECT_NEAR(similarities[0], 1.0, kPrecision);
+  EXPECT_EQ(indices[1], 0);
+  EXPECT_NEAR(similarities[1], 0.9903823, kPrecision);
+
+  text_embedder_close_embedding_matrix(matrix);
+  text_embedder_close_result(&result0);
+  text_embedder_close_result(&result1);
+  text_embedder_close(embedder, /* error_msg */ nullptr);
+}
+
 TEST(TextEmbedderTest, ErrorHandling) {
   // It is an error to set neither the asset buffer nor the path.
   TextEmbedderOptions options = {
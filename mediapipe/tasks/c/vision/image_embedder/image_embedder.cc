@@ -15,10 +15,13 @@ limitations under the License.
 
 #include "mediapipe/tasks/c/vision/image_embedder/image_embedder.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
@@ -31,6 +34,7 @@ limitations under the License.
 #include "mediapipe/tasks/c/core/base_options_converter.h"
 #include "mediapipe/tasks/c/vision/core/common.h"
 #include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/components/utils/embedding_matrix.h"
 #include "mediapipe/tasks/cc/vision/core/running_mode.h"
 #include "mediapipe/tasks/cc/vision/image_embedder/image_embedder.h"
 #include "mediapipe/tasks/cc/vision/utils/image_utils.h"
@@ -49,6 +53,7 @@ using ::mediapipe::tasks::c::core::CppConvertToBaseOptions;
 using ::mediapipe::tasks::vision::CreateImageFromBuffer;
 using ::mediapipe::tasks::vision::core::RunningMode;
 using ::mediapipe::tasks::vision::image_embedder::ImageEmbedder;
+using ::mediapipe::tasks::components::utils::EmbeddingMatrix;
 typedef ::mediapipe::tasks::components::containers::Embedding CppEmbedding;
 typedef ::mediapipe::tasks::vision::image_embedder::ImageEmbedderResult
     CppImageEmbedderResult;
@@ -251,6 +256,47 @@ int CppImageEmbedderCosineSimilarity(const Embedding& u, const Embedding& v,
   return 0;
 }
 
+void* CppImageEmbedderCreateEmbeddingMatrix(const Embedding* embeddings,
+                                            uint32_t embeddings_count,
+                                            int num_threads, char** error_msg) {
+  std::vector<CppEmbedding> cpp_embeddings(embeddings_count);
+  for (uint32_t i = 0; i < embeddings_count; ++i) {
+    CppConvertToCppEmbedding(embeddings[i], &cpp_embeddings[i]);
+  }
+  auto matrix = EmbeddingMatrix::Create(cpp_embeddings, num_threads);
+  if (!matrix.ok()) {
+    ABSL_LOG(ERROR) << "Failed to create embedding matrix: "
+                    << matrix.status();
+    CppProcessError(matrix.status(), error_msg);
+    return nullptr;
+  }
+  return matrix->release();
+}
+
+int CppImageEmbedderTopKSimilar(void* matrix, const Embedding* query,
+                                uint32_t k, uint32_t* indices,
+                                float* similarities, uint32_t* matches_count,
+                                char** error_msg) {
+  CppEmbedding cpp_query;
+  CppConvertToCppEmbedding(*query, &cpp_query);
+  auto matches = static_cast<EmbeddingMatrix*>(matrix)->TopK(
+      cpp_query, std::min<uint32_t>(k, std::numeric_limits<int>::max()));
+  if (!matches.ok()) {
+    ABSL_LOG(ERROR) << "Cannot find the most similar embeddings.";
+    return CppProcessError(matches.status(), error_msg);
+  }
+  for (int i = 0; i < matches->size(); ++i) {
+    indices[i] = (*matches)[i].index;
+    similarities[i] = (*matches)[i].similarity;
+  }
+  *matches_count = matches->size();
+  return 0;
+}
+
+void CppImageEmbedderCloseEmbeddingMatrix(void* matrix) {
+  delete static_cast<EmbeddingMatrix*>(matrix);
+}
+
 }  // namespace mediapipe::tasks::c::vision::image_embedder
 
 extern "C" {
@@ -298,4 +344,27 @@ int image_embedder_cosine_similarity(const Embedding& u, const Embedding& v,
       CppImageEmbedderCosineSimilarity(u, v, similarity, error_msg);
 }
 
+void* image_embedder_create_embedding_matrix(const Embedding* embeddings,
+                                             uint32_t embeddings_count,
+                                             int num_threads,
+                                             char** error_msg) {
+  return mediapipe::tasks::c::vision::image_embedder::
+      CppImageEmbedderCreateEmbeddingMatrix(embeddings, embeddings_count,
+                                            num_threads, error_msg);
+}
+
+int image_embedder_top_k_similar(void* matrix, const Embedding* query,
+                                 uint32_t k, uint32_t* indices,
+                                 float* similarities, uint32_t* matches_count,
+                                 char** error_msg) {
+  return mediapipe::tasks::c::vision::image_embedder::
+      CppImageEmbedderTopKSimilar(matrix, query, k, indices, similarities,
+                                  matches_count, error_msg);
+}
+
+void image_embedder_close_embedding_matrix(void* matrix) {
+  mediapipe::tasks::c::vision::image_embedder::
+      CppImageEmbedderCloseEmbeddingMatrix(matrix);
+}
+
 }  // extern "C"
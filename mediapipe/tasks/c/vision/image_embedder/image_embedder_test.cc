@@ -157,6 +157,89 @@ TEST(ImageEmbedderTest, SucceedsWithCosineSimilarity) {
   image_embedder_close(embedder, /* error_msg */ nullptr);
 }
 
+TEST(ImageEmbedderTest, SucceedsWithTopKSimilar) {
+  const auto image = DecodeImageFromFile(GetFullPath("burger.jpg"));
+  ASSERT_TRUE(image.ok());
+  const auto crop = DecodeImageFromFile(GetFullPath("burger_crop.jpg"));
+  ASSERT_TRUE(crop.ok());
+
+  const std::string model_path = GetFullPath(kModelName);
+  ImageEmbedderOptions options = {
+      /* base_options= */ {/* model_asset_buffer= */ nullptr,
+                           /* model_asset_buffer_count= */ 0,
+                           /* model_asset_path= */ model_path.c_str()},
+      /* running_mode= */ RunningMode::IMAGE,
+      /* embedder_options= */
+      {/* l2_normalize= */ true,
+       /* quantize= */ false}};
+
+  void* embedder = image_embedder_create(&options,
+                                         /* error_msg */ nullptr);
+  EXPECT_NE(embedder, nullptr);
+
+  const MpImage mp_image = {
+      .type = MpImage::IMAGE_FRAME,
+      .image_frame = {
+          .format = static_cast<ImageFormat>(
+              image->GetImageFrameSharedPtr()->Format()),
+          .image_buffer = image->GetImageFrameSharedPtr()->PixelData(),
+          .width = image->GetImageFrameSharedPtr()->Width(),
+          .height = image->GetImageFrameSharedPtr()->Height()}};
+
+  const MpImage mp_crop = {
+      .type = MpImage::IMAGE_FRAME,
+      .image_frame = {
+          .format = static_cast<ImageFormat>(
+              crop->GetImageFrameSharedPtr()->Format()),
+          .image_buffer = crop->GetImageFrameSharedPtr()->PixelData(),
+          .width = crop->GetImageFrameSharedPtr()->Width(),
+          .height = crop->GetImageFrameSharedPtr()->Height()}};
+
+  ImageEmbedderResult image_result;
+  image_embedder_embed_image(embedder, &mp_image, &image_result,
+                             /* error_msg */ nullptr);
+  ImageEmbedderResult crop_result;
+  image_embedder_embed_image(embedder, &mp_crop, &crop_result,
+                             /* error_msg */ nullptr);
+
+  // Rank both embeddings against the crop.
+  Embedding embeddings[] = {image_result.embeddings[0],
+                            crop_result.embeddings[0]};
+  void* matrix = image_embedder_create_embedding_matrix(
+      embeddings, /* embeddings_count= */ 2, /* num_threads= */ 1,
+      /* error_msg */ nullptr);
+  ASSERT_NE(matrix, nullptr);
+  uint32_t indices[3];
+  float similarities[3];
+  uint32_t matches_count;
+  EXPECT_EQ(image_embedder_top_k_similar(
+                matrix, &crop_result.embeddings[0], /* k= */ 3, indices,
+                similarities, &matches_count, /* error_msg */ nullptr),
+            0);
+  ASSERT_EQ(matches_count, 2);
+  EXPECT_EQ(indices[0], 1);
+  EXPECT_NEAR(similarities[0], 1.0, kPrecision);
+  EXPECT_EQ(indices[1], 0);
+  EXPECT_NEAR(similarities[1], 0.925519, kPrecision);
+
+  image_embedder_close_embedding_matrix(matrix);
+  image_embedder_close_result(&image_result);
+  image_embedder_close_result(&crop_result);
+  image_embedder_close(embedder, /* error_msg */ nullptr);
+}
+
+TEST(ImageEmbedderTest, FailsToCreateEmptyEmbeddingMatrix) {
+  char* error_msg;
+  void* matrix = image_embedder_create_embedding_matrix(
+      /* embeddings= */ nullptr, /* embeddings_count= */ 0,
+      /* num_threads= */ 1, &error_msg);
+  EXPECT_EQ(matrix, nullptr);
+
+  EXPECT_THAT(error_msg, HasSubstr("Cannot create an empty embedding matrix"));
+
+  free(error_msg);
+}
+
 TEST(ImageEmbedderTest, VideoModeTest) {
   const auto image = DecodeImageFromFile(GetFullPath(kImageFile));
   ASSERT_TRUE(image.ok());
@@ -0,0 +1,79 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/audio_classifier/batch_audio_classifier.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/audio/audio_classifier/audio_classifier.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace audio_classifier {
+
+absl::StatusOr<std::unique_ptr<BatchAudioClassifier>>
+BatchAudioClassifier::Create(
+    std::vector<std::unique_ptr<AudioClassifier>> audio_classifiers,
+    const BatchAudioClassifierOptions& options) {
+  std::vector<AudioClipBatcher<AudioClassifierResult>::ProcessFn> process_fns;
+  for (const std::unique_ptr<AudioClassifier>& audio_classifier :
+       audio_classifiers) {
+    process_fns.push_back([audio_classifier = audio_classifier.get()](
+                              Matrix audio_clip, double audio_sample_rate) {
+      return audio_classifier->Classify(std::move(audio_clip),
+                                        audio_sample_rate);
+    });
+  }
+  auto batch_audio_classifier = absl::WrapUnique(
+      new BatchAudioClassifier(std::move(audio_classifiers)));
+  MP_ASSIGN_OR_RETURN(batch_audio_classifier->batcher_,
+                      AudioClipBatcher<AudioClassifierResult>::Create(
+                          std::move(process_fns), options));
+  return batch_audio_classifier;
+}
+
+BatchAudioClassifier::BatchAudioClassifier(
+    std::vector<std::unique_ptr<AudioClassifier>> audio_classifiers)
+    : audio_classifiers_(std::move(audio_classifiers)) {}
+
+absl::StatusOr<std::vector<AudioClassifierResult>>
+BatchAudioClassifier::Classify(const Matrix& audio_clip,
+                               double audio_sample_rate,
+                               AudioClipThroughput* throughput) {
+  return batcher_->Process(audio_clip, audio_sample_rate, throughput);
+}
+
+absl::Status BatchAudioClassifier::Close() {
+  absl::Status status;
+  for (const std::unique_ptr<AudioClassifier>& audio_classifier :
+       audio_classifiers_) {
+    status.Update(audio_classifier->Close());
+  }
+  return status;
+}
+
+}  // namespace audio_classifier
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
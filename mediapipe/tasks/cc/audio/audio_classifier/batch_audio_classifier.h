@@ -0,0 +1,82 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_CLASSIFIER_BATCH_AUDIO_CLASSIFIER_H_
+#define MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_CLASSIFIER_BATCH_AUDIO_CLASSIFIER_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/tasks/cc/audio/audio_classifier/audio_classifier.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace audio_classifier {
+
+// The options for configuring a BatchAudioClassifier: the model input windows,
+// and the minimum number of them per segment.
+using BatchAudioClassifierOptions = AudioClipBatchOptions;
+
+// Performs audio classification on long audio clips, e.g. hour-long
+// recordings, using several AudioClassifiers in parallel.
+//
+// The model input tensor only supports a batch size of 1, so rather than
+// batching the windows of the clip in one inference, the clip is split up
+// front into segments starting on window boundaries, which are classified in
+// parallel by the audio classifiers. The results are the same as those of
+// AudioClassifier::Classify() on the whole clip, in the same order and with
+// the same timestamps, up to the resampling edge effects at the segment
+// boundaries when the clip and model sample rates differ.
+class BatchAudioClassifier {
+ public:
+  // Creates a BatchAudioClassifier running each of `audio_classifiers` on its
+  // own thread. The audio classifiers must be created with the same model and
+  // options, in the audio clips mode.
+  static absl::StatusOr<std::unique_ptr<BatchAudioClassifier>> Create(
+      std::vector<std::unique_ptr<AudioClassifier>> audio_classifiers,
+      const BatchAudioClassifierOptions& options);
+
+  // Performs audio classification on `audio_clip`, a Matrix that has the
+  // number of channels rows and the number of samples per channel columns, at
+  // `audio_sample_rate`. Returns a ClassificationResult per model window, as
+  // AudioClassifier::Classify() does, and fills in `throughput` in audio
+  // seconds per wall second if not null.
+  absl::StatusOr<std::vector<AudioClassifierResult>> Classify(
+      const Matrix& audio_clip, double audio_sample_rate,
+      AudioClipThroughput* throughput = nullptr);
+
+  // Shuts down the audio classifiers when all works are done.
+  absl::Status Close();
+
+ private:
+  explicit BatchAudioClassifier(
+      std::vector<std::unique_ptr<AudioClassifier>> audio_classifiers);
+
+  std::vector<std::unique_ptr<AudioClassifier>> audio_classifiers_;
+  // Destroyed before the audio classifiers it runs.
+  std::unique_ptr<AudioClipBatcher<AudioClassifierResult>> batcher_;
+};
+
+}  // namespace audio_classifier
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_CLASSIFIER_BATCH_AUDIO_CLASSIFIER_H_
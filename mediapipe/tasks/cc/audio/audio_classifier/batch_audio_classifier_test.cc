@@ -0,0 +1,129 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/audio_classifier/batch_audio_classifier.h"
+
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/audio/audio_classifier/audio_classifier.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+#include "tensorflow/lite/test_util.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace audio_classifier {
+namespace {
+
+using ::mediapipe::file::JoinPath;
+using ::testing::FloatNear;
+
+constexpr char kTestDataDirectory[] = "/mediapipe/tasks/testdata/audio";
+constexpr char kModelWithMetadata[] =
+    "yamnet_audio_classifier_with_metadata.tflite";
+constexpr int kYamnetNumOfAudioSamples = 15600;
+constexpr int kYamnetAudioSampleRate = 16000;
+constexpr int kNumAudioClassifiers = 3;
+constexpr float kTolerance = 1e-6;
+
+absl::StatusOr<std::vector<std::unique_ptr<AudioClassifier>>>
+CreateAudioClassifiers(int num_audio_classifiers) {
+  std::vector<std::unique_ptr<AudioClassifier>> audio_classifiers;
+  for (int i = 0; i < num_audio_classifiers; ++i) {
+    auto options = std::make_unique<AudioClassifierOptions>();
+    options->base_options.model_asset_path =
+        JoinPath("./", kTestDataDirectory, kModelWithMetadata);
+    MP_ASSIGN_OR_RETURN(audio_classifiers.emplace_back(),
+                        AudioClassifier::Create(std::move(options)));
+  }
+  return audio_classifiers;
+}
+
+// Returns `num_seconds` of a 440Hz tone whose amplitude varies over time.
+Matrix GetToneAudioData(int num_seconds) {
+  Matrix audio_data(1, num_seconds * kYamnetAudioSampleRate);
+  for (int i = 0; i < audio_data.cols(); ++i) {
+    const double t = static_cast<double>(i) / kYamnetAudioSampleRate;
+    audio_data(0, i) = 0.5 * std::sin(0.1 * t) * std::sin(2 * M_PI * 440 * t);
+  }
+  return audio_data;
+}
+
+class BatchAudioClassifierTest : public tflite::testing::Test {};
+
+TEST_F(BatchAudioClassifierTest, MatchesClassify) {
+  const Matrix audio_data = GetToneAudioData(/*num_seconds=*/60);
+  MP_ASSERT_OK_AND_ASSIGN(auto audio_classifiers,
+                          CreateAudioClassifiers(kNumAudioClassifiers));
+  MP_ASSERT_OK_AND_ASSIGN(
+      const std::vector<AudioClassifierResult> expected,
+      audio_classifiers[0]->Classify(audio_data, kYamnetAudioSampleRate));
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<BatchAudioClassifier> batch_audio_classifier,
+      BatchAudioClassifier::Create(
+          std::move(audio_classifiers),
+          {.window_num_samples = kYamnetNumOfAudioSamples,
+           .window_sample_rate = kYamnetAudioSampleRate,
+           .min_windows_per_segment = 4}));
+
+  AudioClipThroughput throughput;
+  MP_ASSERT_OK_AND_ASSIGN(
+      const std::vector<AudioClassifierResult> results,
+      batch_audio_classifier->Classify(audio_data, kYamnetAudioSampleRate,
+                                       &throughput));
+
+  ASSERT_EQ(results.size(), expected.size());
+  for (int i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].timestamp_ms, expected[i].timestamp_ms);
+    ASSERT_EQ(results[i].classifications.size(), 1);
+    const auto& categories = results[i].classifications[0].categories;
+    const auto& expected_categories = expected[i].classifications[0].categories;
+    ASSERT_EQ(categories.size(), expected_categories.size());
+    for (int j = 0; j < categories.size(); ++j) {
+      EXPECT_EQ(categories[j].index, expected_categories[j].index);
+      EXPECT_THAT(categories[j].score,
+                  FloatNear(expected_categories[j].score, kTolerance));
+    }
+  }
+  EXPECT_DOUBLE_EQ(throughput.audio_seconds, 60.0);
+  EXPECT_GT(throughput.audio_seconds_per_wall_second(), 0.0);
+  MP_ASSERT_OK(batch_audio_classifier->Close());
+}
+
+TEST_F(BatchAudioClassifierTest, CreateFailsWithoutWindowSpecs) {
+  MP_ASSERT_OK_AND_ASSIGN(auto audio_classifiers,
+                          CreateAudioClassifiers(/*num_audio_classifiers=*/1));
+  EXPECT_EQ(BatchAudioClassifier::Create(std::move(audio_classifiers), {})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace audio_classifier
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
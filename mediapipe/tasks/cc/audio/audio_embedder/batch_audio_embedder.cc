@@ -0,0 +1,71 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/audio_embedder/batch_audio_embedder.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/audio/audio_embedder/audio_embedder.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+
+namespace mediapipe::tasks::audio::audio_embedder {
+
+absl::StatusOr<std::unique_ptr<BatchAudioEmbedder>>
+BatchAudioEmbedder::Create(
+    std::vector<std::unique_ptr<AudioEmbedder>> audio_embedders,
+    const BatchAudioEmbedderOptions& options) {
+  std::vector<AudioClipBatcher<AudioEmbedderResult>::ProcessFn> process_fns;
+  for (const std::unique_ptr<AudioEmbedder>& audio_embedder :
+       audio_embedders) {
+    process_fns.push_back([audio_embedder = audio_embedder.get()](
+                              Matrix audio_clip, double audio_sample_rate) {
+      return audio_embedder->Embed(std::move(audio_clip), audio_sample_rate);
+    });
+  }
+  auto batch_audio_embedder = absl::WrapUnique(
+      new BatchAudioEmbedder(std::move(audio_embedders)));
+  MP_ASSIGN_OR_RETURN(batch_audio_embedder->batcher_,
+                      AudioClipBatcher<AudioEmbedderResult>::Create(
+                          std::move(process_fns), options));
+  return batch_audio_embedder;
+}
+
+BatchAudioEmbedder::BatchAudioEmbedder(
+    std::vector<std::unique_ptr<AudioEmbedder>> audio_embedders)
+    : audio_embedders_(std::move(audio_embedders)) {}
+
+absl::StatusOr<std::vector<AudioEmbedderResult>> BatchAudioEmbedder::Embed(
+    const Matrix& audio_clip, double audio_sample_rate,
+    AudioClipThroughput* throughput) {
+  return batcher_->Process(audio_clip, audio_sample_rate, throughput);
+}
+
+absl::Status BatchAudioEmbedder::Close() {
+  absl::Status status;
+  for (const std::unique_ptr<AudioEmbedder>& audio_embedder :
+       audio_embedders_) {
+    status.Update(audio_embedder->Close());
+  }
+  return status;
+}
+
+}  // namespace mediapipe::tasks::audio::audio_embedder
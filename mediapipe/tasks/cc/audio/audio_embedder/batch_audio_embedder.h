@@ -0,0 +1,76 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_EMBEDDER_BATCH_AUDIO_EMBEDDER_H_
+#define MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_EMBEDDER_BATCH_AUDIO_EMBEDDER_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/tasks/cc/audio/audio_embedder/audio_embedder.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+
+namespace mediapipe::tasks::audio::audio_embedder {
+
+// The options for configuring a BatchAudioEmbedder: the model input windows,
+// and the minimum number of them per segment.
+using BatchAudioEmbedderOptions = AudioClipBatchOptions;
+
+// Performs embedding extraction on long audio clips, e.g. hour-long
+// recordings, using several AudioEmbedders in parallel.
+//
+// The model input tensor only supports a batch size of 1, so rather than
+// batching the windows of the clip in one inference, the clip is split up
+// front into segments starting on window boundaries, which are embedded in
+// parallel by the audio embedders. The results are the same as those of
+// AudioEmbedder::Embed() on the whole clip, in the same order and with the
+// same timestamps, up to the resampling edge effects at the segment boundaries
+// when the clip and model sample rates differ.
+class BatchAudioEmbedder {
+ public:
+  // Creates a BatchAudioEmbedder running each of `audio_embedders` on its own
+  // thread. The audio embedders must be created with the same model and
+  // options, in the audio clips mode.
+  static absl::StatusOr<std::unique_ptr<BatchAudioEmbedder>> Create(
+      std::vector<std::unique_ptr<AudioEmbedder>> audio_embedders,
+      const BatchAudioEmbedderOptions& options);
+
+  // Performs embedding extraction on `audio_clip`, a Matrix that has the
+  // number of channels rows and the number of samples per channel columns, at
+  // `audio_sample_rate`. Returns an EmbeddingResult per model window, as
+  // AudioEmbedder::Embed() does, and fills in `throughput` in audio seconds
+  // per wall second if not null.
+  absl::StatusOr<std::vector<AudioEmbedderResult>> Embed(
+      const Matrix& audio_clip, double audio_sample_rate,
+      AudioClipThroughput* throughput = nullptr);
+
+  // Shuts down the audio embedders when all works are done.
+  absl::Status Close();
+
+ private:
+  explicit BatchAudioEmbedder(
+      std::vector<std::unique_ptr<AudioEmbedder>> audio_embedders);
+
+  std::vector<std::unique_ptr<AudioEmbedder>> audio_embedders_;
+  // Destroyed before the audio embedders it runs.
+  std::unique_ptr<AudioClipBatcher<AudioEmbedderResult>> batcher_;
+};
+
+}  // namespace mediapipe::tasks::audio::audio_embedder
+
+#endif  // MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_EMBEDDER_BATCH_AUDIO_EMBEDDER_H_
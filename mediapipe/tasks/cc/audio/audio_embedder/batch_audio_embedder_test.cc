@@ -0,0 +1,96 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/audio_embedder/batch_audio_embedder.h"
+
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/audio/audio_embedder/audio_embedder.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+#include "tensorflow/lite/test_util.h"
+
+namespace mediapipe::tasks::audio::audio_embedder {
+namespace {
+
+using ::mediapipe::file::JoinPath;
+using ::testing::FloatNear;
+
+constexpr char kTestDataDirectory[] = "/mediapipe/tasks/testdata/audio";
+constexpr char kModelWithMetadata[] = "yamnet_embedding_metadata.tflite";
+constexpr int kYamnetNumOfAudioSamples = 15600;
+constexpr int kYamnetAudioSampleRate = 16000;
+constexpr int kNumAudioEmbedders = 3;
+constexpr float kValueDiffTolerance = 1e-6;
+
+class BatchAudioEmbedderTest : public tflite::testing::Test {};
+
+TEST_F(BatchAudioEmbedderTest, MatchesEmbed) {
+  // 30 seconds of a 440Hz tone whose amplitude varies over time.
+  Matrix audio_data(1, 30 * kYamnetAudioSampleRate);
+  for (int i = 0; i < audio_data.cols(); ++i) {
+    const double t = static_cast<double>(i) / kYamnetAudioSampleRate;
+    audio_data(0, i) = 0.5 * std::sin(0.1 * t) * std::sin(2 * M_PI * 440 * t);
+  }
+  std::vector<std::unique_ptr<AudioEmbedder>> audio_embedders;
+  for (int i = 0; i < kNumAudioEmbedders; ++i) {
+    auto options = std::make_unique<AudioEmbedderOptions>();
+    options->base_options.model_asset_path =
+        JoinPath("./", kTestDataDirectory, kModelWithMetadata);
+    MP_ASSERT_OK_AND_ASSIGN(audio_embedders.emplace_back(),
+                            AudioEmbedder::Create(std::move(options)));
+  }
+  MP_ASSERT_OK_AND_ASSIGN(
+      const std::vector<AudioEmbedderResult> expected,
+      audio_embedders[0]->Embed(audio_data, kYamnetAudioSampleRate));
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<BatchAudioEmbedder> batch_audio_embedder,
+      BatchAudioEmbedder::Create(
+          std::move(audio_embedders),
+          {.window_num_samples = kYamnetNumOfAudioSamples,
+           .window_sample_rate = kYamnetAudioSampleRate,
+           .min_windows_per_segment = 2}));
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      const std::vector<AudioEmbedderResult> results,
+      batch_audio_embedder->Embed(audio_data, kYamnetAudioSampleRate));
+
+  ASSERT_EQ(results.size(), expected.size());
+  for (int i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].timestamp_ms, expected[i].timestamp_ms);
+    ASSERT_EQ(results[i].embeddings.size(), 1);
+    const std::vector<float>& embedding =
+        results[i].embeddings[0].float_embedding;
+    const std::vector<float>& expected_embedding =
+        expected[i].embeddings[0].float_embedding;
+    ASSERT_EQ(embedding.size(), expected_embedding.size());
+    for (int j = 0; j < embedding.size(); ++j) {
+      EXPECT_THAT(embedding[j],
+                  FloatNear(expected_embedding[j], kValueDiffTolerance));
+    }
+  }
+  MP_ASSERT_OK(batch_audio_embedder->Close());
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::audio::audio_embedder
@@ -0,0 +1,123 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_tensor_specs.h"
+#include "mediapipe/tasks/cc/common.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+
+namespace {
+
+int64_t CeilDiv(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+}  // namespace
+
+absl::StatusOr<AudioClipBatchOptions> GetAudioClipBatchOptions(
+    const AudioTensorSpecs& input_specs) {
+  if (input_specs.num_samples <= 0 || input_specs.sample_rate <= 0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        absl::StrFormat("The model input audio tensor must have a positive "
+                        "number of samples and sample rate, found %d samples "
+                        "at %dHz.",
+                        input_specs.num_samples, input_specs.sample_rate),
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  if (input_specs.num_overlapping_samples != 0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        absl::StrFormat("Audio clips can't be split for models with "
+                        "overlapping input windows, found %d overlapping "
+                        "samples.",
+                        input_specs.num_overlapping_samples),
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  AudioClipBatchOptions options;
+  options.window_num_samples = input_specs.num_samples;
+  options.window_sample_rate = input_specs.sample_rate;
+  return options;
+}
+
+absl::StatusOr<std::vector<AudioClipSegment>> SplitAudioClip(
+    int64_t num_samples, double sample_rate, int num_segments,
+    const AudioClipBatchOptions& options) {
+  const int64_t clip_rate = std::llround(sample_rate);
+  if (clip_rate <= 0 || options.window_num_samples <= 0 ||
+      options.window_sample_rate <= 0 ||
+      options.min_windows_per_segment <= 0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "The sample rates, the window number of samples and the minimum "
+        "number of windows per segment must be positive.",
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  if (num_samples <= 0) {
+    return std::vector<AudioClipSegment>{
+        {.first_sample = 0, .num_samples = 0, .first_window = 0}};
+  }
+
+  // Window `w` starts at sample `w * window_num_samples * clip_rate /
+  // window_sample_rate` of the clip, so segments can only start on multiples
+  // of `unit_windows` windows, which span `unit_samples` samples.
+  const int64_t window_span = options.window_num_samples * clip_rate;
+  const int64_t unit_windows =
+      options.window_sample_rate /
+      std::gcd(window_span, int64_t{options.window_sample_rate});
+  const int64_t unit_samples =
+      unit_windows * window_span / options.window_sample_rate;
+
+  const int64_t num_units = CeilDiv(num_samples, unit_samples);
+  const int64_t units_per_segment =
+      std::max(CeilDiv(options.min_windows_per_segment, unit_windows),
+               CeilDiv(num_units, std::max(num_segments, 1)));
+  const int64_t segment_samples = units_per_segment * unit_samples;
+
+  std::vector<AudioClipSegment> segments;
+  for (int64_t first_sample = 0; first_sample < num_samples;
+       first_sample += segment_samples) {
+    segments.push_back(
+        {.first_sample = first_sample,
+         .num_samples = std::min(segment_samples, num_samples - first_sample),
+         .first_window = first_sample / unit_samples * unit_windows});
+  }
+  return segments;
+}
+
+int64_t GetWindowTimestampMs(int64_t window,
+                             const AudioClipBatchOptions& options) {
+  // AudioToTensorCalculator advances its output timestamps by the window
+  // duration rounded to microseconds, which the aggregation calculators
+  // truncate to milliseconds.
+  const int64_t window_duration_us = std::llround(
+      options.window_num_samples * 1e6 / options.window_sample_rate);
+  return window * window_duration_us / 1000;
+}
+
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
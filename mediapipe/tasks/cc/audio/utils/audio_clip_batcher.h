@@ -0,0 +1,230 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_AUDIO_UTILS_AUDIO_CLIP_BATCHER_H_
+#define MEDIAPIPE_TASKS_CC_AUDIO_UTILS_AUDIO_CLIP_BATCHER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_tensor_specs.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/core/task_replica_pool.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+
+// The options for processing long audio clips as segments in parallel.
+struct AudioClipBatchOptions {
+  // The number of samples per channel of the model input, and their sample
+  // rate, e.g. 15600 samples at 16000Hz for YAMNet. The segments are split on
+  // the boundaries of these windows, so that the clip is framed as if it was
+  // processed at once. Use GetAudioClipBatchOptions() to get them from the
+  // model.
+  int window_num_samples = 0;
+  int window_sample_rate = 0;
+
+  // The minimum number of model windows per segment. Each segment is a
+  // separate call to the task, which resamples it on its own, so shorter
+  // segments add per-call overhead and, when the clip and model sample rates
+  // differ, more resampling edge effects at the segment boundaries.
+  int min_windows_per_segment = 16;
+};
+
+// A segment of an audio clip, starting on a model window boundary.
+struct AudioClipSegment {
+  // The index of the first sample of the segment in the clip.
+  int64_t first_sample;
+  // The number of samples per channel of the segment.
+  int64_t num_samples;
+  // The index of the first model window of the segment in the clip.
+  int64_t first_window;
+};
+
+// The throughput of processing an audio clip.
+struct AudioClipThroughput {
+  // The duration of the clip.
+  double audio_seconds = 0.0;
+  // The wall time spent processing the clip.
+  double wall_seconds = 0.0;
+
+  double audio_seconds_per_wall_second() const {
+    return wall_seconds > 0.0 ? audio_seconds / wall_seconds : 0.0;
+  }
+};
+
+// Returns the options matching the input audio tensor specs of the model, as
+// built by BuildInputAudioTensorSpecs(), with the default minimum number of
+// windows per segment. Fails if the model input windows overlap, as the
+// windows across the segment boundaries would be cut.
+absl::StatusOr<AudioClipBatchOptions> GetAudioClipBatchOptions(
+    const AudioTensorSpecs& input_specs);
+
+// Splits a clip of `num_samples` samples per channel at `sample_rate` into
+// contiguous segments starting on model window boundaries, about
+// `num_segments` of them if the clip is long enough. Both sample rates are
+// rounded to integers to find the window boundaries which fall on a sample of
+// the clip.
+absl::StatusOr<std::vector<AudioClipSegment>> SplitAudioClip(
+    int64_t num_samples, double sample_rate, int num_segments,
+    const AudioClipBatchOptions& options);
+
+// Returns the timestamp of the model window at index `window` in a clip, as
+// the audio tasks compute it when processing the whole clip.
+int64_t GetWindowTimestampMs(int64_t window,
+                             const AudioClipBatchOptions& options);
+
+// Processes long audio clips, e.g. hour-long recordings, by splitting them
+// into segments with SplitAudioClip() and running each of them through one of
+// several replicas of an audio task in the audio clips mode, in parallel.
+//
+// The results of the segments are merged in order, and timestamped as their
+// windows in the whole clip, so that they match the results of processing the
+// whole clip with a single task, up to the resampling edge effects at the
+// segment boundaries.
+//
+// `ResultT` is the result type of the task, with a `timestamp_ms` field. The
+// task must return one result per model window, as the audio tasks do in the
+// audio clips mode.
+template <typename ResultT>
+class AudioClipBatcher {
+ public:
+  // Processes an audio clip given as a Matrix that has the number of channels
+  // rows, at the given sample rate, and returns the results of its windows.
+  using ProcessFn = std::function<absl::StatusOr<std::vector<ResultT>>(
+      mediapipe::Matrix, double)>;
+
+  // Creates an AudioClipBatcher running each of `process_fns` on its own
+  // thread, on one segment at a time.
+  static absl::StatusOr<std::unique_ptr<AudioClipBatcher>> Create(
+      std::vector<ProcessFn> process_fns, const AudioClipBatchOptions& options);
+
+  // Waits for the pending segments to be processed.
+  ~AudioClipBatcher();
+
+  // Processes `audio_clip` at `audio_sample_rate`, and returns the results of
+  // all its windows in timestamp order. Fills in `throughput` if not null.
+  // Must not be called concurrently.
+  absl::StatusOr<std::vector<ResultT>> Process(
+      const mediapipe::Matrix& audio_clip, double audio_sample_rate,
+      AudioClipThroughput* throughput = nullptr);
+
+ private:
+  AudioClipBatcher(std::vector<ProcessFn> process_fns,
+                   const AudioClipBatchOptions& options);
+
+  const std::vector<ProcessFn> process_fns_;
+  const AudioClipBatchOptions options_;
+
+  // Destroyed first, so that the pending segments are processed before the
+  // state they use is destroyed.
+  core::TaskReplicaPool replica_pool_;
+};
+
+template <typename ResultT>
+absl::StatusOr<std::unique_ptr<AudioClipBatcher<ResultT>>>
+AudioClipBatcher<ResultT>::Create(std::vector<ProcessFn> process_fns,
+                                  const AudioClipBatchOptions& options) {
+  if (process_fns.empty()) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "At least one task replica is required.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  if (options.window_num_samples <= 0 || options.window_sample_rate <= 0 ||
+      options.min_windows_per_segment <= 0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "The window number of samples and sample rate, and the minimum "
+        "number of windows per segment must be positive.",
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  return absl::WrapUnique(
+      new AudioClipBatcher(std::move(process_fns), options));
+}
+
+template <typename ResultT>
+AudioClipBatcher<ResultT>::AudioClipBatcher(
+    std::vector<ProcessFn> process_fns, const AudioClipBatchOptions& options)
+    : process_fns_(std::move(process_fns)),
+      options_(options),
+      replica_pool_("audio_clip_batcher", process_fns_.size()) {}
+
+template <typename ResultT>
+AudioClipBatcher<ResultT>::~AudioClipBatcher() = default;
+
+template <typename ResultT>
+absl::StatusOr<std::vector<ResultT>> AudioClipBatcher<ResultT>::Process(
+    const mediapipe::Matrix& audio_clip, double audio_sample_rate,
+    AudioClipThroughput* throughput) {
+  const absl::Time start_time = absl::Now();
+  // A few segments per replica balance the load when segments take uneven
+  // times to process.
+  constexpr int kSegmentsPerReplica = 4;
+  MP_ASSIGN_OR_RETURN(
+      const std::vector<AudioClipSegment> segments,
+      SplitAudioClip(audio_clip.cols(), audio_sample_rate,
+                     kSegmentsPerReplica * process_fns_.size(), options_));
+
+  std::vector<std::vector<ResultT>> segment_results(segments.size());
+  for (int i = 0; i < segments.size(); ++i) {
+    const absl::Status status = replica_pool_.Schedule(
+        [this, &audio_clip, audio_sample_rate, segment = &segments[i],
+         results = &segment_results[i]](int replica) -> absl::Status {
+          MP_ASSIGN_OR_RETURN(
+              *results,
+              process_fns_[replica](audio_clip.middleCols(
+                                        segment->first_sample,
+                                        segment->num_samples),
+                                    audio_sample_rate));
+          return absl::OkStatus();
+        });
+    // Wait() returns the error.
+    if (!status.ok()) break;
+  }
+  MP_RETURN_IF_ERROR(replica_pool_.Wait());
+
+  std::vector<ResultT> results;
+  for (int i = 0; i < segments.size(); ++i) {
+    for (int j = 0; j < segment_results[i].size(); ++j) {
+      ResultT& result = segment_results[i][j];
+      result.timestamp_ms =
+          GetWindowTimestampMs(segments[i].first_window + j, options_);
+      results.push_back(std::move(result));
+    }
+  }
+  if (throughput != nullptr) {
+    throughput->audio_seconds = audio_clip.cols() / audio_sample_rate;
+    throughput->wall_seconds =
+        absl::ToDoubleSeconds(absl::Now() - start_time);
+  }
+  return results;
+}
+
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_AUDIO_UTILS_AUDIO_CLIP_BATCHER_H_
@@ -0,0 +1,235 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/utils/audio_clip_batcher.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_tensor_specs.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace {
+
+constexpr int kWindowNumSamples = 100;
+constexpr int kSampleRate = 1000;
+
+// The result of a window: its first sample, and its timestamp.
+struct FakeResult {
+  float first_sample;
+  std::optional<int64_t> timestamp_ms;
+};
+
+// Returns the first sample and the timestamp of each window of `clip`, at the
+// window sample rate.
+absl::StatusOr<std::vector<FakeResult>> ProcessFake(Matrix clip,
+                                                    double sample_rate) {
+  std::vector<FakeResult> results;
+  for (int64_t first_sample = 0; first_sample < clip.cols();
+       first_sample += kWindowNumSamples) {
+    results.push_back(
+        {.first_sample = clip(0, first_sample),
+         .timestamp_ms = first_sample * 1000 / kSampleRate});
+  }
+  return results;
+}
+
+AudioClipBatchOptions GetOptions(int min_windows_per_segment) {
+  return {.window_num_samples = kWindowNumSamples,
+          .window_sample_rate = kSampleRate,
+          .min_windows_per_segment = min_windows_per_segment};
+}
+
+TEST(GetAudioClipBatchOptionsTest, UsesModelInputWindows) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      AudioClipBatchOptions options,
+      GetAudioClipBatchOptions({.num_channels = 1,
+                                .num_samples = 15600,
+                                .sample_rate = 16000,
+                                .num_overlapping_samples = 0}));
+
+  EXPECT_EQ(options.window_num_samples, 15600);
+  EXPECT_EQ(options.window_sample_rate, 16000);
+  EXPECT_EQ(options.min_windows_per_segment,
+            AudioClipBatchOptions().min_windows_per_segment);
+}
+
+TEST(GetAudioClipBatchOptionsTest, FailsWithOverlappingWindows) {
+  EXPECT_EQ(GetAudioClipBatchOptions({.num_channels = 1,
+                                      .num_samples = 15600,
+                                      .sample_rate = 16000,
+                                      .num_overlapping_samples = 7800})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(GetAudioClipBatchOptionsTest, FailsWithInvalidSampleRate) {
+  EXPECT_EQ(GetAudioClipBatchOptions({.num_channels = 1,
+                                      .num_samples = 15600,
+                                      .sample_rate = 0,
+                                      .num_overlapping_samples = 0})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(SplitAudioClipTest, SplitsOnWindowBoundaries) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<AudioClipSegment> segments,
+      SplitAudioClip(/*num_samples=*/1050, kSampleRate, /*num_segments=*/4,
+                     GetOptions(/*min_windows_per_segment=*/2)));
+
+  ASSERT_EQ(segments.size(), 4);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(segments[i].first_sample, 300 * i);
+    EXPECT_EQ(segments[i].num_samples, 300);
+    EXPECT_EQ(segments[i].first_window, 3 * i);
+  }
+  EXPECT_EQ(segments[3].first_sample, 900);
+  EXPECT_EQ(segments[3].num_samples, 150);
+  EXPECT_EQ(segments[3].first_window, 9);
+}
+
+TEST(SplitAudioClipTest, KeepsMinWindowsPerSegment) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<AudioClipSegment> segments,
+      SplitAudioClip(/*num_samples=*/1000, kSampleRate, /*num_segments=*/10,
+                     GetOptions(/*min_windows_per_segment=*/4)));
+
+  ASSERT_EQ(segments.size(), 3);
+  EXPECT_EQ(segments[1].first_sample, 400);
+  EXPECT_EQ(segments[2].num_samples, 200);
+}
+
+TEST(SplitAudioClipTest, SplitsOnWindowBoundariesAtOtherSampleRates) {
+  // YAMNet windows of 15600 samples at 16kHz span 42997.5 samples at 44.1kHz,
+  // so segments start every other window.
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<AudioClipSegment> segments,
+      SplitAudioClip(/*num_samples=*/44100 * 60, 44100, /*num_segments=*/100,
+                     {.window_num_samples = 15600,
+                      .window_sample_rate = 16000,
+                      .min_windows_per_segment = 1}));
+
+  ASSERT_EQ(segments.size(), 31);
+  for (const AudioClipSegment& segment : segments) {
+    EXPECT_EQ(segment.first_window % 2, 0);
+    EXPECT_EQ(segment.first_sample * 16000,
+              segment.first_window * 15600 * 44100);
+  }
+}
+
+TEST(SplitAudioClipTest, ReturnsOneSegmentForEmptyClips) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<AudioClipSegment> segments,
+      SplitAudioClip(/*num_samples=*/0, kSampleRate, /*num_segments=*/4,
+                     GetOptions(/*min_windows_per_segment=*/1)));
+
+  ASSERT_EQ(segments.size(), 1);
+  EXPECT_EQ(segments[0].num_samples, 0);
+}
+
+TEST(SplitAudioClipTest, FailsWithInvalidSampleRate) {
+  EXPECT_EQ(SplitAudioClip(/*num_samples=*/1000, /*sample_rate=*/0,
+                           /*num_segments=*/4,
+                           GetOptions(/*min_windows_per_segment=*/1))
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(GetWindowTimestampMsTest, AccumulatesRoundedWindowDurations) {
+  const AudioClipBatchOptions options = {.window_num_samples = 1,
+                                         .window_sample_rate = 3};
+  EXPECT_EQ(GetWindowTimestampMs(0, options), 0);
+  EXPECT_EQ(GetWindowTimestampMs(1, options), 333);
+  // The window duration is rounded to 333333us.
+  EXPECT_EQ(GetWindowTimestampMs(3, options), 999);
+}
+
+TEST(AudioClipBatcherTest, MergesSegmentResultsInOrder) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AudioClipBatcher<FakeResult>> batcher,
+      AudioClipBatcher<FakeResult>::Create(
+          {ProcessFake, ProcessFake, ProcessFake},
+          GetOptions(/*min_windows_per_segment=*/2)));
+  Matrix clip(1, 10050);
+  for (int i = 0; i < clip.cols(); ++i) {
+    clip(0, i) = i;
+  }
+
+  AudioClipThroughput throughput;
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<FakeResult> results,
+                          batcher->Process(clip, kSampleRate, &throughput));
+
+  ASSERT_EQ(results.size(), 101);
+  for (int i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].first_sample, i * kWindowNumSamples);
+    EXPECT_EQ(results[i].timestamp_ms, i * 100);
+  }
+  EXPECT_DOUBLE_EQ(throughput.audio_seconds, 10.05);
+  EXPECT_GT(throughput.wall_seconds, 0.0);
+  EXPECT_GT(throughput.audio_seconds_per_wall_second(), 0.0);
+}
+
+TEST(AudioClipBatcherTest, ReturnsReplicaErrors) {
+  int num_calls = 0;
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AudioClipBatcher<FakeResult>> batcher,
+      AudioClipBatcher<FakeResult>::Create(
+          {[&num_calls](Matrix clip, double sample_rate)
+               -> absl::StatusOr<std::vector<FakeResult>> {
+            if (++num_calls == 2) return absl::InternalError("failed");
+            return ProcessFake(std::move(clip), sample_rate);
+          }},
+          GetOptions(/*min_windows_per_segment=*/1)));
+
+  EXPECT_EQ(batcher->Process(Matrix::Zero(1, 1000), kSampleRate)
+                .status()
+                .code(),
+            absl::StatusCode::kInternal);
+  // Skips the segments after the error.
+  EXPECT_EQ(num_calls, 2);
+  // Processes the next clip.
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::vector<FakeResult> results,
+      batcher->Process(Matrix::Zero(1, 1000), kSampleRate));
+  EXPECT_EQ(results.size(), 10);
+}
+
+TEST(AudioClipBatcherTest, CreateFailsWithoutReplicas) {
+  EXPECT_EQ(AudioClipBatcher<FakeResult>::Create(
+                {}, GetOptions(/*min_windows_per_segment=*/1))
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
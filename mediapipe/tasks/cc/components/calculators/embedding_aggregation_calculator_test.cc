@@ -156,5 +156,39 @@ TEST_F(EmbeddingAggregationCalculatorTest, SucceedsWithAggregation) {
                                                  timestamp_ms: 1)pb")}));
 }
 
+TEST_F(EmbeddingAggregationCalculatorTest, KeepsQuantizedEmbeddings) {
+  MP_ASSERT_OK_AND_ASSIGN(auto poller, BuildGraph(/*connect_timestamps=*/true));
+  MP_ASSERT_OK(Send(ParseTextProtoOrDie<EmbeddingResult>(
+      R"pb(embeddings {
+             quantized_embedding { values: "\x7f\x80" }
+             head_index: 0
+           })pb")));
+  MP_ASSERT_OK(Send(
+      ParseTextProtoOrDie<EmbeddingResult>(
+          R"pb(embeddings {
+                 quantized_embedding { values: "\x01\xff" }
+                 head_index: 0
+               })pb"),
+      /*timestamp=*/1000,
+      /*aggregation_timestamps=*/std::optional<std::vector<int>>({0, 1000})));
+  MP_ASSERT_OK_AND_ASSIGN(auto results,
+                          GetResult<std::vector<EmbeddingResult>>(poller));
+
+  EXPECT_THAT(results,
+              Pointwise(EqualsProto(),
+                        {ParseTextProtoOrDie<EmbeddingResult>(
+                             R"pb(embeddings {
+                                    quantized_embedding { values: "\x7f\x80" }
+                                    head_index: 0
+                                  }
+                                  timestamp_ms: 0)pb"),
+                         ParseTextProtoOrDie<EmbeddingResult>(
+                             R"pb(embeddings {
+                                    quantized_embedding { values: "\x01\xff" }
+                                    head_index: 0
+                                  }
+                                  timestamp_ms: 1)pb")}));
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -14,12 +14,12 @@
 
 #include <math.h>
 
-#include <algorithm>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/api2/port.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -28,6 +28,7 @@
 #include "mediapipe/tasks/cc/components/calculators/tensors_to_embeddings_calculator.pb.h"
 #include "mediapipe/tasks/cc/components/containers/proto/embeddings.pb.h"
 #include "mediapipe/tasks/cc/components/processors/proto/embedder_options.pb.h"
+#include "mediapipe/tasks/cc/components/utils/quantized_embedding.h"
 
 namespace mediapipe {
 namespace api2 {
@@ -142,22 +143,12 @@ void TensorsToEmbeddingsCalculator::FillFloatEmbedding(const Tensor& tensor,
 
 void TensorsToEmbeddingsCalculator::FillQuantizedEmbedding(
     const Tensor& tensor, Embedding* embedding) {
-  int size = tensor.shape().num_elements();
   auto tensor_view = tensor.GetCpuReadView();
-  const float* tensor_buffer = tensor_view.buffer<float>();
-  float inv_l2_norm =
-      l2_normalize_ ? GetInverseL2Norm(tensor_buffer, size) : 1.0f;
-  auto* values = embedding->mutable_quantized_embedding()->mutable_values();
-  values->resize(size);
-  for (int i = 0; i < size; ++i) {
-    // Normalize.
-    float normalized = tensor_buffer[i] * inv_l2_norm;
-    // Quantize.
-    int unclamped_value = static_cast<int>(roundf(normalized * 128));
-    // Clamp and assign.
-    (*values)[i] =
-        static_cast<char>(std::max(-128, std::min(unclamped_value, 127)));
-  }
+  tasks::components::utils::QuantizeEmbedding(
+      absl::MakeConstSpan(tensor_view.buffer<float>(),
+                          tensor.shape().num_elements()),
+      l2_normalize_,
+      embedding->mutable_quantized_embedding()->mutable_values());
 }
 
 MEDIAPIPE_REGISTER_NODE(TensorsToEmbeddingsCalculator);
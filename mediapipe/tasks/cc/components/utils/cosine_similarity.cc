@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "mediapipe/tasks/cc/components/utils/cosine_similarity.h"
 
+#include <cmath>
 #include <cstdint>
 
 #include "absl/status/status.h"
@@ -22,6 +23,7 @@ limitations under the License.
 #include "absl/strings/str_format.h"
 #include "mediapipe/tasks/cc/common.h"
 #include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/components/utils/quantized_embedding.h"
 
 namespace mediapipe {
 namespace tasks {
@@ -58,6 +60,29 @@ absl::StatusOr<double> ComputeCosineSimilarity(const T& u, const T& v,
   return dot_product / std::sqrt(norm_u * norm_v);
 }
 
+// Quantized embeddings are compared with exact int8 dot products, rather than
+// converting each value to double.
+absl::StatusOr<double> ComputeCosineSimilarity(const int8_t* u,
+                                               const int8_t* v,
+                                               int num_elements) {
+  if (num_elements <= 0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "Cannot compute cosing similarity on empty embeddings",
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  const double dot_product = Int8DotProduct(u, v, num_elements);
+  const double norm_u = Int8DotProduct(u, u, num_elements);
+  const double norm_v = Int8DotProduct(v, v, num_elements);
+  if (norm_u <= 0.0 || norm_v <= 0.0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "Cannot compute cosine similarity on embedding with 0 norm",
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  return dot_product / std::sqrt(norm_u * norm_v);
+}
+
 }  // namespace
 
 // Utility function to compute cosine similarity [1] between two embedding
@@ -0,0 +1,262 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/components/utils/embedding_matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/components/utils/quantized_embedding.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+
+namespace {
+
+using ::mediapipe::tasks::components::containers::Embedding;
+
+using RowMajorMatrix =
+    Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// Below this number of multiply-adds per shard, scanning with more threads
+// costs more than it saves.
+constexpr int64_t kMinShardSize = 1 << 18;
+
+absl::Status InvalidArgumentError(absl::string_view message) {
+  return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument, message,
+                                 MediaPipeTasksStatus::kInvalidArgumentError);
+}
+
+absl::Span<const int8_t> QuantizedValues(const Embedding& embedding) {
+  return absl::MakeConstSpan(
+      reinterpret_cast<const int8_t*>(embedding.quantized_embedding.data()),
+      embedding.quantized_embedding.size());
+}
+
+template <typename T>
+double SquaredNorm(absl::Span<const T> values) {
+  double squared_norm = 0.0;
+  for (const T value : values) {
+    squared_norm += static_cast<double>(value) * value;
+  }
+  return squared_norm;
+}
+
+// Checks that `embedding` can be compared to embeddings of `dimension`
+// values of the given type, and returns its inverse L2-norm.
+absl::StatusOr<float> ValidateEmbedding(const Embedding& embedding,
+                                        int dimension, bool quantized) {
+  if (quantized ? embedding.quantized_embedding.empty()
+                : embedding.float_embedding.empty()) {
+    return InvalidArgumentError(
+        "Cannot compute cosine similarity between quantized and float "
+        "embeddings");
+  }
+  const int size = quantized ? embedding.quantized_embedding.size()
+                             : embedding.float_embedding.size();
+  if (size != dimension) {
+    return InvalidArgumentError(
+        absl::StrFormat("Cannot compute cosine similarity between embeddings "
+                        "of different sizes (%d vs. %d)",
+                        size, dimension));
+  }
+  const double squared_norm =
+      quantized ? SquaredNorm(QuantizedValues(embedding))
+                : SquaredNorm(absl::MakeConstSpan(embedding.float_embedding));
+  if (squared_norm <= 0.0) {
+    return InvalidArgumentError(
+        "Cannot compute cosine similarity on embedding with 0 norm");
+  }
+  return static_cast<float>(1.0 / std::sqrt(squared_norm));
+}
+
+// Orders matches by decreasing similarity, then increasing index.
+bool IsMoreSimilar(const SimilarityMatch& a, const SimilarityMatch& b) {
+  return a.similarity != b.similarity ? a.similarity > b.similarity
+                                      : a.index < b.index;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<EmbeddingMatrix>> EmbeddingMatrix::Create(
+    absl::Span<const Embedding> embeddings, int num_threads) {
+  if (embeddings.empty()) {
+    return InvalidArgumentError("Cannot create an empty embedding matrix");
+  }
+  const bool quantized = embeddings[0].float_embedding.empty();
+  const int dimension = quantized ? embeddings[0].quantized_embedding.size()
+                                  : embeddings[0].float_embedding.size();
+  if (dimension <= 0) {
+    return InvalidArgumentError(
+        "Cannot compute cosing similarity on empty embeddings");
+  }
+  auto matrix = absl::WrapUnique(new EmbeddingMatrix(
+      embeddings.size(), dimension, quantized, num_threads));
+
+  if (quantized) {
+    matrix->quantized_rows_.reserve(embeddings.size() * dimension);
+    matrix->inverse_norms_.reserve(embeddings.size());
+  } else {
+    matrix->float_rows_.reserve(embeddings.size() * dimension);
+  }
+  for (const Embedding& embedding : embeddings) {
+    MP_ASSIGN_OR_RETURN(const float inverse_norm,
+                        ValidateEmbedding(embedding, dimension, quantized));
+    if (quantized) {
+      const absl::Span<const int8_t> values = QuantizedValues(embedding);
+      matrix->quantized_rows_.insert(matrix->quantized_rows_.end(),
+                                     values.begin(), values.end());
+      matrix->inverse_norms_.push_back(inverse_norm);
+    } else {
+      for (const float value : embedding.float_embedding) {
+        matrix->float_rows_.push_back(value * inverse_norm);
+      }
+    }
+  }
+  return matrix;
+}
+
+EmbeddingMatrix::EmbeddingMatrix(int num_rows, int dimension, bool quantized,
+                                 int num_threads)
+    : num_rows_(num_rows),
+      dimension_(dimension),
+      quantized_(quantized),
+      num_shards_(static_cast<int>(std::clamp<int64_t>(
+          static_cast<int64_t>(num_rows) * dimension / kMinShardSize, 1,
+          std::max(num_threads, 1)))) {
+  if (num_shards_ > 1) {
+    thread_pool_ =
+        std::make_unique<ThreadPool>("embedding_matrix", num_shards_);
+    thread_pool_->StartWorkers();
+  }
+}
+
+void EmbeddingMatrix::ScanRows(absl::Span<const float> float_query,
+                               absl::Span<const int8_t> quantized_query,
+                               float query_inverse_norm, int begin, int end,
+                               float* similarities) const {
+  if (quantized_) {
+    const int8_t* row =
+        quantized_rows_.data() + static_cast<size_t>(begin) * dimension_;
+    for (int i = begin; i < end; ++i, row += dimension_) {
+      similarities[i] =
+          Int8DotProduct(row, quantized_query.data(), dimension_) *
+          inverse_norms_[i] * query_inverse_norm;
+    }
+    return;
+  }
+  // A matrix-vector product, vectorized by Eigen.
+  Eigen::Map<const RowMajorMatrix> rows(
+      float_rows_.data() + static_cast<size_t>(begin) * dimension_,
+      end - begin, dimension_);
+  Eigen::Map<const Eigen::VectorXf> query(float_query.data(), dimension_);
+  Eigen::Map<Eigen::VectorXf> result(similarities + begin, end - begin);
+  result.noalias() = rows * query;
+  result *= query_inverse_norm;
+}
+
+void EmbeddingMatrix::ForEachShard(
+    const std::function<void(int, int, int)>& fn) const {
+  const int shard_size = (num_rows_ + num_shards_ - 1) / num_shards_;
+  if (thread_pool_ == nullptr) {
+    fn(0, 0, num_rows_);
+    return;
+  }
+  absl::BlockingCounter counter(num_shards_);
+  for (int shard = 0; shard < num_shards_; ++shard) {
+    const int begin = std::min(shard * shard_size, num_rows_);
+    const int end = std::min(begin + shard_size, num_rows_);
+    thread_pool_->Schedule([&fn, &counter, shard, begin, end] {
+      fn(shard, begin, end);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+absl::StatusOr<std::vector<float>> EmbeddingMatrix::CosineSimilarities(
+    const Embedding& query) const {
+  MP_ASSIGN_OR_RETURN(const float query_inverse_norm,
+                      ValidateEmbedding(query, dimension_, quantized_));
+  std::vector<float> similarities(num_rows_);
+  ForEachShard([&](int shard, int begin, int end) {
+    ScanRows(query.float_embedding, QuantizedValues(query), query_inverse_norm,
+             begin, end, similarities.data());
+  });
+  return similarities;
+}
+
+absl::StatusOr<std::vector<SimilarityMatch>> EmbeddingMatrix::TopK(
+    const Embedding& query, int k) const {
+  MP_ASSIGN_OR_RETURN(const float query_inverse_norm,
+                      ValidateEmbedding(query, dimension_, quantized_));
+  k = std::clamp(k, 0, num_rows_);
+  std::vector<float> similarities(num_rows_);
+  // The top k of each shard, selected in parallel, then merged.
+  std::vector<std::vector<SimilarityMatch>> shard_matches(num_shards_);
+  ForEachShard([&](int shard, int begin, int end) {
+    ScanRows(query.float_embedding, QuantizedValues(query), query_inverse_norm,
+             begin, end, similarities.data());
+    // A heap of the top k so far, with the least similar one first.
+    std::vector<SimilarityMatch>& matches = shard_matches[shard];
+    matches.reserve(k);
+    for (int i = begin; i < end; ++i) {
+      const SimilarityMatch match = {i, similarities[i]};
+      if (static_cast<int>(matches.size()) < k) {
+        matches.push_back(match);
+        std::push_heap(matches.begin(), matches.end(), IsMoreSimilar);
+      } else if (k > 0 && IsMoreSimilar(match, matches.front())) {
+        std::pop_heap(matches.begin(), matches.end(), IsMoreSimilar);
+        matches.back() = match;
+        std::push_heap(matches.begin(), matches.end(), IsMoreSimilar);
+      }
+    }
+  });
+
+  std::vector<SimilarityMatch> top_k = std::move(shard_matches[0]);
+  for (int shard = 1; shard < num_shards_; ++shard) {
+    top_k.insert(top_k.end(), shard_matches[shard].begin(),
+                 shard_matches[shard].end());
+  }
+  std::partial_sort(top_k.begin(), top_k.begin() + k, top_k.end(),
+                    IsMoreSimilar);
+  top_k.resize(k);
+  return top_k;
+}
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,112 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_EMBEDDING_MATRIX_H_
+#define MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_EMBEDDING_MATRIX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+
+// A row of an EmbeddingMatrix and its cosine similarity to a query.
+struct SimilarityMatch {
+  // The index of the row, i.e. of the embedding the matrix was created from.
+  int index;
+  // The cosine similarity between the row and the query.
+  float similarity;
+};
+
+// Ranks queries against a set of embeddings by cosine similarity [1], like
+// CosineSimilarity() does for two embeddings, but in one scan of a contiguous
+// matrix instead of one call per embedding.
+//
+// Float embeddings are L2-normalized once when the matrix is created, so
+// that similarities are plain dot products. Quantized embeddings are kept as
+// int8 and scanned with integer dot products, scaled by the inverse norms
+// computed once per row. Large matrices are scanned by several threads.
+//
+// The matrix is immutable and can be queried from several threads at once.
+//
+// [1]: https://en.wikipedia.org/wiki/Cosine_similarity
+class EmbeddingMatrix {
+ public:
+  // Creates a matrix from `embeddings`, which must be non-empty, either all
+  // float or all quantized, of the same non-zero size, and have non-zero
+  // L2-norms. Matrices of at least a few thousand rows are scanned with up to
+  // `num_threads` threads.
+  static absl::StatusOr<std::unique_ptr<EmbeddingMatrix>> Create(
+      absl::Span<const containers::Embedding> embeddings, int num_threads = 1);
+
+  // Returns the cosine similarities between `query` and each row. May return
+  // an InvalidArgumentError if `query` is not of the type and size of the
+  // rows, or has an L2-norm of 0.
+  absl::StatusOr<std::vector<float>> CosineSimilarities(
+      const containers::Embedding& query) const;
+
+  // Returns the `k` rows most similar to `query`, or all of them if there are
+  // fewer, by decreasing similarity, with ties by increasing index. May return
+  // the same errors as CosineSimilarities().
+  absl::StatusOr<std::vector<SimilarityMatch>> TopK(
+      const containers::Embedding& query, int k) const;
+
+  int num_rows() const { return num_rows_; }
+  int dimension() const { return dimension_; }
+  bool quantized() const { return quantized_; }
+
+ private:
+  EmbeddingMatrix(int num_rows, int dimension, bool quantized,
+                  int num_threads);
+
+  // Computes the similarities of `query` with rows [begin, end) into
+  // `similarities`, which holds one value per row.
+  void ScanRows(absl::Span<const float> float_query,
+                absl::Span<const int8_t> quantized_query,
+                float query_inverse_norm, int begin, int end,
+                float* similarities) const;
+
+  // Calls `fn(shard, begin, end)` for each shard of rows, in parallel if the
+  // matrix has a thread pool, and returns once all the calls did.
+  void ForEachShard(const std::function<void(int, int, int)>& fn) const;
+
+  const int num_rows_;
+  const int dimension_;
+  const bool quantized_;
+  const int num_shards_;
+  // The L2-normalized float rows, of `dimension_` values each.
+  std::vector<float> float_rows_;
+  // The quantized rows, of `dimension_` values each.
+  std::vector<int8_t> quantized_rows_;
+  // The inverse L2-norms of the quantized rows.
+  std::vector<float> inverse_norms_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_EMBEDDING_MATRIX_H_
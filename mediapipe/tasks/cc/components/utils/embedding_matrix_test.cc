@@ -0,0 +1,220 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/components/utils/embedding_matrix.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/components/utils/cosine_similarity.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+namespace {
+
+using ::mediapipe::tasks::components::containers::Embedding;
+using ::testing::HasSubstr;
+
+// Helper function to generate float Embedding.
+Embedding BuildFloatEmbedding(std::vector<float> values) {
+  Embedding embedding;
+  embedding.float_embedding = values;
+  return embedding;
+}
+
+// Helper function to generate quantized Embedding.
+Embedding BuildQuantizedEmbedding(std::vector<int8_t> values) {
+  Embedding embedding;
+  uint8_t* data = reinterpret_cast<uint8_t*>(values.data());
+  embedding.quantized_embedding = {data, data + values.size()};
+  return embedding;
+}
+
+// Generates `num_embeddings` random embeddings of `dimension` values.
+std::vector<Embedding> BuildRandomEmbeddings(int num_embeddings,
+                                             int dimension, bool quantized,
+                                             int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> distribution(-128, 127);
+  std::vector<Embedding> embeddings;
+  for (int i = 0; i < num_embeddings; ++i) {
+    std::vector<int8_t> values(dimension);
+    for (int8_t& value : values) value = distribution(rng);
+    if (quantized) {
+      embeddings.push_back(BuildQuantizedEmbedding(values));
+    } else {
+      embeddings.push_back(
+          BuildFloatEmbedding(std::vector<float>(values.begin(),
+                                                 values.end())));
+    }
+  }
+  return embeddings;
+}
+
+TEST(EmbeddingMatrix, FailsWithQuantizedAndFloatEmbeddings) {
+  auto matrix = EmbeddingMatrix::Create(
+      {BuildFloatEmbedding({0.1, 0.2}), BuildQuantizedEmbedding({0, 1})});
+
+  EXPECT_EQ(matrix.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(matrix.status().message(),
+              HasSubstr("Cannot compute cosine similarity between quantized "
+                        "and float embeddings"));
+}
+
+TEST(EmbeddingMatrix, FailsWithZeroNorm) {
+  auto matrix = EmbeddingMatrix::Create(
+      {BuildFloatEmbedding({0.1, 0.2}), BuildFloatEmbedding({0.0, 0.0})});
+
+  EXPECT_EQ(matrix.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(
+      matrix.status().message(),
+      HasSubstr("Cannot compute cosine similarity on embedding with 0 norm"));
+}
+
+TEST(EmbeddingMatrix, FailsWithQueryOfDifferentSize) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto matrix, EmbeddingMatrix::Create({BuildFloatEmbedding({0.1, 0.2})}));
+
+  auto similarities =
+      matrix->CosineSimilarities(BuildFloatEmbedding({0.1, 0.2, 0.3}));
+
+  EXPECT_EQ(similarities.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(similarities.status().message(),
+              HasSubstr("Cannot compute cosine similarity between embeddings "
+                        "of different sizes"));
+}
+
+TEST(EmbeddingMatrix, SimilaritiesMatchCosineSimilarity) {
+  for (const bool quantized : {false, true}) {
+    const std::vector<Embedding> embeddings =
+        BuildRandomEmbeddings(/*num_embeddings=*/100, /*dimension=*/37,
+                              quantized, /*seed=*/0);
+    const Embedding query =
+        BuildRandomEmbeddings(1, /*dimension=*/37, quantized, /*seed=*/1)[0];
+    MP_ASSERT_OK_AND_ASSIGN(auto matrix, EmbeddingMatrix::Create(embeddings));
+
+    MP_ASSERT_OK_AND_ASSIGN(auto similarities,
+                            matrix->CosineSimilarities(query));
+
+    ASSERT_EQ(similarities.size(), embeddings.size());
+    for (int i = 0; i < embeddings.size(); ++i) {
+      MP_ASSERT_OK_AND_ASSIGN(double expected,
+                              CosineSimilarity(embeddings[i], query));
+      EXPECT_NEAR(similarities[i], expected, 1e-5) << i;
+    }
+  }
+}
+
+TEST(EmbeddingMatrix, TopKSortsBySimilarityThenIndex) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto matrix,
+      EmbeddingMatrix::Create(
+          {BuildFloatEmbedding({0.0, 1.0}), BuildFloatEmbedding({1.0, 0.0}),
+           BuildFloatEmbedding({1.0, 1.0}), BuildFloatEmbedding({2.0, 0.0}),
+           BuildFloatEmbedding({-1.0, 0.0})}));
+
+  MP_ASSERT_OK_AND_ASSIGN(auto matches,
+                          matrix->TopK(BuildFloatEmbedding({3.0, 0.0}), 3));
+
+  ASSERT_EQ(matches.size(), 3);
+  EXPECT_EQ(matches[0].index, 1);
+  EXPECT_FLOAT_EQ(matches[0].similarity, 1.0);
+  EXPECT_EQ(matches[1].index, 3);
+  EXPECT_FLOAT_EQ(matches[1].similarity, 1.0);
+  EXPECT_EQ(matches[2].index, 2);
+  EXPECT_NEAR(matches[2].similarity, 0.70710677, 1e-6);
+}
+
+TEST(EmbeddingMatrix, TopKReturnsAllRowsIfFewerThanK) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto matrix,
+      EmbeddingMatrix::Create({BuildQuantizedEmbedding({127, 0}),
+                               BuildQuantizedEmbedding({-128, 0})}));
+
+  MP_ASSERT_OK_AND_ASSIGN(auto matches,
+                          matrix->TopK(BuildQuantizedEmbedding({-1, 0}), 10));
+
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].index, 1);
+  EXPECT_FLOAT_EQ(matches[0].similarity, 1.0);
+  EXPECT_EQ(matches[1].index, 0);
+  EXPECT_FLOAT_EQ(matches[1].similarity, -1.0);
+}
+
+TEST(EmbeddingMatrix, MultiThreadedTopKMatchesSingleThreaded) {
+  for (const bool quantized : {false, true}) {
+    const std::vector<Embedding> embeddings =
+        BuildRandomEmbeddings(/*num_embeddings=*/10000, /*dimension=*/128,
+                              quantized, /*seed=*/0);
+    const Embedding query =
+        BuildRandomEmbeddings(1, /*dimension=*/128, quantized, /*seed=*/1)[0];
+    MP_ASSERT_OK_AND_ASSIGN(auto matrix, EmbeddingMatrix::Create(embeddings));
+    MP_ASSERT_OK_AND_ASSIGN(
+        auto parallel_matrix,
+        EmbeddingMatrix::Create(embeddings, /*num_threads=*/4));
+
+    MP_ASSERT_OK_AND_ASSIGN(auto matches, matrix->TopK(query, 20));
+    MP_ASSERT_OK_AND_ASSIGN(auto parallel_matches,
+                            parallel_matrix->TopK(query, 20));
+
+    ASSERT_EQ(parallel_matches.size(), matches.size());
+    for (int i = 0; i < matches.size(); ++i) {
+      EXPECT_EQ(parallel_matches[i].index, matches[i].index);
+      EXPECT_EQ(parallel_matches[i].similarity, matches[i].similarity);
+    }
+  }
+}
+
+}  // namespace
+
+// Benchmarks the top 10 of a query. Args: num_embeddings, dimension,
+// quantized, num_threads.
+void BM_EmbeddingMatrixTopK(benchmark::State& state) {
+  const bool quantized = state.range(2);
+  const std::vector<Embedding> embeddings = BuildRandomEmbeddings(
+      state.range(0), state.range(1), quantized, /*seed=*/0);
+  const Embedding query =
+      BuildRandomEmbeddings(1, state.range(1), quantized, /*seed=*/1)[0];
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto matrix, EmbeddingMatrix::Create(embeddings, state.range(3)));
+
+  for (auto s : state) {
+    MP_ASSERT_OK_AND_ASSIGN(auto matches, matrix->TopK(query, 10));
+    benchmark::DoNotOptimize(matches);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EmbeddingMatrixTopK)
+    ->Args({/*num_embeddings=*/100000, /*dimension=*/512, /*quantized=*/0,
+            /*num_threads=*/1})
+    ->Args({/*num_embeddings=*/100000, /*dimension=*/512, /*quantized=*/1,
+            /*num_threads=*/1})
+    ->Args({/*num_embeddings=*/100000, /*dimension=*/512, /*quantized=*/0,
+            /*num_threads=*/4})
+    ->Args({/*num_embeddings=*/100000, /*dimension=*/512, /*quantized=*/1,
+            /*num_threads=*/4});
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,671 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/components/utils/ivf_pq_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/core/external_file_handler.h"
+#include "mediapipe/tasks/cc/core/proto/external_file.pb.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+
+namespace {
+
+using ::mediapipe::tasks::components::containers::Embedding;
+using ::mediapipe::tasks::core::ExternalFileHandler;
+using ::mediapipe::tasks::core::proto::ExternalFile;
+
+using RowMajorMatrix =
+    Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// The number of centroids of each sub-vector, so that codes fit in a byte.
+constexpr int kNumCodes = 256;
+constexpr char kMagic[8] = {'M', 'P', 'I', 'V', 'F', 'P', 'Q', '\0'};
+constexpr uint32_t kVersion = 1;
+// The sections of index files start at multiples of this offset.
+constexpr size_t kAlignment = 64;
+// The number of points whose distances to the centroids are computed at once
+// by k-means.
+constexpr int kAssignmentBlockSize = 256;
+
+// An index file is laid out as this header, followed by the coarse centroids,
+// the codebooks, a ListHeader per inverted list, and the ids and codes of each
+// list, each section aligned to `kAlignment`.
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t dimension;
+  uint32_t num_lists;
+  uint32_t num_subquantizers;
+  uint64_t size;
+};
+
+struct ListHeader {
+  uint64_t size;
+  uint64_t ids_offset;
+  uint64_t codes_offset;
+};
+
+size_t Align(size_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+absl::Status InvalidArgumentError(absl::string_view message) {
+  return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument, message,
+                                 MediaPipeTasksStatus::kInvalidArgumentError);
+}
+
+absl::Status InvalidIndexFileError(absl::string_view message) {
+  return CreateStatusWithPayload(
+      absl::StatusCode::kInvalidArgument,
+      absl::StrCat("Invalid embedding index file: ", message),
+      MediaPipeTasksStatus::kFileReadError);
+}
+
+// Calls `fn(begin, end)` on shards of [0, `size`), in parallel on
+// `thread_pool` if not null, and returns once all the calls did.
+void ParallelFor(ThreadPool* thread_pool, size_t size,
+                 const std::function<void(size_t, size_t)>& fn) {
+  const size_t num_shards =
+      thread_pool == nullptr
+          ? 1
+          : std::min<size_t>(thread_pool->num_threads(), size);
+  if (num_shards <= 1) {
+    fn(0, size);
+    return;
+  }
+  const size_t shard_size = (size + num_shards - 1) / num_shards;
+  absl::BlockingCounter counter(num_shards);
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    const size_t begin = std::min(shard * shard_size, size);
+    const size_t end = std::min(begin + shard_size, size);
+    thread_pool->Schedule([&fn, &counter, begin, end] {
+      fn(begin, end);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+// Returns the index of the centroid nearest to `point` among the `num`
+// centroids of `dimension` values of `centroids`, given their squared norms.
+int NearestCentroid(const float* point, const float* centroids,
+                    const float* squared_norms, int num, int dimension) {
+  Eigen::Map<const RowMajorMatrix> centroid_matrix(centroids, num, dimension);
+  Eigen::Map<const Eigen::VectorXf> point_vector(point, dimension);
+  Eigen::VectorXf distances = Eigen::Map<const Eigen::VectorXf>(
+                                  squared_norms, num) -
+                              2.0f * (centroid_matrix * point_vector);
+  int nearest;
+  distances.minCoeff(&nearest);
+  return nearest;
+}
+
+std::vector<float> SquaredNorms(const std::vector<float>& centroids, int num,
+                                int dimension) {
+  Eigen::Map<const RowMajorMatrix> centroid_matrix(centroids.data(), num,
+                                                   dimension);
+  std::vector<float> squared_norms(num);
+  Eigen::Map<Eigen::VectorXf>(squared_norms.data(), num) =
+      centroid_matrix.rowwise().squaredNorm();
+  return squared_norms;
+}
+
+// Clusters the `points` of `dimension` values into `k` clusters with Lloyd's
+// algorithm, and returns their centroids.
+std::vector<float> KMeans(const std::vector<float>& points, int dimension,
+                          int k, int num_iterations, std::mt19937& rng,
+                          ThreadPool* thread_pool) {
+  const size_t num_points = points.size() / dimension;
+  std::vector<size_t> samples;
+  std::uniform_int_distribution<size_t> random_point(0, num_points - 1);
+  std::vector<size_t> point_indices(num_points);
+  std::iota(point_indices.begin(), point_indices.end(), 0);
+  std::sample(point_indices.begin(), point_indices.end(),
+              std::back_inserter(samples), k, rng);
+  std::vector<float> centroids(static_cast<size_t>(k) * dimension);
+  for (int c = 0; c < k; ++c) {
+    std::copy_n(points.begin() + samples[c] * dimension, dimension,
+                centroids.begin() + static_cast<size_t>(c) * dimension);
+  }
+
+  std::vector<int> assignments(num_points);
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    const std::vector<float> squared_norms =
+        SquaredNorms(centroids, k, dimension);
+    Eigen::Map<const RowMajorMatrix> centroid_matrix(centroids.data(), k,
+                                                     dimension);
+    // Assigns blocks of points at once, with matrix products.
+    ParallelFor(thread_pool, num_points, [&](size_t begin, size_t end) {
+      RowMajorMatrix distances;
+      for (size_t block = begin; block < end; block += kAssignmentBlockSize) {
+        const size_t block_size =
+            std::min<size_t>(kAssignmentBlockSize, end - block);
+        Eigen::Map<const RowMajorMatrix> block_points(
+            points.data() + block * dimension, block_size, dimension);
+        distances.noalias() =
+            -2.0f * block_points * centroid_matrix.transpose();
+        distances.rowwise() +=
+            Eigen::Map<const Eigen::RowVectorXf>(squared_norms.data(), k);
+        for (size_t i = 0; i < block_size; ++i) {
+          distances.row(i).minCoeff(&assignments[block + i]);
+        }
+      }
+    });
+
+    std::fill(centroids.begin(), centroids.end(), 0.0f);
+    std::vector<int> counts(k, 0);
+    for (size_t i = 0; i < num_points; ++i) {
+      const int c = assignments[i];
+      ++counts[c];
+      float* centroid = centroids.data() + static_cast<size_t>(c) * dimension;
+      const float* point = points.data() + i * dimension;
+      for (int d = 0; d < dimension; ++d) centroid[d] += point[d];
+    }
+    for (int c = 0; c < k; ++c) {
+      float* centroid = centroids.data() + static_cast<size_t>(c) * dimension;
+      if (counts[c] == 0) {
+        // Restarts empty clusters from random points.
+        std::copy_n(points.begin() + random_point(rng) * dimension, dimension,
+                    centroid);
+        continue;
+      }
+      for (int d = 0; d < dimension; ++d) centroid[d] /= counts[c];
+    }
+  }
+  return centroids;
+}
+
+// Orders results by decreasing similarity, then increasing id.
+bool IsMoreSimilar(const SearchResult& a, const SearchResult& b) {
+  return a.similarity != b.similarity ? a.similarity > b.similarity
+                                      : a.id < b.id;
+}
+
+}  // namespace
+
+IvfPqIndex::IvfPqIndex(int dimension, int num_lists, int num_subquantizers,
+                       int num_threads)
+    : dimension_(dimension),
+      num_lists_(num_lists),
+      num_subquantizers_(num_subquantizers),
+      subvector_size_(dimension / num_subquantizers),
+      lists_(num_lists) {
+  if (num_threads > 1) {
+    thread_pool_ = std::make_unique<ThreadPool>("ivf_pq_index", num_threads);
+    thread_pool_->StartWorkers();
+  }
+}
+
+absl::StatusOr<std::unique_ptr<IvfPqIndex>> IvfPqIndex::Train(
+    absl::Span<const Embedding> training_embeddings,
+    const IvfPqIndexOptions& options) {
+  if (options.num_lists <= 0 || options.num_subquantizers <= 0) {
+    return InvalidArgumentError(
+        "num_lists and num_subquantizers must be positive");
+  }
+  const size_t num_points = training_embeddings.size();
+  const int min_num_points = std::max(options.num_lists, kNumCodes);
+  if (num_points < static_cast<size_t>(min_num_points)) {
+    return InvalidArgumentError(absl::StrFormat(
+        "Expected at least %d training embeddings, got %d", min_num_points,
+        num_points));
+  }
+  const Embedding& first = training_embeddings[0];
+  const int dimension = first.float_embedding.empty()
+                            ? first.quantized_embedding.size()
+                            : first.float_embedding.size();
+  if (dimension == 0 || dimension % options.num_subquantizers != 0) {
+    return InvalidArgumentError(absl::StrFormat(
+        "The embedding size (%d) must be a positive multiple of "
+        "num_subquantizers (%d)",
+        dimension, options.num_subquantizers));
+  }
+  auto index = absl::WrapUnique(
+      new IvfPqIndex(dimension, options.num_lists, options.num_subquantizers,
+                     options.num_threads));
+
+  std::vector<float> points;
+  points.reserve(num_points * dimension);
+  for (const Embedding& embedding : training_embeddings) {
+    MP_ASSIGN_OR_RETURN(std::vector<float> values,
+                        index->Normalize(embedding));
+    points.insert(points.end(), values.begin(), values.end());
+  }
+  std::mt19937 rng(options.seed);
+  const std::vector<float> coarse_centroids =
+      KMeans(points, dimension, options.num_lists,
+             options.num_training_iterations, rng, index->thread_pool_.get());
+  const std::vector<float> coarse_squared_norms =
+      SquaredNorms(coarse_centroids, options.num_lists, dimension);
+
+  // The codebooks quantize the residuals of the points to their centroids.
+  std::vector<float> residuals(points.size());
+  ParallelFor(index->thread_pool_.get(), num_points,
+              [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                  const float* point = points.data() + i * dimension;
+                  const float* centroid =
+                      coarse_centroids.data() +
+                      static_cast<size_t>(NearestCentroid(
+                          point, coarse_centroids.data(),
+                          coarse_squared_norms.data(), options.num_lists,
+                          dimension)) *
+                          dimension;
+                  for (int d = 0; d < dimension; ++d) {
+                    residuals[i * dimension + d] = point[d] - centroid[d];
+                  }
+                }
+              });
+  std::vector<float>& centroids = index->owned_centroids_;
+  centroids = coarse_centroids;
+  const int subvector_size = index->subvector_size_;
+  std::vector<float> subvectors(num_points * subvector_size);
+  for (int m = 0; m < options.num_subquantizers; ++m) {
+    for (size_t i = 0; i < num_points; ++i) {
+      std::copy_n(residuals.begin() + i * dimension + m * subvector_size,
+                  subvector_size, subvectors.begin() + i * subvector_size);
+    }
+    const std::vector<float> codebook =
+        KMeans(subvectors, subvector_size, kNumCodes,
+               options.num_training_iterations, rng, index->thread_pool_.get());
+    centroids.insert(centroids.end(), codebook.begin(), codebook.end());
+  }
+
+  index->coarse_centroids_ = absl::MakeConstSpan(
+      centroids.data(), static_cast<size_t>(options.num_lists) * dimension);
+  index->codebooks_ =
+      absl::MakeConstSpan(centroids).subspan(index->coarse_centroids_.size());
+  index->coarse_squared_norms_ = coarse_squared_norms;
+  index->has_id_map_ = true;
+  return index;
+}
+
+absl::StatusOr<std::unique_ptr<IvfPqIndex>> IvfPqIndex::Load(
+    const ExternalFile& index_file, int num_threads) {
+  auto file = std::make_unique<ExternalFile>(index_file);
+  MP_ASSIGN_OR_RETURN(auto handler,
+                      ExternalFileHandler::CreateFromExternalFile(file.get()));
+  const absl::string_view content = handler->GetFileContent();
+
+  FileHeader header;
+  if (content.size() < sizeof(header)) {
+    return InvalidIndexFileError("missing header");
+  }
+  std::memcpy(&header, content.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    return InvalidIndexFileError("unsupported format");
+  }
+  if (header.dimension == 0 || header.num_lists == 0 ||
+      header.num_subquantizers == 0 ||
+      header.dimension % header.num_subquantizers != 0) {
+    return InvalidIndexFileError("invalid dimensions");
+  }
+  if (reinterpret_cast<uintptr_t>(content.data()) % alignof(int64_t) != 0) {
+    return InvalidIndexFileError("misaligned content");
+  }
+  auto index = absl::WrapUnique(new IvfPqIndex(
+      header.dimension, header.num_lists, header.num_subquantizers,
+      num_threads));
+
+  const size_t coarse_offset = Align(sizeof(header));
+  const size_t num_coarse_values =
+      static_cast<size_t>(header.num_lists) * header.dimension;
+  const size_t codebooks_offset =
+      Align(coarse_offset + num_coarse_values * sizeof(float));
+  const size_t num_codebook_values =
+      static_cast<size_t>(kNumCodes) * header.dimension;
+  const size_t lists_offset =
+      Align(codebooks_offset + num_codebook_values * sizeof(float));
+  if (content.size() < lists_offset + header.num_lists * sizeof(ListHeader)) {
+    return InvalidIndexFileError("truncated");
+  }
+  const char* data = content.data();
+  index->coarse_centroids_ = absl::MakeConstSpan(
+      reinterpret_cast<const float*>(data + coarse_offset), num_coarse_values);
+  index->codebooks_ = absl::MakeConstSpan(
+      reinterpret_cast<const float*>(data + codebooks_offset),
+      num_codebook_values);
+  Eigen::Map<const RowMajorMatrix> coarse_centroids(
+      index->coarse_centroids_.data(), header.num_lists, header.dimension);
+  index->coarse_squared_norms_.resize(header.num_lists);
+  Eigen::Map<Eigen::VectorXf>(index->coarse_squared_norms_.data(),
+                              header.num_lists) =
+      coarse_centroids.rowwise().squaredNorm();
+
+  size_t size = 0;
+  for (uint32_t l = 0; l < header.num_lists; ++l) {
+    ListHeader list_header;
+    std::memcpy(&list_header, data + lists_offset + l * sizeof(ListHeader),
+                sizeof(list_header));
+    if (list_header.ids_offset % alignof(int64_t) != 0 ||
+        list_header.ids_offset + list_header.size * sizeof(int64_t) >
+            content.size() ||
+        list_header.codes_offset +
+                list_header.size * header.num_subquantizers >
+            content.size()) {
+      return InvalidIndexFileError("truncated");
+    }
+    InvertedList& list = index->lists_[l];
+    list.ids = reinterpret_cast<const int64_t*>(data + list_header.ids_offset);
+    list.codes =
+        reinterpret_cast<const uint8_t*>(data + list_header.codes_offset);
+    list.size = list_header.size;
+    size += list.size;
+  }
+  if (size != header.size) {
+    return InvalidIndexFileError("inconsistent size");
+  }
+  index->size_ = size;
+  index->index_file_ = std::move(file);
+  index->index_file_handler_ = std::move(handler);
+  return index;
+}
+
+absl::StatusOr<std::vector<float>> IvfPqIndex::Normalize(
+    const Embedding& embedding) const {
+  std::vector<float> values;
+  if (!embedding.float_embedding.empty()) {
+    values = embedding.float_embedding;
+  } else {
+    values.reserve(embedding.quantized_embedding.size());
+    for (const char value : embedding.quantized_embedding) {
+      values.push_back(static_cast<int8_t>(value));
+    }
+  }
+  if (static_cast<int>(values.size()) != dimension_) {
+    return InvalidArgumentError(absl::StrFormat(
+        "Expected an embedding of size %d, got %d", dimension_,
+        values.size()));
+  }
+  Eigen::Map<Eigen::VectorXf> vector(values.data(), dimension_);
+  const float norm = vector.norm();
+  if (norm <= 0.0f) {
+    return InvalidArgumentError(
+        "Cannot compute cosine similarity on embedding with 0 norm");
+  }
+  vector /= norm;
+  return values;
+}
+
+int IvfPqIndex::NearestList(const float* values) const {
+  return NearestCentroid(values, coarse_centroids_.data(),
+                         coarse_squared_norms_.data(), num_lists_,
+                         dimension_);
+}
+
+void IvfPqIndex::MakeOwned(InvertedList& list) {
+  if (list.ids == list.owned_ids.data()) return;
+  list.owned_ids.assign(list.ids, list.ids + list.size);
+  list.owned_codes.assign(list.codes,
+                          list.codes + list.size * num_subquantizers_);
+  list.ids = list.owned_ids.data();
+  list.codes = list.owned_codes.data();
+}
+
+void IvfPqIndex::BuildIdMap() {
+  if (has_id_map_) return;
+  list_of_id_.reserve(size_);
+  for (int l = 0; l < num_lists_; ++l) {
+    for (size_t i = 0; i < lists_[l].size; ++i) {
+      list_of_id_[lists_[l].ids[i]] = l;
+    }
+  }
+  has_id_map_ = true;
+}
+
+absl::Status IvfPqIndex::Add(int64_t id, const Embedding& embedding) {
+  MP_ASSIGN_OR_RETURN(const std::vector<float> values, Normalize(embedding));
+  BuildIdMap();
+  if (list_of_id_.contains(id)) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kAlreadyExists,
+        absl::StrFormat("Embedding %d is already in the index", id),
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  const int l = NearestList(values.data());
+  InvertedList& list = lists_[l];
+  MakeOwned(list);
+
+  const float* centroid = coarse_centroids_.data() +
+                          static_cast<size_t>(l) * dimension_;
+  std::vector<float> residual(subvector_size_);
+  for (int m = 0; m < num_subquantizers_; ++m) {
+    const int offset = m * subvector_size_;
+    for (int d = 0; d < subvector_size_; ++d) {
+      residual[d] = values[offset + d] - centroid[offset + d];
+    }
+    const float* codebook = codebooks_.data() +
+                            static_cast<size_t>(m) * kNumCodes *
+                                subvector_size_;
+    Eigen::Map<const RowMajorMatrix> codewords(codebook, kNumCodes,
+                                               subvector_size_);
+    int code;
+    (codewords.rowwise() -
+     Eigen::Map<const Eigen::RowVectorXf>(residual.data(), subvector_size_))
+        .rowwise()
+        .squaredNorm()
+        .minCoeff(&code);
+    list.owned_codes.push_back(code);
+  }
+  list.owned_ids.push_back(id);
+  list.ids = list.owned_ids.data();
+  list.codes = list.owned_codes.data();
+  ++list.size;
+  list_of_id_[id] = l;
+  ++size_;
+  return absl::OkStatus();
+}
+
+absl::Status IvfPqIndex::Remove(int64_t id) {
+  BuildIdMap();
+  auto it = list_of_id_.find(id);
+  if (it == list_of_id_.end()) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kNotFound,
+        absl::StrFormat("Embedding %d is not in the index", id),
+        MediaPipeTasksStatus::kError);
+  }
+  InvertedList& list = lists_[it->second];
+  MakeOwned(list);
+  const size_t i =
+      std::find(list.owned_ids.begin(), list.owned_ids.end(), id) -
+      list.owned_ids.begin();
+  // Replaces the removed embedding with the last one of the list.
+  const size_t last = list.size - 1;
+  list.owned_ids[i] = list.owned_ids[last];
+  std::copy_n(list.owned_codes.begin() + last * num_subquantizers_,
+              num_subquantizers_,
+              list.owned_codes.begin() + i * num_subquantizers_);
+  list.owned_ids.pop_back();
+  list.owned_codes.resize(last * num_subquantizers_);
+  list.ids = list.owned_ids.data();
+  list.codes = list.owned_codes.data();
+  --list.size;
+  list_of_id_.erase(it);
+  --size_;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<SearchResult>> IvfPqIndex::Search(
+    const Embedding& query, int k, int num_probes) const {
+  MP_ASSIGN_OR_RETURN(const std::vector<float> values, Normalize(query));
+  num_probes = std::clamp(num_probes, 1, num_lists_);
+  if (k <= 0) return std::vector<SearchResult>();
+
+  // The dot products with the coarse centroids, and the nearest lists.
+  Eigen::Map<const Eigen::VectorXf> query_vector(values.data(), dimension_);
+  Eigen::Map<const RowMajorMatrix> coarse_centroids(coarse_centroids_.data(),
+                                                    num_lists_, dimension_);
+  const Eigen::VectorXf coarse_dot_products = coarse_centroids * query_vector;
+  std::vector<int> probes(num_lists_);
+  std::iota(probes.begin(), probes.end(), 0);
+  const auto distance = [&](int l) {
+    return coarse_squared_norms_[l] - 2.0f * coarse_dot_products[l];
+  };
+  std::partial_sort(
+      probes.begin(), probes.begin() + num_probes, probes.end(),
+      [&](int a, int b) { return distance(a) < distance(b); });
+
+  // The dot products of each sub-vector of the query with its codewords.
+  std::vector<float> lookup_table(num_subquantizers_ * kNumCodes);
+  for (int m = 0; m < num_subquantizers_; ++m) {
+    Eigen::Map<const RowMajorMatrix> codewords(
+        codebooks_.data() +
+            static_cast<size_t>(m) * kNumCodes * subvector_size_,
+        kNumCodes, subvector_size_);
+    Eigen::Map<Eigen::VectorXf>(lookup_table.data() + m * kNumCodes,
+                                kNumCodes) =
+        codewords * query_vector.segment(m * subvector_size_, subvector_size_);
+  }
+
+  // A heap of the top k so far, with the least similar one first.
+  std::vector<SearchResult> results;
+  results.reserve(k);
+  for (int p = 0; p < num_probes; ++p) {
+    const InvertedList& list = lists_[probes[p]];
+    const float base_similarity = coarse_dot_products[probes[p]];
+    const uint8_t* code = list.codes;
+    for (size_t i = 0; i < list.size; ++i) {
+      float similarity = base_similarity;
+      for (int m = 0; m < num_subquantizers_; ++m) {
+        similarity += lookup_table[m * kNumCodes + code[m]];
+      }
+      code += num_subquantizers_;
+      const SearchResult result = {list.ids[i], similarity};
+      if (static_cast<int>(results.size()) < k) {
+        results.push_back(result);
+        std::push_heap(results.begin(), results.end(), IsMoreSimilar);
+      } else if (IsMoreSimilar(result, results.front())) {
+        std::pop_heap(results.begin(), results.end(), IsMoreSimilar);
+        results.back() = result;
+        std::push_heap(results.begin(), results.end(), IsMoreSimilar);
+      }
+    }
+  }
+  std::sort_heap(results.begin(), results.end(), IsMoreSimilar);
+  return results;
+}
+
+absl::StatusOr<std::vector<std::vector<SearchResult>>>
+IvfPqIndex::SearchBatch(absl::Span<const Embedding> queries, int k,
+                        int num_probes) const {
+  std::vector<std::vector<SearchResult>> results(queries.size());
+  std::vector<absl::Status> statuses(queries.size());
+  ParallelFor(thread_pool_.get(), queries.size(),
+              [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                  auto query_results = Search(queries[i], k, num_probes);
+                  if (query_results.ok()) {
+                    results[i] = *std::move(query_results);
+                  } else {
+                    statuses[i] = query_results.status();
+                  }
+                }
+              });
+  for (const absl::Status& status : statuses) {
+    MP_RETURN_IF_ERROR(status);
+  }
+  return results;
+}
+
+absl::Status IvfPqIndex::Save(absl::string_view path) const {
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.dimension = dimension_;
+  header.num_lists = num_lists_;
+  header.num_subquantizers = num_subquantizers_;
+  header.size = size_;
+
+  std::ofstream file{std::string(path), std::ios::binary};
+  size_t offset = 0;
+  const auto write = [&](const void* data, size_t size) {
+    file.write(static_cast<const char*>(data), size);
+    offset += size;
+  };
+  const auto pad = [&]() {
+    static constexpr char kPadding[kAlignment] = {};
+    write(kPadding, Align(offset) - offset);
+  };
+  write(&header, sizeof(header));
+  pad();
+  write(coarse_centroids_.data(), coarse_centroids_.size() * sizeof(float));
+  pad();
+  write(codebooks_.data(), codebooks_.size() * sizeof(float));
+  pad();
+
+  // The lists follow their headers, each one's ids then codes.
+  std::vector<ListHeader> list_headers(num_lists_);
+  size_t data_offset = Align(offset + num_lists_ * sizeof(ListHeader));
+  for (int l = 0; l < num_lists_; ++l) {
+    list_headers[l].size = lists_[l].size;
+    list_headers[l].ids_offset = data_offset;
+    data_offset = Align(data_offset + lists_[l].size * sizeof(int64_t));
+    list_headers[l].codes_offset = data_offset;
+    data_offset =
+        Align(data_offset + lists_[l].size * num_subquantizers_);
+  }
+  write(list_headers.data(), list_headers.size() * sizeof(ListHeader));
+  for (const InvertedList& list : lists_) {
+    pad();
+    write(list.ids, list.size * sizeof(int64_t));
+    pad();
+    write(list.codes, list.size * num_subquantizers_);
+  }
+  file.close();
+  if (!file) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kUnknown,
+        absl::StrCat("Failed to write embedding index file ", path),
+        MediaPipeTasksStatus::kError);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
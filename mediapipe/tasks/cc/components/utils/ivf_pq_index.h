@@ -0,0 +1,172 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_IVF_PQ_INDEX_H_
+#define MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_IVF_PQ_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/core/external_file_handler.h"
+#include "mediapipe/tasks/cc/core/proto/external_file.pb.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+
+// Options for training an IvfPqIndex.
+struct IvfPqIndexOptions {
+  // The number of inverted lists, i.e. of clusters the embeddings are
+  // partitioned into. Around the square root of the number of indexed
+  // embeddings is a good trade-off.
+  int num_lists = 1024;
+  // The number of sub-vectors each embedding is split into for product
+  // quantization, each encoded in one byte. Must divide the embedding size.
+  int num_subquantizers = 16;
+  // The number of k-means iterations used to train the quantizers.
+  int num_training_iterations = 10;
+  // The number of threads used for training and batch queries.
+  int num_threads = 1;
+  // The seed of the k-means initialization.
+  uint32_t seed = 0;
+};
+
+// An indexed embedding and its approximate cosine similarity to a query.
+struct SearchResult {
+  // The id the embedding was added with.
+  int64_t id;
+  // The approximate cosine similarity between the embedding and the query.
+  float similarity;
+};
+
+// An approximate nearest neighbor index of embeddings by cosine similarity,
+// for collections too large to be scanned by an EmbeddingMatrix.
+//
+// Embeddings are L2-normalized, assigned to the inverted list of their
+// nearest coarse centroid, and stored as the product quantization [1] of their
+// residual to that centroid: one byte per sub-vector. A query only scans the
+// lists of its `num_probes` nearest centroids, and scores their embeddings
+// with a lookup table of its dot products with the quantization centroids.
+//
+// Indices are saved to a single file, which is memory mapped when loaded:
+// the lists are only copied to memory once embeddings are added to or removed
+// from them.
+//
+// Queries may run concurrently with each other, but not with Add() or
+// Remove().
+//
+// [1]: https://doi.org/10.1109/TPAMI.2010.57
+class IvfPqIndex {
+ public:
+  // Trains the quantizers of an empty index on `training_embeddings`, which
+  // should be representative of the embeddings to index, and number at least
+  // 256 and `options.num_lists`.
+  static absl::StatusOr<std::unique_ptr<IvfPqIndex>> Train(
+      absl::Span<const containers::Embedding> training_embeddings,
+      const IvfPqIndexOptions& options);
+
+  // Loads an index saved by Save() from `index_file`, using `num_threads`
+  // threads for batch queries.
+  static absl::StatusOr<std::unique_ptr<IvfPqIndex>> Load(
+      const core::proto::ExternalFile& index_file, int num_threads = 1);
+
+  // Adds `embedding` to the index with `id`, which must not be in the index
+  // already.
+  absl::Status Add(int64_t id, const containers::Embedding& embedding);
+
+  // Removes the embedding of `id` from the index.
+  absl::Status Remove(int64_t id);
+
+  // Returns the `k` embeddings most similar to `query` among the lists of its
+  // `num_probes` nearest centroids, by decreasing similarity.
+  absl::StatusOr<std::vector<SearchResult>> Search(
+      const containers::Embedding& query, int k, int num_probes) const;
+
+  // Runs Search() for each of `queries`, in parallel.
+  absl::StatusOr<std::vector<std::vector<SearchResult>>> SearchBatch(
+      absl::Span<const containers::Embedding> queries, int k,
+      int num_probes) const;
+
+  // Saves the index to the file at `path`.
+  absl::Status Save(absl::string_view path) const;
+
+  // The number of embeddings in the index.
+  size_t size() const { return size_; }
+  int dimension() const { return dimension_; }
+  int num_lists() const { return num_lists_; }
+
+ private:
+  // The embeddings assigned to a coarse centroid. Points either to the mapped
+  // index file, or to `owned_ids` and `owned_codes` once modified.
+  struct InvertedList {
+    const int64_t* ids = nullptr;
+    const uint8_t* codes = nullptr;
+    size_t size = 0;
+    std::vector<int64_t> owned_ids;
+    std::vector<uint8_t> owned_codes;
+  };
+
+  IvfPqIndex(int dimension, int num_lists, int num_subquantizers,
+             int num_threads);
+
+  // Returns the L2-normalized values of `embedding`.
+  absl::StatusOr<std::vector<float>> Normalize(
+      const containers::Embedding& embedding) const;
+  // Returns the index of the coarse centroid nearest to `values`.
+  int NearestList(const float* values) const;
+  // Copies `list` to memory if it points to the mapped file.
+  void MakeOwned(InvertedList& list);
+  // Fills `list_of_id_` on the first Add() or Remove().
+  void BuildIdMap();
+
+  const int dimension_;
+  const int num_lists_;
+  const int num_subquantizers_;
+  // The size of the sub-vectors.
+  const int subvector_size_;
+  // The `num_lists_` coarse centroids, of `dimension_` values each.
+  absl::Span<const float> coarse_centroids_;
+  // The squared L2-norms of the coarse centroids.
+  std::vector<float> coarse_squared_norms_;
+  // The 256 centroids of each sub-vector, of `subvector_size_` values each.
+  absl::Span<const float> codebooks_;
+  std::vector<float> owned_centroids_;
+  std::vector<InvertedList> lists_;
+  size_t size_ = 0;
+  // The list of each embedding id, built on first use.
+  absl::flat_hash_map<int64_t, int> list_of_id_;
+  bool has_id_map_ = false;
+  // The mapped index file, if loaded.
+  std::unique_ptr<core::proto::ExternalFile> index_file_;
+  std::unique_ptr<core::ExternalFileHandler> index_file_handler_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_IVF_PQ_INDEX_H_
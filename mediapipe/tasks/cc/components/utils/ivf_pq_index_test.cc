@@ -0,0 +1,280 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/components/utils/ivf_pq_index.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/components/containers/embedding_result.h"
+#include "mediapipe/tasks/cc/components/utils/embedding_matrix.h"
+#include "mediapipe/tasks/cc/core/proto/external_file.pb.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+namespace {
+
+using ::mediapipe::tasks::components::containers::Embedding;
+using ::mediapipe::tasks::core::proto::ExternalFile;
+using ::testing::HasSubstr;
+
+constexpr int kDimension = 32;
+
+IvfPqIndexOptions GetOptions() {
+  IvfPqIndexOptions options;
+  options.num_lists = 16;
+  options.num_subquantizers = 8;
+  return options;
+}
+
+// Generates `num_embeddings` float embeddings of `dimension` values, drawn
+// around `num_clusters` random centers like real embeddings tend to be.
+std::vector<Embedding> BuildClusteredEmbeddings(int num_embeddings,
+                                                int dimension,
+                                                int num_clusters, int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> distribution;
+  std::mt19937 center_rng(0);
+  std::vector<std::vector<float>> centers(num_clusters,
+                                          std::vector<float>(dimension));
+  for (std::vector<float>& center : centers) {
+    for (float& value : center) value = distribution(center_rng);
+  }
+  std::uniform_int_distribution<int> random_cluster(0, num_clusters - 1);
+  std::vector<Embedding> embeddings(num_embeddings);
+  for (Embedding& embedding : embeddings) {
+    const std::vector<float>& center = centers[random_cluster(rng)];
+    for (const float value : center) {
+      embedding.float_embedding.push_back(value +
+                                          0.3f * distribution(rng));
+    }
+  }
+  return embeddings;
+}
+
+// Returns the fraction of the exact top `k` of each query found in its
+// `results`, which may hold more than `k` embeddings to rerank.
+double Recall(const EmbeddingMatrix& matrix,
+              absl::Span<const Embedding> queries,
+              const std::vector<std::vector<SearchResult>>& results, int k) {
+  int num_found = 0;
+  for (int q = 0; q < queries.size(); ++q) {
+    absl::flat_hash_set<int64_t> ids;
+    for (const SearchResult& result : results[q]) ids.insert(result.id);
+    const std::vector<SimilarityMatch> matches = *matrix.TopK(queries[q], k);
+    for (const SimilarityMatch& match : matches) {
+      num_found += ids.contains(match.index);
+    }
+  }
+  return static_cast<double>(num_found) / (queries.size() * k);
+}
+
+TEST(IvfPqIndex, FailsWithTooFewTrainingEmbeddings) {
+  auto index = IvfPqIndex::Train(
+      BuildClusteredEmbeddings(100, kDimension, 4, /*seed=*/0), GetOptions());
+
+  EXPECT_EQ(index.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(index.status().message(),
+              HasSubstr("Expected at least 256 training embeddings"));
+}
+
+TEST(IvfPqIndex, FailsWithSizeNotMultipleOfNumSubquantizers) {
+  IvfPqIndexOptions options = GetOptions();
+  options.num_subquantizers = 5;
+
+  auto index = IvfPqIndex::Train(
+      BuildClusteredEmbeddings(1000, kDimension, 4, /*seed=*/0), options);
+
+  EXPECT_EQ(index.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(index.status().message(),
+              HasSubstr("must be a positive multiple of num_subquantizers"));
+}
+
+TEST(IvfPqIndex, SearchFindsNearestNeighbors) {
+  const std::vector<Embedding> embeddings =
+      BuildClusteredEmbeddings(5000, kDimension, 50, /*seed=*/0);
+  const std::vector<Embedding> queries =
+      BuildClusteredEmbeddings(20, kDimension, 50, /*seed=*/1);
+  MP_ASSERT_OK_AND_ASSIGN(auto index,
+                          IvfPqIndex::Train(embeddings, GetOptions()));
+  for (int i = 0; i < embeddings.size(); ++i) {
+    MP_ASSERT_OK(index->Add(i, embeddings[i]));
+  }
+  MP_ASSERT_OK_AND_ASSIGN(auto matrix, EmbeddingMatrix::Create(embeddings));
+
+  std::vector<std::vector<SearchResult>> results;
+  for (const Embedding& query : queries) {
+    MP_ASSERT_OK_AND_ASSIGN(auto query_results,
+                            index->Search(query, 100, /*num_probes=*/4));
+    ASSERT_EQ(query_results.size(), 100);
+    for (int i = 1; i < query_results.size(); ++i) {
+      EXPECT_GE(query_results[i - 1].similarity, query_results[i].similarity);
+    }
+    results.push_back(query_results);
+  }
+
+  EXPECT_EQ(index->size(), embeddings.size());
+  EXPECT_GT(Recall(*matrix, queries, results, 10), 0.9);
+}
+
+TEST(IvfPqIndex, AddAndRemove) {
+  const std::vector<Embedding> embeddings =
+      BuildClusteredEmbeddings(1000, kDimension, 10, /*seed=*/0);
+  MP_ASSERT_OK_AND_ASSIGN(auto index,
+                          IvfPqIndex::Train(embeddings, GetOptions()));
+  MP_ASSERT_OK(index->Add(1, embeddings[0]));
+  MP_ASSERT_OK(index->Add(2, embeddings[1]));
+
+  EXPECT_EQ(index->Add(1, embeddings[2]).code(),
+            absl::StatusCode::kAlreadyExists);
+  MP_ASSERT_OK(index->Remove(1));
+  EXPECT_EQ(index->Remove(1).code(), absl::StatusCode::kNotFound);
+  EXPECT_EQ(index->size(), 1);
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto results,
+      index->Search(embeddings[0], 10, /*num_probes=*/GetOptions().num_lists));
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_EQ(results[0].id, 2);
+}
+
+TEST(IvfPqIndex, SearchBatchMatchesSearch) {
+  const std::vector<Embedding> embeddings =
+      BuildClusteredEmbeddings(2000, kDimension, 20, /*seed=*/0);
+  const std::vector<Embedding> queries =
+      BuildClusteredEmbeddings(50, kDimension, 20, /*seed=*/1);
+  IvfPqIndexOptions options = GetOptions();
+  options.num_threads = 4;
+  MP_ASSERT_OK_AND_ASSIGN(auto index, IvfPqIndex::Train(embeddings, options));
+  for (int i = 0; i < embeddings.size(); ++i) {
+    MP_ASSERT_OK(index->Add(i, embeddings[i]));
+  }
+
+  MP_ASSERT_OK_AND_ASSIGN(auto batch_results,
+                          index->SearchBatch(queries, 5, /*num_probes=*/2));
+
+  ASSERT_EQ(batch_results.size(), queries.size());
+  for (int q = 0; q < queries.size(); ++q) {
+    MP_ASSERT_OK_AND_ASSIGN(auto results,
+                            index->Search(queries[q], 5, /*num_probes=*/2));
+    ASSERT_EQ(batch_results[q].size(), results.size());
+    for (int i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(batch_results[q][i].id, results[i].id);
+      EXPECT_EQ(batch_results[q][i].similarity, results[i].similarity);
+    }
+  }
+}
+
+TEST(IvfPqIndex, SaveAndLoad) {
+  const std::vector<Embedding> embeddings =
+      BuildClusteredEmbeddings(1000, kDimension, 10, /*seed=*/0);
+  MP_ASSERT_OK_AND_ASSIGN(auto index,
+                          IvfPqIndex::Train(embeddings, GetOptions()));
+  for (int i = 0; i < embeddings.size(); ++i) {
+    MP_ASSERT_OK(index->Add(i, embeddings[i]));
+  }
+  const std::string path =
+      file::JoinPath(::testing::TempDir(), "ivf_pq_index.bin");
+  MP_ASSERT_OK(index->Save(path));
+
+  ExternalFile index_file;
+  index_file.set_file_name(path);
+  MP_ASSERT_OK_AND_ASSIGN(auto loaded_index, IvfPqIndex::Load(index_file));
+
+  EXPECT_EQ(loaded_index->size(), index->size());
+  EXPECT_EQ(loaded_index->dimension(), kDimension);
+  for (int q = 0; q < 10; ++q) {
+    MP_ASSERT_OK_AND_ASSIGN(auto results,
+                            index->Search(embeddings[q], 5, /*num_probes=*/2));
+    MP_ASSERT_OK_AND_ASSIGN(
+        auto loaded_results,
+        loaded_index->Search(embeddings[q], 5, /*num_probes=*/2));
+    ASSERT_EQ(loaded_results.size(), results.size());
+    for (int i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(loaded_results[i].id, results[i].id);
+      EXPECT_EQ(loaded_results[i].similarity, results[i].similarity);
+    }
+  }
+
+  // The mapped lists are copied on write.
+  MP_ASSERT_OK(loaded_index->Remove(0));
+  MP_ASSERT_OK(loaded_index->Add(1000, embeddings[0]));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto results, loaded_index->Search(embeddings[0], 1, /*num_probes=*/2));
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_EQ(results[0].id, 1000);
+}
+
+TEST(IvfPqIndex, LoadFailsWithInvalidFile) {
+  ExternalFile index_file;
+  index_file.set_file_content("not an index");
+
+  auto index = IvfPqIndex::Load(index_file);
+
+  EXPECT_EQ(index.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(index.status().message(),
+              HasSubstr("Invalid embedding index file"));
+}
+
+}  // namespace
+
+// Benchmarks batches of 100 queries for their top 100, and reports the recall
+// of the exact top 10 in them along with the throughput. Args: num_embeddings,
+// num_probes.
+void BM_IvfPqIndexSearch(benchmark::State& state) {
+  constexpr int kBenchmarkDimension = 128;
+  constexpr int kNumQueries = 100;
+  const std::vector<Embedding> embeddings = BuildClusteredEmbeddings(
+      state.range(0), kBenchmarkDimension, 1000, /*seed=*/0);
+  const std::vector<Embedding> queries = BuildClusteredEmbeddings(
+      kNumQueries, kBenchmarkDimension, 1000, /*seed=*/1);
+  IvfPqIndexOptions options;
+  options.num_lists = 256;
+  options.num_threads = 4;
+  MP_ASSERT_OK_AND_ASSIGN(auto index, IvfPqIndex::Train(embeddings, options));
+  for (int i = 0; i < embeddings.size(); ++i) {
+    MP_ASSERT_OK(index->Add(i, embeddings[i]));
+  }
+
+  std::vector<std::vector<SearchResult>> results;
+  for (auto s : state) {
+    MP_ASSERT_OK_AND_ASSIGN(results,
+                            index->SearchBatch(queries, 100, state.range(1)));
+  }
+  MP_ASSERT_OK_AND_ASSIGN(auto matrix, EmbeddingMatrix::Create(embeddings));
+  state.counters["recall"] = Recall(*matrix, queries, results, 10);
+  state.counters["qps"] = benchmark::Counter(
+      state.iterations() * kNumQueries, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_IvfPqIndexSearch)
+    ->ArgsProduct({{/*num_embeddings=*/100000}, {/*num_probes=*/1, 4, 16, 64}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,239 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/components/utils/quantized_embedding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+
+// The x86 kernels are built for their instruction sets whatever the build
+// targets, and picked at runtime from the features of the CPU.
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define MP_INT8_DOT_PRODUCT_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+// AVX-VNNI, the VEX encoding of the VNNI instructions, needs GCC 11 or Clang
+// 12.
+#if (defined(__clang__) && __clang_major__ >= 12) || \
+    (!defined(__clang__) && __GNUC__ >= 11)
+#define MP_INT8_DOT_PRODUCT_AVXVNNI 1
+#endif
+// vaddvq_s32() is only available on AArch64.
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_DOTPROD)
+#define MP_INT8_DOT_PRODUCT_ARM_DOTPROD 1
+#include <arm_neon.h>
+#endif
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+
+namespace {
+
+// Returns the dot product of the values [`i`, `size`) of `u` and `v`. The loop
+// is simple enough for compilers to vectorize.
+int32_t PortableDotProduct(const int8_t* u, const int8_t* v, int i, int size) {
+  int32_t dot_product = 0;
+  for (; i < size; ++i) {
+    dot_product += static_cast<int16_t>(u[i]) * static_cast<int16_t>(v[i]);
+  }
+  return dot_product;
+}
+
+int32_t Int8DotProductPortable(const int8_t* u, const int8_t* v, int size) {
+  return PortableDotProduct(u, v, 0, size);
+}
+
+#ifdef MP_INT8_DOT_PRODUCT_X86
+
+// Returns the sum of the 8 int32 of `x`.
+__attribute__((target("avx2"))) int32_t HorizontalSum(__m256i x) {
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(x),
+                              _mm256_extracti128_si256(x, 1));
+  sum = _mm_hadd_epi32(sum, sum);
+  sum = _mm_hadd_epi32(sum, sum);
+  return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) int32_t
+Int8DotProductAvx512Vnni(const int8_t* u, const int8_t* v, int size) {
+  // VPDPBUSD multiplies unsigned bytes by signed ones: `u` is offset by 128
+  // to be unsigned, and 128 times the sum of `v` is subtracted at the end.
+  const __m512i offset = _mm512_set1_epi8(static_cast<char>(0x80));
+  const __m512i ones = _mm512_set1_epi8(1);
+  __m512i products = _mm512_setzero_si512();
+  __m512i v_sums = _mm512_setzero_si512();
+  int i = 0;
+  for (; i + 64 <= size; i += 64) {
+    const __m512i u_values =
+        _mm512_xor_si512(_mm512_loadu_si512(u + i), offset);
+    const __m512i v_values = _mm512_loadu_si512(v + i);
+    products = _mm512_dpbusd_epi32(products, u_values, v_values);
+    v_sums = _mm512_dpbusd_epi32(v_sums, ones, v_values);
+  }
+  return _mm512_reduce_add_epi32(
+             _mm512_sub_epi32(products, _mm512_slli_epi32(v_sums, 7))) +
+         PortableDotProduct(u, v, i, size);
+}
+
+#ifdef MP_INT8_DOT_PRODUCT_AVXVNNI
+__attribute__((target("avx2,avxvnni"))) int32_t Int8DotProductAvxVnni(
+    const int8_t* u, const int8_t* v, int size) {
+  // As above, with 256-bit vectors.
+  const __m256i offset = _mm256_set1_epi8(static_cast<char>(0x80));
+  const __m256i ones = _mm256_set1_epi8(1);
+  __m256i products = _mm256_setzero_si256();
+  __m256i v_sums = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 32 <= size; i += 32) {
+    const __m256i u_values = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)), offset);
+    const __m256i v_values =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+    products = _mm256_dpbusd_avx_epi32(products, u_values, v_values);
+    v_sums = _mm256_dpbusd_avx_epi32(v_sums, ones, v_values);
+  }
+  return HorizontalSum(
+             _mm256_sub_epi32(products, _mm256_slli_epi32(v_sums, 7))) +
+         PortableDotProduct(u, v, i, size);
+}
+#endif  // MP_INT8_DOT_PRODUCT_AVXVNNI
+
+__attribute__((target("avx2"))) int32_t Int8DotProductAvx2(const int8_t* u,
+                                                           const int8_t* v,
+                                                           int size) {
+  // Sign-extends the values to int16, and sums their products by pairs.
+  __m256i products = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    const __m256i u_values = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i)));
+    const __m256i v_values = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)));
+    products =
+        _mm256_add_epi32(products, _mm256_madd_epi16(u_values, v_values));
+  }
+  return HorizontalSum(products) + PortableDotProduct(u, v, i, size);
+}
+
+// The instruction sets of the x86 kernels supported by the CPU and the OS.
+struct X86Features {
+  bool avx2 = false;
+  bool avx_vnni = false;
+  bool avx512_vnni = false;
+};
+
+X86Features GetX86Features() {
+  X86Features features;
+  unsigned int eax, ebx, ecx, edx;
+  // The OS must save the YMM registers for AVX, and the ZMM and mask
+  // registers for AVX-512, as reported by XGETBV when OSXSAVE is set.
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 27))) {
+    return features;
+  }
+  unsigned int xcr0, xcr0_high;
+  __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+  if ((xcr0 & 0x6) != 0x6 || __get_cpuid_max(0, nullptr) < 7) {
+    return features;
+  }
+  const bool os_saves_zmm = (xcr0 & 0xE6) == 0xE6;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  const unsigned int max_subleaf = eax;
+  features.avx2 = ebx & (1u << 5);
+  features.avx512_vnni = os_saves_zmm && (ebx & (1u << 16)) &&  // AVX512F
+                         (ebx & (1u << 30)) &&                  // AVX512BW
+                         (ecx & (1u << 11));                    // AVX512_VNNI
+  if (max_subleaf >= 1) {
+    __cpuid_count(7, 1, eax, ebx, ecx, edx);
+    features.avx_vnni = features.avx2 && (eax & (1u << 4));
+  }
+  return features;
+}
+
+#endif  // MP_INT8_DOT_PRODUCT_X86
+
+#ifdef MP_INT8_DOT_PRODUCT_ARM_DOTPROD
+int32_t Int8DotProductArmDotProd(const int8_t* u, const int8_t* v, int size) {
+  int32x4_t products = vdupq_n_s32(0);
+  int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    products = vdotq_s32(products, vld1q_s8(u + i), vld1q_s8(v + i));
+  }
+  return vaddvq_s32(products) + PortableDotProduct(u, v, i, size);
+}
+#endif  // MP_INT8_DOT_PRODUCT_ARM_DOTPROD
+
+}  // namespace
+
+namespace internal {
+
+std::vector<Int8DotProductFn> GetSupportedInt8DotProductKernels() {
+  std::vector<Int8DotProductFn> kernels = {Int8DotProductPortable};
+#ifdef MP_INT8_DOT_PRODUCT_X86
+  const X86Features features = GetX86Features();
+  if (features.avx2) kernels.push_back(Int8DotProductAvx2);
+#ifdef MP_INT8_DOT_PRODUCT_AVXVNNI
+  if (features.avx_vnni) kernels.push_back(Int8DotProductAvxVnni);
+#endif
+  if (features.avx512_vnni) kernels.push_back(Int8DotProductAvx512Vnni);
+#endif
+#ifdef MP_INT8_DOT_PRODUCT_ARM_DOTPROD
+  kernels.push_back(Int8DotProductArmDotProd);
+#endif
+  return kernels;
+}
+
+}  // namespace internal
+
+void QuantizeEmbedding(absl::Span<const float> values, bool l2_normalize,
+                       std::string* quantized) {
+  float inv_l2_norm = 1.0f;
+  if (l2_normalize) {
+    float squared_l2_norm = 0.0f;
+    for (const float value : values) {
+      squared_l2_norm += value * value;
+    }
+    if (squared_l2_norm > 0.0f) {
+      inv_l2_norm = 1.0f / std::sqrt(squared_l2_norm);
+    }
+  }
+  quantized->resize(values.size());
+  for (int i = 0; i < values.size(); ++i) {
+    // Normalize.
+    const float normalized = values[i] * inv_l2_norm;
+    // Quantize.
+    const int unclamped_value = static_cast<int>(roundf(normalized * 128));
+    // Clamp and assign.
+    (*quantized)[i] = static_cast<char>(std::clamp(unclamped_value, -128, 127));
+  }
+}
+
+int32_t Int8DotProduct(const int8_t* u, const int8_t* v, int size) {
+  static const internal::Int8DotProductFn kKernel =
+      internal::GetSupportedInt8DotProductKernels().back();
+  return kKernel(u, v, size);
+}
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
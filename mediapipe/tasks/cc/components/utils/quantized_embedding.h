@@ -0,0 +1,65 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_QUANTIZED_EMBEDDING_H_
+#define MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_QUANTIZED_EMBEDDING_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+
+// Quantizes `values` into `quantized`, as the int8 values of the quantized
+// embeddings of the embedder tasks: each value is scaled by 128, rounded and
+// clamped to [-128, 127].
+//
+// With `l2_normalize`, the values are first divided by their L2-norm, so that
+// quantized embeddings are unit vectors scaled by 128. This is the format
+// expected to compare quantized embeddings without dequantizing them: their
+// cosine similarity is their Int8DotProduct() over the product of their
+// norms, which are both close to 128.
+void QuantizeEmbedding(absl::Span<const float> values, bool l2_normalize,
+                       std::string* quantized);
+
+// Returns the dot product of the `size` int8 values of `u` and `v`, exactly,
+// with the products summed into int32. On x86, uses the AVX-512 VNNI, AVX-VNNI
+// or AVX2 instructions if the CPU supports them, whatever the build targets.
+// On AArch64, uses the dot product instructions if the build targets them.
+// Else uses a loop left to the compiler to vectorize.
+int32_t Int8DotProduct(const int8_t* u, const int8_t* v, int size);
+
+namespace internal {
+
+using Int8DotProductFn = int32_t (*)(const int8_t* u, const int8_t* v,
+                                     int size);
+
+// Returns the Int8DotProduct() kernels supported by the build and the CPU,
+// from the slowest to the fastest, which Int8DotProduct() uses. For tests.
+std::vector<Int8DotProductFn> GetSupportedInt8DotProductKernels();
+
+}  // namespace internal
+
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_COMPONENTS_UTILS_QUANTIZED_EMBEDDING_H_
@@ -0,0 +1,134 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/components/utils/quantized_embedding.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace components {
+namespace utils {
+namespace {
+
+std::vector<int8_t> BuildRandomValues(int size, std::mt19937& rng) {
+  std::uniform_int_distribution<int> distribution(-128, 127);
+  std::vector<int8_t> values(size);
+  for (int8_t& value : values) {
+    value = distribution(rng);
+  }
+  return values;
+}
+
+int32_t NaiveDotProduct(const std::vector<int8_t>& u,
+                        const std::vector<int8_t>& v) {
+  int32_t dot_product = 0;
+  for (int i = 0; i < u.size(); ++i) {
+    dot_product += u[i] * v[i];
+  }
+  return dot_product;
+}
+
+TEST(Int8DotProductTest, MatchesNaiveDotProduct) {
+  std::mt19937 rng(0);
+  // Covers the vectorized loops and their remainders.
+  for (int size = 0; size <= 300; ++size) {
+    const std::vector<int8_t> u = BuildRandomValues(size, rng);
+    const std::vector<int8_t> v = BuildRandomValues(size, rng);
+
+    EXPECT_EQ(Int8DotProduct(u.data(), v.data(), size), NaiveDotProduct(u, v))
+        << "size: " << size;
+  }
+}
+
+TEST(Int8DotProductTest, AllSupportedKernelsMatchNaiveDotProduct) {
+  const std::vector<internal::Int8DotProductFn> kernels =
+      internal::GetSupportedInt8DotProductKernels();
+  ASSERT_FALSE(kernels.empty());
+  std::mt19937 rng(0);
+  for (int size = 0; size <= 300; ++size) {
+    const std::vector<int8_t> u = BuildRandomValues(size, rng);
+    const std::vector<int8_t> v = BuildRandomValues(size, rng);
+    for (int k = 0; k < kernels.size(); ++k) {
+      EXPECT_EQ(kernels[k](u.data(), v.data(), size), NaiveDotProduct(u, v))
+          << "kernel: " << k << ", size: " << size;
+    }
+  }
+}
+
+TEST(Int8DotProductTest, SucceedsWithExtremeValues) {
+  constexpr int kSize = 1024;
+  const std::vector<int8_t> min_values(kSize, -128);
+  const std::vector<int8_t> max_values(kSize, 127);
+
+  for (const internal::Int8DotProductFn kernel :
+       internal::GetSupportedInt8DotProductKernels()) {
+    EXPECT_EQ(kernel(min_values.data(), min_values.data(), kSize),
+              kSize * 128 * 128);
+    EXPECT_EQ(kernel(min_values.data(), max_values.data(), kSize),
+              -kSize * 128 * 127);
+    EXPECT_EQ(kernel(max_values.data(), min_values.data(), kSize),
+              -kSize * 128 * 127);
+  }
+}
+
+TEST(QuantizeEmbeddingTest, SucceedsWithoutL2Normalization) {
+  std::string quantized;
+  QuantizeEmbedding({0.1f, -0.5f, 2.0f, -2.0f}, /*l2_normalize=*/false,
+                    &quantized);
+
+  EXPECT_EQ(quantized, std::string({13, -64, 127, -128}));
+}
+
+TEST(QuantizeEmbeddingTest, SucceedsWithL2Normalization) {
+  std::string quantized;
+  QuantizeEmbedding({3.0f, -4.0f, 0.0f}, /*l2_normalize=*/true, &quantized);
+
+  // 128 * {0.6, -0.8, 0}
+  EXPECT_EQ(quantized, std::string({77, -102, 0}));
+}
+
+TEST(QuantizeEmbeddingTest, SucceedsWithZeroValues) {
+  std::string quantized;
+  QuantizeEmbedding({0.0f, 0.0f}, /*l2_normalize=*/true, &quantized);
+
+  EXPECT_EQ(quantized, std::string(2, 0));
+}
+
+void BM_Int8DotProduct(benchmark::State& state) {
+  const int size = state.range(0);
+  std::mt19937 rng(0);
+  const std::vector<int8_t> u = BuildRandomValues(size, rng);
+  const std::vector<int8_t> v = BuildRandomValues(size, rng);
+  for (auto s : state) {
+    benchmark::DoNotOptimize(Int8DotProduct(u.data(), v.data(), size));
+  }
+  state.SetBytesProcessed(state.iterations() * size * 2);
+}
+
+BENCHMARK(BM_Int8DotProduct)->Arg(100)->Arg(512)->Arg(1024);
+
+}  // namespace
+}  // namespace utils
+}  // namespace components
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,93 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/core/task_replica_pool.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace core {
+
+TaskReplicaPool::TaskReplicaPool(const std::string& name_prefix,
+                                 int num_replicas)
+    : num_replicas_(num_replicas),
+      worker_pool_(std::make_unique<ThreadPool>(name_prefix, num_replicas)) {
+  worker_pool_->StartWorkers();
+  absl::MutexLock lock(&mutex_);
+  for (int i = 0; i < num_replicas_; ++i) {
+    free_replicas_.push_back(i);
+  }
+}
+
+TaskReplicaPool::~TaskReplicaPool() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &TaskReplicaPool::IsIdle));
+}
+
+absl::Status TaskReplicaPool::Schedule(WorkFn work, int max_pending_items) {
+  absl::MutexLock lock(&mutex_);
+  auto can_schedule = [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return max_pending_items <= 0 || num_pending_items_ < max_pending_items ||
+           !status_.ok();
+  };
+  mutex_.Await(absl::Condition(&can_schedule));
+  // Stops scheduling items after an error.
+  MP_RETURN_IF_ERROR(status_);
+  ++num_pending_items_;
+  worker_pool_->Schedule([this, work = std::move(work)] { Run(work); });
+  return absl::OkStatus();
+}
+
+absl::Status TaskReplicaPool::Wait() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &TaskReplicaPool::IsIdle));
+  absl::Status status = std::move(status_);
+  status_ = absl::OkStatus();
+  return status;
+}
+
+void TaskReplicaPool::Run(const WorkFn& work) {
+  int replica;
+  {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &TaskReplicaPool::HasFreeReplica));
+    // Skips the remaining items after an error.
+    if (!status_.ok()) {
+      --num_pending_items_;
+      return;
+    }
+    replica = free_replicas_.back();
+    free_replicas_.pop_back();
+  }
+  absl::Status status = work(replica);
+
+  absl::MutexLock lock(&mutex_);
+  status_.Update(status);
+  free_replicas_.push_back(replica);
+  --num_pending_items_;
+}
+
+}  // namespace core
+}  // namespace tasks
+}  // namespace mediapipe
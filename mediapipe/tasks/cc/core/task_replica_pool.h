@@ -0,0 +1,94 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_CORE_TASK_REPLICA_POOL_H_
+#define MEDIAPIPE_TASKS_CC_CORE_TASK_REPLICA_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace core {
+
+// Runs work items in parallel on several replicas of a task, e.g. several
+// instances of a task API, which each run one item at a time on their own
+// thread.
+//
+// After an item fails, the items scheduled after it are skipped, and the
+// first error is returned by Schedule() and Wait().
+class TaskReplicaPool {
+ public:
+  // Runs a work item with the replica at index `replica`.
+  using WorkFn = std::function<absl::Status(int replica)>;
+
+  // Creates a pool of `num_replicas` replicas, which must be positive.
+  TaskReplicaPool(const std::string& name_prefix, int num_replicas);
+
+  // Waits for the pending items to be run.
+  ~TaskReplicaPool();
+
+  int num_replicas() const { return num_replicas_; }
+
+  // Schedules `work` to run with the next free replica. If
+  // `max_pending_items` is positive, first blocks until fewer items are
+  // pending, which bounds the memory held by the pending items. Returns the
+  // first error of the items since the last Wait(), without scheduling
+  // `work`, if any.
+  absl::Status Schedule(WorkFn work, int max_pending_items = 0);
+
+  // Waits for the pending items to be run, and returns the first error of the
+  // items since the last Wait(), if any.
+  absl::Status Wait();
+
+ private:
+  // Runs `work` with a free replica.
+  void Run(const WorkFn& work);
+
+  // The conditions awaited on `mutex_`.
+  bool HasFreeReplica() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !free_replicas_.empty();
+  }
+  bool IsIdle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return num_pending_items_ == 0;
+  }
+
+  const int num_replicas_;
+
+  absl::Mutex mutex_;
+  // The indices of the replicas which are not running.
+  std::vector<int> free_replicas_ ABSL_GUARDED_BY(mutex_);
+  // The number of scheduled items which are not run yet.
+  int num_pending_items_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The first error of the items since the last Wait().
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+
+  // Destroyed first, so that the workers are joined before the state they
+  // use is destroyed.
+  std::unique_ptr<ThreadPool> worker_pool_;
+};
+
+}  // namespace core
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_CORE_TASK_REPLICA_POOL_H_
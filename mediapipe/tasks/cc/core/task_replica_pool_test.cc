@@ -0,0 +1,99 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/core/task_replica_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace core {
+namespace {
+
+constexpr int kNumReplicas = 3;
+constexpr int kNumItems = 100;
+
+TEST(TaskReplicaPoolTest, RunsEachReplicaOnOneItemAtATime) {
+  TaskReplicaPool pool("test", kNumReplicas);
+  std::vector<std::atomic<int>> running(kNumReplicas);
+  std::atomic<int> num_overlaps = 0;
+  std::atomic<int> num_runs = 0;
+
+  for (int i = 0; i < kNumItems; ++i) {
+    MP_ASSERT_OK(pool.Schedule([&](int replica) {
+      if (running[replica]++ > 0) ++num_overlaps;
+      ++num_runs;
+      --running[replica];
+      return absl::OkStatus();
+    }));
+  }
+  MP_ASSERT_OK(pool.Wait());
+
+  EXPECT_EQ(num_runs, kNumItems);
+  EXPECT_EQ(num_overlaps, 0);
+}
+
+TEST(TaskReplicaPoolTest, BoundsPendingItems) {
+  TaskReplicaPool pool("test", kNumReplicas);
+  std::atomic<int> num_pending = 0;
+  std::atomic<int> max_pending = 0;
+
+  for (int i = 0; i < kNumItems; ++i) {
+    const int pending = ++num_pending;
+    int max = max_pending;
+    while (pending > max && !max_pending.compare_exchange_weak(max, pending)) {
+    }
+    MP_ASSERT_OK(pool.Schedule(
+        [&](int replica) {
+          --num_pending;
+          return absl::OkStatus();
+        },
+        /*max_pending_items=*/2 * kNumReplicas));
+  }
+  MP_ASSERT_OK(pool.Wait());
+
+  // Counts the item about to be scheduled.
+  EXPECT_LE(max_pending, 2 * kNumReplicas + 1);
+}
+
+TEST(TaskReplicaPoolTest, SkipsItemsAfterAnError) {
+  TaskReplicaPool pool("test", /*num_replicas=*/1);
+  int num_runs = 0;
+  const auto work = [&num_runs](int replica) {
+    return ++num_runs == 2 ? absl::InternalError("failed") : absl::OkStatus();
+  };
+
+  for (int i = 0; i < kNumItems; ++i) {
+    if (!pool.Schedule(work).ok()) break;
+  }
+  EXPECT_EQ(pool.Wait().code(), absl::StatusCode::kInternal);
+  EXPECT_EQ(num_runs, 2);
+
+  // Runs the items scheduled after Wait().
+  MP_ASSERT_OK(pool.Schedule(work));
+  MP_EXPECT_OK(pool.Wait());
+  EXPECT_EQ(num_runs, 3);
+}
+
+}  // namespace
+}  // namespace core
+}  // namespace tasks
+}  // namespace mediapipe
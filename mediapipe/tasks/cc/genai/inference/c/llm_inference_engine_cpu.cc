@@ -12,9 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <pthread.h>
+#include <sys/stat.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -22,40 +24,49 @@
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <variant>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/types/span.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/tasks/cc/core/model_asset_bundle_resources.h"
 #include "mediapipe/tasks/cc/genai/inference/c/llm_inference_engine.h"
+#include "mediapipe/tasks/cc/genai/inference/c/llm_inference_engine_cpu_testing.h"
 #include "mediapipe/tasks/cc/genai/inference/proto/llm_params.pb.h"
 #include "mediapipe/tasks/cc/genai/inference/proto/transformer_params.pb.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/metadata_utils.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/model_data.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/stop_sequence_matcher.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/tokenization_service.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/graph_builder.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_builder_factory.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_weights.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/pack_weights_cache.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/prefix_kv_cache.h"
 // clang-format off
 #include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/scoped_file.h"
 // clang-format on
 #include "sentencepiece/src/sentencepiece_processor.h"  // from @com_google_sentencepiece
-#include "sentencepiece/src/util.h"  // from @com_google_sentencepiece
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
 #include "tensorflow/lite/experimental/genai/genai_ops.h"
@@ -66,9 +77,23 @@
 
 namespace {
 
+using ::mediapipe::tasks::genai::llm_utils::MapUnicodeToBytes;
 using ::mediapipe::tasks::genai::llm_utils::ScopedFile;
-
-constexpr int kCheckLastKChars = 10;
+using ::mediapipe::tasks::genai::llm_utils::StopSequenceMatcher;
+using ::mediapipe::tasks::genai::llm_utils::TokenizationService;
+
+// The predictions of all the sessions of an engine run on this many threads.
+constexpr int kNumWorkerThreads = 4;
+// The XNNPack KV cache grows by pages of this many tokens, so that sessions
+// only hold memory for the tokens they process.
+constexpr size_t kKVCachePageSize = 256;
+// XNNPack prompts are run in chunks of this many tokens, between which other
+// sessions can run their decoding steps.
+constexpr size_t kPrefillChunkSize = 128;
+// Prompts sharing at least this many first tokens with a prompt of an earlier
+// session, possibly of another process, load their KV cache from the cache
+// directory.
+constexpr size_t kMinCachedPrefixSize = 256;
 
 struct TfLiteLlm {
   std::unique_ptr<tflite::Interpreter> interpreter;
@@ -77,17 +102,32 @@ struct TfLiteLlm {
 
 struct LlmInferenceEngineCpu_Engine {
   const sentencepiece::SentencePieceProcessor* tokenizer;
-  const absl::flat_hash_map<unsigned char, int>* bytes_to_unicode_mapper;
-  const absl::flat_hash_map<int, unsigned char>* unicode_to_bytes_mapper;
+  // Encodes the prompts with `tokenizer`, mapping their bytes to unicode for
+  // models with GPT2 style unicode mapping.
+  std::unique_ptr<TokenizationService> tokenization;
+  // Whether the pieces of `tokenizer` are mapped back to bytes.
+  const bool map_bytes_to_unicode;
   const std::variant<mediapipe::tasks::genai::xnn_utils::Llm*, TfLiteLlm*> llm;
   const int start_token_id;
   const std::vector<std::string> stop_tokens;
+  const StopSequenceMatcher stop_sequence_matcher;
   const size_t max_num_tokens;
+  // Null without a cache directory.
+  const std::unique_ptr<mediapipe::tasks::genai::xnn_utils::PrefixKVCache>
+      prefix_kv_cache;
+  // Held while a session runs the model, which serves one session at a time.
+  // XNNPack sessions only hold it for one prompt chunk or decoding step.
+  mutable absl::Mutex llm_mutex;
+  // Runs the predictions of the sessions, as one task per prompt or decoding
+  // step, so that no thread is created per prediction and the decoding steps
+  // of concurrent sessions interleave.
+  std::unique_ptr<mediapipe::ThreadPool> worker_pool;
 
   ~LlmInferenceEngineCpu_Engine() {
+    // Waits for the pending tasks, which use the model.
+    worker_pool.reset();
+    tokenization.reset();
     delete tokenizer;
-    delete bytes_to_unicode_mapper;
-    delete unicode_to_bytes_mapper;
     if (std::holds_alternative<mediapipe::tasks::genai::xnn_utils::Llm*>(llm)) {
       delete std::get<mediapipe::tasks::genai::xnn_utils::Llm*>(llm);
     } else {
@@ -100,200 +140,283 @@ struct LlmInferenceEngineCpu_Session {
   const LlmInferenceEngineCpu_Engine* engine;
   std::string prompt;
   int timestep;
-  std::string last_10_char;
+  // The decoded text not passed to the callback yet, as it may start a stop
+  // sequence or end with part of a UTF-8 character. The stream of the stop
+  // sequence matcher is `final_output` followed by this text.
+  std::string pending_text;
+  StopSequenceMatcher::StreamState stop_state;
   std::string final_output;
-  std::function<void(std::string)> cpu_callback;
+  std::function<void(absl::string_view)> cpu_callback;
   bool early_stop;
-  pthread_t work_id;
+  // Checked before each prompt chunk and decoding step of the prediction.
+  std::atomic<bool> cancelled{false};
+  // Notified once the pending prediction, if any, is done.
+  std::shared_ptr<absl::Notification> prediction_done;
   int next_token_id;
-  ~LlmInferenceEngineCpu_Session() { pthread_join(work_id, nullptr); };
+  // The tokens processed by this session and their KV cache, loaded into the
+  // XNNPack model when the session runs. Shared copy-on-write by clones.
+  std::shared_ptr<mediapipe::tasks::genai::xnn_utils::Llm::Context> context;
+  ~LlmInferenceEngineCpu_Session() {
+    if (prediction_done) prediction_done->WaitForNotification();
+  };
 };
 
-absl::StatusOr<std::unique_ptr<absl::flat_hash_map<unsigned char, int>>>
-CreateBytesToUnicodeMapper() {
-  auto bytes_to_unicode_mapper =
-      std::make_unique<absl::flat_hash_map<unsigned char, int>>();
-  // "!" - "~"
-  for (int i = 33; i <= 126; i++) {
-    bytes_to_unicode_mapper->insert({static_cast<uint8_t>(i), i});
-  }
-  // "¡" - "¬"
-  for (int i = 161; i <= 172; i++) {
-    bytes_to_unicode_mapper->insert({static_cast<uint8_t>(i), i});
-  }
-  // "®" - "ÿ"
-  for (int i = 174; i < 256; i++) {
-    bytes_to_unicode_mapper->insert({static_cast<uint8_t>(i), i});
-  }
-  int n = 0;
-  for (int b = 0; b < 256; b++) {
-    if (!bytes_to_unicode_mapper->contains(static_cast<uint8_t>(b))) {
-      bytes_to_unicode_mapper->insert({static_cast<uint8_t>(b), 256 + n});
-      n += 1;
+// Runs `input_ids` after the tokens of `cpu_session` through the XNNPack
+// model, in chunks of LlmParams::prefill_chunk_size_T tokens, and returns the
+// greedy next token. The model is only held for one chunk at a time, so that
+// the decoding steps of other sessions interleave with long prompts. Returns a
+// cancelled error if the session is cancelled between chunks.
+absl::StatusOr<int> RunXnnLlm(LlmInferenceEngineCpu_Session* cpu_session,
+                              absl::Span<const int> input_ids) {
+  RET_CHECK(!input_ids.empty());
+  auto llm = std::get<mediapipe::tasks::genai::xnn_utils::Llm*>(
+      cpu_session->engine->llm);
+  const size_t chunk_size = llm->GetLlmParams().prefill_chunk_size_T > 0
+                                ? llm->GetLlmParams().prefill_chunk_size_T
+                                : input_ids.size();
+  for (size_t start = 0;; start += chunk_size) {
+    if (cpu_session->cancelled) {
+      return absl::CancelledError("The prediction was cancelled.");
     }
+    const size_t end = std::min(start + chunk_size, input_ids.size());
+    absl::MutexLock lock(&cpu_session->engine->llm_mutex);
+    MP_RETURN_IF_ERROR(llm->LoadContext(cpu_session->context));
+    MP_RETURN_IF_ERROR(llm->AddInputTokens({std::vector<int>(
+        input_ids.begin() + start, input_ids.begin() + end)}));
+    if (end < input_ids.size()) continue;
+
+    MP_ASSIGN_OR_RETURN(auto logits, llm->ComputeLogits());
+    const float* data = logits->DataAs<float>();
+    const float* max_logit = std::max_element(
+        data, data + llm->GetLlmParams().voc_size_V);
+    return max_logit - data;
   }
-  return bytes_to_unicode_mapper;
 }
 
-absl::StatusOr<std::unique_ptr<absl::flat_hash_map<int, unsigned char>>>
-CreateUnicodeToBytesMapper() {
-  MP_ASSIGN_OR_RETURN(auto bytes_to_unicode_mapper,
-                      CreateBytesToUnicodeMapper());
-  auto unicode_to_bytes_mapper =
-      std::make_unique<absl::flat_hash_map<int, unsigned char>>();
-  for (const auto& [key, value] : *bytes_to_unicode_mapper) {
-    unicode_to_bytes_mapper->insert({value, key});
+// Returns the number of bytes at the end of `text` which start a UTF-8
+// character without completing it.
+size_t IncompleteUtf8SuffixSize(absl::string_view text) {
+  for (size_t i = 1; i <= std::min<size_t>(text.size(), 3); ++i) {
+    const unsigned char c = text[text.size() - i];
+    // Continuation bytes.
+    if ((c & 0xC0) == 0x80) continue;
+    if (c < 0xC0) return 0;
+    const size_t char_size = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+    return char_size > i ? i : 0;
   }
-  return unicode_to_bytes_mapper;
+  return 0;
 }
 
-std::string MapBytesToUnicode(
-    absl::string_view prompt,
-    const absl::flat_hash_map<unsigned char, int>* bytes_to_unicode_mapper) {
-  std::string converted_prompt = "";
-  for (const uint8_t byte : prompt) {
-    converted_prompt.append(sentencepiece::string_util::UnicodeCharToUTF8(
-        bytes_to_unicode_mapper->at(byte)));
+// Appends the text of `token_id` to the pending text of `cpu_session`, up to
+// the first stop sequence, which ends the prediction.
+void AppendTokenText(LlmInferenceEngineCpu_Session* cpu_session,
+                     int token_id) {
+  const LlmInferenceEngineCpu_Engine* engine = cpu_session->engine;
+  const std::string& piece = engine->tokenizer->IdToPiece(token_id);
+  std::string token;
+  int byte;
+  if (engine->map_bytes_to_unicode) {
+    token = MapUnicodeToBytes(piece);
+  } else if (engine->tokenizer->IsByte(token_id) &&
+             absl::SimpleHexAtoi(
+                 absl::string_view(piece).substr(3, piece.size() - 4),
+                 &byte)) {
+    // Byte fallback pieces, e.g. "<0xE2>", hold one byte of a character
+    // split across tokens.
+    token.push_back(static_cast<char>(byte));
+  } else {
+    token = absl::StrReplaceAll(piece, {{"▁", " "}});
   }
-  return converted_prompt;
-}
 
-std::string MapUnicodeToBytes(
-    absl::string_view output,
-    const absl::flat_hash_map<int, uint8_t>* unicode_to_bytes_mapper) {
-  sentencepiece::string_util::UnicodeText unicode_text =
-      sentencepiece::string_util::UTF8ToUnicodeText(output);
-  std::string converted_output = "";
-  for (const int code_point : unicode_text) {
-    if (!unicode_to_bytes_mapper->contains(code_point)) {
-      converted_output += code_point;
-    } else {
-      converted_output += unicode_to_bytes_mapper->at(code_point);
-    }
+  cpu_session->pending_text.append(token);
+  const std::optional<size_t> stop_offset =
+      engine->stop_sequence_matcher.Append(token, cpu_session->stop_state);
+  if (stop_offset.has_value()) {
+    cpu_session->early_stop = true;
+    ABSL_DCHECK_GE(*stop_offset, cpu_session->final_output.size());
+    cpu_session->pending_text.resize(*stop_offset -
+                                     cpu_session->final_output.size());
   }
-  return converted_output;
 }
 
-void* next_token_function(void* args) {
-  struct LlmInferenceEngineCpu_Session* cpu_session =
-      (struct LlmInferenceEngineCpu_Session*)args;
-  if (cpu_session->timestep < cpu_session->engine->max_num_tokens) {
-    if (cpu_session->early_stop) {
-      return nullptr;
-    }
-
-    auto token_ids_per_step = std::vector<int>();
-    if (std::holds_alternative<mediapipe::tasks::genai::xnn_utils::Llm*>(
-            cpu_session->engine->llm)) {
-      auto status = std::get<mediapipe::tasks::genai::xnn_utils::Llm*>(
-                        cpu_session->engine->llm)
-                        ->GetNextToken(&token_ids_per_step);
-      if (!status.ok()) {
-        ABSL_LOG(FATAL) << "Failed to generate output: " << status;
-      }
-    } else {
-      auto llm = std::get<TfLiteLlm*>(cpu_session->engine->llm);
-      auto* decode_runner = llm->interpreter->GetSignatureRunner("decode");
-      ABSL_CHECK_EQ(decode_runner->AllocateTensors(), kTfLiteOk);
-      TfLiteTensor* decode_input = decode_runner->input_tensor("args_0");
-      TfLiteTensor* decode_input_pos = decode_runner->input_tensor("args_1");
-      decode_input->data.i64[0] =
-          static_cast<int64_t>(cpu_session->next_token_id);
-      decode_input_pos->data.i64[0] =
-          static_cast<int64_t>(cpu_session->timestep);
-
-      // logits->dims->data[0] = batch size
-      // logits->dims->data[1] = sequence length
-      // logits->dims->data[2] = vocab size
-      const TfLiteTensor* logits = decode_runner->output_tensor("output_0");
-
-      ABSL_CHECK_EQ(decode_runner->Invoke(), kTfLiteOk);
-
-      auto max_logit_it = std::max_element(
-          logits->data.f, logits->data.f + logits->dims->data[2]);
-      token_ids_per_step.push_back(std::distance(logits->data.f, max_logit_it));
-    }
-
-    // For future multithreading support.
-    if (cpu_session->early_stop) {
-      return nullptr;
-    }
+// Passes the pending text of `cpu_session` to the callback, but for the bytes
+// which may start a stop sequence or a UTF-8 character, unless the prediction
+// is done.
+void EmitPendingText(LlmInferenceEngineCpu_Session* cpu_session) {
+  std::string& pending_text = cpu_session->pending_text;
+  size_t ready_size = pending_text.size();
+  if (!cpu_session->early_stop) {
+    const size_t held_size = std::max(
+        cpu_session->engine->stop_sequence_matcher.NumPendingBytes(
+            cpu_session->stop_state),
+        IncompleteUtf8SuffixSize(pending_text));
+    ready_size -= std::min(held_size, ready_size);
+  }
+  const absl::string_view ready_text(pending_text.data(), ready_size);
+  cpu_session->final_output.append(ready_text);
+  cpu_session->cpu_callback(ready_text);
+  pending_text.erase(0, ready_size);
+}
 
-    if (cpu_session->timestep >= cpu_session->engine->max_num_tokens) {
-      cpu_session->early_stop = true;
-    }
+// Passes the rest of the output of `cpu_session` to the callback, as done.
+void FinishPrediction(LlmInferenceEngineCpu_Session* cpu_session) {
+  cpu_session->early_stop = true;
+  EmitPendingText(cpu_session);
+  // The session may be deleted once notified.
+  std::shared_ptr<absl::Notification> prediction_done =
+      cpu_session->prediction_done;
+  prediction_done->Notify();
+}
 
-    cpu_session->next_token_id = token_ids_per_step[0];
+// Runs one decoding step of `cpu_session`, and schedules the next one on the
+// worker pool, behind the steps of other sessions.
+void DecodeNextToken(LlmInferenceEngineCpu_Session* cpu_session) {
+  if (cpu_session->cancelled ||
+      cpu_session->timestep >= cpu_session->engine->max_num_tokens) {
+    FinishPrediction(cpu_session);
+    return;
+  }
 
-    std::string token =
-        cpu_session->engine->tokenizer->IdToPiece(token_ids_per_step[0]);
-    if (cpu_session->engine->unicode_to_bytes_mapper != nullptr) {
-      token = MapUnicodeToBytes(token,
-                                cpu_session->engine->unicode_to_bytes_mapper);
-    } else {
-      token = absl::StrReplaceAll(token, {{"▁", " "}});
-    }
-    cpu_session->last_10_char.append(token);
-
-    int stop_index;
-    for (const auto& stop_token : cpu_session->engine->stop_tokens) {
-      stop_index = cpu_session->last_10_char.find(stop_token);
-      if (stop_index != std::string::npos) {
-        cpu_session->early_stop = true;
-        cpu_session->last_10_char =
-            cpu_session->last_10_char.substr(0, stop_index);
-        break;
+  int output_token_id;
+  if (std::holds_alternative<mediapipe::tasks::genai::xnn_utils::Llm*>(
+          cpu_session->engine->llm)) {
+    // Emits the token sampled by the previous run, and runs it to sample the
+    // next one, unless it is the last token which fits in the KV cache.
+    output_token_id = cpu_session->next_token_id;
+    if (cpu_session->timestep + 1 < cpu_session->engine->max_num_tokens) {
+      const int input_ids[] = {output_token_id};
+      auto next_token_id = RunXnnLlm(cpu_session, input_ids);
+      if (absl::IsCancelled(next_token_id.status())) {
+        FinishPrediction(cpu_session);
+        return;
       }
+      if (!next_token_id.ok()) {
+        ABSL_LOG(FATAL) << "Failed to generate output: "
+                        << next_token_id.status();
+      }
+      cpu_session->next_token_id = *next_token_id;
     }
-
-    std::string ready_char = "";
-    if (cpu_session->early_stop) {
-      ready_char = cpu_session->last_10_char;
-    } else if (cpu_session->last_10_char.size() > kCheckLastKChars) {
-      ready_char = cpu_session->last_10_char.substr(
-          0, cpu_session->last_10_char.size() - kCheckLastKChars);
-      cpu_session->last_10_char = cpu_session->last_10_char.substr(
-          cpu_session->last_10_char.size() - kCheckLastKChars);
-    }
-    cpu_session->final_output.append(ready_char);
-
-    cpu_session->cpu_callback(ready_char);
-
-    ++cpu_session->timestep;
-
-    next_token_function(args);
-  }
-  return nullptr;
-};
-
-void* start_llm_function(void* args) {
-  struct LlmInferenceEngineCpu_Session* cpu_session =
-      (struct LlmInferenceEngineCpu_Session*)args;
-
-  std::vector<int> prompt_ids = {};
-
-  std::string prompt;
-  if (cpu_session->engine->bytes_to_unicode_mapper != nullptr) {
-    prompt = MapBytesToUnicode(cpu_session->prompt,
-                               cpu_session->engine->bytes_to_unicode_mapper);
   } else {
-    prompt = cpu_session->prompt;
+    absl::MutexLock lock(&cpu_session->engine->llm_mutex);
+    auto llm = std::get<TfLiteLlm*>(cpu_session->engine->llm);
+    auto* decode_runner = llm->interpreter->GetSignatureRunner("decode");
+    ABSL_CHECK_EQ(decode_runner->AllocateTensors(), kTfLiteOk);
+    TfLiteTensor* decode_input = decode_runner->input_tensor("args_0");
+    TfLiteTensor* decode_input_pos = decode_runner->input_tensor("args_1");
+    decode_input->data.i64[0] =
+        static_cast<int64_t>(cpu_session->next_token_id);
+    decode_input_pos->data.i64[0] =
+        static_cast<int64_t>(cpu_session->timestep);
+
+    // logits->dims->data[0] = batch size
+    // logits->dims->data[1] = sequence length
+    // logits->dims->data[2] = vocab size
+    const TfLiteTensor* logits = decode_runner->output_tensor("output_0");
+
+    ABSL_CHECK_EQ(decode_runner->Invoke(), kTfLiteOk);
+
+    auto max_logit_it = std::max_element(
+        logits->data.f, logits->data.f + logits->dims->data[2]);
+    output_token_id = std::distance(logits->data.f, max_logit_it);
+    cpu_session->next_token_id = output_token_id;
   }
 
-  auto status = cpu_session->engine->tokenizer->Encode(prompt, &prompt_ids);
+  AppendTokenText(cpu_session, output_token_id);
+  ++cpu_session->timestep;
+  if (cpu_session->early_stop ||
+      cpu_session->timestep >= cpu_session->engine->max_num_tokens) {
+    FinishPrediction(cpu_session);
+    return;
+  }
+  EmitPendingText(cpu_session);
+  cpu_session->engine->worker_pool->Schedule(
+      [cpu_session] { DecodeNextToken(cpu_session); });
+}
 
-  if (!status.ok()) {
-    ABSL_LOG(FATAL) << "Failed to encode input: " << status;
+// Runs the prompt of `cpu_session`, then decodes its output.
+void PrefillPrompt(LlmInferenceEngineCpu_Session* cpu_session) {
+  auto encoded_prompt =
+      cpu_session->engine->tokenization->Encode(cpu_session->prompt);
+  if (!encoded_prompt.ok()) {
+    ABSL_LOG(FATAL) << "Failed to encode input: " << encoded_prompt.status();
   }
+  std::vector<int> prompt_ids = *std::move(encoded_prompt);
   prompt_ids.insert(prompt_ids.begin(), cpu_session->engine->start_token_id);
 
   if (std::holds_alternative<mediapipe::tasks::genai::xnn_utils::Llm*>(
           cpu_session->engine->llm)) {
     auto llm = std::get<mediapipe::tasks::genai::xnn_utils::Llm*>(
         cpu_session->engine->llm);
-    ABSL_CHECK_OK(llm->SeekTimeStep(0));
-    ABSL_CHECK_OK(llm->AddInputTokens({prompt_ids}));
+    size_t num_cached_ids = 0;
+    {
+      absl::MutexLock lock(&cpu_session->engine->llm_mutex);
+      if (!cpu_session->context) {
+        auto context = llm->NewContext();
+        ABSL_CHECK_OK(context);
+        cpu_session->context =
+            std::make_shared<mediapipe::tasks::genai::xnn_utils::Llm::Context>(
+                *std::move(context));
+      }
+      ABSL_CHECK_OK(llm->LoadContext(cpu_session->context));
+      // Only the tokens after the longest prefix already in the KV cache, e.g.
+      // the prompt of the session this one was cloned from, are prefilled.
+      // The last token is always run again to get its logits.
+      const std::vector<int>& prev_ids =
+          cpu_session->context->batch_prev_ids[0];
+      num_cached_ids =
+          std::min<size_t>(std::mismatch(prompt_ids.begin(), prompt_ids.end(),
+                                         prev_ids.begin(), prev_ids.end())
+                                   .first -
+                               prompt_ids.begin(),
+                           prompt_ids.size() - 1);
+      // A new session loads the longest prefix saved by earlier sessions.
+      if (num_cached_ids == 0 && cpu_session->engine->prefix_kv_cache) {
+        auto num_loaded_ids =
+            cpu_session->engine->prefix_kv_cache->Load(*llm, prompt_ids);
+        ABSL_CHECK_OK(num_loaded_ids);
+        num_cached_ids = *num_loaded_ids;
+      }
+      ABSL_CHECK_OK(llm->SeekTimeStep(num_cached_ids));
+    }
+    auto next_token_id = RunXnnLlm(
+        cpu_session,
+        absl::MakeConstSpan(prompt_ids).subspan(num_cached_ids));
+    if (absl::IsCancelled(next_token_id.status())) {
+      FinishPrediction(cpu_session);
+      return;
+    }
+    ABSL_CHECK_OK(next_token_id);
+    cpu_session->next_token_id = *next_token_id;
+    if (num_cached_ids == 0 && cpu_session->engine->prefix_kv_cache) {
+      absl::StatusOr<std::optional<
+          mediapipe::tasks::genai::xnn_utils::PrefixKVCache::Entry>>
+          entry;
+      {
+        absl::MutexLock lock(&cpu_session->engine->llm_mutex);
+        ABSL_CHECK_OK(llm->LoadContext(cpu_session->context));
+        entry = cpu_session->engine->prefix_kv_cache->Snapshot(*llm);
+      }
+      if (!entry.ok()) {
+        ABSL_LOG(WARNING) << "Failed to save the prompt KV cache: "
+                          << entry.status();
+      } else if (entry->has_value()) {
+        // Written by another worker, so that neither the model nor the
+        // decoding of this session wait for the disk.
+        auto shared_entry = std::make_shared<
+            mediapipe::tasks::genai::xnn_utils::PrefixKVCache::Entry>(
+            **std::move(entry));
+        cpu_session->engine->worker_pool->Schedule(
+            [engine = cpu_session->engine, shared_entry] {
+              auto write_status = engine->prefix_kv_cache->Write(*shared_entry);
+              if (!write_status.ok()) {
+                ABSL_LOG(WARNING) << "Failed to save the prompt KV cache: "
+                                  << write_status;
+              }
+            });
+      }
+    }
   } else {
+    absl::MutexLock lock(&cpu_session->engine->llm_mutex);
     auto llm = std::get<TfLiteLlm*>(cpu_session->engine->llm);
     auto* prefill_runner = llm->interpreter->GetSignatureRunner("prefill");
 
@@ -314,9 +437,58 @@ void* start_llm_function(void* args) {
 
   cpu_session->timestep = prompt_ids.size();
 
-  next_token_function(args);
+  DecodeNextToken(cpu_session);
+}
 
-  return nullptr;
+// Identifies the weights of `model_path` in the prefix KV cache.
+std::string GetModelKey(const char* model_path) {
+  std::string model_key(mediapipe::file::Basename(model_path));
+  struct stat model_stat;
+  if (stat(model_path, &model_stat) == 0) {
+    absl::StrAppend(&model_key, ":", model_stat.st_size, ":",
+                    model_stat.st_mtime);
+  }
+  return model_key;
+}
+
+// Creates an engine running `llm`, whose KV cache holds up to the maximum
+// number of tokens of the sessions, with the tokenizer serialized in
+// `spm_model_content`.
+absl::StatusOr<std::unique_ptr<LlmInferenceEngineCpu_Engine>>
+NewXnnLlmCpuEngine(
+    std::unique_ptr<mediapipe::tasks::genai::xnn_utils::Llm> llm,
+    absl::string_view spm_model_content,
+    const odml::infra::proto::LlmParameters& llm_params_proto,
+    bool map_bytes_to_unicode,
+    std::unique_ptr<mediapipe::tasks::genai::xnn_utils::PrefixKVCache>
+        prefix_kv_cache) {
+  auto tokenizer = std::make_unique<sentencepiece::SentencePieceProcessor>();
+  MP_RETURN_IF_ERROR(tokenizer->LoadFromSerializedProto(spm_model_content));
+  const size_t max_num_tokens = llm->GetLlmParams().seq_size_T;
+
+  // Prompts are encoded one at a time, on the worker threads of the engine.
+  auto tokenization = std::make_unique<TokenizationService>(
+      tokenizer.get(),
+      TokenizationService::Options{
+          .map_bytes_to_unicode = map_bytes_to_unicode, .num_threads = 1});
+
+  const std::vector<std::string> stop_tokens(
+      llm_params_proto.stop_tokens().begin(),
+      llm_params_proto.stop_tokens().end());
+  std::unique_ptr<LlmInferenceEngineCpu_Engine> engine(
+      new LlmInferenceEngineCpu_Engine{
+          .tokenizer = tokenizer.release(),
+          .tokenization = std::move(tokenization),
+          .map_bytes_to_unicode = map_bytes_to_unicode,
+          .llm = llm.release(),
+          .start_token_id = llm_params_proto.start_token_id(),
+          .stop_tokens = stop_tokens,
+          .stop_sequence_matcher = StopSequenceMatcher(stop_tokens),
+          .max_num_tokens = max_num_tokens,
+          .prefix_kv_cache = std::move(prefix_kv_cache),
+      });
+
+  return engine;
 }
 
 absl::StatusOr<std::unique_ptr<LlmInferenceEngineCpu_Engine>>
@@ -344,6 +516,11 @@ CreateXnnLlmCpuEngine(const LlmModelSettings* model_settings) {
                           mediapipe::tasks::genai::llm_utils::kLlmBackendName));
   RET_CHECK_EQ(backend, "cpu");
 
+  const bool use_cache_dir =
+      model_settings->cache_dir != nullptr &&
+      *model_settings->cache_dir != '\0' &&
+      absl::string_view(model_settings->cache_dir) != ":nocache";
+
   // Create directory for tokenizer and model cache file.
   if (model_settings->cache_dir != nullptr) {
     auto s = mediapipe::file::RecursivelyCreateDir(model_settings->cache_dir);
@@ -357,7 +534,12 @@ CreateXnnLlmCpuEngine(const LlmModelSettings* model_settings) {
   model_data.reset();
 
   llm_params.seq_size_T = model_settings->max_num_tokens;
+  llm_params.kv_cache_page_size_T = kKVCachePageSize;
+  llm_params.prefill_chunk_size_T = kPrefillChunkSize;
   llm_params.cache_dir = model_settings->cache_dir;
+  // The runtime reads the packed weights from the cache directory, building
+  // them there on the first run, and only pages them in once used.
+  llm_params.lazy_load_weights = use_cache_dir;
 
   auto weight_loader = std::make_unique<
       mediapipe::tasks::genai::xnn_utils::DefaultLlmWeightsLoader>(
@@ -365,42 +547,40 @@ CreateXnnLlmCpuEngine(const LlmModelSettings* model_settings) {
 
   auto runtime_configs =
       std::make_unique<mediapipe::tasks::genai::xnn_utils::RuntimeConfigs>();
+  std::shared_ptr<mediapipe::tasks::genai::xnn_utils::PackWeightsCache>
+      weights_cache;
+  if (llm_params.lazy_load_weights) {
+    weights_cache = weight_loader->weights_cache();
+    runtime_configs->weights_cache = weights_cache;
+  }
 
   MP_ASSIGN_OR_RETURN(auto llm,
                       mediapipe::tasks::genai::xnn_utils::CreateLlm(
                           llm_params, std::move(runtime_configs),
                           std::move(weight_loader), nullptr, *model_type));
+  // Writes the weights packed by the runtime, if the cache was just built.
+  if (weights_cache) {
+    MP_RETURN_IF_ERROR(weights_cache->Finalize());
+  }
 
-  auto tokenizer = std::make_unique<sentencepiece::SentencePieceProcessor>();
-  MP_RETURN_IF_ERROR(tokenizer->LoadFromSerializedProto(spm_model_content));
+  std::unique_ptr<mediapipe::tasks::genai::xnn_utils::PrefixKVCache>
+      prefix_kv_cache;
+  if (use_cache_dir) {
+    prefix_kv_cache =
+        std::make_unique<mediapipe::tasks::genai::xnn_utils::PrefixKVCache>(
+            model_settings->cache_dir, GetModelKey(model_settings->model_path),
+            kMinCachedPrefixSize);
+  }
 
-  std::unique_ptr<absl::flat_hash_map<unsigned char, int>>
-      bytes_to_unicode_mapper;
-  std::unique_ptr<absl::flat_hash_map<int, unsigned char>>
-      unicode_to_bytes_mapper;
   // These models uses GPT2 style unicode mapping, which additional mapping is
   // needed.
-  if (model_type == odml::infra::proto::LLM_MODEL_TYPE_STABLELM_4E1T_3B ||
+  const bool map_bytes_to_unicode =
+      model_type == odml::infra::proto::LLM_MODEL_TYPE_STABLELM_4E1T_3B ||
       model_type == odml::infra::proto::LLM_MODEL_TYPE_FALCON_RW_1B ||
-      model_type == odml::infra::proto::LLM_MODEL_TYPE_PHI_2) {
-    MP_ASSIGN_OR_RETURN(bytes_to_unicode_mapper, CreateBytesToUnicodeMapper());
-    MP_ASSIGN_OR_RETURN(unicode_to_bytes_mapper, CreateUnicodeToBytesMapper());
-  }
-
-  std::unique_ptr<LlmInferenceEngineCpu_Engine> engine(
-      new LlmInferenceEngineCpu_Engine{
-          .tokenizer = tokenizer.release(),
-          .bytes_to_unicode_mapper = bytes_to_unicode_mapper.release(),
-          .unicode_to_bytes_mapper = unicode_to_bytes_mapper.release(),
-          .llm = llm.release(),
-          .start_token_id = llm_params_proto.start_token_id(),
-          .stop_tokens =
-              std::vector<std::string>(llm_params_proto.stop_tokens().begin(),
-                                       llm_params_proto.stop_tokens().end()),
-          .max_num_tokens = model_settings->max_num_tokens,
-      });
-
-  return engine;
+      model_type == odml::infra::proto::LLM_MODEL_TYPE_PHI_2;
+  return NewXnnLlmCpuEngine(std::move(llm), spm_model_content,
+                            llm_params_proto, map_bytes_to_unicode,
+                            std::move(prefix_kv_cache));
 }
 
 // Creates an inference engine from a *.task file.
@@ -486,23 +666,35 @@ CreateTfliteLlmCpuEngine(const LlmModelSettings* model_settings) {
                                           params_buffer.size()));
 
   auto start_token_id = tokenizer->PieceToId(llm_parameters.start_token());
+  auto tokenization = std::make_unique<TokenizationService>(
+      tokenizer.get(), TokenizationService::Options{.num_threads = 1});
+  const std::vector<std::string> stop_tokens(
+      llm_parameters.stop_tokens().begin(), llm_parameters.stop_tokens().end());
 
   std::unique_ptr<LlmInferenceEngineCpu_Engine> engine(
       new LlmInferenceEngineCpu_Engine{
           .tokenizer = tokenizer.release(),
-          .bytes_to_unicode_mapper = nullptr,
-          .unicode_to_bytes_mapper = nullptr,
+          .tokenization = std::move(tokenization),
+          .map_bytes_to_unicode = false,
           .llm = tflite_llm.release(),
           .start_token_id = start_token_id,
-          .stop_tokens =
-              std::vector<std::string>(llm_parameters.stop_tokens().begin(),
-                                       llm_parameters.stop_tokens().end()),
+          .stop_tokens = stop_tokens,
+          .stop_sequence_matcher = StopSequenceMatcher(stop_tokens),
           .max_num_tokens = model_settings->max_num_tokens,
       });
 
   return engine;
 }
 
+// Starts the worker threads of `engine`, and returns it.
+LlmInferenceEngine_Engine* StartEngine(
+    std::unique_ptr<LlmInferenceEngineCpu_Engine> engine) {
+  engine->worker_pool = std::make_unique<mediapipe::ThreadPool>(
+      "llm_inference_engine_cpu", kNumWorkerThreads);
+  engine->worker_pool->StartWorkers();
+  return engine.release();
+}
+
 absl::StatusOr<LlmInferenceEngine_Engine*>
 LlmInferenceEngine_CreateEngine_Helper(const LlmModelSettings* model_settings) {
   std::unique_ptr<LlmInferenceEngineCpu_Engine> engine;
@@ -511,8 +703,7 @@ LlmInferenceEngine_CreateEngine_Helper(const LlmModelSettings* model_settings) {
   } else {
     MP_ASSIGN_OR_RETURN(engine, CreateTfliteLlmCpuEngine(model_settings));
   }
-
-  return engine.release();
+  return StartEngine(std::move(engine));
 }
 
 absl::StatusOr<LlmInferenceEngine_Session*>
@@ -527,6 +718,22 @@ LlmInferenceEngine_CreateSession_Helper(
 
 }  // namespace
 
+namespace mediapipe::tasks::genai {
+
+absl::StatusOr<LlmInferenceEngine_Engine*>
+CreateXnnLlmInferenceEngineForTesting(
+    std::unique_ptr<xnn_utils::Llm> llm, absl::string_view spm_model_content,
+    const odml::infra::proto::LlmParameters& llm_params) {
+  MP_ASSIGN_OR_RETURN(
+      auto engine,
+      NewXnnLlmCpuEngine(std::move(llm), spm_model_content, llm_params,
+                         /*map_bytes_to_unicode=*/false,
+                         /*prefix_kv_cache=*/nullptr));
+  return StartEngine(std::move(engine));
+}
+
+}  // namespace mediapipe::tasks::genai
+
 void LlmInferenceEngine_CloseResponseContext(
     LlmResponseContext* response_context) {
   for (size_t i = 0; i < response_context->response_count; i++) {
@@ -606,8 +813,7 @@ int LlmInferenceEngine_Session_PredictSync(LlmInferenceEngine_Session* session,
   }
 
   auto cpu_session = reinterpret_cast<LlmInferenceEngineCpu_Session*>(session);
-  pthread_join(cpu_session->work_id, nullptr);
-  cpu_session->work_id = 0;
+  cpu_session->prediction_done->WaitForNotification();
   auto final_output = cpu_session->final_output;
 
   char** result = (char**)malloc(sizeof(char*) * 1);
@@ -616,7 +822,7 @@ int LlmInferenceEngine_Session_PredictSync(LlmInferenceEngine_Session* session,
     return static_cast<int>(absl::StatusCode::kResourceExhausted);
   }
 
-  result[0] = (char*)malloc(sizeof(char*) * (final_output.size() + 1));
+  result[0] = (char*)malloc(final_output.size() + 1);
   if (result[0] == nullptr) {
     *error_msg = strdup("Failed to allocate result for cpu session.");
     return static_cast<int>(absl::StatusCode::kResourceExhausted);
@@ -652,18 +858,26 @@ int LlmInferenceEngine_Session_PredictAsync(
     return static_cast<int>(absl::StatusCode::kInvalidArgument);
   }
 
-  cpu_session->cpu_callback = [=](std::string responses) -> void {
+  // Waits for the pending prediction, which uses the same session state.
+  if (cpu_session->prediction_done) {
+    cpu_session->prediction_done->WaitForNotification();
+  }
+
+  // The response is owned by the caller, who frees it with
+  // LlmInferenceEngine_CloseResponseContext.
+  cpu_session->cpu_callback = [=](absl::string_view responses) -> void {
     char** result = (char**)malloc(sizeof(char*) * 1);
     if (result == nullptr) {
       ABSL_LOG(FATAL) << "Failed to allocate result for cpu session.";
     }
 
-    result[0] = (char*)malloc(sizeof(char*) * (responses.size() + 1));
+    result[0] = (char*)malloc(responses.size() + 1);
     if (result[0] == nullptr) {
       ABSL_LOG(FATAL) << "Failed to allocate result for cpu session.";
     }
 
-    snprintf(result[0], responses.size() + 1, "%s", responses.c_str());
+    memcpy(result[0], responses.data(), responses.size());
+    result[0][responses.size()] = '\0';
     auto response_context = std::make_unique<LlmResponseContext>();
     response_context->response_array = result,
     response_context->response_count = 1,
@@ -671,42 +885,83 @@ int LlmInferenceEngine_Session_PredictAsync(
     callback(callback_context, response_context.release());
   };
 
-  cpu_session->final_output = "";
-  cpu_session->last_10_char = "";
+  cpu_session->final_output.clear();
+  cpu_session->pending_text.clear();
+  cpu_session->stop_state = {};
   cpu_session->early_stop = false;
+  cpu_session->cancelled = false;
+  cpu_session->prediction_done = std::make_shared<absl::Notification>();
 
-  pthread_t work_id = 0;
-  cpu_session->work_id = work_id;
-  pthread_create(&cpu_session->work_id, nullptr, start_llm_function,
-                 cpu_session);
+  cpu_session->engine->worker_pool->Schedule(
+      [cpu_session] { PrefillPrompt(cpu_session); });
 
   return 0;
 }
 
 int LlmInferenceEngine_Session_PendingProcessCancellation(
     LlmInferenceEngine_Session* session, char** error_msg) {
-  *error_msg = strdup("Not implemented");
-  return 12;
+  auto cpu_session = reinterpret_cast<LlmInferenceEngineCpu_Session*>(session);
+  // The pending prediction stops before its next prompt chunk or decoding
+  // step, and passes the text decoded so far to the callback, as done.
+  cpu_session->cancelled = true;
+  return 0;
 }
 
 int LlmInferenceEngine_Session_Clone(
     LlmInferenceEngine_Session* session,
     LlmInferenceEngine_Session** cloned_session, char** error_msg) {
-  *error_msg = strdup("Not implemented");
-  return 12;
+  auto cpu_session = reinterpret_cast<LlmInferenceEngineCpu_Session*>(session);
+  if (!std::holds_alternative<mediapipe::tasks::genai::xnn_utils::Llm*>(
+          cpu_session->engine->llm)) {
+    *error_msg = strdup("Cloning is only supported by XNNPack models.");
+    return static_cast<int>(absl::StatusCode::kUnimplemented);
+  }
+
+  // Waits for the pending response, whose tokens are part of the clone.
+  if (cpu_session->prediction_done) {
+    cpu_session->prediction_done->WaitForNotification();
+  }
+
+  std::unique_ptr<LlmInferenceEngineCpu_Session> clone(
+      new LlmInferenceEngineCpu_Session{
+          .engine = cpu_session->engine,
+          .prompt = cpu_session->prompt,
+          .timestep = cpu_session->timestep,
+          .pending_text = cpu_session->pending_text,
+          .stop_state = cpu_session->stop_state,
+          .final_output = cpu_session->final_output,
+          .early_stop = cpu_session->early_stop,
+          .next_token_id = cpu_session->next_token_id,
+      });
+  if (cpu_session->context) {
+    // Loading another context into the model moves the KV cache tensors of
+    // this one.
+    absl::MutexLock lock(&cpu_session->engine->llm_mutex);
+    auto context = mediapipe::tasks::genai::xnn_utils::Llm::CloneContext(
+        cpu_session->context);
+    if (!context.ok()) {
+      *error_msg = strdup(absl::StrCat("Failed to clone session: ",
+                                       context.status().ToString())
+                              .c_str());
+      return static_cast<int>(context.status().code());
+    }
+    clone->context = *std::move(context);
+  }
+
+  *cloned_session = clone.release();
+  return 0;
 }
 
 int LlmInferenceEngine_Session_SizeInTokens(LlmInferenceEngine_Session* session,
                                             const char* input,
                                             char** error_msg) {
   auto cpu_session = reinterpret_cast<LlmInferenceEngineCpu_Session*>(session);
-  std::vector<int> output_ids;
-  auto status = cpu_session->engine->tokenizer->Encode(input, &output_ids);
-  if (!status.ok()) {
-    *error_msg = strdup(status.ToString().c_str());
+  auto num_tokens = cpu_session->engine->tokenization->CountTokens(input);
+  if (!num_tokens.ok()) {
+    *error_msg = strdup(num_tokens.status().ToString().c_str());
     return -1;
   }
-  return output_ids.size();
+  return *num_tokens;
 }
 
 int LlmInferenceEngine_UpdateRuntimeConfig(LlmInferenceEngine_Session* session,
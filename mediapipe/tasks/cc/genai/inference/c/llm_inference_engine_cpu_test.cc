@@ -0,0 +1,135 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/c/llm_inference_engine.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/genai/inference/c/llm_inference_engine_cpu_testing.h"
+#include "mediapipe/tasks/cc/genai/inference/proto/llm_params.pb.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/well_known_models.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/benchmark_weight_accessor.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/graph_builder.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_weights.h"
+
+namespace mediapipe::tasks::genai {
+namespace {
+
+constexpr absl::string_view kTokenizerModelPath =
+    "mediapipe/tasks/cc/text/custom_ops/sentencepiece/testdata/"
+    "sentencepiece.model";
+
+constexpr size_t kMaxNumTokens = 24;
+
+// Returns a small Gemma model with random weights, whose KV cache holds up to
+// `kMaxNumTokens` tokens.
+absl::StatusOr<std::unique_ptr<xnn_utils::Llm>> CreateSmallGemmaLlm(
+    const odml::infra::proto::LlmParameters& llm_params_proto) {
+  xnn_utils::LlmParams params =
+      xnn_utils::LlmParams::FromLLMParametersProto(llm_params_proto);
+  params.num_transformer_M = 2;
+  params.batch_size_B = 1;
+  params.seq_size_T = kMaxNumTokens;
+  params.model_dim_D = 128;
+  params.hidden_dim_HD = 256;
+  params.head_dim_H = 32;
+  params.n_heads_N = 4;
+  params.num_kv_heads = 1;
+  // Within the vocabulary of the tokenizer.
+  params.voc_size_V = 256;
+  params.enable_kv_cache = true;
+  auto weights_loader = std::make_unique<xnn_utils::LlmWeightsLoader>(
+      std::make_unique<xnn_utils::BenchmarkWeightAccessor>(xnn_datatype_fp32,
+                                                           /*seed=*/0),
+      params);
+  return xnn_utils::Llm::CreateLlm(
+      std::move(weights_loader),
+      std::make_unique<xnn_utils::LlmBuilder>(
+          params, std::make_unique<xnn_utils::RuntimeConfigs>()));
+}
+
+// Counts the responses of a prediction, until the last one.
+struct ResponseCounter {
+  absl::Mutex mutex;
+  int num_responses ABSL_GUARDED_BY(mutex) = 0;
+  absl::Notification done;
+};
+
+void CountResponse(void* callback_context,
+                   LlmResponseContext* response_context) {
+  auto* counter = static_cast<ResponseCounter*>(callback_context);
+  {
+    absl::MutexLock lock(&counter->mutex);
+    ++counter->num_responses;
+  }
+  const bool done = response_context->done;
+  LlmInferenceEngine_CloseResponseContext(response_context);
+  delete response_context;
+  if (done) counter->done.Notify();
+}
+
+TEST(LlmInferenceEngineCpuTest, DecodesUpToMaxNumTokens) {
+  odml::infra::proto::LlmParameters llm_params =
+      llm_utils::GetGemma2BParams();
+  // Random weights never stop before the KV cache is full.
+  llm_params.clear_stop_tokens();
+  MP_ASSERT_OK_AND_ASSIGN(auto llm, CreateSmallGemmaLlm(llm_params));
+  std::string spm_model_content;
+  MP_ASSERT_OK(file::GetContents(file::JoinPath("./", kTokenizerModelPath),
+                                 &spm_model_content));
+  MP_ASSERT_OK_AND_ASSIGN(
+      LlmInferenceEngine_Engine* engine,
+      CreateXnnLlmInferenceEngineForTesting(std::move(llm), spm_model_content,
+                                            llm_params));
+
+  const LlmSessionConfig session_config = {};
+  LlmInferenceEngine_Session* session = nullptr;
+  char* error_msg = nullptr;
+  ASSERT_EQ(LlmInferenceEngine_CreateSession(engine, &session_config,
+                                             &session, &error_msg),
+            0);
+  const char prompt[] = "hello world";
+  const int prompt_size =
+      LlmInferenceEngine_Session_SizeInTokens(session, prompt, &error_msg);
+  ASSERT_GT(prompt_size, 0);
+  ASSERT_EQ(LlmInferenceEngine_Session_AddQueryChunk(session, prompt,
+                                                     &error_msg),
+            0);
+
+  ResponseCounter counter;
+  ASSERT_EQ(LlmInferenceEngine_Session_PredictAsync(session, &counter,
+                                                    &error_msg, CountResponse),
+            0);
+  counter.done.WaitForNotification();
+
+  LlmInferenceEngine_Session_Delete(session);
+  // One response per decoding step, up to the token which fills the KV cache,
+  // after the start token and the prompt.
+  absl::MutexLock lock(&counter.mutex);
+  EXPECT_EQ(counter.num_responses, kMaxNumTokens - 1 - prompt_size);
+  LlmInferenceEngine_Engine_Delete(engine);
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::genai
@@ -0,0 +1,40 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_TASKS_CC_GENAI_INFERENCE_C_LLM_INFERENCE_ENGINE_CPU_TESTING_H_
+#define MEDIAPIPE_TASKS_CC_GENAI_INFERENCE_C_LLM_INFERENCE_ENGINE_CPU_TESTING_H_
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/tasks/cc/genai/inference/c/llm_inference_engine.h"
+#include "mediapipe/tasks/cc/genai/inference/proto/llm_params.pb.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+
+namespace mediapipe::tasks::genai {
+
+// Creates a CPU engine running `llm`, e.g. a small model with random weights,
+// instead of loading a model file. The sessions hold up to the sequence size
+// of `llm` tokens, and use the SentencePiece tokenizer serialized in
+// `spm_model_content` and the start and stop tokens of `llm_params`. The
+// engine is deleted with LlmInferenceEngine_Engine_Delete().
+absl::StatusOr<LlmInferenceEngine_Engine*>
+CreateXnnLlmInferenceEngineForTesting(
+    std::unique_ptr<xnn_utils::Llm> llm, absl::string_view spm_model_content,
+    const odml::infra::proto::LlmParameters& llm_params);
+
+}  // namespace mediapipe::tasks::genai
+
+#endif  // MEDIAPIPE_TASKS_CC_GENAI_INFERENCE_C_LLM_INFERENCE_ENGINE_CPU_TESTING_H_
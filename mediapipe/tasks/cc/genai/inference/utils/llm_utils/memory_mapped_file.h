@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <memory>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/scoped_file.h"
@@ -53,8 +54,23 @@ class MemoryMappedFile {
       ScopedFile::PlatformFile file, uint64_t offset = 0u, uint64_t length = 0u,
       absl::string_view key = "");
 
+  // Creates a read-only MemoryMappedFile object, which unlike Create() doesn't
+  // read ahead the file: pages are only read once accessed, or prefetched with
+  // Prefetch(). Writing through data() crashes.
+  static absl::StatusOr<std::unique_ptr<MemoryMappedFile>> CreateLazy(
+      absl::string_view path);
+  static absl::StatusOr<std::unique_ptr<MemoryMappedFile>> CreateLazy(
+      ScopedFile::PlatformFile file);
+
   virtual ~MemoryMappedFile() = default;
 
+  // Starts reading the bytes [offset, offset + length) of the file in the
+  // background, so that accessing them later doesn't block. No-op where not
+  // supported.
+  virtual absl::Status Prefetch(uint64_t offset, uint64_t length) {
+    return absl::OkStatus();
+  }
+
   // Returns the file size in bytes.
   virtual uint64_t length() = 0;
 
@@ -43,6 +43,18 @@ class MemoryMappedFilePosix : public MemoryMappedFile {
 
   void* data() override { return data_; }
 
+  absl::Status Prefetch(uint64_t offset, uint64_t length) override {
+    RET_CHECK_LE(offset + length, length_);
+    if (length == 0) return absl::OkStatus();
+    // madvise() takes page aligned addresses.
+    const uint64_t start = offset / getpagesize() * getpagesize();
+    RET_CHECK_EQ(madvise(static_cast<char*>(data_) + start,
+                         offset + length - start, MADV_WILLNEED),
+                 0)
+        << "madvise failed, error: " << strerror(errno);
+    return absl::OkStatus();
+  }
+
  private:
   uint64_t length_;
   void* data_;
@@ -90,6 +102,31 @@ absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::Create(
   return std::make_unique<MemoryMappedFilePosix>(length, data);
 }
 
+// static
+absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::CreateLazy(
+    absl::string_view path) {
+  MP_ASSIGN_OR_RETURN(auto scoped_file, ScopedFile::Open(path));
+  return CreateLazy(scoped_file.file());
+}
+
+// static
+absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::CreateLazy(
+    int file) {
+  const size_t length = lseek(file, 0, SEEK_END);
+  if (length == 0) {
+    return absl::InvalidArgumentError("Cannot mmap empty file.");
+  }
+
+  // Unlike Create(), maps the file read-only on all platforms, and without
+  // MADV_WILLNEED. Shared and private read-only mappings behave the same, and
+  // the former are faster on Mac.
+  void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+  RET_CHECK_NE(data, MAP_FAILED) << "Failed to map, error: " << strerror(errno);
+  RET_CHECK_NE(data, nullptr) << "Failed to map.";
+
+  return std::make_unique<MemoryMappedFilePosix>(length, data);
+}
+
 absl::StatusOr<std::unique_ptr<MemoryMappedFile>>
 MemoryMappedFile::CreateMutable(absl::string_view path) {
   MP_ASSIGN_OR_RETURN(auto scoped_file, ScopedFile::OpenWritable(path));
@@ -107,6 +107,19 @@ absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::Create(
                     /*writable=*/false);
 }
 
+// Mapped views are only read once accessed on Windows.
+// static
+absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::CreateLazy(
+    absl::string_view path) {
+  return Create(path);
+}
+
+// static
+absl::StatusOr<std::unique_ptr<MemoryMappedFile>> MemoryMappedFile::CreateLazy(
+    HANDLE file) {
+  return Create(file);
+}
+
 // static
 absl::StatusOr<std::unique_ptr<MemoryMappedFile>>
 MemoryMappedFile::CreateMutable(absl::string_view path) {
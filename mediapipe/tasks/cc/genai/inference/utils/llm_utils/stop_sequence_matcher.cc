@@ -0,0 +1,91 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/stop_sequence_matcher.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace mediapipe::tasks::genai::llm_utils {
+
+StopSequenceMatcher::StopSequenceMatcher(
+    const std::vector<std::string>& stop_sequences) {
+  // Builds the trie of the stop sequences, with -1 for missing edges.
+  nodes_.emplace_back();
+  nodes_[0].next.fill(-1);
+  for (const std::string& stop_sequence : stop_sequences) {
+    int32_t node = 0;
+    for (unsigned char c : stop_sequence) {
+      if (nodes_[node].next[c] < 0) {
+        nodes_[node].next[c] = nodes_.size();
+        Node child;
+        child.next.fill(-1);
+        child.depth = nodes_[node].depth + 1;
+        nodes_.push_back(child);
+      }
+      node = nodes_[node].next[c];
+    }
+    nodes_[node].match_size = stop_sequence.size();
+  }
+
+  // Replaces the missing edges with the edges of the failure links, in
+  // breadth-first order so that the failure links are complete first.
+  std::vector<int32_t> fail(nodes_.size(), 0);
+  std::queue<int32_t> queue;
+  for (int32_t& next : nodes_[0].next) {
+    if (next < 0) {
+      next = 0;
+    } else {
+      queue.push(next);
+    }
+  }
+  while (!queue.empty()) {
+    const int32_t node = queue.front();
+    queue.pop();
+    const Node& failure = nodes_[fail[node]];
+    nodes_[node].match_size =
+        std::max(nodes_[node].match_size, failure.match_size);
+    for (int c = 0; c < 256; ++c) {
+      int32_t& next = nodes_[node].next[c];
+      if (next < 0) {
+        next = failure.next[c];
+      } else {
+        fail[next] = failure.next[c];
+        queue.push(next);
+      }
+    }
+  }
+}
+
+std::optional<size_t> StopSequenceMatcher::Append(absl::string_view text,
+                                                  StreamState& state) const {
+  for (unsigned char c : text) {
+    state.node = nodes_[state.node].next[c];
+    ++state.size;
+    if (const size_t match_size = nodes_[state.node].match_size;
+        match_size > 0) {
+      return state.size - match_size;
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace mediapipe::tasks::genai::llm_utils
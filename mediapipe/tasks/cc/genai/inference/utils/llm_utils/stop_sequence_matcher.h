@@ -0,0 +1,78 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_LLM_UTILS_STOP_SEQUENCE_MATCHER_H_
+#define MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_LLM_UTILS_STOP_SEQUENCE_MATCHER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace mediapipe::tasks::genai::llm_utils {
+
+// Finds stop sequences in streamed text, e.g. the output of an LLM decoded
+// token by token, with an Aho-Corasick automaton: each byte is matched against
+// all the stop sequences at once, whichever token boundaries they span.
+//
+// The matcher is immutable, and can be shared by several streams, each with
+// its own StreamState.
+class StopSequenceMatcher {
+ public:
+  // The matching state of a stream of text.
+  struct StreamState {
+    // The automaton node of the longest suffix of the stream which is a
+    // prefix of a stop sequence.
+    int32_t node = 0;
+    // The number of bytes of the stream.
+    size_t size = 0;
+  };
+
+  // Empty stop sequences are ignored.
+  explicit StopSequenceMatcher(const std::vector<std::string>& stop_sequences);
+
+  // Appends `text` to the stream of `state`. If a stop sequence ends in
+  // `text`, returns the offset in the stream at which the first one to end
+  // starts, and the rest of `text` is not appended.
+  std::optional<size_t> Append(absl::string_view text,
+                               StreamState& state) const;
+
+  // Returns the number of bytes at the end of the stream of `state` which
+  // could start a stop sequence, and should be held back until more text is
+  // appended.
+  size_t NumPendingBytes(const StreamState& state) const {
+    return nodes_[state.node].depth;
+  }
+
+ private:
+  struct Node {
+    // The next node for each byte, following failure links.
+    std::array<int32_t, 256> next;
+    // The length of the prefix of the stop sequences leading to this node.
+    size_t depth = 0;
+    // The length of the longest stop sequence which is a suffix of this
+    // prefix, or 0 if none.
+    size_t match_size = 0;
+  };
+
+  std::vector<Node> nodes_;
+};
+
+}  // namespace mediapipe::tasks::genai::llm_utils
+
+#endif  // MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_LLM_UTILS_STOP_SEQUENCE_MATCHER_H_
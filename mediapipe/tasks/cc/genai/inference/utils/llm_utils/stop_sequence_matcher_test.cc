@@ -0,0 +1,64 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/stop_sequence_matcher.h"
+
+#include <optional>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe::tasks::genai::llm_utils {
+namespace {
+
+TEST(StopSequenceMatcherTest, MatchesAcrossAppends) {
+  StopSequenceMatcher matcher({"<eos>", "<end_of_turn>"});
+  StopSequenceMatcher::StreamState state;
+
+  EXPECT_EQ(matcher.Append("Hello <e", state), std::nullopt);
+  EXPECT_EQ(matcher.NumPendingBytes(state), 2);
+  EXPECT_EQ(matcher.Append("nd_of_", state), std::nullopt);
+  EXPECT_EQ(matcher.NumPendingBytes(state), 8);
+  EXPECT_EQ(matcher.Append("turn> ignored", state), 6);
+}
+
+TEST(StopSequenceMatcherTest, ReturnsTheFirstSequenceToEnd) {
+  StopSequenceMatcher matcher({"abcd", "bc"});
+  StopSequenceMatcher::StreamState state;
+
+  EXPECT_EQ(matcher.Append("xab", state), std::nullopt);
+  EXPECT_EQ(matcher.Append("cd", state), 2);
+}
+
+TEST(StopSequenceMatcherTest, ReleasesBytesWhichCannotStartASequence) {
+  StopSequenceMatcher matcher({"<eos>"});
+  StopSequenceMatcher::StreamState state;
+
+  EXPECT_EQ(matcher.Append("a <eo", state), std::nullopt);
+  EXPECT_EQ(matcher.NumPendingBytes(state), 3);
+  EXPECT_EQ(matcher.Append("<", state), std::nullopt);
+  EXPECT_EQ(matcher.NumPendingBytes(state), 1);
+  EXPECT_EQ(matcher.Append("x", state), std::nullopt);
+  EXPECT_EQ(matcher.NumPendingBytes(state), 0);
+}
+
+TEST(StopSequenceMatcherTest, IgnoresEmptySequences) {
+  StopSequenceMatcher matcher({""});
+  StopSequenceMatcher::StreamState state;
+
+  EXPECT_EQ(matcher.Append("anything", state), std::nullopt);
+  EXPECT_EQ(matcher.NumPendingBytes(state), 0);
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::genai::llm_utils
@@ -0,0 +1,251 @@
+// Copyright 2025 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/tokenization_service.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/genai/inference/proto/prompt_template.pb.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/prompt_utils.h"
+#include "sentencepiece/src/sentencepiece_processor.h"  // from @com_google_sentencepiece
+
+namespace mediapipe::tasks::genai::llm_utils {
+namespace {
+
+// The UTF-8 encoding of the character of a byte. The characters are all below
+// U+0800, so they take at most 2 bytes.
+struct Utf8Char {
+  char bytes[2];
+  uint8_t size;
+};
+
+// Returns the code point of the character of each byte.
+std::array<int, 256> CreateBytesToCodePointTable() {
+  std::array<int, 256> code_points;
+  code_points.fill(-1);
+  // "!" - "~", "¡" - "¬" and "®" - "ÿ" map to themselves.
+  for (int b = 33; b <= 126; ++b) code_points[b] = b;
+  for (int b = 161; b <= 172; ++b) code_points[b] = b;
+  for (int b = 174; b < 256; ++b) code_points[b] = b;
+  // The other bytes map to U+0100 and up, in order.
+  int n = 0;
+  for (int b = 0; b < 256; ++b) {
+    if (code_points[b] < 0) code_points[b] = 256 + n++;
+  }
+  return code_points;
+}
+
+std::array<Utf8Char, 256> CreateBytesToUtf8Table() {
+  const std::array<int, 256> code_points = CreateBytesToCodePointTable();
+  std::array<Utf8Char, 256> table;
+  for (int b = 0; b < 256; ++b) {
+    const int code_point = code_points[b];
+    if (code_point < 0x80) {
+      table[b] = {{static_cast<char>(code_point), 0}, 1};
+    } else {
+      table[b] = {{static_cast<char>(0xC0 | (code_point >> 6)),
+                   static_cast<char>(0x80 | (code_point & 0x3F))},
+                  2};
+    }
+  }
+  return table;
+}
+
+// Returns the byte of each character below U+0800, or -1 for the characters
+// which are not in the table.
+std::array<int16_t, 0x800> CreateCodePointToBytesTable() {
+  std::array<int16_t, 0x800> table;
+  table.fill(-1);
+  const std::array<int, 256> code_points = CreateBytesToCodePointTable();
+  for (int b = 0; b < 256; ++b) table[code_points[b]] = b;
+  return table;
+}
+
+}  // namespace
+
+std::string MapBytesToUnicode(absl::string_view text) {
+  static const std::array<Utf8Char, 256> kTable = CreateBytesToUtf8Table();
+  std::string converted(2 * text.size(), '\0');
+  char* out = converted.data();
+  for (const uint8_t byte : text) {
+    const Utf8Char& c = kTable[byte];
+    out[0] = c.bytes[0];
+    out[1] = c.bytes[1];
+    out += c.size;
+  }
+  converted.resize(out - converted.data());
+  return converted;
+}
+
+std::string MapUnicodeToBytes(absl::string_view text) {
+  static const std::array<int16_t, 0x800> kTable =
+      CreateCodePointToBytesTable();
+  std::string converted;
+  converted.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    const uint8_t lead = text[i];
+    int code_point = -1;
+    if (lead < 0x80) {
+      code_point = lead;
+    } else if ((lead & 0xE0) == 0xC0 && i + 1 < text.size() &&
+               (static_cast<uint8_t>(text[i + 1]) & 0xC0) == 0x80) {
+      code_point = ((lead & 0x1F) << 6) | (text[i + 1] & 0x3F);
+    }
+    if (code_point >= 0 && kTable[code_point] >= 0) {
+      converted += static_cast<char>(kTable[code_point]);
+      i += code_point < 0x80 ? 0 : 1;
+    } else {
+      // Longer characters are copied a byte at a time, as their continuation
+      // bytes never start a character of the table.
+      converted += text[i];
+    }
+  }
+  return converted;
+}
+
+TokenizationService::TokenizationService(
+    const sentencepiece::SentencePieceProcessor* tokenizer,
+    const Options& options)
+    : tokenizer_(tokenizer), options_(options) {
+  if (options_.num_threads > 1) {
+    worker_pool_ = std::make_unique<ThreadPool>("tokenization_service",
+                                                options_.num_threads);
+    worker_pool_->StartWorkers();
+  }
+}
+
+absl::StatusOr<std::vector<int>> TokenizationService::Encode(
+    absl::string_view text) const {
+  std::vector<int> ids;
+  if (options_.map_bytes_to_unicode) {
+    MP_RETURN_IF_ERROR(tokenizer_->Encode(MapBytesToUnicode(text), &ids));
+  } else {
+    MP_RETURN_IF_ERROR(tokenizer_->Encode(text, &ids));
+  }
+  return ids;
+}
+
+absl::StatusOr<int> TokenizationService::CountTokens(
+    absl::string_view text) const {
+  MP_ASSIGN_OR_RETURN(const std::vector<int> ids, Encode(text));
+  return static_cast<int>(ids.size());
+}
+
+absl::StatusOr<std::vector<std::vector<int>>> TokenizationService::EncodeBatch(
+    absl::Span<const absl::string_view> texts) const {
+  std::vector<std::vector<int>> ids(texts.size());
+  MP_RETURN_IF_ERROR(ParallelFor(texts.size(), [&](size_t i) -> absl::Status {
+    MP_ASSIGN_OR_RETURN(ids[i], Encode(texts[i]));
+    return absl::OkStatus();
+  }));
+  return ids;
+}
+
+absl::StatusOr<std::vector<int>> TokenizationService::CountTokensBatch(
+    absl::Span<const absl::string_view> texts) const {
+  std::vector<int> counts(texts.size());
+  MP_RETURN_IF_ERROR(ParallelFor(texts.size(), [&](size_t i) -> absl::Status {
+    MP_ASSIGN_OR_RETURN(counts[i], CountTokens(texts[i]));
+    return absl::OkStatus();
+  }));
+  return counts;
+}
+
+absl::StatusOr<std::vector<int>> TokenizationService::EncodeTemplate(
+    absl::string_view text) {
+  {
+    absl::MutexLock lock(&cache_mutex_);
+    if (auto it = template_cache_.find(text); it != template_cache_.end()) {
+      return it->second;
+    }
+  }
+  // Encodes outside of the lock, so that other templates can be looked up
+  // meanwhile.
+  MP_ASSIGN_OR_RETURN(std::vector<int> ids, Encode(text));
+  absl::MutexLock lock(&cache_mutex_);
+  if (template_cache_.size() >= options_.max_cached_templates) {
+    template_cache_.clear();
+  }
+  template_cache_.emplace(text, ids);
+  return ids;
+}
+
+absl::StatusOr<std::vector<int>> TokenizationService::EncodePromptPrefix(
+    const odml::infra::proto::PromptTemplates& prompt_templates,
+    odml::infra::proto::PromptRole last_prompt_role,
+    odml::infra::proto::PromptRole current_prompt_role) {
+  MP_ASSIGN_OR_RETURN(
+      const std::string prompt_prefix,
+      GetPromptPrefixFromPromptTemplates(prompt_templates, last_prompt_role,
+                                         current_prompt_role));
+  return EncodeTemplate(prompt_prefix);
+}
+
+absl::Status TokenizationService::ParallelFor(
+    size_t size, const std::function<absl::Status(size_t)>& fn) const {
+  const size_t num_workers =
+      worker_pool_ == nullptr
+          ? 1
+          : std::min<size_t>(worker_pool_->num_threads(), size);
+  // Each worker takes the next index, as texts can have very different
+  // lengths.
+  std::atomic<size_t> next_index = 0;
+  std::vector<absl::Status> statuses(num_workers);
+  const auto run_worker = [&](size_t worker) {
+    for (size_t i = next_index++; i < size; i = next_index++) {
+      absl::Status status = fn(i);
+      if (!status.ok()) {
+        statuses[worker] = std::move(status);
+        // Stops the other workers.
+        next_index = size;
+        return;
+      }
+    }
+  };
+  if (num_workers <= 1) {
+    run_worker(0);
+  } else {
+    absl::BlockingCounter counter(num_workers);
+    for (size_t worker = 0; worker < num_workers; ++worker) {
+      worker_pool_->Schedule([&run_worker, &counter, worker] {
+        run_worker(worker);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  for (absl::Status& status : statuses) {
+    MP_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe::tasks::genai::llm_utils
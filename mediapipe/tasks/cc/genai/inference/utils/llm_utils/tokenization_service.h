@@ -0,0 +1,121 @@
+// Copyright 2025 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_LLM_UTILS_TOKENIZATION_SERVICE_H_
+#define MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_LLM_UTILS_TOKENIZATION_SERVICE_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/genai/inference/proto/prompt_template.pb.h"
+#include "sentencepiece/src/sentencepiece_processor.h"  // from @com_google_sentencepiece
+
+namespace mediapipe::tasks::genai::llm_utils {
+
+// Returns `text` with each byte replaced by the UTF-8 encoding of the
+// character which GPT-2 style byte-level vocabularies use for it: printable
+// bytes map to themselves, and the other ones to U+0100 and up. The encodings
+// are looked up in a table built once.
+std::string MapBytesToUnicode(absl::string_view text);
+
+// Inverse of MapBytesToUnicode(): returns `text` with each character of the
+// table replaced by its byte. Other characters are kept as is.
+std::string MapUnicodeToBytes(absl::string_view text);
+
+// Encodes text with a SentencePiece tokenizer, for the prompts of an LLM and
+// for bulk token counting.
+//
+// Batches are encoded on a pool of worker threads, and the ids of text which
+// repeats across prompts, e.g. the prefixes and suffixes of prompt templates,
+// are cached. The service is thread-safe.
+class TokenizationService {
+ public:
+  struct Options {
+    // Whether text is mapped with MapBytesToUnicode() before it is encoded,
+    // for tokenizers of GPT-2 style byte-level vocabularies.
+    bool map_bytes_to_unicode = false;
+    // The number of threads encoding batches. Batches are encoded on the
+    // calling thread if it is at most 1.
+    int num_threads = 4;
+    // The maximum number of cached template encodings. The cache is cleared
+    // when it is full.
+    size_t max_cached_templates = 256;
+  };
+
+  // `tokenizer` must outlive the service.
+  TokenizationService(const sentencepiece::SentencePieceProcessor* tokenizer,
+                      const Options& options);
+
+  // Returns the token ids of `text`.
+  absl::StatusOr<std::vector<int>> Encode(absl::string_view text) const;
+
+  // Returns the number of tokens of `text`.
+  absl::StatusOr<int> CountTokens(absl::string_view text) const;
+
+  // Returns the token ids of each of `texts`, encoded in parallel.
+  absl::StatusOr<std::vector<std::vector<int>>> EncodeBatch(
+      absl::Span<const absl::string_view> texts) const;
+
+  // Returns the number of tokens of each of `texts`, counted in parallel.
+  absl::StatusOr<std::vector<int>> CountTokensBatch(
+      absl::Span<const absl::string_view> texts) const;
+
+  // Returns the token ids of `text`, which is encoded once and then looked
+  // up in the cache. Meant for text repeating across prompts.
+  //
+  // SentencePiece starts each encoded text with a whitespace of its own, so
+  // the ids of a template followed by the ids of a text only match the ids of
+  // their concatenation if the text starts a new word, e.g. after a template
+  // ending with a newline. Otherwise they only approximate them, e.g. for
+  // token accounting.
+  absl::StatusOr<std::vector<int>> EncodeTemplate(absl::string_view text);
+
+  // Returns the token ids of the prompt prefix between prompts of
+  // `last_prompt_role` and `current_prompt_role`, as returned by
+  // GetPromptPrefixFromPromptTemplates() and encoded by EncodeTemplate().
+  absl::StatusOr<std::vector<int>> EncodePromptPrefix(
+      const odml::infra::proto::PromptTemplates& prompt_templates,
+      odml::infra::proto::PromptRole last_prompt_role,
+      odml::infra::proto::PromptRole current_prompt_role);
+
+ private:
+  // Runs `fn` for each index in [0, `size`) on the worker threads, and
+  // returns the first error.
+  absl::Status ParallelFor(size_t size,
+                           const std::function<absl::Status(size_t)>& fn) const;
+
+  const sentencepiece::SentencePieceProcessor* tokenizer_;
+  const Options options_;
+  // Null if batches are encoded on the calling thread.
+  std::unique_ptr<ThreadPool> worker_pool_;
+
+  absl::Mutex cache_mutex_;
+  absl::flat_hash_map<std::string, std::vector<int>> template_cache_
+      ABSL_GUARDED_BY(cache_mutex_);
+};
+
+}  // namespace mediapipe::tasks::genai::llm_utils
+
+#endif  // MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_LLM_UTILS_TOKENIZATION_SERVICE_H_
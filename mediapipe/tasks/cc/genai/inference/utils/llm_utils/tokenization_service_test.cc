@@ -0,0 +1,209 @@
+// Copyright 2025 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/tokenization_service.h"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/genai/inference/proto/prompt_template.pb.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/prompt_utils.h"
+#include "sentencepiece/src/sentencepiece_processor.h"  // from @com_google_sentencepiece
+
+namespace mediapipe::tasks::genai::llm_utils {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+constexpr absl::string_view kTokenizerModelPath =
+    "mediapipe/tasks/cc/text/custom_ops/sentencepiece/testdata/"
+    "sentencepiece.model";
+
+const std::vector<absl::string_view>& Texts() {
+  static const auto* texts = new std::vector<absl::string_view>{
+      "hello world",
+      "",
+      "the quick brown fox jumps over the lazy dog",
+      "a",
+      "tokenization of a somewhat longer prompt, with punctuation!",
+  };
+  return *texts;
+}
+
+class TokenizationServiceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    MP_ASSERT_OK(tokenizer_.Load(file::JoinPath("./", kTokenizerModelPath)));
+  }
+
+  sentencepiece::SentencePieceProcessor tokenizer_;
+};
+
+TEST(MapBytesToUnicodeTest, MapsBytesToCharacters) {
+  // Printable bytes map to themselves, " " to U+0120 and "\n" to U+010A.
+  EXPECT_EQ(MapBytesToUnicode("a b\n~"), "a\xc4\xa0" "b\xc4\x8a~");
+  // "ÿ" maps to itself, and the soft hyphen to U+0143.
+  EXPECT_EQ(MapBytesToUnicode("\xff\xad"), "\xc3\xbf\xc5\x83");
+  EXPECT_EQ(MapBytesToUnicode(""), "");
+}
+
+TEST(MapUnicodeToBytesTest, InvertsMapBytesToUnicode) {
+  std::string bytes(256, '\0');
+  for (int b = 0; b < 256; ++b) bytes[b] = static_cast<char>(b);
+  EXPECT_EQ(MapUnicodeToBytes(MapBytesToUnicode(bytes)), bytes);
+}
+
+TEST(MapUnicodeToBytesTest, KeepsOtherCharacters) {
+  // " " and "\n" are not in the table, unlike U+0120 and U+010A, and neither
+  // are U+0400 and "€".
+  EXPECT_EQ(MapUnicodeToBytes("a\xc4\xa0" "b \n\xd0\x80\xe2\x82\xac"),
+            "a b \n\xd0\x80\xe2\x82\xac");
+  EXPECT_EQ(MapUnicodeToBytes(""), "");
+}
+
+TEST_F(TokenizationServiceTest, EncodeMatchesTokenizer) {
+  TokenizationService service(&tokenizer_, {});
+
+  for (absl::string_view text : Texts()) {
+    std::vector<int> expected_ids;
+    MP_ASSERT_OK(tokenizer_.Encode(text, &expected_ids));
+    MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> ids, service.Encode(text));
+    EXPECT_THAT(ids, ElementsAreArray(expected_ids));
+    MP_ASSERT_OK_AND_ASSIGN(const int num_tokens, service.CountTokens(text));
+    EXPECT_EQ(num_tokens, expected_ids.size());
+  }
+}
+
+TEST_F(TokenizationServiceTest, EncodeMapsBytesToUnicode) {
+  TokenizationService service(&tokenizer_, {.map_bytes_to_unicode = true});
+
+  std::vector<int> expected_ids;
+  MP_ASSERT_OK(
+      tokenizer_.Encode(MapBytesToUnicode("hello world"), &expected_ids));
+  MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> ids,
+                          service.Encode("hello world"));
+  EXPECT_THAT(ids, ElementsAreArray(expected_ids));
+}
+
+TEST_F(TokenizationServiceTest, BatchesMatchSingleTexts) {
+  for (int num_threads : {1, 4}) {
+    TokenizationService service(&tokenizer_, {.num_threads = num_threads});
+
+    MP_ASSERT_OK_AND_ASSIGN(const std::vector<std::vector<int>> batch_ids,
+                            service.EncodeBatch(Texts()));
+    MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> batch_counts,
+                            service.CountTokensBatch(Texts()));
+
+    ASSERT_EQ(batch_ids.size(), Texts().size());
+    ASSERT_EQ(batch_counts.size(), Texts().size());
+    for (int i = 0; i < Texts().size(); ++i) {
+      MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> ids,
+                              service.Encode(Texts()[i]));
+      EXPECT_THAT(batch_ids[i], ElementsAreArray(ids));
+      EXPECT_EQ(batch_counts[i], ids.size());
+    }
+  }
+}
+
+TEST_F(TokenizationServiceTest, EncodeTemplateMatchesEncode) {
+  TokenizationService service(&tokenizer_, {.max_cached_templates = 1});
+
+  for (int i = 0; i < 2; ++i) {
+    for (absl::string_view text :
+         {"<start_of_turn>user\n", "<end_of_turn>\n"}) {
+      MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> expected_ids,
+                              service.Encode(text));
+      MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> ids,
+                              service.EncodeTemplate(text));
+      EXPECT_THAT(ids, ElementsAreArray(expected_ids));
+      // Looked up in the cache.
+      MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> cached_ids,
+                              service.EncodeTemplate(text));
+      EXPECT_THAT(cached_ids, ElementsAreArray(expected_ids));
+    }
+  }
+}
+
+TEST_F(TokenizationServiceTest, EncodeTemplateIsThreadSafe) {
+  TokenizationService service(&tokenizer_, {.max_cached_templates = 2});
+  MP_ASSERT_OK_AND_ASSIGN(const std::vector<std::vector<int>> expected_ids,
+                          service.EncodeBatch(Texts()));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 100; ++i) {
+        const size_t index = (t + i) % Texts().size();
+        MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> ids,
+                                service.EncodeTemplate(Texts()[index]));
+        EXPECT_THAT(ids, ElementsAreArray(expected_ids[index]));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+TEST_F(TokenizationServiceTest, TemplateIdsDifferInsideAWord) {
+  TokenizationService service(&tokenizer_, {});
+
+  // "Station" continues the last word of the template, but is encoded as a
+  // new word.
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<int> ids,
+                          service.EncodeTemplate("Kyoto"));
+  MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> text_ids,
+                          service.Encode("Station"));
+  ids.insert(ids.end(), text_ids.begin(), text_ids.end());
+  MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> prompt_ids,
+                          service.Encode("KyotoStation"));
+
+  EXPECT_THAT(ids, Not(ElementsAreArray(prompt_ids)));
+}
+
+TEST_F(TokenizationServiceTest, EncodePromptPrefix) {
+  TokenizationService service(&tokenizer_, {});
+  odml::infra::proto::PromptTemplates prompt_templates;
+  prompt_templates.mutable_user_template()->set_prompt_prefix(
+      "<start_of_turn>user\n");
+  prompt_templates.mutable_user_template()->set_prompt_suffix(
+      "<end_of_turn>\n");
+  prompt_templates.mutable_model_template()->set_prompt_prefix(
+      "<start_of_turn>model\n");
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      const std::string prompt_prefix,
+      GetPromptPrefixFromPromptTemplates(
+          prompt_templates, odml::infra::proto::PromptRole::PROMPT_ROLE_USER,
+          odml::infra::proto::PromptRole::PROMPT_ROLE_MODEL));
+  MP_ASSERT_OK_AND_ASSIGN(const std::vector<int> expected_ids,
+                          service.Encode(prompt_prefix));
+  MP_ASSERT_OK_AND_ASSIGN(
+      const std::vector<int> ids,
+      service.EncodePromptPrefix(
+          prompt_templates, odml::infra::proto::PromptRole::PROMPT_ROLE_USER,
+          odml::infra::proto::PromptRole::PROMPT_ROLE_MODEL));
+
+  EXPECT_THAT(ids, Not(IsEmpty()));
+  EXPECT_THAT(ids, ElementsAreArray(expected_ids));
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::genai::llm_utils
@@ -451,6 +451,23 @@ absl::StatusOr<std::shared_ptr<Tensor>> XnnGraphBuilder::Permute(
   return output;
 }
 
+absl::StatusOr<std::shared_ptr<Tensor>> XnnGraphBuilder::Convert(
+    std::shared_ptr<Tensor> input, xnn_datatype datatype) {
+  MP_ASSIGN_OR_RETURN(
+      auto output, IntermediateTensor(input->dims, datatype, "convert_output"));
+
+  build_steps_.push_back([input,
+                          output](xnn_subgraph_t subgraph) -> absl::Status {
+    RET_CHECK_EQ(
+        xnn_status_success,
+        xnn_define_unary(subgraph, xnn_unary_convert, /*params=*/nullptr,
+                         input->tensor_id(subgraph),
+                         output->tensor_id(subgraph), /*flags=*/0));
+    return absl::OkStatus();
+  });
+  return output;
+}
+
 absl::StatusOr<std::shared_ptr<Tensor>> XnnGraphBuilder::Slice(
     std::shared_ptr<Tensor> input, Tensor::DimsType starts,
     Tensor::DimsType ends) {
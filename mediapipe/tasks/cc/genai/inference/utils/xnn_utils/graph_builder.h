@@ -55,6 +55,11 @@ struct XnnWeightsCache {
   // runtime.
   virtual absl::Status Finalize();
 
+  // Hints that the weights whose names start with `name_prefix` are about to
+  // be used, so that lazily loaded weights can be read ahead. No-op by
+  // default.
+  virtual void Prefetch(absl::string_view name_prefix) {}
+
   xnn_weights_cache_t Get() const { return xnn_weights_cache; }
 
  protected:
@@ -170,6 +175,10 @@ class XnnGraphBuilder {
   absl::StatusOr<std::shared_ptr<Tensor>> Permute(std::shared_ptr<Tensor> input,
                                                   Tensor::DimsType permute);
 
+  // Converts the elements of `input` to `datatype`, e.g. from fp32 to fp16.
+  absl::StatusOr<std::shared_ptr<Tensor>> Convert(std::shared_ptr<Tensor> input,
+                                                  xnn_datatype datatype);
+
   // Create a slice of the input tensor. Both `starts` and `ends` must have
   // the same sizes as the number of dimensions in the input tensor. The
   // resulting slice includes data from `[start[i], end[i])` for each dimension.
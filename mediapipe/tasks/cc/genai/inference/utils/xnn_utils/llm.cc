@@ -19,10 +19,13 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <numeric>
 #include <optional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -33,6 +36,8 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -52,8 +57,103 @@ namespace {
 using FeedForwardWeights = LlmWeights::FeedForwardWeights;
 using SelfAttentionWeights = LlmWeights::SelfAttentionWeights;
 
+// Attention mask value of the tokens not to attend to.
+constexpr float kMaskedValue = 0.8 * std::numeric_limits<float>::lowest();
+
+// Returns a new tensor pointing to the buffer of `tensor`.
+std::shared_ptr<Tensor> ShareBuffer(std::shared_ptr<Tensor> tensor) {
+  auto result = std::make_shared<Tensor>(tensor->dims, tensor->datatype);
+  result->Borrow(std::move(tensor));
+  return result;
+}
+
+// Returns the size in bytes of `num_elements` elements of `cache`, an FP32 or
+// FP16 KV cache.
+size_t KVCacheBytes(const Tensor& cache, size_t num_elements) {
+  return num_elements * (cache.datatype == xnn_datatype_fp16 ? sizeof(uint16_t)
+                                                             : sizeof(float));
+}
+
+// Points `cache`, a [T, B, N, H] KV cache, to a new buffer of `num_rows`
+// holding a copy of its first `num_rows_to_copy` rows.
+absl::Status CopyKVCacheRows(Tensor& cache, size_t num_rows_to_copy,
+                             size_t num_rows) {
+  RET_CHECK(cache.datatype == xnn_datatype_fp32 ||
+            cache.datatype == xnn_datatype_fp16)
+      << cache.datatype;
+  RET_CHECK_LE(num_rows_to_copy, num_rows);
+  Tensor::DimsType dims = cache.dims;
+  const size_t row_size = std::accumulate(
+      dims.begin() + 1, dims.end(), size_t(1), std::multiplies<size_t>());
+  dims[0] = num_rows;
+  auto copy = std::make_shared<Tensor>(std::move(dims), cache.datatype);
+  copy->AllocateBufferIfNeeded();
+  if (num_rows_to_copy > 0) {
+    memcpy(copy->Data(), cache.Data(),
+           KVCacheBytes(cache, num_rows_to_copy * row_size));
+  }
+  cache.Borrow(std::move(copy));
+  return absl::OkStatus();
+}
+
+// Returns the number of rows the buffer of `cache`, a [T, B, N, H] KV cache,
+// can hold.
+size_t KVCacheRowCapacity(const Tensor& cache) {
+  const size_t row_size =
+      std::accumulate(cache.dims.begin() + 1, cache.dims.end(), size_t(1),
+                      std::multiplies<size_t>());
+  return cache.flat_data ? cache.elements_capacity / row_size : 0;
+}
+
+// Returns the number of rows to allocate for a KV cache of `num_rows` rows,
+// in place of a buffer of `capacity` rows. Paged caches at least double, so
+// that growing them token by token copies each row twice on average.
+size_t KVCacheRowsToAllocate(const LlmParams& llm_params, size_t num_rows,
+                             size_t capacity = 0) {
+  const size_t page_size = llm_params.kv_cache_page_size_T;
+  if (page_size == 0) return std::max(num_rows, llm_params.seq_size_T);
+  const size_t min_num_rows = std::max(num_rows, 2 * capacity);
+  return std::min((min_num_rows + page_size - 1) / page_size * page_size,
+                  std::max(num_rows, llm_params.seq_size_T));
+}
+
+// Moves the [T, B, N, H] KV cache rows [num_rows_to_drop, num_rows) of
+// `cache` to the front.
+absl::Status DropKVCacheRows(Tensor& cache, size_t num_rows_to_drop,
+                             size_t num_rows) {
+  RET_CHECK(cache.datatype == xnn_datatype_fp32 ||
+            cache.datatype == xnn_datatype_fp16)
+      << cache.datatype;
+  RET_CHECK_LE(num_rows_to_drop, num_rows);
+  const size_t row_size =
+      std::accumulate(cache.dims.begin() + 1, cache.dims.end(), size_t(1),
+                      std::multiplies<size_t>());
+  char* data = static_cast<char*>(cache.Data());
+  memmove(data, data + KVCacheBytes(cache, num_rows_to_drop * row_size),
+          KVCacheBytes(cache, (num_rows - num_rows_to_drop) * row_size));
+  return absl::OkStatus();
+}
+
+// Points `model_tensor` to the buffer of `context_tensor` and takes its dims,
+// without reallocating.
+void LoadKVCacheTensor(Tensor& model_tensor,
+                       std::shared_ptr<Tensor> context_tensor) {
+  // Resize() copies the current data when the capacity is exceeded, so shrink
+  // to a single row first: the current dims may not fit in the new buffer.
+  Tensor::DimsType dims = context_tensor->dims;
+  Tensor::DimsType single_row = dims;
+  single_row[0] = 1;
+  model_tensor.Resize(std::move(single_row));
+  model_tensor.Borrow(std::move(context_tensor));
+  model_tensor.Resize(std::move(dims));
+}
+
 }  // namespace
 
+Llm::~Llm() {
+  if (weights_prefetch_thread_.joinable()) weights_prefetch_thread_.join();
+}
+
 absl::StatusOr<std::unique_ptr<Llm>> Llm::CreateLlm(
     absl::string_view weights_folder, const LlmParams& llm_params,
     std::unique_ptr<xnn_utils::RuntimeConfigs> runtime_configs) {
@@ -78,8 +178,20 @@ absl::StatusOr<std::unique_ptr<Llm>> Llm::CreateLlm(
   RET_CHECK_EQ(llm_params.enable_kv_cache, llm_params.enable_dynamic_shape)
           .SetCode(absl::StatusCode::kInvalidArgument)
       << "Dynamic shape should be enabled together with KV cache.";
+  // ComputeLogits() returns the logits of up to draft_size_G + 1 tokens of
+  // the last chunk.
+  RET_CHECK(llm_params.prefill_chunk_size_T == 0 ||
+            llm_params.prefill_chunk_size_T > llm_params.draft_size_G)
+          .SetCode(absl::StatusCode::kInvalidArgument)
+      << "The prefill chunk size should be larger than the draft size.";
+  const absl::Time start_time = absl::Now();
   MP_ASSIGN_OR_RETURN(auto weights, weight_loader->LoadWeights());
-  return CreatePrefixDecodeLlm(std::move(weights), std::move(builder));
+  const absl::Time load_weights_end_time = absl::Now();
+  MP_ASSIGN_OR_RETURN(
+      auto llm, CreatePrefixDecodeLlm(std::move(weights), std::move(builder)));
+  llm->cold_start_stats_.load_weights = load_weights_end_time - start_time;
+  llm->cold_start_stats_.create_runtime = absl::Now() - load_weights_end_time;
+  return llm;
 }
 
 absl::StatusOr<std::unique_ptr<Llm>> Llm::CreatePrefixDecodeLlm(
@@ -98,6 +210,12 @@ absl::StatusOr<std::unique_ptr<Llm>> Llm::CreatePrefixDecodeLlm(
 
   auto& inter_layer = preprocess_out.first;
   auto& resource = preprocess_out.second;
+  if (llm_params.enable_batch_slots) {
+    RET_CHECK(llm_params.skip_absolute_positional_embeddings)
+        << "Batch slots require rotary positional embeddings.";
+    RET_CHECK_EQ(resource.atten_mask->dims.size(), 4)
+        << "Batch slots are not supported by this model.";
+  }
 
   std::vector<KVCache> kv_cache;
   std::shared_ptr<Tensor> logits_output;
@@ -122,6 +240,17 @@ absl::StatusOr<std::unique_ptr<Llm>> Llm::CreatePrefixDecodeLlm(
   logits_output->MarkOutput();
 
   MP_ASSIGN_OR_RETURN(auto graph, builder->Build());
+  if (llm_params.kv_cache_page_size_T > 0) {
+    // The graph is built for seq_size_T tokens, but paged KV caches only hold
+    // their first page so far.
+    for (auto& kv : kv_cache) {
+      for (Tensor* cache : {kv.k_cache.get(), kv.v_cache.get()}) {
+        Tensor::DimsType dims = cache->dims;
+        dims[0] = KVCacheRowCapacity(*cache);
+        cache->Resize(std::move(dims));
+      }
+    }
+  }
   auto llm = builder->GetLlm(std::move(*graph));
   llm->transformer_input_ = input;
   llm->logits_output_ = logits_output;
@@ -232,16 +361,23 @@ absl::StatusOr<Llm::Context> Llm::NewContext() const {
           [this]() {
             std::vector<KVCache> kvs;
             if (!llm_params_.enable_kv_cache) return kvs;
+            // With paging, new contexts start with a single page.
+            auto NewKVCache = [this](const Tensor& current_cache) {
+              Tensor::DimsType dims = current_cache.dims;
+              if (llm_params_.kv_cache_page_size_T > 0) {
+                dims[0] = KVCacheRowsToAllocate(llm_params_, 1);
+              }
+              auto cache =
+                  std::make_shared<Tensor>(dims, current_cache.datatype);
+              cache->LoadFromVec({}).IgnoreError();
+              return cache;
+            };
             kvs.resize(kv_cache().size());
             for (size_t i = 0; i < kvs.size(); ++i) {
               auto& kv = kvs[i];
               const auto& current_kv = kv_cache()[i];
-              kv.k_cache = std::make_shared<Tensor>(
-                  current_kv.k_cache->dims, current_kv.k_cache->datatype);
-              kv.k_cache->LoadFromVec({}).IgnoreError();
-              kv.v_cache = std::make_shared<Tensor>(
-                  current_kv.v_cache->dims, current_kv.v_cache->datatype);
-              kv.v_cache->LoadFromVec({}).IgnoreError();
+              kv.k_cache = NewKVCache(*current_kv.k_cache);
+              kv.v_cache = NewKVCache(*current_kv.v_cache);
               kv.k_slice = std::make_shared<Tensor>(
                   current_kv.k_slice->dims, current_kv.k_slice->datatype);
               kv.k_slice->Borrow(kv.k_cache->Slice(0, 0));
@@ -262,13 +398,23 @@ absl::Status Llm::LoadContext(
   // is: 1) let existing context point to the buffer from new context; 2) move
   // tensors from existing context to new context; 3) store new context.
   {
+    std::vector<KVCache> previous_kv_cache;
+    previous_kv_cache.reserve(kv_cache().size());
     for (size_t i = 0; i < kv_cache().size(); ++i) {
-      kv_cache()[i].k_cache->Borrow(context->kv_cache[i].k_cache);
-      kv_cache()[i].v_cache->Borrow(context->kv_cache[i].v_cache);
-      kv_cache()[i].k_slice->Borrow(context->kv_cache[i].k_slice);
-      kv_cache()[i].v_slice->Borrow(context->kv_cache[i].v_slice);
+      auto& kv = kv_cache()[i];
+      previous_kv_cache.push_back(KVCache{
+          .k_cache = ShareBuffer(kv.k_cache),
+          .v_cache = ShareBuffer(kv.v_cache),
+          .k_slice = ShareBuffer(kv.k_slice),
+          .v_slice = ShareBuffer(kv.v_slice),
+      });
+      LoadKVCacheTensor(*kv.k_cache, context->kv_cache[i].k_cache);
+      LoadKVCacheTensor(*kv.v_cache, context->kv_cache[i].v_cache);
+      kv.k_slice->Borrow(context->kv_cache[i].k_slice);
+      kv.v_slice->Borrow(context->kv_cache[i].v_slice);
     }
     context->kv_cache = std::move(kv_cache());
+    kv_cache() = std::move(previous_kv_cache);
   }
   context_ = std::move(context);
   return absl::OkStatus();
@@ -287,6 +433,63 @@ absl::Status Llm::ReduceContextPrevIds(std::shared_ptr<Context> context,
   return absl::OkStatus();
 }
 
+absl::StatusOr<std::shared_ptr<Llm::Context>> Llm::CloneContext(
+    std::shared_ptr<Context> context) {
+  RET_CHECK(context);
+  if (!context->kv_cache_share) {
+    context->kv_cache_share = std::make_shared<KVCacheShare>();
+  }
+  auto clone = std::make_shared<Context>(Context{
+      .batch_prev_ids = context->batch_prev_ids,
+      .batch_start_time_steps = context->batch_start_time_steps,
+      .position_offset = context->position_offset,
+      .kv_cache_share = context->kv_cache_share,
+  });
+  clone->kv_cache.reserve(context->kv_cache.size());
+  for (const auto& kv : context->kv_cache) {
+    clone->kv_cache.push_back(KVCache{
+        .k_cache = ShareBuffer(kv.k_cache),
+        .v_cache = ShareBuffer(kv.v_cache),
+        .k_slice = ShareBuffer(kv.k_slice),
+        .v_slice = ShareBuffer(kv.v_slice),
+    });
+  }
+  return clone;
+}
+
+absl::Status Llm::UnshareKVCache(size_t num_tokens, size_t max_num_tokens) {
+  auto& share = context_->kv_cache_share;
+  if (!share) return absl::OkStatus();
+  if (share.use_count() > 1) {
+    for (auto& kv : kv_cache()) {
+      for (Tensor* cache : {kv.k_cache.get(), kv.v_cache.get()}) {
+        // Keeps the capacity of the shared buffer, which the context would
+        // have grown into, so that the copy is not followed by another one
+        // as soon as the context grows past `max_num_tokens`.
+        MP_RETURN_IF_ERROR(CopyKVCacheRows(
+            *cache, num_tokens,
+            std::max(KVCacheRowCapacity(*cache),
+                     KVCacheRowsToAllocate(llm_params_, max_num_tokens))));
+      }
+    }
+  }
+  share.reset();
+  return absl::OkStatus();
+}
+
+absl::Status Llm::ReserveKVCache(size_t num_tokens_to_keep, size_t num_tokens) {
+  for (auto& kv : kv_cache()) {
+    for (Tensor* cache : {kv.k_cache.get(), kv.v_cache.get()}) {
+      const size_t capacity = KVCacheRowCapacity(*cache);
+      if (capacity >= num_tokens) continue;
+      MP_RETURN_IF_ERROR(CopyKVCacheRows(
+          *cache, num_tokens_to_keep,
+          KVCacheRowsToAllocate(llm_params_, num_tokens, capacity)));
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::Status Llm::GetInputTokenEmbeddings(
     absl::Span<const std::vector<int>> batch_input_ids) {
   for (size_t batch = 0; batch < llm_params_.batch_size_B; ++batch) {
@@ -313,12 +516,41 @@ absl::Status Llm::AddInputTokens(
     RET_CHECK_EQ(it->size(), input_seq_len);
   }
 
+  const size_t chunk_size = llm_params_.prefill_chunk_size_T;
+  if (chunk_size == 0 || input_seq_len <= chunk_size) {
+    return AddInputTokensChunk(batch_input_ids);
+  }
+  std::vector<std::vector<int>> batch_chunk_ids(batch_input_ids.size());
+  // The remainder runs first, so that the last chunk, whose logits are
+  // computed, is a full one.
+  size_t end = input_seq_len % chunk_size;
+  if (end == 0) end = chunk_size;
+  for (size_t start = 0; start < input_seq_len;
+       start = end, end += chunk_size) {
+    for (size_t batch = 0; batch < batch_input_ids.size(); ++batch) {
+      batch_chunk_ids[batch].assign(batch_input_ids[batch].begin() + start,
+                                    batch_input_ids[batch].begin() + end);
+    }
+    MP_RETURN_IF_ERROR(AddInputTokensChunk(batch_chunk_ids));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Llm::AddInputTokensChunk(
+    absl::Span<const std::vector<int>> batch_input_ids) {
+  const size_t input_seq_len = batch_input_ids.at(0).size();
   RET_CHECK(!batch_prev_ids().empty());
   const size_t current_seq_len = TotalTokenSize();
 
   // Let builder re-populate the values of these tensors.
-  MP_RETURN_IF_ERROR(builder_->InitAttentionMask(current_seq_len, input_seq_len,
-                                                 *atten_masks_));
+  if (llm_params_.enable_batch_slots) {
+    MP_RETURN_IF_ERROR(builder_->InitBatchSlotsAttentionMask(
+        current_seq_len, input_seq_len, context_->batch_start_time_steps,
+        *atten_masks_));
+  } else {
+    MP_RETURN_IF_ERROR(builder_->InitAttentionMask(
+        current_seq_len, input_seq_len, *atten_masks_));
+  }
   if (!llm_params_.skip_absolute_positional_embeddings) {
     // Initialize the positional embedding data.
     MP_RETURN_IF_ERROR(builder_->InitPosEmbedding(
@@ -326,8 +558,9 @@ absl::Status Llm::AddInputTokens(
   }
   if (segment_pos_) {
     // Initialize the segment pos.
-    MP_RETURN_IF_ERROR(builder_->InitSegmentPos(current_seq_len, input_seq_len,
-                                                *segment_pos_));
+    MP_RETURN_IF_ERROR(builder_->InitSegmentPos(
+        current_seq_len + context_->position_offset, input_seq_len,
+        *segment_pos_));
   }
   // Initialize the positions for FireLite.
   if (query_positions_) {
@@ -339,6 +572,12 @@ absl::Status Llm::AddInputTokens(
         current_seq_len, input_seq_len, *key_positions_));
   }
 
+  // Other contexts may still read the tokens about to be overwritten.
+  MP_RETURN_IF_ERROR(
+      UnshareKVCache(current_seq_len, current_seq_len + input_seq_len));
+  MP_RETURN_IF_ERROR(
+      ReserveKVCache(current_seq_len, current_seq_len + input_seq_len));
+
   if (llm_params_.enable_dynamic_shape) {
     MP_RETURN_IF_ERROR(ReshapeInputResource());
 
@@ -393,14 +632,83 @@ absl::Status Llm::AddInputTokens(
     const auto& input_ids = batch_input_ids[batch];
     prev_ids.insert(prev_ids.end(), input_ids.begin(), input_ids.end());
   }
+  if (cold_start_done_) {
+    MP_RETURN_IF_ERROR(SetupRuntime());
+    return Run();
+  }
+  const absl::Time start_time = absl::Now();
+  StartWeightsPrefetch();
   MP_RETURN_IF_ERROR(SetupRuntime());
-  return Run();
+  MP_RETURN_IF_ERROR(Run());
+  cold_start_stats_.first_prefill += absl::Now() - start_time;
+  return absl::OkStatus();
+}
+
+void Llm::StartWeightsPrefetch() {
+  if (!llm_params_.lazy_load_weights || !runtime_configs_->weights_cache ||
+      weights_prefetch_thread_.joinable()) {
+    return;
+  }
+  // Layers are read ahead one after the other, so that the first ones are
+  // paged in first.
+  std::vector<std::string> name_prefixes;
+  for (int i = 0; i < llm_params_.num_transformer_M; ++i) {
+    name_prefixes.push_back(
+        absl::StrCat(LlmWeightsLoader::kTransformerWeightPrefix, i, "."));
+  }
+  name_prefixes.push_back("params.lm.softmax.");
+  weights_prefetch_thread_ =
+      std::thread([weights_cache = runtime_configs_->weights_cache,
+                   name_prefixes = std::move(name_prefixes)]() {
+        for (const std::string& name_prefix : name_prefixes) {
+          weights_cache->Prefetch(name_prefix);
+        }
+      });
 }
 
 absl::Status Llm::SeekTimeStep(size_t time_step) {
   for (auto& prev_ids : batch_prev_ids()) {
     prev_ids.resize(time_step);
   }
+  if (time_step == 0) context_->position_offset = 0;
+  for (auto& start_time_step : context_->batch_start_time_steps) {
+    start_time_step = std::min(start_time_step, time_step);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Llm::RestartBatchSlots(absl::Span<const size_t> batch_indices) {
+  RET_CHECK(llm_params_.enable_batch_slots);
+  auto& start_time_steps = context_->batch_start_time_steps;
+  start_time_steps.resize(llm_params_.batch_size_B);
+  for (size_t batch : batch_indices) {
+    RET_CHECK_LT(batch, start_time_steps.size());
+    start_time_steps[batch] = TotalTokenSize();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Llm::DropLeadingTimeSteps(size_t num_time_steps) {
+  RET_CHECK(llm_params_.enable_batch_slots);
+  const size_t total_token_size = TotalTokenSize();
+  RET_CHECK_LE(num_time_steps, total_token_size);
+  if (num_time_steps == 0) return absl::OkStatus();
+
+  MP_RETURN_IF_ERROR(UnshareKVCache(total_token_size, total_token_size));
+  for (auto& kv : kv_cache()) {
+    MP_RETURN_IF_ERROR(
+        DropKVCacheRows(*kv.k_cache, num_time_steps, total_token_size));
+    MP_RETURN_IF_ERROR(
+        DropKVCacheRows(*kv.v_cache, num_time_steps, total_token_size));
+  }
+  for (auto& prev_ids : batch_prev_ids()) {
+    prev_ids.erase(prev_ids.begin(), prev_ids.begin() + num_time_steps);
+  }
+  for (auto& start_time_step : context_->batch_start_time_steps) {
+    start_time_step -= std::min(start_time_step, num_time_steps);
+  }
+  // The cached keys were rotated at their positions before the drop.
+  context_->position_offset += num_time_steps;
   return absl::OkStatus();
 }
 
@@ -431,6 +739,13 @@ absl::StatusOr<std::shared_ptr<Tensor>> Llm::ComputeLogits(
     size_t expected_seq_len) {
   const size_t decode_step = TotalTokenSize();
   VLOG(2) << "Decode step " << decode_step;
+  if (!cold_start_done_) {
+    cold_start_done_ = true;
+    ABSL_LOG(INFO) << "Time to first token: load weights "
+                   << cold_start_stats_.load_weights << ", create runtime "
+                   << cold_start_stats_.create_runtime << ", first prefill "
+                   << cold_start_stats_.first_prefill;
+  }
 
   if (decode_step + llm_params_.draft_size_G >= llm_params_.seq_size_T) {
     return absl::OutOfRangeError(
@@ -491,9 +806,16 @@ LlmBuilder::PreProcess(std::shared_ptr<Tensor> token_embedding,
   constexpr absl::string_view kPosEmbeddingSource = "pos_embedding";
   constexpr absl::string_view kSegmentPosSource = "segment_pos";
   if (is_prefix) {
-    MP_ASSIGN_OR_RETURN(resource.atten_mask, NewInput({llm_params_.seq_size_T,
-                                                       llm_params_.seq_size_T},
-                                                      kAttnMaskSource));
+    // Batch slots get their own mask, broadcast over the heads.
+    MP_ASSIGN_OR_RETURN(
+        resource.atten_mask,
+        NewInput(llm_params_.enable_batch_slots
+                     ? Tensor::DimsType{llm_params_.batch_size_B, 1,
+                                        llm_params_.seq_size_T,
+                                        llm_params_.seq_size_T}
+                     : Tensor::DimsType{llm_params_.seq_size_T,
+                                        llm_params_.seq_size_T},
+                 kAttnMaskSource));
     MP_ASSIGN_OR_RETURN(resource.segment_pos, NewInput({llm_params_.seq_size_T,
                                                         llm_params_.head_dim_H},
                                                        kSegmentPosSource));
@@ -750,11 +1072,36 @@ absl::Status LlmBuilder::InitAttentionMask(size_t current_seq_len,
   return absl::OkStatus();
 }
 
+absl::Status LlmBuilder::InitBatchSlotsAttentionMask(
+    size_t current_seq_len, size_t process_seq_len,
+    absl::Span<const size_t> batch_start_time_steps, Tensor& out_attn_mask) {
+  if (!attention_mask_values_.data()) {
+    MP_RETURN_IF_ERROR(InitAttentionMaskValues(process_seq_len));
+  }
+
+  const size_t seq_len = current_seq_len + process_seq_len;
+  out_attn_mask.Resize(Tensor::DimsType{llm_params_.batch_size_B, 1,
+                                        process_seq_len, seq_len});
+  float* values = out_attn_mask.DataAs<float>();
+  for (size_t batch = 0; batch < llm_params_.batch_size_B; ++batch) {
+    const size_t start_time_step = batch < batch_start_time_steps.size()
+                                       ? batch_start_time_steps[batch]
+                                       : 0;
+    RET_CHECK_LE(start_time_step, current_seq_len);
+    for (size_t r = 0; r < process_seq_len; ++r) {
+      const float* row = attention_mask_values_[r + current_seq_len].data();
+      std::copy(row, row + seq_len, values);
+      std::fill(values, values + start_time_step, kMaskedValue);
+      values += seq_len;
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::Status LlmBuilder::InitAttentionMaskValues(size_t process_seq_len) {
   const size_t seq_size = llm_params_.seq_size_T;
-  constexpr float neg_value = 0.8 * std::numeric_limits<float>::lowest();
   {
-    std::vector<float> values(seq_size * seq_size, neg_value);
+    std::vector<float> values(seq_size * seq_size, kMaskedValue);
     float* values_ptr = values.data();
     attention_mask_values_ = MakeMdSpan(values_ptr, seq_size, seq_size,
                                         [values = std::move(values)]() {});
@@ -862,8 +1209,14 @@ absl::Status LlmBuilder::InitSegmentPos(size_t current_seq_len,
   }
 
   out_segment_pos.Resize(Tensor::DimsType{process_seq_len, rope_size});
-  MP_RETURN_IF_ERROR(out_segment_pos.LoadFromBuffer(
-      segment_pos_values_[current_seq_len].data()));
+  if (current_seq_len + process_seq_len <= segment_pos_values_.shape()[0]) {
+    MP_RETURN_IF_ERROR(out_segment_pos.LoadFromBuffer(
+        segment_pos_values_[current_seq_len].data()));
+  } else {
+    // Positions past seq_size_T, see Llm::Context::position_offset.
+    MP_RETURN_IF_ERROR(out_segment_pos.LoadFromVec(FillXnnRoPEWeights(
+        process_seq_len, rope_size, /*start_position=*/current_seq_len)));
+  }
   return absl::OkStatus();
 }
 
@@ -987,49 +1340,69 @@ absl::Status LlmBuilder::BuildKVCache(std::shared_ptr<Tensor>& key,
     RET_CHECK_EQ(key->dims[0], llm_params_.batch_size_B);
     RET_CHECK_EQ(value->dims.size(), 4);
     RET_CHECK_EQ(value->dims[0], llm_params_.batch_size_B);
+    const xnn_datatype cache_datatype =
+        llm_params_.kv_cache_precision == LlmParams::KVCachePrecision::FP16
+            ? xnn_datatype_fp16
+            : key->datatype;
     // Permute has memory copy, in some cases we can use reshape to mimic
     // permute, to avoid memory copy.
     const bool quick_reshape = (key->dims[0] == 1 || key->dims[1] == 1);
-    // BSNH -> SBNH
-    if (quick_reshape) {
-      MP_ASSIGN_OR_RETURN(
-          resource.cache->k_slice,
-          Reshape(key, {key->dims[1], llm_params_.batch_size_B,
-                        llm_params_.num_kv_heads, llm_params_.head_dim_H}));
-      MP_ASSIGN_OR_RETURN(
-          resource.cache->v_slice,
-          Reshape(value, {value->dims[1], llm_params_.batch_size_B,
-                          llm_params_.num_kv_heads, llm_params_.head_dim_H}));
-    } else {
-      MP_ASSIGN_OR_RETURN(resource.cache->k_slice, Permute(key, {1, 0, 2, 3}));
-      MP_ASSIGN_OR_RETURN(resource.cache->v_slice,
-                          Permute(value, {1, 0, 2, 3}));
+    const Tensor::DimsType cache_dims = {key->dims[1], llm_params_.batch_size_B,
+                                         llm_params_.num_kv_heads,
+                                         llm_params_.head_dim_H};
+    // BSNH -> SBNH. The new keys and values are written in place into the KV
+    // cache, see Llm::AddInputTokens().
+    std::shared_ptr<Tensor> k_slice = key;
+    std::shared_ptr<Tensor> v_slice = value;
+    if (!quick_reshape) {
+      MP_ASSIGN_OR_RETURN(k_slice, Permute(key, {1, 0, 2, 3}));
+      MP_ASSIGN_OR_RETURN(v_slice, Permute(value, {1, 0, 2, 3}));
+    }
+    if (cache_datatype != key->datatype) {
+      MP_ASSIGN_OR_RETURN(k_slice, Convert(k_slice, cache_datatype));
+      MP_ASSIGN_OR_RETURN(v_slice, Convert(v_slice, cache_datatype));
     }
 
-    MP_ASSIGN_OR_RETURN(
-        resource.cache->k_cache,
-        NewInput(resource.cache->k_slice->dims, "prefix_k_cache"));
-    MP_ASSIGN_OR_RETURN(
-        resource.cache->v_cache,
-        NewInput(resource.cache->v_slice->dims, "prefix_v_cache"));
-    (resource.cache->k_slice = key)->MarkOutput().tag = "prefix_k_slice";
-    (resource.cache->v_slice = value)->MarkOutput().tag = "prefix_v_slice";
-
+    auto NewKVCacheInput = [this, &cache_dims, cache_datatype](
+                               absl::string_view tag)
+        -> absl::StatusOr<std::shared_ptr<Tensor>> {
+      auto cache = std::make_shared<Tensor>(cache_dims, cache_datatype);
+      // With paging, only the first page is allocated, see
+      // Llm::ReserveKVCache().
+      MP_RETURN_IF_ERROR(
+          CopyKVCacheRows(*cache, /*num_rows_to_copy=*/0,
+                          KVCacheRowsToAllocate(llm_params_, 1)));
+      cache->tag = tag;
+      MP_RETURN_IF_ERROR(MarkInput(cache));
+      return cache;
+    };
+    MP_ASSIGN_OR_RETURN(resource.cache->k_cache,
+                        NewKVCacheInput("prefix_k_cache"));
+    MP_ASSIGN_OR_RETURN(resource.cache->v_cache,
+                        NewKVCacheInput("prefix_v_cache"));
+    (resource.cache->k_slice = k_slice)->MarkOutput().tag = "prefix_k_slice";
+    (resource.cache->v_slice = v_slice)->MarkOutput().tag = "prefix_v_slice";
+
+    std::shared_ptr<Tensor> k_cache = resource.cache->k_cache;
+    std::shared_ptr<Tensor> v_cache = resource.cache->v_cache;
+    if (cache_datatype != key->datatype) {
+      MP_ASSIGN_OR_RETURN(k_cache, Convert(k_cache, key->datatype));
+      MP_ASSIGN_OR_RETURN(v_cache, Convert(v_cache, value->datatype));
+    }
     // TBNH -> BTNH
     if (quick_reshape) {
       MP_ASSIGN_OR_RETURN(
-          key, Reshape(resource.cache->k_cache,
-                       {llm_params_.batch_size_B, 0, llm_params_.num_kv_heads,
-                        llm_params_.head_dim_H}));
+          key, Reshape(k_cache, {llm_params_.batch_size_B, 0,
+                                 llm_params_.num_kv_heads,
+                                 llm_params_.head_dim_H}));
       MP_ASSIGN_OR_RETURN(
-          value, Reshape(resource.cache->v_cache,
-                         {llm_params_.batch_size_B, 0, llm_params_.num_kv_heads,
-                          llm_params_.head_dim_H}));
+          value, Reshape(v_cache, {llm_params_.batch_size_B, 0,
+                                   llm_params_.num_kv_heads,
+                                   llm_params_.head_dim_H}));
     } else {
       // TODO - b/329445989: Consolidate this permute with DotAttention.
-      MP_ASSIGN_OR_RETURN(key, Permute(resource.cache->k_cache, {1, 0, 2, 3}));
-      MP_ASSIGN_OR_RETURN(value,
-                          Permute(resource.cache->v_cache, {1, 0, 2, 3}));
+      MP_ASSIGN_OR_RETURN(key, Permute(k_cache, {1, 0, 2, 3}));
+      MP_ASSIGN_OR_RETURN(value, Permute(v_cache, {1, 0, 2, 3}));
     }
   }
 
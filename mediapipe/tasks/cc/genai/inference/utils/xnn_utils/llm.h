@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <memory>
 #include <optional>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -26,6 +27,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "mediapipe/tasks/cc/genai/inference/common/mdspan.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/graph_builder.h"
@@ -37,6 +39,7 @@ namespace mediapipe::tasks::genai {
 namespace xnn_utils {
 
 class LlmBuilder;
+class PrefixKVCache;
 
 // The base class that hosts the XNNPACK graph for large language models. It is
 // responsible for hosting the assets required to run the models, including
@@ -55,7 +58,7 @@ class Llm : protected xnn_utils::XnnGraph {
  public:
   explicit Llm(XnnGraph&& other) : XnnGraph(std::move(other)) {}
   Llm(Llm&&) = default;
-  ~Llm() override = default;
+  ~Llm() override;
 
   // Enable if enable_kv_cache
   struct KVCache {
@@ -65,12 +68,37 @@ class Llm : protected xnn_utils::XnnGraph {
     std::shared_ptr<Tensor> v_slice;
   };
 
+  // Held by all the contexts sharing the same KV cache buffers, see
+  // CloneContext().
+  struct KVCacheShare {};
+
+  // The phases of the time to first token of the first prompt.
+  struct ColdStartStats {
+    // LlmWeightsLoader::LoadWeights().
+    absl::Duration load_weights;
+    // Building the graph and creating the XNNPack runtime, which packs the
+    // weights missing from the weights cache.
+    absl::Duration create_runtime;
+    // The graph runs before the first ComputeLogits(), which page in the
+    // weights with LlmParams::lazy_load_weights.
+    absl::Duration first_prefill;
+  };
+
   // An aggregation of all the data that can represent the context of the
   // model.
   struct Context {
     // Previous ids, including prompt.
     std::vector<std::vector<int>> batch_prev_ids;
     std::vector<KVCache> kv_cache;
+    // The time step at which the sequence of each batch slot starts, see
+    // RestartBatchSlots(). Empty if they all start at 0.
+    std::vector<size_t> batch_start_time_steps;
+    // The number of time steps dropped by DropLeadingTimeSteps(). The token
+    // at time step t is rotated as at position t + position_offset, so that
+    // the keys in the KV cache keep the positions they were rotated at.
+    size_t position_offset = 0;
+    // Non-null if `kv_cache` buffers may be shared with other contexts.
+    std::shared_ptr<KVCacheShare> kv_cache_share;
   };
 
   // Reduce the number of previous ids to effectively undo the last
@@ -79,6 +107,14 @@ class Llm : protected xnn_utils::XnnGraph {
   static absl::Status ReduceContextPrevIds(std::shared_ptr<Context> context,
                                            std::vector<int> batch_num_tokens);
 
+  // Returns a context holding the same tokens as `context`, with a KV cache
+  // sharing the buffers of `context` copy-on-write. The first write to shared
+  // buffers copies the tokens to keep, where AddInputTokens() would otherwise
+  // have grown them, so branching several contexts from one prompt prefills
+  // it once.
+  static absl::StatusOr<std::shared_ptr<Context>> CloneContext(
+      std::shared_ptr<Context> context);
+
   // Create LLM graph using the `DefaultLlmWeightsLoader` to load model from
   // `weights_folder`.
   static absl::StatusOr<std::unique_ptr<Llm>> CreateLlm(
@@ -108,7 +144,10 @@ class Llm : protected xnn_utils::XnnGraph {
       std::unique_ptr<LlmWeightsLoader> weight_loader,
       std::unique_ptr<LlmBuilder> builder);
 
-  // Add input token ids at the end of all previously added tokens.
+  // Add input token ids at the end of all previously added tokens. Inputs
+  // longer than LlmParams::prefill_chunk_size_T are run in chunks, the first
+  // one taking the remainder, and only the logits of the last chunk are
+  // computed.
   virtual absl::Status AddInputTokens(
       absl::Span<const std::vector<int>> batch_input_ids);
 
@@ -117,6 +156,18 @@ class Llm : protected xnn_utils::XnnGraph {
   // the internal state.
   absl::Status SeekTimeStep(size_t time_step);
 
+  // Restarts the sequences of the batch slots in `batch_indices` at the
+  // current time step: the tokens added to them from now on don't attend to
+  // the previous ones. Requires LlmParams::enable_batch_slots.
+  absl::Status RestartBatchSlots(absl::Span<const size_t> batch_indices);
+
+  // Drops the first `num_time_steps` tokens of all the batch slots to make
+  // room in the KV cache, keeping the distances between the other tokens:
+  // the next tokens are rotated at positions following those of the cached
+  // keys, see Context::position_offset. Slots starting earlier lose the
+  // dropped tokens. Requires LlmParams::enable_batch_slots.
+  absl::Status DropLeadingTimeSteps(size_t num_time_steps);
+
   // Samples the logits from ComputeLogits() and returns the sampled ids. This
   // also AddInputTokens() with the sampled ids.
   ABSL_DEPRECATED("Use ComputeLogits() and do your own sampling.")
@@ -134,6 +185,9 @@ class Llm : protected xnn_utils::XnnGraph {
   // The size of all tokens, including prompt and generated tokens.
   virtual size_t TotalTokenSize() const;
 
+  // Complete once ComputeLogits() was called, which also logs them.
+  const ColdStartStats& cold_start_stats() const { return cold_start_stats_; }
+
   const LlmParams& GetLlmParams() { return llm_params_; }
 
   // Create a new context with internal model parameters. The variables in the
@@ -141,7 +195,8 @@ class Llm : protected xnn_utils::XnnGraph {
   virtual absl::StatusOr<Context> NewContext() const;
 
   // If `context` is non-null, and different from existing context_, load the
-  // context into the model.
+  // context into the model. The previous context keeps its KV cache, and can
+  // be loaded again later.
   virtual absl::Status LoadContext(
       /*absl_nullable - not yet supported*/ std::shared_ptr<Context> context);
 
@@ -149,6 +204,7 @@ class Llm : protected xnn_utils::XnnGraph {
   friend class PrefixDecodeLlm;
   friend class LlmTest;
   friend class LlmBuilder;
+  friend class PrefixKVCache;
 
   Llm() : XnnGraph(XnnSubgraphPtr{nullptr, nullptr}, nullptr) {}
 
@@ -182,6 +238,25 @@ class Llm : protected xnn_utils::XnnGraph {
 
   absl::Status ReshapeInputResource();
 
+  // Runs `batch_input_ids`, of the same non-zero length, in a single graph
+  // run, see AddInputTokens().
+  absl::Status AddInputTokensChunk(
+      absl::Span<const std::vector<int>> batch_input_ids);
+
+  // Gives the current context its own copy of the KV cache if the buffers are
+  // shared, keeping `num_tokens` tokens. The copy has the capacity of the
+  // shared buffers, and at least room for `max_num_tokens`.
+  absl::Status UnshareKVCache(size_t num_tokens, size_t max_num_tokens);
+
+  // Makes sure the KV cache buffers can hold `num_tokens` tokens, keeping the
+  // first `num_tokens_to_keep` tokens.
+  absl::Status ReserveKVCache(size_t num_tokens_to_keep, size_t num_tokens);
+
+  // With LlmParams::lazy_load_weights, starts reading ahead the packed weights
+  // of each layer in execution order on a background thread, so that the
+  // first prefill overlaps reading the weights of the next layers.
+  void StartWeightsPrefetch();
+
   LlmWeights weights_;
   LlmParams llm_params_;
 
@@ -200,6 +275,10 @@ class Llm : protected xnn_utils::XnnGraph {
   // Hold a shared_ptr to the LlmBuilder for initializing the input resources
   // as well as performing necessary wiring customizations at decoding time.
   std::shared_ptr<LlmBuilder> builder_;
+
+  ColdStartStats cold_start_stats_;
+  bool cold_start_done_ = false;
+  std::thread weights_prefetch_thread_;
 };
 
 // Responsible for creating the high-level components that are required by large
@@ -302,6 +381,12 @@ class LlmBuilder : protected XnnGraphBuilder {
                                          size_t process_seq_len,
                                          Tensor& out_attn_mask);
 
+  // Same as InitAttentionMask() for a [B, 1, T, T] `out_attn_mask`, where
+  // batch slot b also masks the tokens before `batch_start_time_steps[b]`.
+  absl::Status InitBatchSlotsAttentionMask(
+      size_t current_seq_len, size_t process_seq_len,
+      absl::Span<const size_t> batch_start_time_steps, Tensor& out_attn_mask);
+
   // Initialize the `out_pos_embedding` values given the condition that
   // `current_seq_len` number of tokens has been processed, and it's about to
   // process `process_seq_len` number of tokens.
@@ -0,0 +1,202 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_batch_scheduler.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_weights.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/sampling.h"
+
+namespace mediapipe::tasks::genai::xnn_utils {
+
+absl::StatusOr<std::unique_ptr<LlmBatchScheduler>> LlmBatchScheduler::Create(
+    Llm* llm, std::unique_ptr<Sampler> sampler) {
+  RET_CHECK(llm);
+  RET_CHECK(sampler);
+  RET_CHECK(llm->GetLlmParams().enable_batch_slots)
+      << "The LLM must be created with enable_batch_slots.";
+  return absl::WrapUnique(new LlmBatchScheduler(llm, std::move(sampler)));
+}
+
+LlmBatchScheduler::LlmBatchScheduler(Llm* llm,
+                                     std::unique_ptr<Sampler> sampler)
+    : llm_(llm),
+      sampler_(std::move(sampler)),
+      slots_(llm->GetLlmParams().batch_size_B) {}
+
+absl::Status LlmBatchScheduler::AddRequest(Request request) {
+  const LlmParams& params = llm_->GetLlmParams();
+  if (request.prompt_ids.empty()) {
+    return absl::InvalidArgumentError("The prompt must not be empty.");
+  }
+  if (request.prompt_ids.size() + params.draft_size_G >= params.seq_size_T) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The prompt has ", request.prompt_ids.size(),
+                     " tokens, but the maximum sequence length is ",
+                     params.seq_size_T));
+  }
+  if (request.max_num_output_tokens == 0 || !request.on_token) {
+    return absl::InvalidArgumentError(
+        "The request must generate tokens, and have an on_token callback.");
+  }
+  absl::MutexLock lock(&mutex_);
+  queue_.push_back(std::move(request));
+  return absl::OkStatus();
+}
+
+bool LlmBatchScheduler::HasRequests() const {
+  absl::MutexLock lock(&mutex_);
+  return num_active_slots_ > 0 || !queue_.empty();
+}
+
+absl::StatusOr<size_t> LlmBatchScheduler::Step() {
+  MP_RETURN_IF_ERROR(AdmitRequests());
+
+  // All the slots must process the same number of tokens.
+  std::optional<size_t> num_input_ids;
+  for (const Slot& slot : slots_) {
+    if (!slot.request) continue;
+    const size_t num_remaining_prompt_ids =
+        slot.request->prompt_ids.size() - slot.num_processed_prompt_ids;
+    const size_t num_slot_input_ids =
+        std::max<size_t>(num_remaining_prompt_ids, 1);
+    num_input_ids = std::min(num_input_ids.value_or(num_slot_input_ids),
+                             num_slot_input_ids);
+  }
+  if (!num_input_ids) return 0;
+  MP_RETURN_IF_ERROR(MakeRoom(*num_input_ids));
+
+  // Free slots process padding, which is ignored once a request is admitted.
+  std::vector<std::vector<int>> batch_input_ids(
+      slots_.size(), std::vector<int>(*num_input_ids, 0));
+  bool has_active_slots = false;
+  for (size_t batch = 0; batch < slots_.size(); ++batch) {
+    Slot& slot = slots_[batch];
+    if (!slot.request) continue;
+    has_active_slots = true;
+    const std::vector<int>& prompt_ids = slot.request->prompt_ids;
+    if (slot.num_processed_prompt_ids < prompt_ids.size()) {
+      const auto begin = prompt_ids.begin() + slot.num_processed_prompt_ids;
+      std::copy(begin, begin + *num_input_ids,
+                batch_input_ids[batch].begin());
+      slot.num_processed_prompt_ids += *num_input_ids;
+    } else {
+      batch_input_ids[batch][0] = slot.last_token_id;
+    }
+  }
+  if (!has_active_slots) return 0;
+
+  MP_RETURN_IF_ERROR(llm_->AddInputTokens(batch_input_ids));
+  MP_ASSIGN_OR_RETURN(auto logits, llm_->ComputeLogits());
+  MP_ASSIGN_OR_RETURN(auto batch_token_ids, sampler_->Sample(*logits));
+  RET_CHECK_EQ(batch_token_ids.size(), slots_.size());
+
+  size_t num_output_tokens = 0;
+  for (size_t batch = 0; batch < slots_.size(); ++batch) {
+    Slot& slot = slots_[batch];
+    if (!slot.request ||
+        slot.num_processed_prompt_ids < slot.request->prompt_ids.size()) {
+      continue;
+    }
+    slot.last_token_id = batch_token_ids[batch][0];
+    ++slot.num_output_tokens;
+    ++num_output_tokens;
+    if (!slot.request->on_token(slot.last_token_id) ||
+        slot.num_output_tokens >= slot.request->max_num_output_tokens) {
+      Retire(slot, absl::OkStatus());
+    }
+  }
+  return num_output_tokens;
+}
+
+absl::Status LlmBatchScheduler::AdmitRequests() {
+  std::vector<size_t> admitted_batch_indices;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (queue_.empty()) return absl::OkStatus();
+    // Start over when all the requests are done.
+    if (num_active_slots_ == 0) {
+      MP_RETURN_IF_ERROR(llm_->SeekTimeStep(0));
+    }
+    for (size_t batch = 0; batch < slots_.size() && !queue_.empty();
+         ++batch) {
+      if (slots_[batch].request) continue;
+      slots_[batch] = Slot{.request = std::move(queue_.front()),
+                           .start_time_step = llm_->TotalTokenSize()};
+      queue_.pop_front();
+      ++num_active_slots_;
+      admitted_batch_indices.push_back(batch);
+    }
+  }
+  if (admitted_batch_indices.empty()) return absl::OkStatus();
+  return llm_->RestartBatchSlots(admitted_batch_indices);
+}
+
+absl::Status LlmBatchScheduler::MakeRoom(size_t num_time_steps) {
+  const LlmParams& params = llm_->GetLlmParams();
+  // ComputeLogits() requires the sequence to stay shorter than seq_size_T.
+  while (llm_->TotalTokenSize() + num_time_steps + params.draft_size_G >=
+         params.seq_size_T) {
+    std::optional<size_t> first_start_time_step;
+    for (const Slot& slot : slots_) {
+      if (!slot.request) continue;
+      first_start_time_step =
+          std::min(first_start_time_step.value_or(slot.start_time_step),
+                   slot.start_time_step);
+    }
+    if (!first_start_time_step) return llm_->SeekTimeStep(0);
+
+    if (*first_start_time_step > 0) {
+      MP_RETURN_IF_ERROR(llm_->DropLeadingTimeSteps(*first_start_time_step));
+      for (Slot& slot : slots_) {
+        if (slot.request) slot.start_time_step -= *first_start_time_step;
+      }
+    } else {
+      // The oldest requests fill the whole KV cache.
+      for (Slot& slot : slots_) {
+        if (slot.request && slot.start_time_step == 0) {
+          Retire(slot, absl::OutOfRangeError(absl::StrCat(
+                           "Hit max sequence length ", params.seq_size_T)));
+        }
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+void LlmBatchScheduler::Retire(Slot& slot, absl::Status status) {
+  Request request = *std::move(slot.request);
+  slot.request.reset();
+  {
+    absl::MutexLock lock(&mutex_);
+    --num_active_slots_;
+  }
+  if (request.on_done) request.on_done(std::move(status));
+}
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
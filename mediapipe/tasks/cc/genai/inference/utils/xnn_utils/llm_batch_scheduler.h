@@ -0,0 +1,100 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_LLM_BATCH_SCHEDULER_H_
+#define MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_LLM_BATCH_SCHEDULER_H_
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/sampling.h"
+
+namespace mediapipe::tasks::genai::xnn_utils {
+
+// Generates the responses of concurrent requests with a single Llm, each
+// request running in a batch slot. Every step processes one token of all the
+// slots, so that they share the weight reads which bound the decoding speed.
+// Requests are admitted into free slots, and retired, between steps.
+//
+// Slots still processing their prompt take one prompt token per step, unless
+// all the active slots are doing so: prompts are then processed in chunks.
+class LlmBatchScheduler {
+ public:
+  struct Request {
+    // The prompt, including the start token.
+    std::vector<int> prompt_ids;
+    // The maximum number of tokens to generate.
+    size_t max_num_output_tokens = 0;
+    // Called with each generated token. Returning false ends the request.
+    std::function<bool(int)> on_token;
+    // Called once the request ends. The status is OUT_OF_RANGE if the request
+    // ran out of KV cache.
+    std::function<void(absl::Status)> on_done;
+  };
+
+  // `llm` must be created with LlmParams::enable_batch_slots, and outlive the
+  // scheduler. Its batch size is the maximum number of concurrent requests.
+  static absl::StatusOr<std::unique_ptr<LlmBatchScheduler>> Create(
+      Llm* llm, std::unique_ptr<Sampler> sampler);
+
+  // Queues `request`, to be admitted by the next steps. Thread-safe.
+  absl::Status AddRequest(Request request) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Admits queued requests into the free slots, and processes one token of
+  // each active slot. Returns the number of generated tokens.
+  absl::StatusOr<size_t> Step() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Whether there are active or queued requests. Thread-safe.
+  bool HasRequests() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Slot {
+    std::optional<Request> request;
+    // The time step at which the sequence of the request starts.
+    size_t start_time_step = 0;
+    size_t num_processed_prompt_ids = 0;
+    size_t num_output_tokens = 0;
+    int last_token_id = 0;
+  };
+
+  LlmBatchScheduler(Llm* llm, std::unique_ptr<Sampler> sampler);
+
+  absl::Status AdmitRequests() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Makes room in the KV cache for `num_time_steps` more tokens, dropping the
+  // tokens no request needs, and then retiring the longest requests.
+  absl::Status MakeRoom(size_t num_time_steps) ABSL_LOCKS_EXCLUDED(mutex_);
+  void Retire(Slot& slot, absl::Status status) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Llm* const llm_;
+  const std::unique_ptr<Sampler> sampler_;
+  // Only accessed by Step().
+  std::vector<Slot> slots_;
+
+  mutable absl::Mutex mutex_;
+  std::deque<Request> queue_ ABSL_GUARDED_BY(mutex_);
+  size_t num_active_slots_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
+
+#endif  // MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_LLM_BATCH_SCHEDULER_H_
@@ -15,6 +15,7 @@
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -29,22 +30,28 @@
 
 #include "absl/flags/flag.h"
 #include "absl/log/absl_log.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_macros.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/tasks/cc/genai/inference/proto/llm_params.pb.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/well_known_models.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/benchmark_weight_accessor.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/falcon.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/graph_builder.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_batch_scheduler.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_weights.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/phi.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/prefix_kv_cache.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/sampling.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/speculative_decoder.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/stablelm.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/xnn_tensor.h"
 #include "xnnpack.h"  // from @XNNPACK
@@ -75,6 +82,11 @@ namespace mediapipe::tasks::genai::xnn_utils {
 namespace {
 
 using ::benchmark::internal::Benchmark;
+using ::mediapipe::IsOkAndHolds;
+using ::mediapipe::StatusIs;
+using ::testing::FloatNear;
+using ::testing::HasSubstr;
+using ::testing::Pointwise;
 
 std::unique_ptr<RuntimeConfigs> GetRunTimeConfigsForBenchmark() {
   auto runtime_config = std::make_unique<RuntimeConfigs>();
@@ -85,13 +97,16 @@ std::unique_ptr<RuntimeConfigs> GetRunTimeConfigsForBenchmark() {
 }
 
 std::pair<std::unique_ptr<xnn_utils::LlmBuilder>, LlmParams>
-GetLlmBuilderAndParamsForBenchmark(size_t seq_size) {
+GetLlmBuilderAndParamsForBenchmark(
+    size_t seq_size,
+    const std::function<void(LlmParams&)>& update_params = nullptr) {
   auto model_type_string = absl::GetFlag(FLAGS_model_type);
   if (absl::EqualsIgnoreCase(model_type_string, "FALCON_RW_1B")) {
     LlmParams params =
         LlmParams::FromLLMParametersProto(llm_utils::GetFalconRW1BParams());
     params.seq_size_T = seq_size;
     params.enable_kv_cache = true;
+    if (update_params) update_params(params);
     return {std::make_unique<FalconRW1BBuilder>(
                 params, GetRunTimeConfigsForBenchmark()),
             params};
@@ -100,6 +115,7 @@ GetLlmBuilderAndParamsForBenchmark(size_t seq_size) {
         LlmParams::FromLLMParametersProto(llm_utils::GetGemma2BParams());
     params.seq_size_T = seq_size;
     params.enable_kv_cache = true;
+    if (update_params) update_params(params);
     return {
         std::make_unique<LlmBuilder>(params, GetRunTimeConfigsForBenchmark()),
         params};
@@ -108,6 +124,7 @@ GetLlmBuilderAndParamsForBenchmark(size_t seq_size) {
         LlmParams::FromLLMParametersProto(llm_utils::GetGemma2_2BParams());
     params.seq_size_T = seq_size;
     params.enable_kv_cache = true;
+    if (update_params) update_params(params);
     return {
         std::make_unique<LlmBuilder>(params, GetRunTimeConfigsForBenchmark()),
         params};
@@ -116,6 +133,7 @@ GetLlmBuilderAndParamsForBenchmark(size_t seq_size) {
         LlmParams::FromLLMParametersProto(llm_utils::GetGemma3_1BParams());
     params.seq_size_T = seq_size;
     params.enable_kv_cache = true;
+    if (update_params) update_params(params);
     return {
         std::make_unique<LlmBuilder>(params, GetRunTimeConfigsForBenchmark()),
         params};
@@ -124,6 +142,7 @@ GetLlmBuilderAndParamsForBenchmark(size_t seq_size) {
         LlmParams::FromLLMParametersProto(llm_utils::GetStablelm4E1T3BParams());
     params.seq_size_T = seq_size;
     params.enable_kv_cache = true;
+    if (update_params) update_params(params);
     return {std::make_unique<Stablelm4E1T3BBuilder>(
                 params, GetRunTimeConfigsForBenchmark()),
             params};
@@ -132,6 +151,7 @@ GetLlmBuilderAndParamsForBenchmark(size_t seq_size) {
         LlmParams::FromLLMParametersProto(llm_utils::GetPhi2Params());
     params.seq_size_T = seq_size;
     params.enable_kv_cache = true;
+    if (update_params) update_params(params);
     return {
         std::make_unique<Phi2Builder>(params, GetRunTimeConfigsForBenchmark()),
         params};
@@ -240,6 +260,305 @@ static void BenchmarLlmSizes(Benchmark* b) {
   }
 }
 
+// Returns a small Gemma model with random weights, which stores its KV cache
+// at `kv_cache_precision`.
+absl::StatusOr<std::unique_ptr<Llm>> CreateSmallGemmaLlm(
+    const std::function<void(LlmParams&)>& update_params) {
+  LlmParams params =
+      LlmParams::FromLLMParametersProto(llm_utils::GetGemma2BParams());
+  params.num_transformer_M = 2;
+  params.batch_size_B = 1;
+  params.seq_size_T = 64;
+  params.model_dim_D = 128;
+  params.hidden_dim_HD = 256;
+  params.head_dim_H = 32;
+  params.n_heads_N = 4;
+  params.num_kv_heads = 1;
+  params.voc_size_V = 256;
+  params.enable_kv_cache = true;
+  update_params(params);
+  auto weights_loader = std::make_unique<BenchmarkLlmWeightsLoader>(
+      params, xnn_datatype_fp32, /*seed=*/0);
+  return Llm::CreateLlm(
+      std::move(weights_loader),
+      std::make_unique<LlmBuilder>(params, std::make_unique<RuntimeConfigs>()));
+}
+
+// Returns the perplexity of `llm` on `token_ids`, decoded one at a time.
+absl::StatusOr<double> ComputePerplexity(Llm& llm,
+                                         const std::vector<int>& token_ids) {
+  MP_RETURN_IF_ERROR(llm.SeekTimeStep(0));
+  const size_t vocab_size = llm.GetLlmParams().voc_size_V;
+  double negative_log_likelihood = 0.0;
+  for (size_t i = 0; i + 1 < token_ids.size(); ++i) {
+    MP_RETURN_IF_ERROR(llm.AddInputTokens({{token_ids[i]}}));
+    MP_ASSIGN_OR_RETURN(auto logits, llm.ComputeLogits());
+    const float* data = logits->DataAs<float>();
+    const float max_logit = *std::max_element(data, data + vocab_size);
+    double sum = 0.0;
+    for (size_t v = 0; v < vocab_size; ++v) {
+      sum += std::exp(data[v] - max_logit);
+    }
+    negative_log_likelihood +=
+        max_logit + std::log(sum) - data[token_ids[i + 1]];
+  }
+  return std::exp(negative_log_likelihood / (token_ids.size() - 1));
+}
+
+TEST(LlmTest, Fp16KVCacheKeepsPerplexity) {
+  MP_ASSERT_OK_AND_ASSIGN(auto fp32_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {
+                            params.kv_cache_precision =
+                                LlmParams::KVCachePrecision::FP32;
+                          }));
+  MP_ASSERT_OK_AND_ASSIGN(auto fp16_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {
+                            params.kv_cache_precision =
+                                LlmParams::KVCachePrecision::FP16;
+                          }));
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<int> token_ids(48);
+  for (int& token_id : token_ids) token_id = distribution(rng);
+
+  MP_ASSERT_OK_AND_ASSIGN(double fp32_perplexity,
+                          ComputePerplexity(*fp32_llm, token_ids));
+  MP_ASSERT_OK_AND_ASSIGN(double fp16_perplexity,
+                          ComputePerplexity(*fp16_llm, token_ids));
+  EXPECT_NEAR(fp16_perplexity, fp32_perplexity, 1e-2 * fp32_perplexity);
+}
+
+TEST(LlmTest, PagedKVCacheMatchesUnpagedKVCache) {
+  MP_ASSERT_OK_AND_ASSIGN(auto llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  MP_ASSERT_OK_AND_ASSIGN(auto paged_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {
+                            params.kv_cache_page_size_T = 4;
+                          }));
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<int> token_ids(40);
+  for (int& token_id : token_ids) token_id = distribution(rng);
+
+  // The prompt fills two pages and a half, and decoding grows the cache past
+  // several more page boundaries.
+  const std::vector<int> prompt_ids(token_ids.begin(), token_ids.begin() + 10);
+  MP_ASSERT_OK(llm->AddInputTokens({prompt_ids}));
+  MP_ASSERT_OK(paged_llm->AddInputTokens({prompt_ids}));
+  for (size_t i = prompt_ids.size(); i < token_ids.size(); ++i) {
+    MP_ASSERT_OK_AND_ASSIGN(auto logits, llm->ComputeLogits());
+    const std::vector<float> expected_logits(logits->DataAs<float>(),
+                                             logits->DataAs<float>() + 256);
+    MP_ASSERT_OK_AND_ASSIGN(logits, paged_llm->ComputeLogits());
+    EXPECT_THAT(absl::MakeConstSpan(logits->DataAs<float>(), 256),
+                Pointwise(FloatNear(1e-4f), expected_logits))
+        << "at time step " << i;
+
+    MP_ASSERT_OK(llm->AddInputTokens({{token_ids[i]}}));
+    MP_ASSERT_OK(paged_llm->AddInputTokens({{token_ids[i]}}));
+  }
+}
+
+TEST(LlmTest, ChunkedPrefillMatchesUnchunkedPrefill) {
+  MP_ASSERT_OK_AND_ASSIGN(auto llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  MP_ASSERT_OK_AND_ASSIGN(auto chunked_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {
+                            params.prefill_chunk_size_T = 4;
+                          }));
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<int> prompt_ids(10);
+  for (int& token_id : prompt_ids) token_id = distribution(rng);
+
+  MP_ASSERT_OK(llm->AddInputTokens({prompt_ids}));
+  MP_ASSERT_OK(chunked_llm->AddInputTokens({prompt_ids}));
+  for (int token_id : {7, 42, 101}) {
+    MP_ASSERT_OK_AND_ASSIGN(auto logits, llm->ComputeLogits());
+    const std::vector<float> expected_logits(logits->DataAs<float>(),
+                                             logits->DataAs<float>() + 256);
+    MP_ASSERT_OK_AND_ASSIGN(logits, chunked_llm->ComputeLogits());
+    EXPECT_THAT(absl::MakeConstSpan(logits->DataAs<float>(), 256),
+                Pointwise(FloatNear(1e-4f), expected_logits));
+
+    MP_ASSERT_OK(llm->AddInputTokens({{token_id}}));
+    MP_ASSERT_OK(chunked_llm->AddInputTokens({{token_id}}));
+  }
+}
+
+TEST(LlmTest, ChunkedPrefillComputesTheLogitsOfTheDraftTokens) {
+  auto with_draft = [](LlmParams& params) { params.draft_size_G = 2; };
+  MP_ASSERT_OK_AND_ASSIGN(auto llm, CreateSmallGemmaLlm(with_draft));
+  MP_ASSERT_OK_AND_ASSIGN(auto chunked_llm,
+                          CreateSmallGemmaLlm([&](LlmParams& params) {
+                            with_draft(params);
+                            params.prefill_chunk_size_T = 3;
+                          }));
+  // Runs as chunks of 1, 3, 3 and 3 tokens.
+  const std::vector<int> prompt_ids = {2, 17, 42, 101, 7, 250, 33, 64, 5, 9};
+
+  MP_ASSERT_OK(llm->AddInputTokens({prompt_ids}));
+  MP_ASSERT_OK(chunked_llm->AddInputTokens({prompt_ids}));
+  MP_ASSERT_OK_AND_ASSIGN(auto logits, llm->ComputeLogits(3));
+  const std::vector<float> expected_logits(logits->DataAs<float>(),
+                                           logits->DataAs<float>() + 3 * 256);
+  MP_ASSERT_OK_AND_ASSIGN(logits, chunked_llm->ComputeLogits(3));
+  EXPECT_THAT(absl::MakeConstSpan(logits->DataAs<float>(), 3 * 256),
+              Pointwise(FloatNear(1e-4f), expected_logits));
+}
+
+TEST(LlmTest, CreateLlmFailsWithPrefillChunksNotLargerThanTheDraft) {
+  EXPECT_THAT(CreateSmallGemmaLlm([](LlmParams& params) {
+                params.draft_size_G = 2;
+                params.prefill_chunk_size_T = 2;
+              }).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("prefill chunk size")));
+}
+
+TEST(LlmTest, ColdStartStatsCoverTheFirstPrefill) {
+  MP_ASSERT_OK_AND_ASSIGN(auto llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  EXPECT_GT(llm->cold_start_stats().create_runtime, absl::ZeroDuration());
+
+  MP_ASSERT_OK(llm->AddInputTokens({{1, 2, 3, 4}}));
+  MP_ASSERT_OK(llm->ComputeLogits().status());
+  const absl::Duration first_prefill = llm->cold_start_stats().first_prefill;
+  EXPECT_GT(first_prefill, absl::ZeroDuration());
+
+  // Decoding is not part of the cold start.
+  MP_ASSERT_OK(llm->AddInputTokens({{5}}));
+  EXPECT_EQ(llm->cold_start_stats().first_prefill, first_prefill);
+}
+
+TEST(LlmTest, PrefixKVCacheSkipsPrefillOfSharedPrefix) {
+  MP_ASSERT_OK_AND_ASSIGN(auto llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  const PrefixKVCache cache(::testing::TempDir(), "small_gemma",
+                            /*min_prefix_size=*/8);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<int> prompt_ids(24);
+  for (int& token_id : prompt_ids) token_id = distribution(rng);
+  // Shares its first 16 tokens with `prompt_ids`.
+  std::vector<int> other_prompt_ids(prompt_ids.begin(),
+                                    prompt_ids.begin() + 16);
+  other_prompt_ids.insert(other_prompt_ids.end(), {1, 2, 3, 4, 5});
+
+  MP_ASSERT_OK(llm->SeekTimeStep(0));
+  MP_ASSERT_OK(llm->AddInputTokens({prompt_ids}));
+  MP_ASSERT_OK(cache.Save(*llm));
+  MP_ASSERT_OK(llm->SeekTimeStep(0));
+  MP_ASSERT_OK(llm->AddInputTokens({other_prompt_ids}));
+  MP_ASSERT_OK_AND_ASSIGN(auto logits, llm->ComputeLogits());
+  const std::vector<float> expected_logits(logits->DataAs<float>(),
+                                           logits->DataAs<float>() + 256);
+
+  // As if in a new process.
+  MP_ASSERT_OK_AND_ASSIGN(auto new_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  EXPECT_THAT(cache.Load(*new_llm, other_prompt_ids), IsOkAndHolds(16));
+  EXPECT_EQ(new_llm->TotalTokenSize(), 16);
+  MP_ASSERT_OK(new_llm->AddInputTokens({std::vector<int>(
+      other_prompt_ids.begin() + 16, other_prompt_ids.end())}));
+  MP_ASSERT_OK_AND_ASSIGN(logits, new_llm->ComputeLogits());
+  EXPECT_THAT(absl::MakeConstSpan(logits->DataAs<float>(), 256),
+              Pointwise(FloatNear(1e-4f), expected_logits));
+}
+
+// Returns the logits of the batch slot `batch` from `llm`.ComputeLogits().
+absl::StatusOr<std::vector<float>> ComputeSlotLogits(Llm& llm, size_t batch) {
+  MP_ASSIGN_OR_RETURN(auto logits, llm.ComputeLogits());
+  const size_t vocab_size = llm.GetLlmParams().voc_size_V;
+  const float* data = logits->DataAs<float>() + batch * vocab_size;
+  return std::vector<float>(data, data + vocab_size);
+}
+
+TEST(LlmTest, BatchSlotMatchesSingleSequenceAfterDroppingTimeSteps) {
+  MP_ASSERT_OK_AND_ASSIGN(auto llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  MP_ASSERT_OK_AND_ASSIGN(auto batch_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {
+                            params.batch_size_B = 2;
+                            params.enable_batch_slots = true;
+                          }));
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<int> filler_ids(16);
+  for (int& token_id : filler_ids) token_id = distribution(rng);
+  std::vector<int> prompt_ids(8);
+  for (int& token_id : prompt_ids) token_id = distribution(rng);
+  std::vector<int> other_ids(8);
+  for (int& token_id : other_ids) token_id = distribution(rng);
+  std::vector<int> decode_ids(8);
+  for (int& token_id : decode_ids) token_id = distribution(rng);
+
+  // Slot 1 starts its sequence after the filler tokens, while slot 0 keeps
+  // processing other tokens.
+  MP_ASSERT_OK(batch_llm->AddInputTokens({filler_ids, filler_ids}));
+  MP_ASSERT_OK(batch_llm->RestartBatchSlots({1}));
+  MP_ASSERT_OK(batch_llm->AddInputTokens({other_ids, prompt_ids}));
+  MP_ASSERT_OK(llm->AddInputTokens({prompt_ids}));
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<float> batch_logits,
+                          ComputeSlotLogits(*batch_llm, /*batch=*/1));
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<float> expected_logits,
+                          ComputeSlotLogits(*llm, /*batch=*/0));
+  EXPECT_THAT(batch_logits, Pointwise(FloatNear(1e-3f), expected_logits));
+
+  // Then the filler tokens are evicted from the KV cache.
+  MP_ASSERT_OK(batch_llm->DropLeadingTimeSteps(filler_ids.size()));
+  for (int token_id : decode_ids) {
+    MP_ASSERT_OK(batch_llm->AddInputTokens({{other_ids[0]}, {token_id}}));
+    MP_ASSERT_OK(llm->AddInputTokens({{token_id}}));
+    MP_ASSERT_OK_AND_ASSIGN(batch_logits,
+                            ComputeSlotLogits(*batch_llm, /*batch=*/1));
+    MP_ASSERT_OK_AND_ASSIGN(expected_logits,
+                            ComputeSlotLogits(*llm, /*batch=*/0));
+    // The rotary positions differ by the start time step of slot 1, which
+    // only changes the rounding.
+    EXPECT_THAT(batch_logits, Pointwise(FloatNear(1e-3f), expected_logits));
+  }
+}
+
+TEST(LlmTest, SpeculativeDecodingWithSameModelAcceptsAllDraftTokens) {
+  // With the same weights, the draft model predicts the target model exactly.
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto target_llm,
+      CreateSmallGemmaLlm([](LlmParams& params) { params.draft_size_G = 3; }));
+  MP_ASSERT_OK_AND_ASSIGN(auto draft_llm,
+                          CreateSmallGemmaLlm([](LlmParams& params) {}));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sampler, Sampler::Create(Sampler::Type::kGreedy, /*top_k=*/0,
+                                    /*top_p=*/0, /*temperature=*/0,
+                                    /*seed=*/0));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto decoder, SpeculativeDecoder::Create(
+                        target_llm.get(), draft_llm.get(), std::move(sampler)));
+  const std::vector<int> prompt_ids = {2, 17, 42, 101, 7, 250, 33, 64};
+
+  MP_ASSERT_OK(decoder->Start(prompt_ids));
+  std::vector<int> output_ids;
+  while (output_ids.size() < 16) {
+    MP_ASSERT_OK_AND_ASSIGN(std::vector<int> step_ids, decoder->Step());
+    output_ids.insert(output_ids.end(), step_ids.begin(), step_ids.end());
+  }
+
+  // Greedy decoding with the draft model alone.
+  MP_ASSERT_OK(draft_llm->SeekTimeStep(0));
+  MP_ASSERT_OK(draft_llm->AddInputTokens({prompt_ids}));
+  std::vector<int> expected_ids;
+  while (expected_ids.size() < output_ids.size()) {
+    MP_ASSERT_OK_AND_ASSIGN(auto logits, draft_llm->ComputeLogits());
+    const float* data = logits->DataAs<float>();
+    expected_ids.push_back(std::max_element(data, data + 256) - data);
+    MP_ASSERT_OK(draft_llm->AddInputTokens({{expected_ids.back()}}));
+  }
+  EXPECT_EQ(output_ids, expected_ids);
+  EXPECT_EQ(decoder->stats().num_output_tokens, output_ids.size());
+  EXPECT_DOUBLE_EQ(decoder->stats().AcceptanceRate(), 1.0);
+  EXPECT_GT(decoder->stats().TokensPerSecond(), 0.0);
+}
+
 }  // namespace
 
 // Benchmark LLM model specified by --model_type flag (QC8 weights, all
@@ -282,9 +601,155 @@ void BM_Llm_Mixed_INT48(benchmark::State& state) {
   RunBenchmark(*llm, state);
 }
 
+// Benchmark the decoding speed of the model specified by --model_type with QC8
+// weights, with a KV cache stored in FP32 if state.range(2) is zero and in
+// FP16 otherwise.
+void BM_Llm_KVCachePrecision(benchmark::State& state) {
+  auto [builder, params] = GetLlmBuilderAndParamsForBenchmark(
+      state.range(0), [&state](LlmParams& params) {
+        params.kv_cache_precision = state.range(2)
+                                        ? LlmParams::KVCachePrecision::FP16
+                                        : LlmParams::KVCachePrecision::FP32;
+      });
+  auto weights_loader =
+      std::make_unique<BenchmarkLlmWeightsLoader>(params, xnn_datatype_qcint8);
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto llm, Llm::CreateLlm(std::move(weights_loader), std::move(builder)));
+
+  RunBenchmarkDecode(*llm, state);
+}
+
+// Benchmark the time to first token of a prompt, given a context which holds
+// its first state.range(1) tokens. If state.range(2) is non-zero, the context
+// is cloned from the one which processed them, and only the remaining tokens
+// are prefilled. Otherwise the whole prompt is prefilled in a new context.
+void BM_Llm_FirstTokenLatency(benchmark::State& state) {
+  auto [builder, params] = GetLlmBuilderAndParamsForBenchmark(state.range(0));
+  auto weights_loader =
+      std::make_unique<BenchmarkLlmWeightsLoader>(params, xnn_datatype_qcint8);
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto llm, Llm::CreateLlm(std::move(weights_loader), std::move(builder)));
+
+  constexpr size_t kSuffixSize = 16;
+  const size_t batch_size = params.batch_size_B;
+  const size_t prefix_size = state.range(1);
+  const bool clone_context = state.range(2) != 0;
+  std::mt19937 rng;
+  auto i32rng = std::bind(
+      std::uniform_int_distribution<int>(0, params.voc_size_V - 1),
+      std::ref(rng));
+  std::vector<std::vector<int>> prefix_tokens(batch_size,
+                                              std::vector<int>(prefix_size));
+  std::vector<std::vector<int>> suffix_tokens(batch_size,
+                                              std::vector<int>(kSuffixSize));
+  std::vector<std::vector<int>> prompt_tokens(batch_size);
+  for (int i = 0; i < batch_size; ++i) {
+    std::generate(prefix_tokens[i].begin(), prefix_tokens[i].end(),
+                  std::ref(i32rng));
+    std::generate(suffix_tokens[i].begin(), suffix_tokens[i].end(),
+                  std::ref(i32rng));
+    prompt_tokens[i] = prefix_tokens[i];
+    prompt_tokens[i].insert(prompt_tokens[i].end(), suffix_tokens[i].begin(),
+                            suffix_tokens[i].end());
+  }
+
+  MP_ASSERT_OK_AND_ASSIGN(auto prefix_context, llm->NewContext());
+  auto shared_prefix_context =
+      std::make_shared<Llm::Context>(std::move(prefix_context));
+  MP_ASSERT_OK(llm->LoadContext(shared_prefix_context));
+  MP_ASSERT_OK(llm->AddInputTokens(prefix_tokens));
+
+  for (auto s : state) {
+    state.PauseTiming();
+    std::shared_ptr<Llm::Context> context;
+    if (clone_context) {
+      MP_ASSERT_OK_AND_ASSIGN(context,
+                              Llm::CloneContext(shared_prefix_context));
+    } else {
+      MP_ASSERT_OK_AND_ASSIGN(auto new_context, llm->NewContext());
+      context = std::make_shared<Llm::Context>(std::move(new_context));
+    }
+    MP_ASSERT_OK(llm->LoadContext(context));
+    state.ResumeTiming();
+    MP_ASSERT_OK(
+        llm->AddInputTokens(clone_context ? suffix_tokens : prompt_tokens));
+    MP_ASSERT_OK_AND_ASSIGN(auto logits, llm->ComputeLogits());
+    benchmark::DoNotOptimize(logits);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Benchmark the decoding throughput of LlmBatchScheduler serving state.range(1)
+// concurrent requests, with as many batch slots. Twice as many requests are
+// sent, so that requests are admitted and retired while others are decoding.
+void BM_Llm_BatchScheduler(benchmark::State& state) {
+  const size_t num_slots = state.range(1);
+  auto [builder, params] = GetLlmBuilderAndParamsForBenchmark(
+      state.range(0), [num_slots](LlmParams& params) {
+        params.batch_size_B = num_slots;
+        params.enable_batch_slots = true;
+      });
+  auto weights_loader =
+      std::make_unique<BenchmarkLlmWeightsLoader>(params, xnn_datatype_qcint8);
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto llm, Llm::CreateLlm(std::move(weights_loader), std::move(builder)));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sampler,
+      Sampler::Create(Sampler::Type::kGreedy, /*top_k=*/0, /*top_p=*/0.0f,
+                      /*temperature=*/1.0f, /*seed=*/0));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto scheduler, LlmBatchScheduler::Create(llm.get(), std::move(sampler)));
+
+  constexpr size_t kPromptSize = 64;
+  constexpr size_t kNumOutputTokens = 64;
+  std::mt19937 rng;
+  auto i32rng = std::bind(
+      std::uniform_int_distribution<int>(0, params.voc_size_V - 1),
+      std::ref(rng));
+  std::vector<std::vector<int>> prompts(2 * num_slots,
+                                        std::vector<int>(kPromptSize));
+  for (auto& prompt : prompts) {
+    std::generate(prompt.begin(), prompt.end(), std::ref(i32rng));
+  }
+
+  int64_t num_token_processed = 0;
+  for (auto s : state) {
+    for (const auto& prompt : prompts) {
+      MP_ASSERT_OK(scheduler->AddRequest(
+          {.prompt_ids = prompt,
+           .max_num_output_tokens = kNumOutputTokens,
+           .on_token = [](int token_id) { return true; }}));
+    }
+    while (scheduler->HasRequests()) {
+      MP_ASSERT_OK_AND_ASSIGN(size_t num_output_tokens, scheduler->Step());
+      num_token_processed += num_output_tokens;
+    }
+  }
+  state.SetItemsProcessed(num_token_processed);
+}
+
 // Run benchmark for three different cache sizes: 64, 512, 1024.
 BENCHMARK(BM_Llm_QCINT8)->UseRealTime()->Apply(BenchmarLlmSizes);
 BENCHMARK(BM_Llm_QCINT4)->UseRealTime()->Apply(BenchmarLlmSizes);
 BENCHMARK(BM_Llm_Mixed_INT48)->UseRealTime()->Apply(BenchmarLlmSizes);
+BENCHMARK(BM_Llm_KVCachePrecision)
+    ->UseRealTime()
+    ->Args({/*sequence_length=*/1024, /*prompt_size=*/128, /*fp16=*/0})
+    ->Args({/*sequence_length=*/1024, /*prompt_size=*/128, /*fp16=*/1})
+    ->Args({/*sequence_length=*/4096, /*prompt_size=*/2048, /*fp16=*/0})
+    ->Args({/*sequence_length=*/4096, /*prompt_size=*/2048, /*fp16=*/1});
+BENCHMARK(BM_Llm_BatchScheduler)
+    ->UseRealTime()
+    ->Args({/*sequence_length=*/512, /*num_slots=*/1})
+    ->Args({/*sequence_length=*/512, /*num_slots=*/2})
+    ->Args({/*sequence_length=*/512, /*num_slots=*/4})
+    ->Args({/*sequence_length=*/512, /*num_slots=*/8});
+BENCHMARK(BM_Llm_FirstTokenLatency)
+    ->UseRealTime()
+    ->Args({/*sequence_length=*/512, /*prefix_size=*/256, /*clone=*/0})
+    ->Args({/*sequence_length=*/512, /*prefix_size=*/256, /*clone=*/1});
 
 }  // namespace mediapipe::tasks::genai::xnn_utils
@@ -522,8 +522,8 @@ DefaultLlmWeightsLoader::DefaultLlmWeightsLoader(
     : LlmWeightsLoader(nullptr, params) {
   // Prefer to load from the scoped cache file if provided.
   if (scoped_cache_file && scoped_cache_file->IsValid()) {
-    xnn_weights_cache_ =
-        std::make_shared<PackWeightsCache>(std::move(scoped_cache_file));
+    xnn_weights_cache_ = std::make_shared<PackWeightsCache>(
+        std::move(scoped_cache_file), params.lazy_load_weights);
   } else {
     xnn_weights_cache_ = std::make_shared<PackWeightsCache>(
         params.cache_dir.empty()
@@ -531,7 +531,8 @@ DefaultLlmWeightsLoader::DefaultLlmWeightsLoader(
             : mediapipe::file::JoinPath(
                   params.cache_dir,
                   absl::StrCat(mediapipe::file::Basename(weight_path),
-                               ".cache")));
+                               ".cache")),
+        params.lazy_load_weights);
   }
   ABSL_CHECK_OK(xnn_weights_cache_->Initialize());
   if (flat_buffer_model != nullptr) {
@@ -548,7 +549,8 @@ DefaultLlmWeightsLoader::DefaultLlmWeightsLoader(
         << "loading the weight cache from a scoped file is currently only "
            "supported if the model is passed as a FlatBufferModel";
     weight_accessor_ = std::make_unique<WeightAccessorCompositeWithCache>(
-        std::make_shared<TfLiteWeightAccessor>(weight_path),
+        std::make_shared<TfLiteWeightAccessor>(weight_path,
+                                               params.lazy_load_weights),
         xnn_weights_cache_.get());
   }
 }
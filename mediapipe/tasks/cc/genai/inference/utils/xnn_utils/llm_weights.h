@@ -147,9 +147,41 @@ struct LlmParams {
   bool enable_dynamic_shape ABSL_DEPRECATED(
       "This is always enabled if enable_kv_cache is true.") = false;
 
+  // If true, the attention mask has a batch dimension, so that each batch
+  // slot can restart its sequence at any time step, see
+  // Llm::RestartBatchSlots(). This requires rotary positional embeddings,
+  // with which attention only depends on the distance between tokens.
+  bool enable_batch_slots = false;
+
+  // If non-zero, the KV cache buffers grow with the sequence, doubling in
+  // whole pages of this many tokens, instead of being allocated for
+  // seq_size_T tokens up front.
+  size_t kv_cache_page_size_T = 0;
+
+  // If non-zero, Llm::AddInputTokens() runs longer inputs in chunks of this
+  // many tokens, which bounds the activation memory of long prompts. Must be
+  // larger than draft_size_G, so that the last chunk holds the tokens whose
+  // logits are computed.
+  size_t prefill_chunk_size_T = 0;
+
+  // The precision at which the KV cache is stored. Attention still runs at
+  // the activation precision: the cache is converted as it is read, which
+  // halves the memory read by each decoding step with FP16.
+  enum class KVCachePrecision {
+    FP32 = 0,
+    FP16 = 1,
+  } kv_cache_precision = KVCachePrecision::FP32;
+
   // If provided, the runtime will prepare cache at the provided directory.
   // Otherwise, cache will be prepared besides the original model.
   std::string cache_dir;
+
+  // If true, DefaultLlmWeightsLoader maps the model and an existing packed
+  // weights cache without reading them ahead, so that weights are only paged
+  // in once used, and Llm reads ahead the packed weights of each layer in
+  // execution order during the first prefill. Requires passing the loader's
+  // weights_cache() to the runtime, see RuntimeConfigs::weights_cache.
+  bool lazy_load_weights = false;
 };
 
 struct RMSNormWeights {
@@ -272,6 +304,13 @@ class DefaultLlmWeightsLoader : public LlmWeightsLoader {
       std::shared_ptr<tflite::FlatBufferModel> flat_buffer_model = nullptr,
       std::shared_ptr<ScopedFile> scoped_cache_file = nullptr);
 
+  // The packed weights cache, to share with the XNNPack runtime through
+  // RuntimeConfigs::weights_cache, and to finalize once the runtime is
+  // created.
+  std::shared_ptr<PackWeightsCache> weights_cache() const {
+    return xnn_weights_cache_;
+  }
+
  private:
   std::shared_ptr<PackWeightsCache> xnn_weights_cache_;
 };
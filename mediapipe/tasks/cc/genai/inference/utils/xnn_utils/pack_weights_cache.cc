@@ -97,20 +97,21 @@ absl::Status AppendToFileDescriptor(const ScopedFile& scoped_file,
 
 }  // namespace
 
-PackWeightsCache::PackWeightsCache(absl::string_view cache_path)
-    : cache_file_(std::string(cache_path)) {
+PackWeightsCache::PackWeightsCache(absl::string_view cache_path, bool lazy)
+    : cache_file_(std::string(cache_path)), lazy_(lazy) {
   xnn_weights_cache = &cache_provider_;
 }
 
-PackWeightsCache::PackWeightsCache(std::shared_ptr<ScopedFile> scoped_file)
-    : cache_file_(std::move(scoped_file)) {
+PackWeightsCache::PackWeightsCache(std::shared_ptr<ScopedFile> scoped_file,
+                                   bool lazy)
+    : cache_file_(std::move(scoped_file)), lazy_(lazy) {
   xnn_weights_cache = &cache_provider_;
 }
 
 PackWeightsCache::~PackWeightsCache() { xnn_weights_cache = nullptr; }
 
 absl::Status PackWeightsCache::Initialize() {
-  mmap_file_ = GetMmapFile();
+  mmap_file_ = GetMmapFile(lazy_);
   if (mmap_file_) {
     MP_RETURN_IF_ERROR(InitializeFromCache(mmap_file_));
   } else {
@@ -189,6 +190,20 @@ absl::Status PackWeightsCache::Finalize() {
   return InitializeFromCache(mmap_file_);
 }
 
+void PackWeightsCache::Prefetch(absl::string_view name_prefix) {
+  if (!is_finalized_ || builder_ || !mmap_file_) return;
+  const uint32_t fb_size = named_buffers_->flatbuffer_size();
+  for (const auto& [name, offset_size] : name_to_offset_size_) {
+    if (!absl::StartsWith(name, name_prefix)) continue;
+    if (auto s = mmap_file_->Prefetch(fb_size + offset_size.first,
+                                      offset_size.second);
+        !s.ok()) {
+      ABSL_LOG(WARNING) << "Failed to prefetch " << name << ": " << s;
+      return;
+    }
+  }
+}
+
 bool PackWeightsCache::ShouldDoubleCheckCompatibility(
     const xnn_weights_cache_look_up_key* cache_key) {
   if (builder_) return false;
@@ -208,18 +223,23 @@ bool PackWeightsCache::ShouldDoubleCheckCompatibility(
   return false;
 }
 
-std::shared_ptr<MemoryMappedFile> PackWeightsCache::GetMmapFile() {
+std::shared_ptr<MemoryMappedFile> PackWeightsCache::GetMmapFile(bool lazy) {
   return std::visit(
       absl::Overload(
-          [](const std::string& filename) {
-            return mediapipe::file::Exists(filename).ok()
-                       ? MemoryMappedFile::CreateMutable(filename).value_or(
-                             nullptr)
-                       : nullptr;
+          [lazy](const std::string& filename) {
+            if (!mediapipe::file::Exists(filename).ok()) {
+              return std::shared_ptr<MemoryMappedFile>();
+            }
+            return std::shared_ptr<MemoryMappedFile>(
+                (lazy ? MemoryMappedFile::CreateLazy(filename)
+                      : MemoryMappedFile::CreateMutable(filename))
+                    .value_or(nullptr));
           },
-          [](const std::shared_ptr<ScopedFile>& scoped_file) {
-            return MemoryMappedFile::CreateMutable(scoped_file->file())
-                .value_or(nullptr);
+          [lazy](const std::shared_ptr<ScopedFile>& scoped_file) {
+            return std::shared_ptr<MemoryMappedFile>(
+                (lazy ? MemoryMappedFile::CreateLazy(scoped_file->file())
+                      : MemoryMappedFile::CreateMutable(scoped_file->file()))
+                    .value_or(nullptr));
           }),
       cache_file_);
 }
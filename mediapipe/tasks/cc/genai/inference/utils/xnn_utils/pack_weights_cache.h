@@ -48,13 +48,16 @@ class PackWeightsCache : public XnnWeightsCache {
  public:
   // File path to the weight cache. If the file exists, the
   // cache will be loaded from the file. Otherwise, the weights cache will be
-  // built and written to the file.
-  explicit PackWeightsCache(absl::string_view cache_path);
+  // built and written to the file. If `lazy`, a cache loaded from the file is
+  // mapped read-only, and its weights are only read once used or prefetched
+  // with Prefetch().
+  explicit PackWeightsCache(absl::string_view cache_path, bool lazy = false);
   // File descriptor to write cache data to or read cache data from. Must be
   // writable.
   // TODO: b/401011041 - Consider supporting read-only file descriptors if the
   // cache has already been built.
-  explicit PackWeightsCache(std::shared_ptr<ScopedFile> scoped_file);
+  explicit PackWeightsCache(std::shared_ptr<ScopedFile> scoped_file,
+                            bool lazy = false);
   ~PackWeightsCache() override;
 
   // Initializes the cache. The default implementation loads the serialized
@@ -70,6 +73,10 @@ class PackWeightsCache : public XnnWeightsCache {
   // more cache would be added. It also serializes the cache to `cache_path`.
   absl::Status Finalize() override;
 
+  // Starts reading the packed weights whose names start with `name_prefix`
+  // from the cache file. Thread-safe once the cache is finalized.
+  void Prefetch(absl::string_view name_prefix) override;
+
  protected:
   // Returns true if the key is found, but we still report cache miss to XNNPack
   // and trigger packing. Later we double check if the packed weight matches
@@ -79,11 +86,9 @@ class PackWeightsCache : public XnnWeightsCache {
       const xnn_weights_cache_look_up_key*);
 
  private:
-  // Returns writable mapped memory of the cache file. Returns nullptr in case
-  // of any error.
-  // TODO: b/401011041 - Consider returning a readable memory mapping if the
-  // cache file has already been built.
-  std::shared_ptr<MemoryMappedFile> GetMmapFile();
+  // Returns writable mapped memory of the cache file, or a read-only mapping
+  // without read-ahead if `lazy`. Returns nullptr in case of any error.
+  std::shared_ptr<MemoryMappedFile> GetMmapFile(bool lazy = false);
 
   absl::Status Append(absl::string_view data);
   absl::Status Prepend(absl::string_view data);
@@ -117,6 +122,7 @@ class PackWeightsCache : public XnnWeightsCache {
 
   // File path or descriptor to write the cache file to.
   std::variant<std::string, std::shared_ptr<ScopedFile>> cache_file_;
+  const bool lazy_;
 
   std::shared_ptr<MemoryMappedFile> mmap_file_;
   // Immutable flatbuffer.
@@ -0,0 +1,239 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/prefix_kv_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/llm_utils/memory_mapped_file.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/xnn_tensor.h"
+#include "xnnpack.h"  // from @XNNPACK
+
+namespace mediapipe::tasks::genai::xnn_utils {
+namespace {
+
+using ::mediapipe::tasks::genai::llm_utils::MemoryMappedFile;
+
+constexpr char kMagic[8] = {'M', 'P', 'K', 'V', 'C', 'A', 'C', 'H'};
+constexpr uint32_t kVersion = 1;
+// The KV cache data of entries starts at a multiple of this offset.
+constexpr size_t kDataAlignment = 64;
+
+// An entry is laid out as this header, followed by the token ids, and the K
+// and V caches of each layer, of `num_tokens` rows of `row_size` bytes.
+struct EntryHeader {
+  char magic[8];
+  uint32_t version;
+  // The xnn_datatype of the KV cache.
+  uint32_t datatype;
+  uint64_t model_fingerprint;
+  uint64_t num_layers;
+  uint64_t num_tokens;
+  uint64_t row_size;
+};
+
+// FNV-1a, which unlike absl::Hash is stable across processes.
+uint64_t Fingerprint(absl::string_view data,
+                     uint64_t fingerprint = 14695981039346656037ull) {
+  for (unsigned char c : data) {
+    fingerprint = (fingerprint ^ c) * 1099511628211ull;
+  }
+  return fingerprint;
+}
+
+absl::string_view AsBytes(absl::Span<const int> ids) {
+  return absl::string_view(reinterpret_cast<const char*>(ids.data()),
+                           ids.size() * sizeof(int));
+}
+
+// Returns the number of bytes of one token of `cache`, a [T, B, N, H] KV
+// cache.
+absl::StatusOr<size_t> KVCacheRowSize(const Tensor& cache) {
+  RET_CHECK_EQ(cache.dims.size(), 4);
+  RET_CHECK(cache.datatype == xnn_datatype_fp32 ||
+            cache.datatype == xnn_datatype_fp16);
+  return cache.dims[1] * cache.dims[2] * cache.dims[3] *
+         (cache.datatype == xnn_datatype_fp16 ? sizeof(uint16_t)
+                                              : sizeof(float));
+}
+
+size_t DataOffset(size_t num_tokens) {
+  const size_t size = sizeof(EntryHeader) + num_tokens * sizeof(int);
+  return (size + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+}
+
+}  // namespace
+
+PrefixKVCache::PrefixKVCache(absl::string_view cache_dir,
+                             absl::string_view model_key,
+                             size_t min_prefix_size)
+    : cache_dir_(cache_dir),
+      model_key_(model_key),
+      min_prefix_size_(std::max<size_t>(min_prefix_size, 1)) {}
+
+std::string PrefixKVCache::GetEntryPath(
+    absl::Span<const int> prefix_ids) const {
+  const uint64_t fingerprint =
+      Fingerprint(AsBytes(prefix_ids), Fingerprint(model_key_));
+  return mediapipe::file::JoinPath(
+      cache_dir_, absl::StrCat("prefix_", absl::Hex(fingerprint,
+                                                    absl::kZeroPad16),
+                               ".kvcache"));
+}
+
+absl::StatusOr<size_t> PrefixKVCache::Load(
+    Llm& llm, absl::Span<const int> prompt_ids) const {
+  RET_CHECK_EQ(llm.GetLlmParams().batch_size_B, 1);
+  RET_CHECK(!llm.GetLlmParams().enable_batch_slots);
+  if (prompt_ids.size() <= min_prefix_size_) return 0;
+  const std::string path =
+      GetEntryPath(prompt_ids.subspan(0, min_prefix_size_));
+  if (!mediapipe::file::Exists(path).ok()) return 0;
+  auto file = MemoryMappedFile::Create(path);
+  if (!file.ok()) {
+    ABSL_LOG(WARNING) << "Failed to map " << path << ": " << file.status();
+    return 0;
+  }
+  const char* data = static_cast<const char*>((*file)->data());
+  const uint64_t length = (*file)->length();
+
+  std::vector<Llm::KVCache>& kv_cache = llm.kv_cache();
+  RET_CHECK(!kv_cache.empty());
+  const Tensor& k_cache = *kv_cache[0].k_cache;
+  MP_ASSIGN_OR_RETURN(const size_t row_size, KVCacheRowSize(k_cache));
+  EntryHeader header;
+  if (length >= sizeof(header)) memcpy(&header, data, sizeof(header));
+  if (length < sizeof(header) ||
+      memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.datatype != static_cast<uint32_t>(k_cache.datatype) ||
+      header.model_fingerprint != Fingerprint(model_key_) ||
+      header.num_layers != kv_cache.size() || header.row_size != row_size ||
+      length < DataOffset(header.num_tokens) +
+                   2 * header.num_layers * header.num_tokens * row_size) {
+    ABSL_LOG(WARNING) << "Ignoring incompatible prefix KV cache " << path;
+    return 0;
+  }
+
+  const int* entry_ids = reinterpret_cast<const int*>(data + sizeof(header));
+  const size_t num_tokens = std::min<size_t>(
+      std::mismatch(prompt_ids.begin(), prompt_ids.end(), entry_ids,
+                    entry_ids + header.num_tokens)
+              .first -
+          prompt_ids.begin(),
+      prompt_ids.size() - 1);
+  // Only fingerprint collisions share fewer tokens.
+  if (num_tokens < min_prefix_size_) return 0;
+
+  MP_RETURN_IF_ERROR(llm.SeekTimeStep(0));
+  MP_RETURN_IF_ERROR(llm.UnshareKVCache(0, num_tokens));
+  MP_RETURN_IF_ERROR(llm.ReserveKVCache(0, num_tokens));
+  const char* cache_data = data + DataOffset(header.num_tokens);
+  for (Llm::KVCache& kv : kv_cache) {
+    for (Tensor* cache : {kv.k_cache.get(), kv.v_cache.get()}) {
+      memcpy(cache->Data(), cache_data, num_tokens * row_size);
+      cache_data += header.num_tokens * row_size;
+    }
+  }
+  llm.batch_prev_ids()[0].assign(prompt_ids.begin(),
+                                 prompt_ids.begin() + num_tokens);
+  return num_tokens;
+}
+
+absl::StatusOr<std::optional<PrefixKVCache::Entry>> PrefixKVCache::Snapshot(
+    Llm& llm) const {
+  RET_CHECK_EQ(llm.GetLlmParams().batch_size_B, 1);
+  RET_CHECK(!llm.GetLlmParams().enable_batch_slots);
+  const std::vector<int>& ids = llm.batch_prev_ids()[0];
+  if (ids.size() < min_prefix_size_) return std::nullopt;
+  std::string path =
+      GetEntryPath(absl::MakeConstSpan(ids).subspan(0, min_prefix_size_));
+  if (mediapipe::file::Exists(path).ok()) return std::nullopt;
+
+  const std::vector<Llm::KVCache>& kv_cache = llm.kv_cache();
+  RET_CHECK(!kv_cache.empty());
+  MP_ASSIGN_OR_RETURN(const size_t row_size,
+                      KVCacheRowSize(*kv_cache[0].k_cache));
+  EntryHeader header = {
+      .version = kVersion,
+      .datatype = static_cast<uint32_t>(kv_cache[0].k_cache->datatype),
+      .model_fingerprint = Fingerprint(model_key_),
+      .num_layers = kv_cache.size(),
+      .num_tokens = ids.size(),
+      .row_size = row_size,
+  };
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  const size_t data_offset = DataOffset(ids.size());
+  const size_t cache_size = ids.size() * row_size;
+  std::string contents(data_offset + 2 * kv_cache.size() * cache_size, '\0');
+  memcpy(contents.data(), &header, sizeof(header));
+  memcpy(contents.data() + sizeof(header), ids.data(),
+         ids.size() * sizeof(int));
+  char* data = contents.data() + data_offset;
+  for (const Llm::KVCache& kv : kv_cache) {
+    for (const Tensor* cache : {kv.k_cache.get(), kv.v_cache.get()}) {
+      memcpy(data, cache->Data(), cache_size);
+      data += cache_size;
+    }
+  }
+  return Entry{.path = std::move(path), .contents = std::move(contents)};
+}
+
+absl::Status PrefixKVCache::Write(const Entry& entry) const {
+  const std::string temp_path =
+      absl::StrCat(entry.path, ".", absl::ToUnixNanos(absl::Now()), ".tmp");
+  absl::Status status = [&]() -> absl::Status {
+    MP_RETURN_IF_ERROR(mediapipe::file::SetContents(temp_path, entry.contents));
+    if (std::rename(temp_path.c_str(), entry.path.c_str()) != 0 &&
+        !mediapipe::file::Exists(entry.path).ok()) {
+      return absl::ErrnoToStatus(
+          errno, absl::StrCat("Failed to rename ", temp_path, " to ",
+                              entry.path));
+    }
+    return absl::OkStatus();
+  }();
+  // Left behind on errors, or if another process saved the entry first.
+  std::remove(temp_path.c_str());
+  return status;
+}
+
+absl::Status PrefixKVCache::Save(Llm& llm) const {
+  MP_ASSIGN_OR_RETURN(const std::optional<Entry> entry, Snapshot(llm));
+  if (!entry.has_value()) return absl::OkStatus();
+  return Write(*entry);
+}
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
@@ -0,0 +1,81 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_PREFIX_KV_CACHE_H_
+#define MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_PREFIX_KV_CACHE_H_
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+
+namespace mediapipe::tasks::genai::xnn_utils {
+
+// A KV cache of prompt prefixes on disk, shared across processes, so that
+// prompts starting with the same tokens, e.g. a system prompt, are only
+// prefilled once. Entries are keyed by the model and the first
+// `min_prefix_size` tokens of a prompt, and hold the keys and values of the
+// first prompt saved with them. Any prompt sharing more than these tokens
+// with the entry loads the shared tokens from it.
+//
+// Entries are files of `cache_dir`, laid out so that they can be memory mapped
+// and copied into the KV cache without parsing.
+class PrefixKVCache {
+ public:
+  // `model_key` must change whenever the model weights do.
+  PrefixKVCache(absl::string_view cache_dir, absl::string_view model_key,
+                size_t min_prefix_size = 256);
+
+  // Replaces the tokens of the context of `llm` with the longest prefix of
+  // `prompt_ids` found in the cache, short of its last token, which is left
+  // to compute the logits. Returns the number of loaded tokens, 0 if none.
+  // `llm` must have a batch size of 1 and no batch slots.
+  absl::StatusOr<size_t> Load(Llm& llm,
+                              absl::Span<const int> prompt_ids) const;
+
+  // An entry, ready to be written to its file.
+  struct Entry {
+    std::string path;
+    std::string contents;
+  };
+
+  // Copies the tokens of the context of `llm` and their KV cache into an
+  // entry, unless they are fewer than `min_prefix_size`, or their entry
+  // exists already. Unlike Write(), this needs exclusive access to `llm`.
+  absl::StatusOr<std::optional<Entry>> Snapshot(Llm& llm) const;
+
+  // Writes `entry` to a temporary file first, so that other processes never
+  // load partial entries.
+  absl::Status Write(const Entry& entry) const;
+
+  // Snapshot()s and Write()s the context of `llm`.
+  absl::Status Save(Llm& llm) const;
+
+ private:
+  // Returns the path of the entry of the prompts starting with `prefix_ids`.
+  std::string GetEntryPath(absl::Span<const int> prefix_ids) const;
+
+  const std::string cache_dir_;
+  const std::string model_key_;
+  const size_t min_prefix_size_;
+};
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
+
+#endif  // MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_PREFIX_KV_CACHE_H_
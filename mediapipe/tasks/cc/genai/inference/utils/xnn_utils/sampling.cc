@@ -25,16 +25,73 @@
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status_macros.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/xnn_tensor.h"
 
 namespace mediapipe::tasks::genai::xnn_utils {
+namespace {
+
+// Above this many candidates, the top p are found by partitioning them.
+constexpr size_t kMaxTopPSortSize = 256;
+
+bool GreaterProbability(const std::pair<float, int>& a,
+                        const std::pair<float, int>& b) {
+  return a.first > b.first;
+}
+
+// Keeps the smallest set of most probable `candidates` whose probabilities
+// sum to `p` or more, in decreasing order. Instead of sorting all of them,
+// they are partitioned around their median until the boundary of the set is
+// within kMaxTopPSortSize candidates.
+void SelectTopP(std::vector<std::pair<float, int>>& candidates, float p) {
+  size_t begin = 0;
+  size_t end = candidates.size();
+  float remaining_p = p;
+  while (end - begin > kMaxTopPSortSize) {
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(candidates.begin() + begin, candidates.begin() + middle,
+                     candidates.begin() + end, GreaterProbability);
+    float sum = 0.0f;
+    for (size_t i = begin; i < middle; ++i) {
+      sum += candidates[i].first;
+    }
+    if (sum >= remaining_p) {
+      end = middle;
+    } else {
+      remaining_p -= sum;
+      begin = middle;
+    }
+  }
+  std::sort(candidates.begin() + begin, candidates.begin() + end,
+            GreaterProbability);
+  size_t size = begin;
+  float sum = 0.0f;
+  while (size < end && sum < remaining_p) {
+    sum += candidates[size++].first;
+  }
+  std::sort(candidates.begin(), candidates.begin() + begin,
+            GreaterProbability);
+  candidates.resize(std::max<size_t>(size, 1));
+}
+
+// Calls `task(i)` for i in [0, `range`) in parallel on `threadpool`.
+template <typename Task>
+void ParallelFor(pthreadpool_t threadpool, size_t range, Task& task) {
+  pthreadpool_parallelize_1d(
+      threadpool,
+      [](void* context, size_t i) { (*static_cast<Task*>(context))(i); },
+      &task, range, /*flags=*/0);
+}
+
+}  // namespace
 
 absl::StatusOr<std::unique_ptr<Sampler>> Sampler::Create(Type type, int top_k,
                                                          float top_p,
                                                          float temperature,
-                                                         int seed) {
+                                                         int seed,
+                                                         int num_threads) {
   if (type == Type::kTopK || type == Type::kTopP) {
     RET_CHECK_GT(top_k, 1).SetCode(absl::StatusCode::kInvalidArgument)
         << "top_k must be > 1";
@@ -49,7 +106,22 @@ absl::StatusOr<std::unique_ptr<Sampler>> Sampler::Create(Type type, int top_k,
     RET_CHECK_LE(top_p, 1.0).SetCode(absl::StatusCode::kInvalidArgument)
         << "top_p must be between 0 and 1";
   }
-  return absl::WrapUnique(new Sampler(type, top_k, top_p, temperature, seed));
+  RET_CHECK_GE(num_threads, 1).SetCode(absl::StatusCode::kInvalidArgument)
+      << "num_threads must be >= 1";
+  return absl::WrapUnique(
+      new Sampler(type, top_k, top_p, temperature, seed, num_threads));
+}
+
+Sampler::Sampler(Type type, int top_k, float top_p, float temperature, int seed,
+                 int num_threads)
+    : type_(type),
+      top_k_(top_k),
+      top_p_(top_p),
+      temperature_(temperature),
+      seed_(seed) {
+  if (num_threads > 1) {
+    threadpool_.reset(pthreadpool_create(num_threads));
+  }
 }
 
 absl::StatusOr<std::vector<std::vector<int>>> Sampler::Sample(
@@ -58,25 +130,90 @@ absl::StatusOr<std::vector<std::vector<int>>> Sampler::Sample(
     return absl::InvalidArgumentError(
         "Tensor must be (Batch, seq_len, vocab_size)");
   }
+  if (type_ == Type::kGreedy) {
+    return SampleGreedy(logits);
+  }
+  if (type_ != Type::kTopK && type_ != Type::kTopP) {
+    return absl::InvalidArgumentError("Unsupported sampler type");
+  }
 
-  switch (type_) {
-    case Type::kGreedy:
-      return SampleGreedy(logits);
-    case Type::kTopK:
-      return SampleTopK(logits);
-    case Type::kTopP:
-      return SampleTopP(logits);
-    default:
-      return absl::InvalidArgumentError("Unsupported sampler type");
+  const size_t batch_size = logits.dims[0];
+  const size_t draft_size = logits.dims[1];
+  const size_t vocab_size = logits.dims[2];
+  MP_ASSIGN_OR_RETURN(const size_t k, GetTopK(vocab_size));
+  const float* flat_data = logits.DataAs<float>();
+  for (size_t batch = 0; batch < batch_size; ++batch) {
+    GetBatchState(batch);
   }
-};
 
-Sampler::Sampler(Type type, int top_k, float top_p, float temperature, int seed)
-    : type_(type),
-      top_k_(top_k),
-      top_p_(top_p),
-      temperature_(temperature),
-      generator_(std::make_unique<std::mt19937>(seed)) {}
+  std::vector<std::vector<int>> outputs(batch_size,
+                                        std::vector<int>(draft_size));
+  auto sample_batch = [&](size_t batch) {
+    BatchState& state = batch_states_[batch];
+    for (size_t draft = 0; draft < draft_size; ++draft) {
+      // the index of the first logit for a single token
+      const size_t token_index =
+          (batch * draft_size * vocab_size) + (draft * vocab_size);
+      SelectCandidates(flat_data + token_index, vocab_size, k,
+                       state.candidates);
+      outputs[batch][draft] = DrawCandidate(state.candidates, state.generator);
+    }
+  };
+  if (threadpool_ && batch_size > 1) {
+    ParallelFor(threadpool_.get(), batch_size, sample_batch);
+  } else {
+    for (size_t batch = 0; batch < batch_size; ++batch) {
+      sample_batch(batch);
+    }
+  }
+  return outputs;
+}
+
+absl::StatusOr<std::vector<float>> Sampler::ComputeProbabilities(
+    absl::Span<const float> logits) {
+  RET_CHECK(!logits.empty());
+  std::vector<float> probabilities(logits.size(), 0.0f);
+  if (type_ == Type::kGreedy) {
+    probabilities[std::max_element(logits.begin(), logits.end()) -
+                  logits.begin()] = 1.0f;
+    return probabilities;
+  }
+
+  MP_ASSIGN_OR_RETURN(const size_t k, GetTopK(logits.size()));
+  std::vector<Candidate>& candidates = GetBatchState(0).candidates;
+  SelectCandidates(logits.data(), logits.size(), k, candidates);
+  // Top-p drops the tail of the candidates, so renormalizes over the others,
+  // as DrawCandidate() does.
+  float sum = 0.0f;
+  for (const auto& [probability, _] : candidates) {
+    sum += probability;
+  }
+  for (const auto& [probability, id] : candidates) {
+    probabilities[id] = probability / sum;
+  }
+  return probabilities;
+}
+
+absl::StatusOr<int> Sampler::SampleFromProbabilities(
+    absl::Span<const float> probabilities) {
+  RET_CHECK(!probabilities.empty());
+  float sum = 0.0f;
+  for (float probability : probabilities) {
+    sum += probability;
+  }
+  float remaining = std::uniform_real_distribution<float>(0.0f, sum)(
+      GetBatchState(0).generator);
+  for (size_t id = 0; id + 1 < probabilities.size(); ++id) {
+    remaining -= probabilities[id];
+    if (remaining < 0.0f) return id;
+  }
+  return probabilities.size() - 1;
+}
+
+float Sampler::SampleUniform() {
+  return std::uniform_real_distribution<float>(0.0f, 1.0f)(
+      GetBatchState(0).generator);
+}
 
 absl::StatusOr<std::vector<std::vector<int>>> Sampler::SampleGreedy(
     const Tensor& logits) {
@@ -110,135 +247,86 @@ absl::StatusOr<std::vector<std::vector<int>>> Sampler::SampleGreedy(
   return outputs;
 };
 
-absl::StatusOr<std::vector<std::vector<int>>> Sampler::SampleTopK(
-    const Tensor& logits) {
-  const size_t batch_size = logits.dims[0];
-  const size_t draft_size = logits.dims[1];
-  const size_t vocab_size = logits.dims[2];
-  const float* flat_data = logits.DataAs<float>();
-
-  std::vector<std::vector<int>> outputs;
-  outputs.reserve(batch_size);
-  for (int batch = 0; batch < batch_size; ++batch) {
-    outputs.push_back(std::vector<int>());
-    outputs[batch].reserve(draft_size);
-    for (int draft = 0; draft < draft_size; ++draft) {
-      // the index of the first logit for a single token
-      int token_index =
-          (batch * draft_size * vocab_size) + (draft * vocab_size);
-      std::vector<std::pair<float, int>> logits_ids;
-      logits_ids.reserve(vocab_size);
-      for (int v = 0; v < vocab_size; ++v) {
-        float logit = flat_data[token_index + v];
-        logits_ids.push_back(std::make_pair(logit, v));
-      }
-      MP_RETURN_IF_ERROR(SelectTopK(logits_ids, top_k_));
-      // No need to normalize logits here, sampler takes care of that.
-      MP_RETURN_IF_ERROR(ScaledSoftmax(logits_ids, /*normalize=*/false));
-      MP_ASSIGN_OR_RETURN(int sample_idx, DoSampling(logits_ids));
-      outputs[batch].push_back(sample_idx);
-    }
+absl::StatusOr<size_t> Sampler::GetTopK(size_t vocab_size) const {
+  const size_t k = type_ == Type::kTopP && top_k_ <= 0 ? vocab_size : top_k_;
+  if (k > vocab_size) {
+    return absl::InvalidArgumentError(
+        "Top k value must be smaller than the number of logits.");
   }
-  return outputs;
+  return k;
 }
 
-absl::StatusOr<std::vector<std::vector<int>>> Sampler::SampleTopP(
-    const Tensor& logits) {
-  const size_t batch_size = logits.dims[0];
-  const size_t draft_size = logits.dims[1];
-  const size_t vocab_size = logits.dims[2];
-  const int k = top_k_ > 0 ? top_k_ : vocab_size;
-  const float* flat_data = logits.DataAs<float>();
-
-  std::vector<std::vector<int>> outputs;
-  outputs.reserve(batch_size);
-  for (int batch = 0; batch < batch_size; ++batch) {
-    outputs.push_back(std::vector<int>());
-    outputs[batch].reserve(draft_size);
-    for (int draft = 0; draft < draft_size; ++draft) {
-      // the index of the first logit for a single token
-      int token_index =
-          (batch * draft_size * vocab_size) + (draft * vocab_size);
-      std::vector<std::pair<float, int>> logits_ids;
-      logits_ids.reserve(vocab_size);
-      for (int v = 0; v < vocab_size; ++v) {
-        float logit = flat_data[token_index + v];
-        logits_ids.push_back(std::make_pair(logit, v));
-      }
-      MP_RETURN_IF_ERROR(SelectTopK(logits_ids, k));
-      MP_RETURN_IF_ERROR(ScaledSoftmax(logits_ids, /*normalize=*/true));
-      MP_RETURN_IF_ERROR(SelectTopP(logits_ids, top_p_));
-      MP_ASSIGN_OR_RETURN(int sample_idx, DoSampling(logits_ids));
-      outputs[batch].push_back(sample_idx);
-    }
+Sampler::BatchState& Sampler::GetBatchState(size_t batch) {
+  while (batch_states_.size() <= batch) {
+    batch_states_.push_back(
+        BatchState{.generator = std::mt19937(seed_ + batch_states_.size())});
   }
-  return outputs;
+  return batch_states_[batch];
 }
 
-absl::Status Sampler::SelectTopK(std::vector<std::pair<float, int>>& logits_ids,
-                                 int k) {
-  if (k > logits_ids.size()) {
-    return absl::InvalidArgumentError(
-        "Top k value must be smaller than the number of logits.");
+void Sampler::SelectCandidates(const float* logits, size_t vocab_size,
+                               size_t k,
+                               std::vector<Candidate>& candidates) const {
+  candidates.clear();
+  float max_logit;
+  if (k < vocab_size) {
+    // A min-heap of the top k logits. Most logits are discarded by a single
+    // comparison with the smallest of them.
+    for (int v = 0; v < k; ++v) {
+      candidates.push_back(std::make_pair(logits[v], v));
+    }
+    std::make_heap(candidates.begin(), candidates.end(), GreaterProbability);
+    for (int v = k; v < vocab_size; ++v) {
+      if (logits[v] <= candidates.front().first) continue;
+      std::pop_heap(candidates.begin(), candidates.end(), GreaterProbability);
+      candidates.back() = std::make_pair(logits[v], v);
+      std::push_heap(candidates.begin(), candidates.end(), GreaterProbability);
+    }
+    std::sort_heap(candidates.begin(), candidates.end(), GreaterProbability);
+    max_logit = candidates.front().first;
+  } else {
+    for (int v = 0; v < vocab_size; ++v) {
+      candidates.push_back(std::make_pair(logits[v], v));
+    }
+    max_logit = *std::max_element(logits, logits + vocab_size);
   }
-  std::partial_sort(
-      logits_ids.begin(), logits_ids.begin() + k, logits_ids.end(),
-      [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
-        // reverse order.
-        return a.first > b.first;
-      });
-  logits_ids.resize(k);
-  return absl::OkStatus();
-}
 
-absl::Status Sampler::SelectTopP(std::vector<std::pair<float, int>>& logits_ids,
-                                 float p) {
-  int included = 0;
-  float prob_sum = 0.0;
-  for (const auto& [logit, _] : logits_ids) {
-    ++included;
-    prob_sum += logit;
-    if (prob_sum >= p) {
-      break;
-    }
+  const float scale = 1 / (temperature_ ? temperature_ : 1.0);
+  double sum = 0.0;
+  for (auto& [value, _] : candidates) {
+    value = expf(scale * (value - max_logit));
+    sum += value;
   }
-  if (included == 0) {
-    return absl::InternalError("Bad top_p value.");
+  for (auto& [value, _] : candidates) {
+    value /= sum;
   }
-  logits_ids.resize(included);
-  return absl::OkStatus();
-}
 
-absl::Status Sampler::ScaledSoftmax(
-    std::vector<std::pair<float, int>>& logits_ids, bool normalize) {
-  float scale = 1 / (temperature_ ? temperature_ : 1.0);
-  double sum = 0.0;
-  float max_logit = logits_ids[0].first;
-  for (int i = 0; i < logits_ids.size(); ++i) {
-    const float logit = logits_ids[i].first;
-    const float p = expf(scale * (logit - max_logit));
-    sum += p;
-    logits_ids[i].first = p;
-  }
-  if (normalize) {
-    for (int i = 0; i < logits_ids.size(); ++i) {
-      logits_ids[i].first /= sum;
+  if (type_ != Type::kTopP) return;
+  if (k < vocab_size) {
+    // The candidates are sorted already.
+    size_t size = 0;
+    float prob_sum = 0.0f;
+    while (size < candidates.size() && prob_sum < top_p_) {
+      prob_sum += candidates[size++].first;
     }
+    candidates.resize(std::max<size_t>(size, 1));
+  } else {
+    SelectTopP(candidates, top_p_);
   }
-  return absl::OkStatus();
 }
 
-absl::StatusOr<int> Sampler::DoSampling(
-    std::vector<std::pair<float, int>>& logits_ids) {
-  std::vector<float> probs;
-  probs.reserve(logits_ids.size());
-  for (const auto& [logit, _] : logits_ids) {
-    probs.push_back(logit);
-  }
-  // Probabilities are normalized by `discrete_distribution`.
-  std::discrete_distribution<> dist(probs.begin(), probs.end());
-  int sample_idx = dist(*generator_);
-  return logits_ids[sample_idx].second;
+int Sampler::DrawCandidate(absl::Span<const Candidate> candidates,
+                           std::mt19937& generator) {
+  float sum = 0.0f;
+  for (const auto& [probability, _] : candidates) {
+    sum += probability;
+  }
+  float remaining = std::uniform_real_distribution<float>(0.0f, sum)(generator);
+  for (size_t i = 0; i + 1 < candidates.size(); ++i) {
+    remaining -= candidates[i].first;
+    if (remaining < 0.0f) return candidates[i].second;
+  }
+  return candidates.back().second;
 }
 
 }  // namespace mediapipe::tasks::genai::xnn_utils
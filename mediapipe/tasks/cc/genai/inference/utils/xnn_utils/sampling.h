@@ -17,6 +17,7 @@
 
 #include <sys/stat.h>
 
+#include <cstddef>
 #include <memory>
 #include <random>
 #include <utility>
@@ -24,7 +25,9 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/xnn_tensor.h"
+#include "pthreadpool.h"  // from @pthreadpool
 
 namespace mediapipe::tasks::genai::xnn_utils {
 
@@ -45,40 +48,66 @@ class Sampler {
   //   applying softmax. Finally, the top p are selected from the probabilities
   //   such that sum of p_i is greater than or equal to top_p. Lastly, a sample
   //   is drawn from the resulting distribution.
+  // If `num_threads` > 1, the batches of the logits are sampled in parallel.
+  // Each batch draws from its own generator, seeded with `seed` + batch.
   static absl::StatusOr<std::unique_ptr<Sampler>> Create(Type type, int top_k,
                                                          float top_p,
                                                          float temperature,
-                                                         int seed);
+                                                         int seed,
+                                                         int num_threads = 1);
   // Given an input tensor of shape `(Batch, seq_len, vocab_size)`, runs
   // the configured sampling algorithm to find a winning class. The results are
   // reported as a 2D vector of integer indices where the first axis corresponds
   // to the batch size, and the second axis corresponds to the sequence length.
   absl::StatusOr<std::vector<std::vector<int>>> Sample(const Tensor& logits);
 
+  // Returns the distribution Sample() draws from given the `logits` of one
+  // token: the probability of each id of the vocabulary, zero for the ids
+  // outside of the top k or top p. kGreedy returns a one-hot distribution.
+  absl::StatusOr<std::vector<float>> ComputeProbabilities(
+      absl::Span<const float> logits);
+
+  // Draws an id from `probabilities`, which don't need to be normalized.
+  absl::StatusOr<int> SampleFromProbabilities(
+      absl::Span<const float> probabilities);
+
+  // Draws a number uniformly from [0, 1).
+  float SampleUniform();
+
  private:
-  Sampler(Type type, int top_k, float top_p, float temperature, int seed);
+  // A (probability, id) pair.
+  using Candidate = std::pair<float, int>;
+
+  // The state of sampling one batch. The buffers are reused across calls, so
+  // that sampling doesn't allocate memory per token.
+  struct BatchState {
+    std::mt19937 generator;
+    std::vector<Candidate> candidates;
+  };
+
+  Sampler(Type type, int top_k, float top_p, float temperature, int seed,
+          int num_threads);
   absl::StatusOr<std::vector<std::vector<int>>> SampleGreedy(
       const Tensor& logits);
-  absl::StatusOr<std::vector<std::vector<int>>> SampleTopK(
-      const Tensor& logits);
-  absl::StatusOr<std::vector<std::vector<int>>> SampleTopP(
-      const Tensor& logits);
-  absl::Status SelectTopK(std::vector<std::pair<float, int>>& logits_ids,
-                          int k);
-  // `logits_ids` must be sorted and normalized.
-  absl::Status SelectTopP(std::vector<std::pair<float, int>>& logits_ids,
-                          float p);
-  // `logits_ids` must be sorted.
-  absl::Status ScaledSoftmax(std::vector<std::pair<float, int>>& logits_ids,
-                             bool normalize);
-  absl::StatusOr<int> DoSampling(
-      std::vector<std::pair<float, int>>& logits_ids);
+  // The number of top logits to select from `vocab_size` logits.
+  absl::StatusOr<size_t> GetTopK(size_t vocab_size) const;
+  BatchState& GetBatchState(size_t batch);
+  // Sets `candidates` to the normalized probabilities of the top k and top p
+  // ids of `logits`, in decreasing order. Temperature and softmax are only
+  // computed on the top k logits.
+  void SelectCandidates(const float* logits, size_t vocab_size, size_t k,
+                        std::vector<Candidate>& candidates) const;
+  static int DrawCandidate(absl::Span<const Candidate> candidates,
+                           std::mt19937& generator);
 
   Type type_;
   int top_k_;
   float top_p_;
   float temperature_;
-  std::unique_ptr<std::mt19937> generator_;
+  int seed_;
+  std::vector<BatchState> batch_states_;
+  std::unique_ptr<pthreadpool, decltype(&pthreadpool_destroy)> threadpool_{
+      nullptr, pthreadpool_destroy};
 };
 
 }  // namespace mediapipe::tasks::genai::xnn_utils
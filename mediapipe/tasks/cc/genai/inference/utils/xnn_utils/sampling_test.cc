@@ -0,0 +1,175 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/xnn_tensor.h"
+
+namespace mediapipe::tasks::genai::xnn_utils {
+namespace {
+
+using ::testing::AnyOf;
+using ::testing::ElementsAre;
+using ::testing::FloatNear;
+using ::testing::Pointwise;
+
+std::unique_ptr<Tensor> CreateLogits(size_t batch_size, size_t vocab_size,
+                                     int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> distribution(0.0f, 4.0f);
+  std::vector<float> values(batch_size * vocab_size);
+  for (float& value : values) value = distribution(rng);
+  auto logits = std::make_unique<Tensor>(
+      Tensor::DimsType{batch_size, /*seq_len=*/1, vocab_size});
+  ABSL_CHECK_OK(logits->LoadFromVec(values));
+  return logits;
+}
+
+TEST(SamplerTest, TopKSamplesFromTheTopLogits) {
+  auto logits = std::make_unique<Tensor>(Tensor::DimsType{1, 1, 6});
+  MP_ASSERT_OK(logits->LoadFromVec({0.0f, 5.0f, -1.0f, 4.0f, 6.0f, 1.0f}));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sampler, Sampler::Create(Sampler::Type::kTopK, /*top_k=*/3,
+                                    /*top_p=*/0.0f, /*temperature=*/1.0f,
+                                    /*seed=*/0));
+
+  for (int i = 0; i < 100; ++i) {
+    MP_ASSERT_OK_AND_ASSIGN(auto ids, sampler->Sample(*logits));
+    EXPECT_THAT(ids, ElementsAre(ElementsAre(AnyOf(1, 3, 4))));
+  }
+}
+
+TEST(SamplerTest, ComputesTopPProbabilities) {
+  // Probabilities of 0.5, 0.25 and 0.125 for ids 2, 0 and 3, and 0.0625 for
+  // ids 1 and 4.
+  const std::vector<float> logits = {std::log(0.25f), std::log(0.0625f),
+                                     std::log(0.5f), std::log(0.125f),
+                                     std::log(0.0625f)};
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sampler, Sampler::Create(Sampler::Type::kTopP, /*top_k=*/5,
+                                    /*top_p=*/0.8f, /*temperature=*/1.0f,
+                                    /*seed=*/0));
+
+  MP_ASSERT_OK_AND_ASSIGN(auto probabilities,
+                          sampler->ComputeProbabilities(logits));
+  EXPECT_THAT(probabilities,
+              Pointwise(FloatNear(1e-5f),
+                        {0.25f / 0.875f, 0.0f, 0.5f / 0.875f, 0.125f / 0.875f,
+                         0.0f}));
+}
+
+TEST(SamplerTest, TopPOverWholeVocabularyMatchesSortedSelection) {
+  constexpr size_t kVocabSize = 10000;
+  auto logits = CreateLogits(/*batch_size=*/1, kVocabSize, /*seed=*/0);
+  const float* data = logits->DataAs<float>();
+  // With k being the vocabulary size, the top p are found by partitioning.
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sampler, Sampler::Create(Sampler::Type::kTopP, /*top_k=*/kVocabSize,
+                                    /*top_p=*/0.9f, /*temperature=*/1.0f,
+                                    /*seed=*/0));
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto probabilities,
+      sampler->ComputeProbabilities(absl::MakeConstSpan(data, kVocabSize)));
+
+  std::vector<std::pair<float, int>> sorted_ids;
+  const float max_logit = *std::max_element(data, data + kVocabSize);
+  double sum = 0.0;
+  for (int v = 0; v < kVocabSize; ++v) {
+    sorted_ids.push_back({std::exp(data[v] - max_logit), v});
+    sum += sorted_ids.back().first;
+  }
+  std::sort(sorted_ids.begin(), sorted_ids.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+  std::vector<bool> expected_selected(kVocabSize, false);
+  double prob_sum = 0.0;
+  for (const auto& [probability, id] : sorted_ids) {
+    expected_selected[id] = true;
+    prob_sum += probability / sum;
+    if (prob_sum >= 0.9) break;
+  }
+  for (int v = 0; v < kVocabSize; ++v) {
+    EXPECT_EQ(probabilities[v] > 0.0f, expected_selected[v]) << v;
+  }
+}
+
+TEST(SamplerTest, BatchesSampledInParallelMatchSequentialSampling) {
+  auto logits = CreateLogits(/*batch_size=*/8, /*vocab_size=*/1000,
+                             /*seed=*/0);
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sequential_sampler,
+      Sampler::Create(Sampler::Type::kTopP, /*top_k=*/40, /*top_p=*/0.9f,
+                      /*temperature=*/0.8f, /*seed=*/1));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto parallel_sampler,
+      Sampler::Create(Sampler::Type::kTopP, /*top_k=*/40, /*top_p=*/0.9f,
+                      /*temperature=*/0.8f, /*seed=*/1, /*num_threads=*/4));
+
+  for (int i = 0; i < 10; ++i) {
+    MP_ASSERT_OK_AND_ASSIGN(auto sequential_ids,
+                            sequential_sampler->Sample(*logits));
+    MP_ASSERT_OK_AND_ASSIGN(auto parallel_ids,
+                            parallel_sampler->Sample(*logits));
+    EXPECT_EQ(parallel_ids, sequential_ids);
+  }
+}
+
+}  // namespace
+
+// Benchmarks sampling batch_size x vocab_size logits. Args: type (1 for
+// kTopK, 2 for kTopP), vocab_size, batch_size, num_threads.
+void BM_Sampler(benchmark::State& state) {
+  const auto type = static_cast<Sampler::Type>(state.range(0));
+  const size_t vocab_size = state.range(1);
+  const size_t batch_size = state.range(2);
+  auto logits = CreateLogits(batch_size, vocab_size, /*seed=*/0);
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto sampler,
+      Sampler::Create(type, /*top_k=*/40, /*top_p=*/0.95f,
+                      /*temperature=*/0.8f, /*seed=*/0,
+                      /*num_threads=*/state.range(3)));
+
+  for (auto s : state) {
+    MP_ASSERT_OK_AND_ASSIGN(auto ids, sampler->Sample(*logits));
+    benchmark::DoNotOptimize(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_Sampler)
+    ->Args({/*type=*/1, /*vocab_size=*/32000, /*batch_size=*/1,
+            /*num_threads=*/1})
+    ->Args({/*type=*/1, /*vocab_size=*/256000, /*batch_size=*/1,
+            /*num_threads=*/1})
+    ->Args({/*type=*/2, /*vocab_size=*/256000, /*batch_size=*/1,
+            /*num_threads=*/1})
+    ->Args({/*type=*/2, /*vocab_size=*/256000, /*batch_size=*/8,
+            /*num_threads=*/1})
+    ->Args({/*type=*/2, /*vocab_size=*/256000, /*batch_size=*/8,
+            /*num_threads=*/4});
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
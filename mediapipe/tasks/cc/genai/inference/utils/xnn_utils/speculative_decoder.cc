@@ -0,0 +1,183 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/speculative_decoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm_weights.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/sampling.h"
+
+namespace mediapipe::tasks::genai::xnn_utils {
+
+double SpeculativeDecoder::Stats::AcceptanceRate() const {
+  if (num_draft_tokens == 0) return 0.0;
+  return static_cast<double>(num_accepted_draft_tokens) / num_draft_tokens;
+}
+
+double SpeculativeDecoder::Stats::TokensPerSecond() const {
+  if (duration <= absl::ZeroDuration()) return 0.0;
+  return num_output_tokens / absl::ToDoubleSeconds(duration);
+}
+
+absl::StatusOr<std::unique_ptr<SpeculativeDecoder>> SpeculativeDecoder::Create(
+    Llm* target, Llm* draft, std::unique_ptr<Sampler> sampler) {
+  RET_CHECK(target);
+  RET_CHECK(draft);
+  RET_CHECK(sampler);
+  const LlmParams& target_params = target->GetLlmParams();
+  const LlmParams& draft_params = draft->GetLlmParams();
+  RET_CHECK_GT(target_params.draft_size_G, 0)
+      << "The target model must score the draft tokens.";
+  RET_CHECK_EQ(draft_params.draft_size_G, 0);
+  RET_CHECK_EQ(target_params.batch_size_B, 1);
+  RET_CHECK_EQ(draft_params.batch_size_B, 1);
+  RET_CHECK_EQ(target_params.voc_size_V, draft_params.voc_size_V);
+  return absl::WrapUnique(
+      new SpeculativeDecoder(target, draft, std::move(sampler)));
+}
+
+SpeculativeDecoder::SpeculativeDecoder(Llm* target, Llm* draft,
+                                       std::unique_ptr<Sampler> sampler)
+    : target_(target),
+      draft_(draft),
+      sampler_(std::move(sampler)),
+      num_draft_tokens_(target->GetLlmParams().draft_size_G) {}
+
+absl::Status SpeculativeDecoder::Start(const std::vector<int>& prompt_ids) {
+  if (prompt_ids.size() <= num_draft_tokens_ + 1) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The prompt has ", prompt_ids.size(),
+                     " tokens, but must be longer than ",
+                     num_draft_tokens_ + 1));
+  }
+  // The last prompt token is run by the first step.
+  const std::vector<int> prefix_ids(prompt_ids.begin(), prompt_ids.end() - 1);
+  for (Llm* llm : {target_, draft_}) {
+    MP_RETURN_IF_ERROR(llm->SeekTimeStep(0));
+    MP_RETURN_IF_ERROR(llm->AddInputTokens({prefix_ids}));
+  }
+  draft_input_ids_ = {prompt_ids.back()};
+  return absl::OkStatus();
+}
+
+absl::Status SpeculativeDecoder::Draft(
+    std::vector<int>& draft_ids,
+    std::vector<std::vector<float>>& draft_probabilities) {
+  const size_t vocab_size = draft_->GetLlmParams().voc_size_V;
+  draft_ids.clear();
+  draft_probabilities.clear();
+  for (size_t i = 0; i < num_draft_tokens_; ++i) {
+    MP_RETURN_IF_ERROR(draft_->AddInputTokens(
+        {i == 0 ? draft_input_ids_ : std::vector<int>{draft_ids.back()}}));
+    MP_ASSIGN_OR_RETURN(auto logits, draft_->ComputeLogits());
+    MP_ASSIGN_OR_RETURN(
+        std::vector<float> probabilities,
+        sampler_->ComputeProbabilities(
+            absl::MakeConstSpan(logits->DataAs<float>(), vocab_size)));
+    MP_ASSIGN_OR_RETURN(int draft_id,
+                        sampler_->SampleFromProbabilities(probabilities));
+    draft_ids.push_back(draft_id);
+    draft_probabilities.push_back(std::move(probabilities));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<int>> SpeculativeDecoder::Step() {
+  RET_CHECK(!draft_input_ids_.empty()) << "Start() must be called first.";
+  const absl::Time start_time = absl::Now();
+  const size_t vocab_size = target_->GetLlmParams().voc_size_V;
+
+  std::vector<int> draft_ids;
+  std::vector<std::vector<float>> draft_probabilities;
+  MP_RETURN_IF_ERROR(Draft(draft_ids, draft_probabilities));
+
+  // Scores the last output token and the draft tokens in one run.
+  std::vector<int> target_input_ids = {draft_input_ids_.back()};
+  target_input_ids.insert(target_input_ids.end(), draft_ids.begin(),
+                          draft_ids.end());
+  MP_RETURN_IF_ERROR(target_->AddInputTokens({target_input_ids}));
+  MP_ASSIGN_OR_RETURN(auto logits,
+                      target_->ComputeLogits(num_draft_tokens_ + 1));
+  const float* target_logits = logits->DataAs<float>();
+
+  // Accepts draft token i with probability min(1, p(i) / q(i)), where p and q
+  // are the target and draft probabilities. The first rejected token is
+  // replaced by a sample of max(0, p - q), and a bonus token is sampled from
+  // the target model if they are all accepted.
+  std::vector<int> output_ids;
+  for (size_t i = 0; i <= num_draft_tokens_; ++i) {
+    MP_ASSIGN_OR_RETURN(
+        std::vector<float> probabilities,
+        sampler_->ComputeProbabilities(absl::MakeConstSpan(
+            target_logits + i * vocab_size, vocab_size)));
+    if (i < num_draft_tokens_) {
+      const int draft_id = draft_ids[i];
+      const std::vector<float>& draft_probability = draft_probabilities[i];
+      if (sampler_->SampleUniform() * draft_probability[draft_id] <
+          probabilities[draft_id]) {
+        output_ids.push_back(draft_id);
+        continue;
+      }
+      std::vector<float> residual(vocab_size);
+      float residual_sum = 0.0f;
+      for (size_t v = 0; v < vocab_size; ++v) {
+        residual[v] = std::max(probabilities[v] - draft_probability[v], 0.0f);
+        residual_sum += residual[v];
+      }
+      // Only rounding errors can leave the residual empty.
+      if (residual_sum > 0.0f) probabilities = std::move(residual);
+    }
+    MP_ASSIGN_OR_RETURN(int output_id,
+                        sampler_->SampleFromProbabilities(probabilities));
+    output_ids.push_back(output_id);
+    break;
+  }
+
+  // Rolls back the rejected draft tokens. The target model ran them all, and
+  // the draft model all but the last one.
+  const size_t num_accepted = output_ids.size() - 1;
+  MP_RETURN_IF_ERROR(target_->SeekTimeStep(
+      target_->TotalTokenSize() - (num_draft_tokens_ - num_accepted)));
+  if (num_accepted == num_draft_tokens_) {
+    draft_input_ids_ = {draft_ids.back(), output_ids.back()};
+  } else {
+    MP_RETURN_IF_ERROR(draft_->SeekTimeStep(
+        draft_->TotalTokenSize() - (num_draft_tokens_ - 1 - num_accepted)));
+    draft_input_ids_ = {output_ids.back()};
+  }
+
+  ++stats_.num_steps;
+  stats_.num_draft_tokens += num_draft_tokens_;
+  stats_.num_accepted_draft_tokens += num_accepted;
+  stats_.num_output_tokens += output_ids.size();
+  stats_.duration += absl::Now() - start_time;
+  return output_ids;
+}
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
@@ -0,0 +1,90 @@
+// Copyright 2024 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_SPECULATIVE_DECODER_H_
+#define MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_SPECULATIVE_DECODER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/llm.h"
+#include "mediapipe/tasks/cc/genai/inference/utils/xnn_utils/sampling.h"
+
+namespace mediapipe::tasks::genai::xnn_utils {
+
+// Generates the tokens of a target Llm with the help of a smaller draft Llm
+// sharing its vocabulary. Each step, the draft model proposes K tokens one at
+// a time, and the target model scores all of them in a single run, which
+// costs about as much as decoding one token as both are bound by the weight
+// reads. Draft tokens are accepted by rejection sampling, so that the output
+// follows the distribution of sampling the target model with `sampler`.
+class SpeculativeDecoder {
+ public:
+  struct Stats {
+    size_t num_steps = 0;
+    size_t num_draft_tokens = 0;
+    size_t num_accepted_draft_tokens = 0;
+    size_t num_output_tokens = 0;
+    // The time spent in Step().
+    absl::Duration duration;
+
+    // The fraction of the draft tokens accepted by the target model.
+    double AcceptanceRate() const;
+    // The number of output tokens per second of Step().
+    double TokensPerSecond() const;
+  };
+
+  // K is the LlmParams::draft_size_G of `target`, which must be positive. The
+  // draft model must have no draft tokens. Both models must have a batch size
+  // of 1, and outlive the decoder.
+  static absl::StatusOr<std::unique_ptr<SpeculativeDecoder>> Create(
+      Llm* target, Llm* draft, std::unique_ptr<Sampler> sampler);
+
+  // Restarts both models with `prompt_ids`, which must be longer than K + 1
+  // tokens as the target model computes the logits of the last K + 1 tokens
+  // of every run.
+  absl::Status Start(const std::vector<int>& prompt_ids);
+
+  // Generates between 1 and K + 1 tokens, which are added to both models.
+  // Returns OUT_OF_RANGE when the target model runs out of sequence length.
+  absl::StatusOr<std::vector<int>> Step();
+
+  // The stats of all the steps since the decoder was created.
+  const Stats& stats() const { return stats_; }
+
+ private:
+  SpeculativeDecoder(Llm* target, Llm* draft,
+                     std::unique_ptr<Sampler> sampler);
+
+  // Proposes K draft tokens, and their draft probabilities.
+  absl::Status Draft(std::vector<int>& draft_ids,
+                     std::vector<std::vector<float>>& draft_probabilities);
+
+  Llm* const target_;
+  Llm* const draft_;
+  const std::unique_ptr<Sampler> sampler_;
+  const size_t num_draft_tokens_;
+  // The tokens the draft model has yet to process. The last one is the last
+  // output token, which the target model has yet to process too.
+  std::vector<int> draft_input_ids_;
+  Stats stats_;
+};
+
+}  // namespace mediapipe::tasks::genai::xnn_utils
+
+#endif  // MEDIAPIPE_TASKS_GENAI_INFERENCE_UTILS_XNN_UTILS_SPECULATIVE_DECODER_H_
@@ -46,9 +46,12 @@ TfLiteWeightAccessor::TfLiteWeightAccessor(
   BuildWeightsMapFromTfliteModel(data);
 }
 
-TfLiteWeightAccessor::TfLiteWeightAccessor(absl::string_view filename) {
+TfLiteWeightAccessor::TfLiteWeightAccessor(absl::string_view filename,
+                                           bool lazy) {
   std::shared_ptr<MemoryMappedFile> mmap_file =
-      MemoryMappedFile::Create(filename).value_or(nullptr);
+      (lazy ? MemoryMappedFile::CreateLazy(filename)
+            : MemoryMappedFile::Create(filename))
+          .value_or(nullptr);
   if (mmap_file) {
     tflite_model_ = std::shared_ptr<const ::tflite::Model>(
         mmap_file, ::tflite::GetModel(mmap_file->data()));
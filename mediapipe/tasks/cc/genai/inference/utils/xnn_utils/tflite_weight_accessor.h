@@ -35,7 +35,8 @@ class TfLiteWeightAccessor : public WeightAccessor {
   // `tflite_model` alive, and assumes `data` outlives `tflite_model`.
   TfLiteWeightAccessor(std::shared_ptr<const tflite::Model> tflite_model,
                        char* data);
-  explicit TfLiteWeightAccessor(absl::string_view filename);
+  // If `lazy`, the weights are only read from `filename` once used.
+  explicit TfLiteWeightAccessor(absl::string_view filename, bool lazy = false);
   ~TfLiteWeightAccessor() override = default;
 
   // Returns Tensor wrapping the data buffer from tflite model. Possible errors:
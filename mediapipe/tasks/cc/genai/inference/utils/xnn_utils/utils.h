@@ -44,7 +44,10 @@ static constexpr absl::string_view kKeySelfAttentionReshapedWeight{
 static constexpr absl::string_view kKeyInDimLastInWeight{
     "in_dim_last_in_weight"};
 
-std::vector<float> FillXnnRoPEWeights(size_t max_seq_len, size_t num_channels);
+// Returns the cos and sin values of XNNPack RoPE for `max_seq_len` positions
+// from `start_position`, as [max_seq_len, num_channels].
+std::vector<float> FillXnnRoPEWeights(size_t max_seq_len, size_t num_channels,
+                                      size_t start_position = 0);
 
 // expect_size_bytes == 0 means don't check size.
 template <typename element_type = char>
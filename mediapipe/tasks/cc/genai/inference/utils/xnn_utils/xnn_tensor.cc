@@ -249,7 +249,8 @@ const void* Tensor::Data() const { return const_cast<Tensor*>(this)->Data(); }
 absl::Status Tensor::DefineInSubgraph(xnn_subgraph& subgraph, uint32_t flags) {
   uint32_t id;
   switch (datatype) {
-    case xnn_datatype_fp32: {
+    case xnn_datatype_fp32:
+    case xnn_datatype_fp16: {
       RET_CHECK_EQ(xnn_status_success,
                    xnn_define_tensor_value(
                        &subgraph, datatype, dims.size(), dims.data(),
@@ -191,7 +191,7 @@ struct Tensor {
   virtual absl::Status DefineInSubgraph(xnn_subgraph& subgraph, uint32_t flags);
 
   virtual size_t ElementSize(size_t num_elements) const {
-    return num_elements * 4;
+    return num_elements * (datatype == xnn_datatype_fp16 ? 2 : 4);
   }
 
   DimsType internal_dims;
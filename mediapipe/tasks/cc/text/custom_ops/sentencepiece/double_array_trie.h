@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef MEDIAPIPE_TASKS_CC_TEXT_CUSTOM_OPS_SENTENCEPIECE_DOUBLE_ARRAY_TRIE_H_
 #define MEDIAPIPE_TASKS_CC_TEXT_CUSTOM_OPS_SENTENCEPIECE_DOUBLE_ARRAY_TRIE_H_
 
+#include <cstdint>
+
 #include "mediapipe/tasks/cc/text/custom_ops/sentencepiece/config_generated.h"
 #include "mediapipe/tasks/cc/text/custom_ops/sentencepiece/utils.h"
 
@@ -45,13 +47,25 @@ class DoubleArrayTrie {
 
   // nodes and nodes_length specify the array of the nodes of the trie.
   explicit DoubleArrayTrie(const flatbuffers::Vector<uint32_t>* nodes)
-      : nodes_(nodes) {}
+      : DoubleArrayTrie(nodes->data(), nodes->size()) {}
+
+  // A trie of the `nodes_length` nodes at `nodes`, as built by BuildTrie(),
+  // e.g. memory mapped from a file.
+  DoubleArrayTrie(const uint32_t* nodes, uint32_t nodes_length)
+      : nodes_(nodes), nodes_length_(nodes_length) {}
 
   // Finds matches that are prefixes of a string.
   template <typename callback>
   void IteratePrefixMatches(const utils::string_view& input,
                             callback update_fn) const;
 
+  // Finds matches of `prefix` followed by prefixes of `input`, e.g. of
+  // WordPiece suffixes, with match lengths counted in `input`.
+  template <typename callback>
+  void IteratePrefixMatches(const utils::string_view& prefix,
+                            const utils::string_view& input,
+                            callback update_fn) const;
+
   // Finds the longest prefix match of a string.
   Match LongestPrefixMatch(const utils::string_view& input) const {
     Match match;
@@ -61,49 +75,77 @@ class DoubleArrayTrie {
 
  private:
   // Returns whether a node as a leaf as a child.
-  bool has_leaf(uint32_t i) const { return ((*nodes_)[i]) & 0x100; }
+  bool has_leaf(uint32_t i) const { return nodes_[i] & 0x100; }
 
   // Returns a value associated with a node. Available when a node is a leaf.
   int value(uint32_t i) const {
-    return static_cast<int>(((*nodes_)[i]) & 0x7fffffff);
+    return static_cast<int>(nodes_[i] & 0x7fffffff);
   }
 
   // Returns a label associated with a node.
   // A leaf node will have the MSB set and thus return an invalid label.
-  int32_t label(uint32_t i) const { return ((*nodes_)[i]) & 0x800000ff; }
+  int32_t label(uint32_t i) const { return nodes_[i] & 0x800000ff; }
 
   // Returns offset to children.
   int32_t offset(uint32_t i) const {
-    const uint32_t node = (*nodes_)[i];
+    const uint32_t node = nodes_[i];
     return (node >> 10) << ((node & 0x200) >> 6);
   }
 
-  const flatbuffers::Vector<uint32_t>* nodes_;
+  // Follows the characters of `input` from the node at `*pos`, calling
+  // `update_fn` on each match, and returns false if they are not all in the
+  // trie.
+  template <typename callback>
+  bool Traverse(const utils::string_view& input, uint32_t* pos,
+                callback update_fn) const;
+
+  const uint32_t* nodes_;
+  uint32_t nodes_length_;
 };
 
 template <typename callback>
-void DoubleArrayTrie::IteratePrefixMatches(const utils::string_view& input,
-                                           callback update_fn) const {
-  if (nodes_->size() == 0) {
-    return;
-  }
-  uint32_t pos = offset(0);
+bool DoubleArrayTrie::Traverse(const utils::string_view& input, uint32_t* pos,
+                               callback update_fn) const {
   for (int i = 0; i < input.length(); ++i) {
-    pos ^= static_cast<unsigned char>(input.at(i));
-    if (pos < 0 || pos >= nodes_->size() || label(pos) != input.at(i)) {
+    *pos ^= static_cast<unsigned char>(input.at(i));
+    if (*pos >= nodes_length_ || label(*pos) != input.at(i)) {
       // No match, exit.
-      return;
+      return false;
     }
-    const bool node_has_leaf = has_leaf(pos);
-    pos ^= offset(pos);
-    if (pos < 0 || pos >= nodes_->size()) {
+    const bool node_has_leaf = has_leaf(*pos);
+    *pos ^= offset(*pos);
+    if (*pos >= nodes_length_) {
       // We can get here only if the structure is corrupted.
-      return;
+      return false;
     }
     if (node_has_leaf) {
-      update_fn(Match(value(pos), i + 1));
+      update_fn(Match(value(*pos), i + 1));
     }
   }
+  return true;
+}
+
+template <typename callback>
+void DoubleArrayTrie::IteratePrefixMatches(const utils::string_view& input,
+                                           callback update_fn) const {
+  if (nodes_length_ == 0) {
+    return;
+  }
+  uint32_t pos = offset(0);
+  Traverse(input, &pos, update_fn);
+}
+
+template <typename callback>
+void DoubleArrayTrie::IteratePrefixMatches(const utils::string_view& prefix,
+                                           const utils::string_view& input,
+                                           callback update_fn) const {
+  if (nodes_length_ == 0) {
+    return;
+  }
+  uint32_t pos = offset(0);
+  if (Traverse(prefix, &pos, [](const Match&) {})) {
+    Traverse(input, &pos, update_fn);
+  }
 }
 
 }  // namespace mediapipe::tflite_operations::sentencepiece
@@ -70,4 +70,23 @@ TEST(DoubleArrayTrieTest, ComplexMatch) {
   EXPECT_THAT(matches, testing::ElementsAre(DoubleArrayTrie::Match(15, 8)));
 }
 
+TEST(DoubleArrayTrieTest, MatchWithPrefix) {
+  const std::vector<std::string> test_strings = {"A", "##A", "##AB", "B"};
+  const std::vector<uint32_t> nodes = BuildTrie(test_strings);
+  DoubleArrayTrie dat(nodes.data(), nodes.size());
+
+  std::vector<DoubleArrayTrie::Match> matches;
+  dat.IteratePrefixMatches(
+      utils::string_view("##"), utils::string_view("ABC"),
+      [&matches](const DoubleArrayTrie::Match& m) { matches.push_back(m); });
+  EXPECT_THAT(matches, testing::ElementsAre(DoubleArrayTrie::Match(1, 1),
+                                            DoubleArrayTrie::Match(2, 2)));
+
+  matches.clear();
+  dat.IteratePrefixMatches(
+      utils::string_view("#"), utils::string_view("A"),
+      [&matches](const DoubleArrayTrie::Match& m) { matches.push_back(m); });
+  EXPECT_TRUE(matches.empty());
+}
+
 }  // namespace mediapipe::tflite_operations::sentencepiece
@@ -0,0 +1,110 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/language_detector/streaming_language_detector.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/components/containers/category.h"
+#include "mediapipe/tasks/cc/components/containers/classification_result.h"
+#include "mediapipe/tasks/cc/text/language_detector/language_detector.h"
+#include "mediapipe/tasks/cc/text/utils/windowed_text_classifier.h"
+
+namespace mediapipe::tasks::text::language_detector {
+
+namespace {
+
+using ::mediapipe::tasks::components::containers::Category;
+using ::mediapipe::tasks::components::containers::ClassificationResult;
+using ::mediapipe::tasks::components::containers::Classifications;
+using ::mediapipe::tasks::text::utils::WindowedTextClassifier;
+
+// Converts `predictions` to a ClassificationResult of one head, whose
+// categories are only identified by the language codes.
+ClassificationResult ConvertToClassificationResult(
+    const LanguageDetectorResult& predictions) {
+  Classifications classifications{.head_index = 0};
+  for (const LanguageDetectorPrediction& prediction : predictions) {
+    classifications.categories.push_back(
+        {.index = 0,
+         .score = prediction.probability,
+         .category_name = prediction.language_code});
+  }
+  return {.classifications = {std::move(classifications)}};
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<StreamingLanguageDetector>>
+StreamingLanguageDetector::Create(
+    std::vector<std::unique_ptr<LanguageDetector>> language_detectors,
+    const StreamingLanguageDetectorOptions& options) {
+  std::vector<WindowedTextClassifier::ClassifyFn> classify_fns;
+  for (const std::unique_ptr<LanguageDetector>& language_detector :
+       language_detectors) {
+    classify_fns.push_back(
+        [language_detector = language_detector.get()](
+            absl::string_view window) -> absl::StatusOr<ClassificationResult> {
+          MP_ASSIGN_OR_RETURN(const LanguageDetectorResult predictions,
+                              language_detector->Detect(window));
+          return ConvertToClassificationResult(predictions);
+        });
+  }
+  auto streaming_language_detector = absl::WrapUnique(
+      new StreamingLanguageDetector(std::move(language_detectors)));
+  MP_ASSIGN_OR_RETURN(
+      streaming_language_detector->windowed_classifier_,
+      WindowedTextClassifier::Create(std::move(classify_fns), options));
+  return streaming_language_detector;
+}
+
+StreamingLanguageDetector::StreamingLanguageDetector(
+    std::vector<std::unique_ptr<LanguageDetector>> language_detectors)
+    : language_detectors_(std::move(language_detectors)) {}
+
+absl::Status StreamingLanguageDetector::Append(absl::string_view chunk) {
+  return windowed_classifier_->Append(chunk);
+}
+
+absl::StatusOr<LanguageDetectorResult> StreamingLanguageDetector::Finish() {
+  MP_ASSIGN_OR_RETURN(const ClassificationResult result,
+                      windowed_classifier_->Finish());
+  LanguageDetectorResult predictions;
+  for (const Classifications& classifications : result.classifications) {
+    for (const Category& category : classifications.categories) {
+      predictions.push_back({.language_code = *category.category_name,
+                             .probability = category.score});
+    }
+  }
+  return predictions;
+}
+
+absl::Status StreamingLanguageDetector::Close() {
+  absl::Status status;
+  for (const std::unique_ptr<LanguageDetector>& language_detector :
+       language_detectors_) {
+    status.Update(language_detector->Close());
+  }
+  return status;
+}
+
+}  // namespace mediapipe::tasks::text::language_detector
@@ -0,0 +1,75 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_TEXT_LANGUAGE_DETECTOR_STREAMING_LANGUAGE_DETECTOR_H_
+#define MEDIAPIPE_TASKS_CC_TEXT_LANGUAGE_DETECTOR_STREAMING_LANGUAGE_DETECTOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/tasks/cc/text/language_detector/language_detector.h"
+#include "mediapipe/tasks/cc/text/utils/windowed_text_classifier.h"
+
+namespace mediapipe::tasks::text::language_detector {
+
+// The options for configuring a StreamingLanguageDetector: the size of the
+// windows, and the maximum number of predictions and probability threshold
+// applied to the aggregated probabilities.
+using StreamingLanguageDetectorOptions = utils::WindowedClassificationOptions;
+
+// Predicts the languages of documents streamed in chunks, e.g. documents far
+// longer than the model input.
+//
+// The documents are split into overlapping windows, whose languages are
+// predicted in parallel by several LanguageDetectors, and the probabilities
+// are the means of those of the windows weighted by their sizes. Only a few
+// windows are held at a time, however long the documents are.
+class StreamingLanguageDetector {
+ public:
+  // Creates a StreamingLanguageDetector running each of `language_detectors`
+  // on its own thread. The language detectors should be created with the same
+  // model and without `max_results` or `score_threshold` in their classifier
+  // options, as the languages missing from the predictions of a window count
+  // as predicted with probability 0.
+  static absl::StatusOr<std::unique_ptr<StreamingLanguageDetector>> Create(
+      std::vector<std::unique_ptr<LanguageDetector>> language_detectors,
+      const StreamingLanguageDetectorOptions& options);
+
+  // Appends `chunk` to the document. After an error, Finish() must be called
+  // to start a new document.
+  absl::Status Append(absl::string_view chunk);
+
+  // Returns the predicted languages of the document. The next appended chunk
+  // starts a new document.
+  absl::StatusOr<LanguageDetectorResult> Finish();
+
+  // Shuts down the language detectors when all the work is done.
+  absl::Status Close();
+
+ private:
+  explicit StreamingLanguageDetector(
+      std::vector<std::unique_ptr<LanguageDetector>> language_detectors);
+
+  std::vector<std::unique_ptr<LanguageDetector>> language_detectors_;
+  // Destroyed before the language detectors it runs.
+  std::unique_ptr<utils::WindowedTextClassifier> windowed_classifier_;
+};
+
+}  // namespace mediapipe::tasks::text::language_detector
+
+#endif  // MEDIAPIPE_TASKS_CC_TEXT_LANGUAGE_DETECTOR_STREAMING_LANGUAGE_DETECTOR_H_
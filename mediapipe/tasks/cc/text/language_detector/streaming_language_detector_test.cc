@@ -0,0 +1,113 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/language_detector/streaming_language_detector.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/text/language_detector/language_detector.h"
+#include "tensorflow/lite/test_util.h"
+
+namespace mediapipe::tasks::text::language_detector {
+namespace {
+
+using ::mediapipe::file::JoinPath;
+using ::testing::FloatNear;
+
+constexpr char kTestDataDirectory[] = "/mediapipe/tasks/testdata/text/";
+constexpr char kLanguageDetector[] = "language_detector.tflite";
+constexpr int kNumLanguageDetectors = 2;
+constexpr float kTolerance = 0.000001;
+
+std::string GetFullPath(absl::string_view file_name) {
+  return JoinPath("./", kTestDataDirectory, file_name);
+}
+
+absl::StatusOr<std::vector<std::unique_ptr<LanguageDetector>>>
+CreateLanguageDetectors() {
+  std::vector<std::unique_ptr<LanguageDetector>> language_detectors;
+  for (int i = 0; i < kNumLanguageDetectors; ++i) {
+    auto options = std::make_unique<LanguageDetectorOptions>();
+    options->base_options.model_asset_path = GetFullPath(kLanguageDetector);
+    MP_ASSIGN_OR_RETURN(language_detectors.emplace_back(),
+                        LanguageDetector::Create(std::move(options)));
+  }
+  return language_detectors;
+}
+
+class StreamingLanguageDetectorTest : public tflite::testing::Test {};
+
+TEST_F(StreamingLanguageDetectorTest, ShortTextMatchesDetect) {
+  constexpr absl::string_view kText =
+      "To be, or not to be, that is the question";
+  MP_ASSERT_OK_AND_ASSIGN(auto language_detectors, CreateLanguageDetectors());
+  MP_ASSERT_OK_AND_ASSIGN(LanguageDetectorResult expected,
+                          language_detectors[0]->Detect(kText));
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<StreamingLanguageDetector> streaming_language_detector,
+      StreamingLanguageDetector::Create(std::move(language_detectors),
+                                        {.score_threshold = 0.3}));
+
+  MP_ASSERT_OK(streaming_language_detector->Append(kText));
+  MP_ASSERT_OK_AND_ASSIGN(LanguageDetectorResult result,
+                          streaming_language_detector->Finish());
+
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].language_code, "en");
+  EXPECT_EQ(result[0].language_code, expected[0].language_code);
+  EXPECT_THAT(result[0].probability,
+              FloatNear(expected[0].probability, kTolerance));
+  MP_ASSERT_OK(streaming_language_detector->Close());
+}
+
+TEST_F(StreamingLanguageDetectorTest, DetectsLanguagesOfLongDocuments) {
+  MP_ASSERT_OK_AND_ASSIGN(auto language_detectors, CreateLanguageDetectors());
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<StreamingLanguageDetector> streaming_language_detector,
+      StreamingLanguageDetector::Create(std::move(language_detectors),
+                                        {.max_results = 1}));
+
+  for (int i = 0; i < 200; ++i) {
+    MP_ASSERT_OK(streaming_language_detector->Append(
+        "Il y a beaucoup de bouches qui parlent et fort peu de têtes qui "
+        "pensent. "));
+  }
+  MP_ASSERT_OK_AND_ASSIGN(LanguageDetectorResult result_fr,
+                          streaming_language_detector->Finish());
+  ASSERT_EQ(result_fr.size(), 1);
+  EXPECT_EQ(result_fr[0].language_code, "fr");
+
+  for (int i = 0; i < 200; ++i) {
+    MP_ASSERT_OK(
+        streaming_language_detector->Append("это какой-то английский язык "));
+  }
+  MP_ASSERT_OK_AND_ASSIGN(LanguageDetectorResult result_ru,
+                          streaming_language_detector->Finish());
+  ASSERT_EQ(result_ru.size(), 1);
+  EXPECT_EQ(result_ru[0].language_code, "ru");
+  MP_ASSERT_OK(streaming_language_detector->Close());
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::text::language_detector
@@ -0,0 +1,79 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/text_classifier/streaming_text_classifier.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/text/text_classifier/text_classifier.h"
+#include "mediapipe/tasks/cc/text/utils/windowed_text_classifier.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace text {
+namespace text_classifier {
+
+using ::mediapipe::tasks::text::utils::WindowedTextClassifier;
+
+absl::StatusOr<std::unique_ptr<StreamingTextClassifier>>
+StreamingTextClassifier::Create(
+    std::vector<std::unique_ptr<TextClassifier>> classifiers,
+    const StreamingTextClassifierOptions& options) {
+  std::vector<WindowedTextClassifier::ClassifyFn> classify_fns;
+  for (const std::unique_ptr<TextClassifier>& classifier : classifiers) {
+    classify_fns.push_back(
+        [classifier = classifier.get()](absl::string_view window) {
+          return classifier->Classify(window);
+        });
+  }
+  auto streaming_classifier = absl::WrapUnique(
+      new StreamingTextClassifier(std::move(classifiers)));
+  MP_ASSIGN_OR_RETURN(
+      streaming_classifier->windowed_classifier_,
+      WindowedTextClassifier::Create(std::move(classify_fns), options));
+  return streaming_classifier;
+}
+
+StreamingTextClassifier::StreamingTextClassifier(
+    std::vector<std::unique_ptr<TextClassifier>> classifiers)
+    : classifiers_(std::move(classifiers)) {}
+
+absl::Status StreamingTextClassifier::Append(absl::string_view chunk) {
+  return windowed_classifier_->Append(chunk);
+}
+
+absl::StatusOr<TextClassifierResult> StreamingTextClassifier::Finish() {
+  return windowed_classifier_->Finish();
+}
+
+absl::Status StreamingTextClassifier::Close() {
+  absl::Status status;
+  for (const std::unique_ptr<TextClassifier>& classifier : classifiers_) {
+    status.Update(classifier->Close());
+  }
+  return status;
+}
+
+}  // namespace text_classifier
+}  // namespace text
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,81 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_TEXT_TEXT_CLASSIFIER_STREAMING_TEXT_CLASSIFIER_H_
+#define MEDIAPIPE_TASKS_CC_TEXT_TEXT_CLASSIFIER_STREAMING_TEXT_CLASSIFIER_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/tasks/cc/text/text_classifier/text_classifier.h"
+#include "mediapipe/tasks/cc/text/utils/windowed_text_classifier.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace text {
+namespace text_classifier {
+
+// The options for configuring a StreamingTextClassifier: the size of the
+// windows, and the maximum number of results and score threshold applied to
+// the aggregated scores.
+using StreamingTextClassifierOptions = utils::WindowedClassificationOptions;
+
+// Performs classification on documents streamed in chunks, e.g. documents
+// far longer than the sequence length of the model, which Classify() would
+// truncate.
+//
+// The documents are split into overlapping windows, which are classified in
+// parallel by several TextClassifiers, and the results are the means of the
+// scores of the windows weighted by their sizes. Only a few windows are held
+// at a time, however long the documents are.
+class StreamingTextClassifier {
+ public:
+  // Creates a StreamingTextClassifier running each of `classifiers` on its own
+  // thread. The classifiers should be created with the same model and without
+  // `max_results` or `score_threshold` in their classifier options, as the
+  // categories missing from the results of a window count as scored 0.
+  static absl::StatusOr<std::unique_ptr<StreamingTextClassifier>> Create(
+      std::vector<std::unique_ptr<TextClassifier>> classifiers,
+      const StreamingTextClassifierOptions& options);
+
+  // Appends `chunk` to the document. After an error, Finish() must be called
+  // to start a new document.
+  absl::Status Append(absl::string_view chunk);
+
+  // Returns the classification results of the document. The next appended
+  // chunk starts a new document.
+  absl::StatusOr<TextClassifierResult> Finish();
+
+  // Shuts down the classifiers when all the work is done.
+  absl::Status Close();
+
+ private:
+  explicit StreamingTextClassifier(
+      std::vector<std::unique_ptr<TextClassifier>> classifiers);
+
+  std::vector<std::unique_ptr<TextClassifier>> classifiers_;
+  // Destroyed before the classifiers it runs.
+  std::unique_ptr<utils::WindowedTextClassifier> windowed_classifier_;
+};
+
+}  // namespace text_classifier
+}  // namespace text
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_TEXT_TEXT_CLASSIFIER_STREAMING_TEXT_CLASSIFIER_H_
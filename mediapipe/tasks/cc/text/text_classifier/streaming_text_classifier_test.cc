@@ -0,0 +1,124 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/text_classifier/streaming_text_classifier.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/text/text_classifier/text_classifier.h"
+#include "tensorflow/lite/test_util.h"
+
+namespace mediapipe::tasks::text::text_classifier {
+namespace {
+
+using ::mediapipe::file::JoinPath;
+using ::testing::FloatNear;
+
+constexpr char kTestDataDirectory[] = "/mediapipe/tasks/testdata/text/";
+constexpr char kTestBertModelPath[] = "bert_text_classifier.tflite";
+constexpr int kNumClassifiers = 2;
+constexpr float kPrecision = 1e-5;
+
+std::string GetFullPath(absl::string_view file_name) {
+  return JoinPath("./", kTestDataDirectory, file_name);
+}
+
+absl::StatusOr<std::vector<std::unique_ptr<TextClassifier>>>
+CreateBertClassifiers() {
+  std::vector<std::unique_ptr<TextClassifier>> classifiers;
+  for (int i = 0; i < kNumClassifiers; ++i) {
+    auto options = std::make_unique<TextClassifierOptions>();
+    options->base_options.model_asset_path = GetFullPath(kTestBertModelPath);
+    MP_ASSIGN_OR_RETURN(classifiers.emplace_back(),
+                        TextClassifier::Create(std::move(options)));
+  }
+  return classifiers;
+}
+
+class StreamingTextClassifierTest : public tflite::testing::Test {};
+
+TEST_F(StreamingTextClassifierTest, ShortTextMatchesClassify) {
+  constexpr absl::string_view kText =
+      "it's a charming and often affecting journey";
+  MP_ASSERT_OK_AND_ASSIGN(auto classifiers, CreateBertClassifiers());
+  MP_ASSERT_OK_AND_ASSIGN(TextClassifierResult expected,
+                          classifiers[0]->Classify(kText));
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<StreamingTextClassifier> streaming_classifier,
+      StreamingTextClassifier::Create(std::move(classifiers), {}));
+
+  MP_ASSERT_OK(streaming_classifier->Append(kText.substr(0, 10)));
+  MP_ASSERT_OK(streaming_classifier->Append(kText.substr(10)));
+  MP_ASSERT_OK_AND_ASSIGN(TextClassifierResult result,
+                          streaming_classifier->Finish());
+
+  ASSERT_EQ(result.classifications.size(), 1);
+  EXPECT_EQ(result.classifications[0].head_name,
+            expected.classifications[0].head_name);
+  const auto& categories = result.classifications[0].categories;
+  const auto& expected_categories = expected.classifications[0].categories;
+  ASSERT_EQ(categories.size(), expected_categories.size());
+  for (int i = 0; i < categories.size(); ++i) {
+    EXPECT_EQ(categories[i].index, expected_categories[i].index);
+    EXPECT_EQ(categories[i].category_name,
+              expected_categories[i].category_name);
+    EXPECT_THAT(categories[i].score,
+                FloatNear(expected_categories[i].score, kPrecision));
+  }
+  MP_ASSERT_OK(streaming_classifier->Close());
+}
+
+TEST_F(StreamingTextClassifierTest, ClassifiesLongDocuments) {
+  MP_ASSERT_OK_AND_ASSIGN(auto classifiers, CreateBertClassifiers());
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<StreamingTextClassifier> streaming_classifier,
+      StreamingTextClassifier::Create(std::move(classifiers),
+                                      {.max_results = 1}));
+
+  for (int document = 0; document < 2; ++document) {
+    const absl::string_view sentence =
+        document == 0 ? "it's a charming and often affecting journey. "
+                      : "unflinchingly bleak and desperate. ";
+    for (int i = 0; i < 500; ++i) {
+      MP_ASSERT_OK(streaming_classifier->Append(sentence));
+    }
+    MP_ASSERT_OK_AND_ASSIGN(TextClassifierResult result,
+                            streaming_classifier->Finish());
+
+    ASSERT_EQ(result.classifications.size(), 1);
+    ASSERT_EQ(result.classifications[0].categories.size(), 1);
+    EXPECT_EQ(result.classifications[0].categories[0].category_name,
+              document == 0 ? "positive" : "negative");
+  }
+  MP_ASSERT_OK(streaming_classifier->Close());
+}
+
+TEST_F(StreamingTextClassifierTest, CreateFailsWithoutClassifiers) {
+  EXPECT_EQ(StreamingTextClassifier::Create({}, {}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::text::text_classifier
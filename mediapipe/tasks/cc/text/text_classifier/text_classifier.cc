@@ -75,6 +75,8 @@ ConvertTextClassifierOptionsToProto(TextClassifierOptions* options) {
               &(options->classifier_options)));
   options_proto->mutable_classifier_options()->Swap(
       classifier_options_proto.get());
+  options_proto->mutable_seq_len_buckets()->Assign(
+      options->seq_len_buckets.begin(), options->seq_len_buckets.end());
   return options_proto;
 }
 
@@ -17,6 +17,7 @@ limitations under the License.
 #define MEDIAPIPE_TASKS_CC_TEXT_TEXT_CLASSIFIER_TEXT_CLASSIFIER_H_
 
 #include <memory>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -44,6 +45,12 @@ struct TextClassifierOptions {
   // Options for configuring the classifier behavior, such as score threshold,
   // number of results, etc.
   components::processors::ClassifierOptions classifier_options;
+
+  // Increasing sequence lengths that the input tensors of BERT models with
+  // dynamic input shapes are padded to, e.g. {16, 32, 64, 128}. Short inputs
+  // then run with the smallest length fitting them, and longer inputs are
+  // truncated to the largest one. Ignored for other models.
+  std::vector<int> seq_len_buckets;
 };
 
 // Performs classification on text.
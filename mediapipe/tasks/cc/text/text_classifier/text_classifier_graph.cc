@@ -117,10 +117,12 @@ class TextClassifierGraph : public core::ModelTaskGraph {
     // stream.
     auto& preprocessing = graph.AddNode(
         "mediapipe.tasks.components.processors.TextPreprocessingGraph");
+    auto& preprocessing_options = preprocessing.GetOptions<
+        components::processors::proto::TextPreprocessingGraphOptions>();
     MP_RETURN_IF_ERROR(components::processors::ConfigureTextPreprocessingGraph(
-        model_resources,
-        preprocessing.GetOptions<
-            components::processors::proto::TextPreprocessingGraphOptions>()));
+        model_resources, preprocessing_options));
+    *preprocessing_options.mutable_seq_len_buckets() =
+        task_options.seq_len_buckets();
     text_in >> preprocessing.In(kTextTag);
 
     // Adds both InferenceCalculator and ModelResourcesCalculator.
@@ -71,6 +71,8 @@ ConvertTextEmbedderOptionsToProto(TextEmbedderOptions* options) {
           components::processors::ConvertEmbedderOptionsToProto(
               &(options->embedder_options)));
   options_proto->mutable_embedder_options()->Swap(embedder_options_proto.get());
+  options_proto->mutable_seq_len_buckets()->Assign(
+      options->seq_len_buckets.begin(), options->seq_len_buckets.end());
   return options_proto;
 }
 
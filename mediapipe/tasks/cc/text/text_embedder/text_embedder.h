@@ -17,6 +17,7 @@ limitations under the License.
 #define MEDIAPIPE_TASKS_CC_TEXT_TEXT_EMBEDDER_TEXT_EMBEDDER_H_
 
 #include <memory>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -41,6 +42,12 @@ struct TextEmbedderOptions {
   // Options for configuring the embedder behavior, such as L2-normalization or
   // scalar-quantization.
   components::processors::EmbedderOptions embedder_options;
+
+  // Increasing sequence lengths that the input tensors of BERT models with
+  // dynamic input shapes are padded to, e.g. {16, 32, 64, 128}. Short inputs
+  // then run with the smallest length fitting them, and longer inputs are
+  // truncated to the largest one. Ignored for other models.
+  std::vector<int> seq_len_buckets;
 };
 
 // Performs embedding extraction on text.
@@ -23,6 +23,7 @@ limitations under the License.
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -218,6 +219,37 @@ TEST_F(EmbedderTest, SucceedsWithMobileBertAndDifferentThemes) {
   MP_ASSERT_OK(text_embedder->Close());
 }
 
+TEST_F(EmbedderTest, SucceedsWithMobileBertAndSeqLenBuckets) {
+  auto options = std::make_unique<TextEmbedderOptions>();
+  options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, kMobileBert);
+  MP_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TextEmbedder> text_embedder,
+                          TextEmbedder::Create(std::move(options)));
+  auto bucketed_options = std::make_unique<TextEmbedderOptions>();
+  bucketed_options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, kMobileBert);
+  bucketed_options->seq_len_buckets = {16, 32, 64};
+  MP_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TextEmbedder> bucketed_text_embedder,
+                          TextEmbedder::Create(std::move(bucketed_options)));
+
+  // The padding is masked, so it barely changes the embeddings.
+  for (absl::string_view text :
+       {"a great trip", "it's a charming and often affecting journey"}) {
+    MP_ASSERT_OK_AND_ASSIGN(TextEmbedderResult result,
+                            text_embedder->Embed(text));
+    MP_ASSERT_OK_AND_ASSIGN(TextEmbedderResult bucketed_result,
+                            bucketed_text_embedder->Embed(text));
+    MP_ASSERT_OK_AND_ASSIGN(
+        double similarity,
+        TextEmbedder::CosineSimilarity(result.embeddings[0],
+                                       bucketed_result.embeddings[0]));
+    EXPECT_NEAR(similarity, 1.0, kSimilarityTolerancy);
+  }
+
+  MP_ASSERT_OK(text_embedder->Close());
+  MP_ASSERT_OK(bucketed_text_embedder->Close());
+}
+
 TEST_F(EmbedderTest, SucceedsWithUSEAndDifferentThemes) {
   auto options = std::make_unique<TextEmbedderOptions>();
   options->base_options.model_asset_path =
@@ -15,8 +15,18 @@ limitations under the License.
 
 #include "mediapipe/tasks/cc/text/tokenizers/bert_tokenizer.h"
 
+#include <cstddef>
 #include <cstdint>
-
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
+#include "mediapipe/tasks/cc/text/utils/vocab_utils.h"
 #include "tensorflow_text/core/kernels/regex_split.h"
 
 namespace mediapipe {
@@ -24,37 +34,53 @@ namespace tasks {
 namespace text {
 namespace tokenizers {
 
-FlatHashMapBackedWordpiece::FlatHashMapBackedWordpiece(
-    const std::vector<std::string>& vocab)
-    : vocab_{vocab} {
-  for (int i = 0; i < vocab_.size(); ++i) {
-    index_map_[vocab_[i]] = i;
+namespace {
+
+// Returns the vocabulary of a buffer with one word per line, or holding a
+// prebuilt TrieVocab.
+TrieVocab LoadTrieVocab(const char* vocab_buffer_data,
+                        size_t vocab_buffer_size) {
+  const absl::string_view buffer(vocab_buffer_data, vocab_buffer_size);
+  if (TrieVocab::IsBuffer(buffer)) {
+    // Copied, as the buffer may be unaligned and released after the tokenizer
+    // is created, e.g. a file associated with a model.
+    absl::StatusOr<TrieVocab> vocab = TrieVocab::CopyFromBuffer(buffer);
+    if (vocab.ok()) return *std::move(vocab);
   }
+  return TrieVocab(LoadVocabFromBuffer(vocab_buffer_data, vocab_buffer_size));
 }
 
-tensorflow::text::LookupStatus FlatHashMapBackedWordpiece::Contains(
-    absl::string_view key, bool* value) const {
-  *value = index_map_.contains(key);
-  return tensorflow::text::LookupStatus();
-}
-
-bool FlatHashMapBackedWordpiece::LookupId(const absl::string_view key,
-                                          int* result) const {
-  auto it = index_map_.find(key);
-  if (it == index_map_.end()) {
-    return false;
+}  // namespace
+
+BertTokenizer::BertTokenizer(const char* vocab_buffer_data,
+                             size_t vocab_buffer_size,
+                             const BertTokenizerOptions& options)
+    : BertTokenizer(LoadTrieVocab(vocab_buffer_data, vocab_buffer_size),
+                    options) {}
+
+BertTokenizer::BertTokenizer(TrieVocab vocab,
+                             const BertTokenizerOptions& options)
+    : vocab_{std::move(vocab)},
+      options_{options},
+      delim_re_{options.delim_str},
+      include_delim_re_{options.include_delim_str} {
+  if (!vocab_.LookupId(options_.unknown_token, &unknown_token_id_)) {
+    unknown_token_id_ = -1;
   }
-  *result = it->second;
-  return true;
 }
 
-bool FlatHashMapBackedWordpiece::LookupWord(int vocab_id,
-                                            absl::string_view* result) const {
-  if (vocab_id >= vocab_.size() || vocab_id < 0) {
-    return false;
+bool BertTokenizer::WordpieceTokenize(absl::string_view token,
+                                      std::vector<WordPiece>* pieces) const {
+  if (token.size() > options_.max_bytes_per_token) {
+    pieces->push_back({-1, 0, static_cast<int>(token.size())});
+    return true;
   }
-  *result = vocab_[vocab_id];
-  return true;
+  const size_t num_pieces = pieces->size();
+  vocab_.Wordpiece(token, options_.suffix_indicator,
+                   options_.max_chars_per_subtoken,
+                   options_.split_unknown_chars, pieces);
+  return !options_.split_unknown_chars && pieces->size() > num_pieces &&
+         (*pieces)[num_pieces].id < 0;
 }
 
 TokenizerResult BertTokenizer::Tokenize(const std::string& input) {
@@ -76,34 +102,74 @@ WordpieceTokenizerResult BertTokenizer::TokenizeWordpiece(
   tensorflow::text::RegexSplit(input, delim_re_, true, include_delim_re_,
                                &tokens, &begin_offsets, &end_offsets);
 
+  std::vector<WordPiece> pieces;
   for (int token_index = 0; token_index < tokens.size(); token_index++) {
-    auto& token = tokens[token_index];
-    int num_word_pieces = 0;
-    tensorflow::text::LookupStatus status = WordpieceTokenize(
-        token, options_.max_bytes_per_token, options_.max_chars_per_subtoken,
-        options_.suffix_indicator, options_.use_unknown_token,
-        options_.unknown_token, options_.split_unknown_chars, &vocab_,
-        &subwords, &wp_absolute_begin_offset, &wp_absolute_end_offset,
-        &num_word_pieces);
-
-    result.row_lengths.emplace_back(num_word_pieces);
-    // for the last num_word_pieces added into wp_absolute_begin_offset and
-    // wp_absolute_end_offset, offset them with begin_offsets[token_index]
-    int absolute_offset_size = wp_absolute_begin_offset.size();
-    for (int i = num_word_pieces; i > 0; i--) {
-      wp_absolute_begin_offset[absolute_offset_size - i] +=
-          begin_offsets[token_index];
-      wp_absolute_end_offset[absolute_offset_size - i] +=
-          begin_offsets[token_index];
-    }
-    if (!status.success) {
-      return result;
+    const absl::string_view token = tokens[token_index];
+    pieces.clear();
+    const bool unknown_token = WordpieceTokenize(token, &pieces);
+    for (const WordPiece& piece : pieces) {
+      int end = piece.end;
+      absl::string_view word;
+      if (piece.id >= 0 && vocab_.LookupWord(piece.id, &word)) {
+        subwords.emplace_back(word);
+      } else if (options_.use_unknown_token) {
+        subwords.push_back(options_.unknown_token);
+        // Like WordpieceTokenize(), which ends the unknown token of too long
+        // tokens at the length of the unknown token.
+        if (token.size() > options_.max_bytes_per_token) {
+          end = options_.unknown_token.size();
+        }
+      } else if (unknown_token || piece.begin == 0) {
+        subwords.emplace_back(token.substr(piece.begin, end - piece.begin));
+      } else {
+        subwords.push_back(
+            absl::StrCat(options_.suffix_indicator,
+                         token.substr(piece.begin, end - piece.begin)));
+      }
+      wp_absolute_begin_offset.push_back(begin_offsets[token_index] +
+                                         piece.begin);
+      wp_absolute_end_offset.push_back(begin_offsets[token_index] + end);
     }
+    result.row_lengths.emplace_back(pieces.size());
   }
 
   return result;
 }
 
+int BertTokenizer::TokenizeIds(absl::string_view input, int unknown_id,
+                               absl::Span<int32_t> ids) {
+  std::vector<absl::string_view> tokens;
+  std::vector<long long> begin_offsets;
+  std::vector<long long> end_offsets;
+  tensorflow::text::RegexSplit(input, delim_re_, true, include_delim_re_,
+                               &tokens, &begin_offsets, &end_offsets);
+
+  int num_ids = 0;
+  // Reused across tokens.
+  std::vector<WordPiece> pieces;
+  for (absl::string_view token : tokens) {
+    pieces.clear();
+    const bool unknown_token = WordpieceTokenize(token, &pieces);
+    for (const WordPiece& piece : pieces) {
+      int id = piece.id;
+      if (id < 0) {
+        // The unknown token, or else the unknown token or character itself.
+        int token_id;
+        if (options_.use_unknown_token) {
+          id = unknown_token_id_;
+        } else if (unknown_token && vocab_.LookupId(token, &token_id)) {
+          id = token_id;
+        }
+      }
+      if (num_ids < ids.size()) {
+        ids[num_ids] = id >= 0 ? id : unknown_id;
+      }
+      ++num_ids;
+    }
+  }
+  return num_ids;
+}
+
 }  // namespace tokenizers
 }  // namespace text
 }  // namespace tasks
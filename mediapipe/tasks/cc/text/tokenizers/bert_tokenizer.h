@@ -17,13 +17,15 @@ limitations under the License.
 #define MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_BERT_TOKENIZER_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "mediapipe/tasks/cc/text/tokenizers/tokenizer.h"
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
 #include "mediapipe/tasks/cc/text/utils/vocab_utils.h"
 #include "re2/re2.h"
 #include "tensorflow_text/core/kernels/wordpiece_tokenizer.h"
@@ -68,34 +70,20 @@ struct BertTokenizerOptions {
   std::string include_delim_str = kDefaultIncludeDelimRe;
 };
 
-// A flat-hash-map based implementation of WordpieceVocab, used in
-// BertTokenizer to invoke tensorflow::text::WordpieceTokenize within.
-class FlatHashMapBackedWordpiece : public tensorflow::text::WordpieceVocab {
- public:
-  explicit FlatHashMapBackedWordpiece(const std::vector<std::string>& vocab);
-
-  tensorflow::text::LookupStatus Contains(absl::string_view key,
-                                          bool* value) const override;
-  bool LookupId(absl::string_view key, int* result) const;
-  bool LookupWord(int vocab_id, absl::string_view* result) const;
-  int VocabularySize() const { return vocab_.size(); }
-
- private:
-  // All words indexed position in vocabulary file.
-  std::vector<std::string> vocab_;
-  absl::flat_hash_map<absl::string_view, int> index_map_;
-};
-
 // Wordpiece tokenizer for bert models. Initialized with a vocab file or vector.
+// Word pieces are matched in a TrieVocab, like
+// tensorflow::text::WordpieceTokenize() would in a hash map.
 class BertTokenizer : public mediapipe::tasks::text::tokenizers::Tokenizer {
  public:
   // Initialize the tokenizer from vocab vector and tokenizer configs.
   explicit BertTokenizer(const std::vector<std::string>& vocab,
                          const BertTokenizerOptions& options = {})
-      : vocab_{FlatHashMapBackedWordpiece(vocab)},
-        options_{options},
-        delim_re_{options.delim_str},
-        include_delim_re_{options.include_delim_str} {}
+      : BertTokenizer(TrieVocab(vocab), options) {}
+
+  // Initialize the tokenizer from a vocab trie, e.g. built or memory mapped
+  // once for several tokenizers, and tokenizer configs.
+  explicit BertTokenizer(TrieVocab vocab,
+                         const BertTokenizerOptions& options = {});
 
   // Initialize the tokenizer from file path to vocab and tokenizer configs.
   explicit BertTokenizer(const std::string& path_to_vocab,
@@ -104,12 +92,10 @@ class BertTokenizer : public mediapipe::tasks::text::tokenizers::Tokenizer {
                       options) {}
 
   // Initialize the tokenizer from buffer and size of vocab and tokenizer
-  // configs.
+  // configs. The buffer holds either one word per line, or the buffer() of a
+  // prebuilt TrieVocab, which is copied instead of building the trie again.
   BertTokenizer(const char* vocab_buffer_data, size_t vocab_buffer_size,
-                const BertTokenizerOptions& options = {})
-      : BertTokenizer(mediapipe::tasks::text::LoadVocabFromBuffer(
-                          vocab_buffer_data, vocab_buffer_size),
-                      options) {}
+                const BertTokenizerOptions& options = {});
 
   // Perform tokenization, return tokenized results containing the subwords.
   TokenizerResult Tokenize(const std::string& input) override;
@@ -118,10 +104,17 @@ class BertTokenizer : public mediapipe::tasks::text::tokenizers::Tokenizer {
   // subwords and offsets
   WordpieceTokenizerResult TokenizeWordpiece(const std::string& input) const;
 
+  // Writes the ids of the word pieces matched in the vocabulary trie, without
+  // building their strings.
+  int TokenizeIds(absl::string_view input, int unknown_id,
+                  absl::Span<int32_t> ids) override;
+
   // Check if a certain key is included in the vocab.
   tensorflow::text::LookupStatus Contains(const absl::string_view key,
                                           bool* value) const {
-    return vocab_.Contains(key, value);
+    int id;
+    *value = vocab_.LookupId(key, &id);
+    return tensorflow::text::LookupStatus();
   }
 
   // Find the id of a wordpiece.
@@ -134,11 +127,18 @@ class BertTokenizer : public mediapipe::tasks::text::tokenizers::Tokenizer {
     return vocab_.LookupWord(vocab_id, result);
   }
 
-  int VocabularySize() const { return vocab_.VocabularySize(); }
+  int VocabularySize() const { return vocab_.size(); }
 
  private:
-  mediapipe::tasks::text::tokenizers::FlatHashMapBackedWordpiece vocab_;
+  // Appends the word pieces of `token` to `pieces`, with -1 ids for the
+  // unknown ones, and returns whether the whole token is unknown.
+  bool WordpieceTokenize(absl::string_view token,
+                         std::vector<WordPiece>* pieces) const;
+
+  TrieVocab vocab_;
   BertTokenizerOptions options_;
+  // The id of `options_.unknown_token`, or -1 if it isn't in the vocabulary.
+  int unknown_token_id_ = -1;
   RE2 delim_re_;
   RE2 include_delim_re_;
 };
@@ -15,9 +15,19 @@ limitations under the License.
 
 #include "mediapipe/tasks/cc/text/tokenizers/bert_tokenizer.h"
 
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/tasks/cc/core/utils.h"
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
 
 namespace mediapipe {
 namespace tasks {
@@ -26,10 +36,25 @@ namespace tokenizers {
 
 using ::mediapipe::tasks::core::LoadBinaryContent;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 
 namespace {
 constexpr char kTestVocabPath[] =
     "mediapipe/tasks/testdata/text/mobilebert_vocab.txt";
+constexpr char kTestText[] =
+    "i'm questionansweraskask, what is the capital of france? paris.";
+
+// Returns the ids of the subwords of Tokenize().
+std::vector<int32_t> TokenizeAndLookupIds(Tokenizer& tokenizer,
+                                          const std::string& input,
+                                          int unknown_id) {
+  std::vector<int32_t> ids;
+  for (const std::string& subword : tokenizer.Tokenize(input).subwords) {
+    int id;
+    ids.push_back(tokenizer.LookupId(subword, &id) ? id : unknown_id);
+  }
+  return ids;
+}
 }  // namespace
 
 void AssertTokenizerResults(std::unique_ptr<BertTokenizer> tokenizer) {
@@ -73,6 +98,43 @@ TEST(TokenizerTest, TestTokenizerCreationFromVector) {
   AssertTokenizerResults(std::move(tokenizer));
 }
 
+TEST(TokenizerTest, TestTokenizerCreationFromTrieVocab) {
+  const TrieVocab vocab({"i", "'", "m", "question"});
+  MP_ASSERT_OK_AND_ASSIGN(TrieVocab mapped_vocab,
+                          TrieVocab::FromBuffer(vocab.buffer()));
+  auto tokenizer = absl::make_unique<BertTokenizer>(std::move(mapped_vocab));
+
+  AssertTokenizerResults(std::move(tokenizer));
+}
+
+TEST(TokenizerTest, TestTokenizerCreationFromTrieVocabBuffer) {
+  const TrieVocab vocab({"i", "'", "m", "question"});
+  // Unaligned, like a file associated with a model.
+  const std::string buffer = absl::StrCat(" ", vocab.buffer());
+  auto tokenizer = absl::make_unique<BertTokenizer>(buffer.data() + 1,
+                                                    buffer.size() - 1);
+
+  AssertTokenizerResults(std::move(tokenizer));
+}
+
+TEST(TokenizerTest, TestTokenizerLooksUpEveryId) {
+  auto tokenizer = absl::make_unique<BertTokenizer>(
+      std::vector<std::string>{"[UNK]", "i", "", "i"});
+
+  EXPECT_EQ(tokenizer->VocabularySize(), 4);
+  absl::string_view word;
+  ASSERT_TRUE(tokenizer->LookupWord(1, &word));
+  EXPECT_EQ(word, "i");
+  ASSERT_TRUE(tokenizer->LookupWord(2, &word));
+  EXPECT_EQ(word, "");
+  ASSERT_TRUE(tokenizer->LookupWord(3, &word));
+  EXPECT_EQ(word, "i");
+  EXPECT_FALSE(tokenizer->LookupWord(4, &word));
+  int id;
+  ASSERT_TRUE(tokenizer->LookupId("i", &id));
+  EXPECT_EQ(id, 3);
+}
+
 TEST(TokenizerTest, TestTokenizerMultipleRows) {
 #ifdef _WIN32
   // TODO: Investigate why these tests are failing
@@ -106,6 +168,27 @@ TEST(TokenizerTest, TestTokenizerUnknownTokens) {
   EXPECT_THAT(results.row_lengths, ElementsAre(1, 1, 1, 1));
 }
 
+TEST(TokenizerTest, TestTokenizerSplitUnknownChars) {
+  std::vector<std::string> vocab;
+  vocab.emplace_back("i");
+  vocab.emplace_back("##m");
+  vocab.emplace_back("[UNK]");
+  BertTokenizerOptions options;
+  options.split_unknown_chars = true;
+  auto tokenizer = absl::make_unique<BertTokenizer>(vocab, options);
+
+  auto results = tokenizer->TokenizeWordpiece("ixm");
+
+  EXPECT_THAT(results.subwords, ElementsAre("i", kDefaultUnknownToken, "##m"));
+  EXPECT_THAT(results.wp_begin_offset, ElementsAre(0, 1, 2));
+  EXPECT_THAT(results.wp_end_offset, ElementsAre(1, 2, 3));
+  std::vector<int32_t> ids(3);
+  EXPECT_EQ(tokenizer->TokenizeIds("ixm", /*unknown_id=*/-1,
+                                   absl::MakeSpan(ids)),
+            3);
+  EXPECT_THAT(ids, ElementsAre(0, 2, 1));
+}
+
 TEST(TokenizerTest, TestLookupId) {
   std::vector<std::string> vocab;
   vocab.emplace_back("i");
@@ -181,6 +264,72 @@ TEST(TokenizerTest, TestLVocabularySize) {
   ASSERT_EQ(tokenizer->VocabularySize(), 4);
 }
 
+TEST(TokenizerTest, TestTokenizeIdsMatchesTokenize) {
+#ifdef _WIN32
+  // TODO: Investigate why these tests are failing
+  GTEST_SKIP("Unexpected result on Windows");
+#endif  // _WIN32
+  auto tokenizer = absl::make_unique<BertTokenizer>(kTestVocabPath);
+  const std::vector<int32_t> expected_ids =
+      TokenizeAndLookupIds(*tokenizer, kTestText, /*unknown_id=*/-1);
+
+  std::vector<int32_t> ids(expected_ids.size());
+  EXPECT_EQ(tokenizer->TokenizeIds(kTestText, /*unknown_id=*/-1,
+                                   absl::MakeSpan(ids)),
+            expected_ids.size());
+  EXPECT_THAT(ids, ElementsAreArray(expected_ids));
+}
+
+TEST(TokenizerTest, TestTokenizeIdsUnknownTokens) {
+  std::vector<std::string> vocab;
+  vocab.emplace_back("i");
+  vocab.emplace_back("'");
+  vocab.emplace_back("m");
+  vocab.emplace_back("question");
+  auto tokenizer = absl::make_unique<BertTokenizer>(vocab);
+
+  std::vector<int32_t> ids(4);
+  EXPECT_EQ(tokenizer->TokenizeIds("i'm questionansweraskask",
+                                   /*unknown_id=*/-1, absl::MakeSpan(ids)),
+            4);
+  EXPECT_THAT(ids, ElementsAre(0, 1, 2, -1));
+}
+
+TEST(TokenizerTest, TestTokenizeIdsTruncatesToOutputSize) {
+  std::vector<std::string> vocab;
+  vocab.emplace_back("i");
+  vocab.emplace_back("'");
+  vocab.emplace_back("m");
+  vocab.emplace_back("question");
+  auto tokenizer = absl::make_unique<BertTokenizer>(vocab);
+
+  std::vector<int32_t> ids(2, -2);
+  EXPECT_EQ(tokenizer->TokenizeIds("i'm question", /*unknown_id=*/-1,
+                                   absl::MakeSpan(ids)),
+            4);
+  EXPECT_THAT(ids, ElementsAre(0, 1));
+}
+
+// Benchmarks tokenizing text into ids. Args: 0 to tokenize into strings and
+// look up their ids, 1 to use TokenizeIds().
+void BM_BertTokenizeIds(benchmark::State& state) {
+  BertTokenizer tokenizer(kTestVocabPath);
+  std::string text;
+  for (int i = 0; i < 32; ++i) absl::StrAppend(&text, kTestText, " ");
+  std::vector<int32_t> ids(1024);
+  int num_tokens = 0;
+  for (auto s : state) {
+    if (state.range(0) == 0) {
+      num_tokens = TokenizeAndLookupIds(tokenizer, text, 0).size();
+    } else {
+      num_tokens = tokenizer.TokenizeIds(text, 0, absl::MakeSpan(ids));
+    }
+    benchmark::DoNotOptimize(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * num_tokens);
+}
+BENCHMARK(BM_BertTokenizeIds)->Arg(0)->Arg(1);
+
 }  // namespace tokenizers
 }  // namespace text
 }  // namespace tasks
@@ -15,9 +15,16 @@ limitations under the License.
 
 #include "mediapipe/tasks/cc/text/tokenizers/regex_tokenizer.h"
 
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
 #include "mediapipe/tasks/cc/text/utils/vocab_utils.h"
 
 namespace mediapipe {
@@ -34,12 +41,16 @@ constexpr char kStart[] = "<START>";
 constexpr char kPad[] = "<PAD>";
 constexpr char kUnknown[] = "<UNKNOWN>";
 
-void buildIndexTokenMap(
-    const absl::node_hash_map<std::string, int>& token_index_map,
-    absl::node_hash_map<int, absl::string_view>* index_token_map) {
-  for (const auto& token : token_index_map) {
-    (*index_token_map)[token.second] = token.first;
+TrieVocab BuildVocab(const absl::node_hash_map<std::string, int>& token_ids) {
+  std::vector<std::string> tokens;
+  std::vector<int> ids;
+  tokens.reserve(token_ids.size());
+  ids.reserve(token_ids.size());
+  for (const auto& [token, id] : token_ids) {
+    tokens.push_back(token);
+    ids.push_back(id);
   }
+  return TrieVocab(tokens, ids);
 }
 
 }  // namespace
@@ -51,64 +62,66 @@ void buildIndexTokenMap(
 RegexTokenizer::RegexTokenizer(const std::string& regex_pattern,
                                const std::string& path_to_vocab)
     : delim_re_{absl::Substitute("($0)", regex_pattern)},
-      token_index_map_{LoadVocabAndIndexFromFile(path_to_vocab)} {
-  buildIndexTokenMap(token_index_map_, &index_token_map_);
-}
+      vocab_{BuildVocab(LoadVocabAndIndexFromFile(path_to_vocab))} {}
 
 RegexTokenizer::RegexTokenizer(const std::string& regex_pattern,
                                const char* vocab_buffer_data,
                                size_t vocab_buffer_size)
     : delim_re_{absl::Substitute("($0)", regex_pattern)},
-      token_index_map_{
-          LoadVocabAndIndexFromBuffer(vocab_buffer_data, vocab_buffer_size)} {
-  buildIndexTokenMap(token_index_map_, &index_token_map_);
-}
+      vocab_{BuildVocab(
+          LoadVocabAndIndexFromBuffer(vocab_buffer_data, vocab_buffer_size))} {}
 
-TokenizerResult RegexTokenizer::Tokenize(const std::string& input) {
-  absl::string_view leftover(input.data());
+template <typename TokenFn>
+void RegexTokenizer::ForEachToken(absl::string_view input, TokenFn fn) const {
+  absl::string_view leftover = input;
   absl::string_view last_end = leftover;
 
-  TokenizerResult result;
-
   // Keep looking for split points until we have reached the end of the input.
   absl::string_view extracted_delim_token;
   while (RE2::FindAndConsume(&leftover, delim_re_, &extracted_delim_token)) {
     absl::string_view token(last_end.data(),
                             extracted_delim_token.data() - last_end.data());
-    bool has_non_empty_token = token.length() > 0;
-
     last_end = leftover;
 
     // Mark the end of the previous token, only if there was something.
-    if (has_non_empty_token) {
-      result.subwords.push_back(std::string(token));
+    if (!token.empty()) {
+      fn(token);
     }
   }
 
   // Close the last token.
   if (!leftover.empty()) {
-    result.subwords.push_back(std::string(leftover));
+    fn(leftover);
   }
+}
 
+TokenizerResult RegexTokenizer::Tokenize(const std::string& input) {
+  TokenizerResult result;
+  ForEachToken(input, [&result](absl::string_view token) {
+    result.subwords.push_back(std::string(token));
+  });
   return result;
 }
 
+int RegexTokenizer::TokenizeIds(absl::string_view input, int unknown_id,
+                                absl::Span<int32_t> ids) {
+  int num_tokens = 0;
+  ForEachToken(input, [&](absl::string_view token) {
+    if (num_tokens < ids.size()) {
+      int id;
+      ids[num_tokens] = LookupId(token, &id) ? id : unknown_id;
+    }
+    ++num_tokens;
+  });
+  return num_tokens;
+}
+
 bool RegexTokenizer::LookupId(absl::string_view key, int* result) const {
-  auto it = token_index_map_.find(key);
-  if (it == token_index_map_.end()) {
-    return false;
-  }
-  *result = it->second;
-  return true;
+  return vocab_.LookupId(key, result);
 }
 
 bool RegexTokenizer::LookupWord(int vocab_id, absl::string_view* result) const {
-  auto it = index_token_map_.find(vocab_id);
-  if (it == index_token_map_.end()) {
-    return false;
-  }
-  *result = it->second;
-  return true;
+  return vocab_.LookupWord(vocab_id, result);
 }
 
 bool RegexTokenizer::GetStartToken(int* start_token) {
@@ -17,11 +17,13 @@ limitations under the License.
 #define MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_REGEX_TOKENIZER_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
-#include "absl/container/node_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "mediapipe/tasks/cc/text/tokenizers/tokenizer.h"
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
 #include "re2/re2.h"
 
 namespace mediapipe {
@@ -41,6 +43,10 @@ class RegexTokenizer : public Tokenizer {
 
   TokenizerResult Tokenize(const std::string& input) override;
 
+  // Looks up the tokens of `input` as views into it, without copies.
+  int TokenizeIds(absl::string_view input, int unknown_id,
+                  absl::Span<int32_t> ids) override;
+
   bool LookupId(absl::string_view key, int* result) const override;
 
   bool LookupWord(int vocab_id, absl::string_view* result) const override;
@@ -50,9 +56,12 @@ class RegexTokenizer : public Tokenizer {
   bool GetUnknownToken(int* unknown_token);
 
  private:
+  // Calls `fn` on each non-empty token of `input`, in order.
+  template <typename TokenFn>
+  void ForEachToken(absl::string_view input, TokenFn fn) const;
+
   RE2 delim_re_;
-  absl::node_hash_map<std::string, int> token_index_map_;
-  absl::node_hash_map<int, absl::string_view> index_token_map_;
+  TrieVocab vocab_;
 };
 
 }  // namespace tokenizers
@@ -15,6 +15,13 @@ limitations under the License.
 
 #include "mediapipe/tasks/cc/text/tokenizers/regex_tokenizer.h"
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/tasks/cc/core/utils.h"
@@ -121,8 +128,53 @@ TEST(RegexTokenizerTest, TestGetSpecialTokensFailure) {
   ASSERT_FALSE(tokenizer->GetUnknownToken(&unknown_token));
 }
 
+TEST(RegexTokenizerTest, TestTokenizeIds) {
+  auto tokenizer = CreateRegexTokenizer(kRegex, kTestRegexVocabPath);
+  std::vector<int32_t> ids(6, -2);
+  EXPECT_EQ(tokenizer->TokenizeIds("good    morning, i'm your teacher xyzzy.\n",
+                                   /*unknown_id=*/-1, absl::MakeSpan(ids)),
+            6);
+  EXPECT_THAT(ids, ElementsAre(52, 1972, 146, 129, 1750, -1));
+}
+
+TEST(RegexTokenizerTest, TestTokenizeIdsTruncatesToOutputSize) {
+  auto tokenizer = CreateRegexTokenizer(kRegex, kTestRegexVocabPath);
+  std::vector<int32_t> ids(2, -2);
+  EXPECT_EQ(tokenizer->TokenizeIds("good    morning, i'm your teacher.\n",
+                                   /*unknown_id=*/-1, absl::MakeSpan(ids)),
+            5);
+  EXPECT_THAT(ids, ElementsAre(52, 1972));
+}
+
 }  // namespace
 
+// Benchmarks tokenizing text into ids. Args: 0 to tokenize into strings and
+// look up their ids, 1 to use TokenizeIds().
+void BM_RegexTokenizeIds(benchmark::State& state) {
+  auto tokenizer = CreateRegexTokenizer(kRegex, kTestRegexVocabPath);
+  std::string text;
+  for (int i = 0; i < 64; ++i) {
+    absl::StrAppend(&text, "good    morning, i'm your teacher.\n");
+  }
+  std::vector<int32_t> ids(512);
+  int num_tokens = 0;
+  for (auto s : state) {
+    if (state.range(0) == 0) {
+      const TokenizerResult result = tokenizer->Tokenize(text);
+      for (int i = 0; i < result.subwords.size(); ++i) {
+        int id;
+        ids[i] = tokenizer->LookupId(result.subwords[i], &id) ? id : 0;
+      }
+      num_tokens = result.subwords.size();
+    } else {
+      num_tokens = tokenizer->TokenizeIds(text, 0, absl::MakeSpan(ids));
+    }
+    benchmark::DoNotOptimize(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * num_tokens);
+}
+BENCHMARK(BM_RegexTokenizeIds)->Arg(0)->Arg(1);
+
 }  // namespace tokenizers
 }  // namespace text
 }  // namespace tasks
@@ -16,13 +16,16 @@ limitations under the License.
 #ifndef MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_SENTENCEPIECE_TOKENIZER_H_
 #define MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_SENTENCEPIECE_TOKENIZER_H_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <vector>
 
 #include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/tasks/cc/text/tokenizers/tokenizer.h"
 #include "sentencepiece/src/sentencepiece_processor.h"  // from @com_google_sentencepiece
@@ -61,6 +64,18 @@ class SentencePieceTokenizer : public Tokenizer {
     return result;
   }
 
+  // Encodes `input` to ids directly. Pieces are never missing from the
+  // vocabulary, so `unknown_id` is unused.
+  int TokenizeIds(absl::string_view input, int unknown_id,
+                  absl::Span<int32_t> ids) override {
+    std::vector<int> token_ids;
+    const auto status = sp_.Encode(input, &token_ids);
+    ABSL_CHECK(status.ok()) << status.ToString();
+    std::copy_n(token_ids.begin(), std::min(token_ids.size(), ids.size()),
+                ids.begin());
+    return token_ids.size();
+  }
+
   // Find the id of a string token.
   bool LookupId(absl::string_view key, int* result) const override {
     *result = sp_.PieceToId(key);
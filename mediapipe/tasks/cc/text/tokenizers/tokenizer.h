@@ -16,11 +16,15 @@ limitations under the License.
 #ifndef MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_TOKENIZER_H_
 #define MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_TOKENIZER_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mediapipe {
 namespace tasks {
@@ -37,6 +41,22 @@ class Tokenizer {
   // Perform tokenization to get tokenized results.
   virtual TokenizerResult Tokenize(const std::string& input) = 0;
 
+  // Writes the vocabulary ids of the tokens of `input` to `ids`, with
+  // `unknown_id` for the tokens missing from the vocabulary, and returns the
+  // number of tokens of `input`. If there are more tokens than `ids` can hold,
+  // only the first ones are written. Unlike Tokenize(), implementations need
+  // not build a string per token.
+  virtual int TokenizeIds(absl::string_view input, int unknown_id,
+                          absl::Span<int32_t> ids) {
+    TokenizerResult result = Tokenize(std::string(input));
+    const size_t num_ids = std::min(result.subwords.size(), ids.size());
+    for (size_t i = 0; i < num_ids; ++i) {
+      int id;
+      ids[i] = LookupId(result.subwords[i], &id) ? id : unknown_id;
+    }
+    return result.subwords.size();
+  }
+
   // Find the id of a string token.
   virtual bool LookupId(absl::string_view key, int* result) const = 0;
 
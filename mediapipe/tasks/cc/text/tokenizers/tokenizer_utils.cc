@@ -111,6 +111,8 @@ absl::StatusOr<std::unique_ptr<Tokenizer>> CreateTokenizerFromProcessUnit(
       MP_ASSIGN_OR_RETURN(absl::string_view vocab_buffer,
                           CheckAndLoadFirstAssociatedFile(options->vocab_file(),
                                                           metadata_extractor));
+      // The vocabulary file may also hold a prebuilt TrieVocab, which saves
+      // building the trie of a large vocabulary when the model is loaded.
       return std::make_unique<BertTokenizer>(vocab_buffer.data(),
                                              vocab_buffer.size());
     }
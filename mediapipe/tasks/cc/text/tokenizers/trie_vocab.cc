@@ -0,0 +1,281 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/text/custom_ops/sentencepiece/double_array_trie.h"
+#include "mediapipe/tasks/cc/text/custom_ops/sentencepiece/double_array_trie_builder.h"
+#include "mediapipe/tasks/cc/text/custom_ops/sentencepiece/utils.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace text {
+namespace tokenizers {
+
+namespace {
+
+using ::mediapipe::tflite_operations::sentencepiece::BuildTrie;
+using ::mediapipe::tflite_operations::sentencepiece::DoubleArrayTrie;
+using ::mediapipe::tflite_operations::sentencepiece::utils::string_view;
+
+// The buffer starts with kMagic, the number of trie nodes and the number of
+// ids, followed by the trie nodes, the offsets of the word of each id and of
+// their end, and the words.
+constexpr int kHeaderSize = 3;
+
+// Starts the buffer. A vocabulary file can't start with a null character.
+constexpr char kMagic[sizeof(uint32_t)] = {'\0', 'T', 'V', '1'};
+
+// Marks the word offset of an id without a word.
+constexpr uint32_t kNoWord = uint32_t{1} << 31;
+
+string_view ToTrieStringView(absl::string_view s) {
+  return string_view(s.data(), s.size());
+}
+
+// Returns the number of bytes of the UTF-8 character starting `s`, or 1 if
+// it is invalid.
+int CharLength(absl::string_view s) {
+  const unsigned char lead = s[0];
+  const int length = lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+  if (length > s.size()) return 1;
+  for (int i = 1; i < length; ++i) {
+    if ((static_cast<unsigned char>(s[i]) & 0xC0) != 0x80) return 1;
+  }
+  return length;
+}
+
+}  // namespace
+
+TrieVocab::TrieVocab(const std::vector<std::string>& words)
+    : TrieVocab(words, [&words] {
+        std::vector<int> ids(words.size());
+        for (int i = 0; i < ids.size(); ++i) ids[i] = i;
+        return ids;
+      }()) {}
+
+TrieVocab::TrieVocab(const std::vector<std::string>& words,
+                     const std::vector<int>& ids) {
+  // The last id of each word, as looked up in a hash map, and the word of
+  // each id, as indexed in a vector.
+  absl::flat_hash_map<absl::string_view, int> id_of_word;
+  int num_ids = 0;
+  for (int i = 0; i < words.size(); ++i) {
+    if (ids[i] < 0) continue;
+    if (!words[i].empty()) id_of_word[words[i]] = ids[i];
+    num_ids = std::max(num_ids, ids[i] + 1);
+  }
+  std::vector<const std::string*> word_of_id(num_ids);
+  for (int i = 0; i < words.size(); ++i) {
+    if (ids[i] >= 0) word_of_id[ids[i]] = &words[i];
+  }
+  std::vector<std::string> unique_words;
+  std::vector<int> unique_ids;
+  unique_words.reserve(id_of_word.size());
+  unique_ids.reserve(id_of_word.size());
+  for (const auto& [word, id] : id_of_word) {
+    unique_words.emplace_back(word);
+    unique_ids.push_back(id);
+  }
+  const std::vector<uint32_t> nodes =
+      unique_words.empty() ? std::vector<uint32_t>()
+                           : BuildTrie(unique_words, unique_ids);
+
+  std::vector<uint32_t> word_offsets;
+  word_offsets.reserve(num_ids + 1);
+  std::string word_bytes;
+  for (const std::string* word : word_of_id) {
+    if (word == nullptr) {
+      word_offsets.push_back(word_bytes.size() | kNoWord);
+      continue;
+    }
+    word_offsets.push_back(word_bytes.size());
+    word_bytes.append(*word);
+  }
+  word_offsets.push_back(word_bytes.size());
+
+  owned_buffer_ = {0, static_cast<uint32_t>(nodes.size()),
+                   static_cast<uint32_t>(num_ids)};
+  std::memcpy(owned_buffer_.data(), kMagic, sizeof(kMagic));
+  owned_buffer_.insert(owned_buffer_.end(), nodes.begin(), nodes.end());
+  owned_buffer_.insert(owned_buffer_.end(), word_offsets.begin(),
+                       word_offsets.end());
+  const size_t words_offset = owned_buffer_.size();
+  owned_buffer_.resize(words_offset +
+                       (word_bytes.size() + sizeof(uint32_t) - 1) /
+                           sizeof(uint32_t));
+  std::memcpy(owned_buffer_.data() + words_offset, word_bytes.data(),
+              word_bytes.size());
+  buffer_ = owned_buffer_;
+  // The buffer was just built, and is consistent.
+  Init().IgnoreError();
+}
+
+absl::StatusOr<TrieVocab> TrieVocab::FromBuffer(absl::string_view buffer) {
+  if (reinterpret_cast<uintptr_t>(buffer.data()) % alignof(uint32_t) != 0) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "The vocabulary buffer must be aligned",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  TrieVocab vocab;
+  vocab.buffer_ =
+      absl::MakeConstSpan(reinterpret_cast<const uint32_t*>(buffer.data()),
+                          buffer.size() / sizeof(uint32_t));
+  MP_RETURN_IF_ERROR(vocab.Init());
+  return vocab;
+}
+
+absl::StatusOr<TrieVocab> TrieVocab::CopyFromBuffer(absl::string_view buffer) {
+  TrieVocab vocab;
+  vocab.owned_buffer_.resize(buffer.size() / sizeof(uint32_t));
+  std::memcpy(vocab.owned_buffer_.data(), buffer.data(),
+              vocab.owned_buffer_.size() * sizeof(uint32_t));
+  vocab.buffer_ = vocab.owned_buffer_;
+  MP_RETURN_IF_ERROR(vocab.Init());
+  return vocab;
+}
+
+bool TrieVocab::IsBuffer(absl::string_view data) {
+  return absl::StartsWith(data, absl::string_view(kMagic, sizeof(kMagic)));
+}
+
+absl::Status TrieVocab::Init() {
+  const auto invalid_buffer_error = [] {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "Invalid vocabulary buffer",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  };
+  if (buffer_.size() < kHeaderSize || !IsBuffer(buffer())) {
+    return invalid_buffer_error();
+  }
+  const size_t num_nodes = buffer_[1];
+  const size_t num_ids = buffer_[2];
+  num_ids_ = num_ids;
+  const size_t words_offset = kHeaderSize + num_nodes + num_ids + 1;
+  if (words_offset > buffer_.size()) {
+    return invalid_buffer_error();
+  }
+  nodes_ = buffer_.subspan(kHeaderSize, num_nodes);
+  word_offsets_ = buffer_.subspan(kHeaderSize + num_nodes, num_ids + 1);
+  words_ = absl::string_view(
+      reinterpret_cast<const char*>(buffer_.data() + words_offset),
+      (buffer_.size() - words_offset) * sizeof(uint32_t));
+  if ((word_offsets_.back() & ~kNoWord) > words_.size()) {
+    return invalid_buffer_error();
+  }
+  words_ = words_.substr(0, word_offsets_.back() & ~kNoWord);
+  return absl::OkStatus();
+}
+
+absl::string_view TrieVocab::buffer() const {
+  return absl::string_view(reinterpret_cast<const char*>(buffer_.data()),
+                           buffer_.size() * sizeof(uint32_t));
+}
+
+bool TrieVocab::LookupId(absl::string_view word, int* id) const {
+  const DoubleArrayTrie trie(nodes_.data(), nodes_.size());
+  bool found = false;
+  trie.IteratePrefixMatches(ToTrieStringView(word),
+                            [&](const DoubleArrayTrie::Match& match) {
+                              if (match.match_length == word.size()) {
+                                *id = match.id;
+                                found = true;
+                              }
+                            });
+  return found;
+}
+
+bool TrieVocab::LookupWord(int id, absl::string_view* word) const {
+  if (id < 0 || id + 1 >= word_offsets_.size() ||
+      (word_offsets_[id] & kNoWord) != 0) {
+    return false;
+  }
+  const uint32_t begin = word_offsets_[id];
+  const uint32_t end = word_offsets_[id + 1] & ~kNoWord;
+  if (begin > end || end > words_.size()) {
+    return false;
+  }
+  *word = words_.substr(begin, end - begin);
+  return true;
+}
+
+void TrieVocab::Wordpiece(absl::string_view token,
+                          absl::string_view suffix_indicator,
+                          int max_chars_per_piece, bool split_unknown_chars,
+                          std::vector<WordPiece>* pieces) const {
+  const DoubleArrayTrie trie(nodes_.data(), nodes_.size());
+  const size_t num_pieces = pieces->size();
+  int begin = 0;
+  while (begin < token.size()) {
+    const absl::string_view rest = token.substr(begin);
+    // Pieces can't be longer than `max_chars_per_piece` characters.
+    const int first_char_length = CharLength(rest);
+    int max_length = first_char_length;
+    for (int num_chars = 1;
+         max_length < rest.size() &&
+         (max_chars_per_piece <= 0 || num_chars < max_chars_per_piece);
+         ++num_chars) {
+      max_length += CharLength(rest.substr(max_length));
+    }
+
+    // The longest match ending on a character boundary.
+    WordPiece piece = {-1, begin, -1};
+    const auto update_piece = [&](const DoubleArrayTrie::Match& match) {
+      if (match.match_length == max_length ||
+          (static_cast<unsigned char>(rest[match.match_length]) & 0xC0) !=
+              0x80) {
+        piece.id = match.id;
+        piece.end = begin + match.match_length;
+      }
+    };
+    const string_view input(rest.data(), max_length);
+    if (begin == 0) {
+      trie.IteratePrefixMatches(input, update_piece);
+    } else {
+      trie.IteratePrefixMatches(ToTrieStringView(suffix_indicator), input,
+                                update_piece);
+    }
+    if (piece.id < 0) {
+      if (!split_unknown_chars) {
+        pieces->resize(num_pieces);
+        pieces->push_back({-1, 0, static_cast<int>(token.size())});
+        return;
+      }
+      piece.end = begin + first_char_length;
+    }
+    pieces->push_back(piece);
+    begin = piece.end;
+  }
+}
+
+}  // namespace tokenizers
+}  // namespace text
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,123 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_TRIE_VOCAB_H_
+#define MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_TRIE_VOCAB_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "mediapipe/tasks/cc/text/custom_ops/sentencepiece/double_array_trie.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace text {
+namespace tokenizers {
+
+// A piece of a token split by TrieVocab::Wordpiece().
+struct WordPiece {
+  // The vocabulary id of the piece, or -1 if it is unknown.
+  int id;
+  // The byte offsets of the piece in the token.
+  int begin;
+  int end;
+};
+
+// A vocabulary of words and their ids, looked up in the double-array trie [1]
+// of the SentencePiece ops, without hashing or copying the looked up strings.
+//
+// The trie and the words are stored in one buffer, which can be saved and
+// used in place later, e.g. memory mapped from a file, instead of building
+// the trie again.
+//
+// [1]: https://linux.thai.net/~thep/datrie/datrie.html
+class TrieVocab {
+ public:
+  // Builds a vocabulary of `words`, whose ids are their indices.
+  explicit TrieVocab(const std::vector<std::string>& words);
+
+  // Builds a vocabulary of `words` with the corresponding `ids`. Duplicate
+  // words are found by their last id, but each id keeps its word. Empty words
+  // are not found by LookupId(), and negative ids are ignored.
+  TrieVocab(const std::vector<std::string>& words, const std::vector<int>& ids);
+
+  // Returns a vocabulary using `buffer`, which must hold the buffer() of
+  // another vocabulary at a 4-byte aligned address, and outlive the returned
+  // vocabulary.
+  static absl::StatusOr<TrieVocab> FromBuffer(absl::string_view buffer);
+
+  // Returns a vocabulary holding a copy of `buffer`, which must hold the
+  // buffer() of another vocabulary at any address.
+  static absl::StatusOr<TrieVocab> CopyFromBuffer(absl::string_view buffer);
+
+  // Returns whether `data` starts like the buffer() of a vocabulary, e.g. to
+  // tell it from a vocabulary file with one word per line.
+  static bool IsBuffer(absl::string_view data);
+
+  TrieVocab(TrieVocab&&) = default;
+  TrieVocab& operator=(TrieVocab&&) = default;
+
+  // The buffer holding the vocabulary, to save for FromBuffer().
+  absl::string_view buffer() const;
+
+  // Finds the id of `word`.
+  bool LookupId(absl::string_view word, int* id) const;
+
+  // Finds the word of `id`.
+  bool LookupWord(int id, absl::string_view* word) const;
+
+  // The number of ids of the vocabulary, i.e. its largest id plus one, which
+  // is the number of words if their ids are their indices.
+  int size() const { return num_ids_; }
+
+  // Splits `token` into the longest word pieces of the vocabulary, from left
+  // to right, and appends them to `pieces`, like
+  // tensorflow::text::WordpieceTokenize() does. Pieces after the first one
+  // are looked up with `suffix_indicator` prepended, and have at most
+  // `max_chars_per_piece` UTF-8 characters if it is positive. If no piece
+  // matches at some point, then the character there is an unknown piece if
+  // `split_unknown_chars`, else the whole token is a single unknown piece.
+  void Wordpiece(absl::string_view token, absl::string_view suffix_indicator,
+                 int max_chars_per_piece, bool split_unknown_chars,
+                 std::vector<WordPiece>* pieces) const;
+
+ private:
+  TrieVocab() = default;
+
+  // Points the trie and the words into `buffer_`.
+  absl::Status Init();
+
+  // The buffer holding the vocabulary, if built.
+  std::vector<uint32_t> owned_buffer_;
+  absl::Span<const uint32_t> buffer_;
+  int num_ids_ = 0;
+  absl::Span<const uint32_t> nodes_;
+  // The offsets of the words of each id in `words_`, and of their end, with
+  // the kNoWord bit set for the ids without a word.
+  absl::Span<const uint32_t> word_offsets_;
+  absl::string_view words_;
+};
+
+}  // namespace tokenizers
+}  // namespace text
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_TEXT_TOKENIZERS_TRIE_VOCAB_H_
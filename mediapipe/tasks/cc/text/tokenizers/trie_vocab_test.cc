@@ -0,0 +1,200 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/tokenizers/trie_vocab.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace text {
+namespace tokenizers {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::FieldsAre;
+
+TrieVocab CreateVocab() {
+  return TrieVocab({"i", "'", "m", "question", "##ans", "##wer", "##ask",
+                    "##a", "\xc3\xa9t\xc3\xa9", "[UNK]"});
+}
+
+TEST(TrieVocabTest, LookupId) {
+  const TrieVocab vocab = CreateVocab();
+
+  int id;
+  EXPECT_FALSE(vocab.LookupId("que", &id));
+  EXPECT_FALSE(vocab.LookupId("questions", &id));
+  EXPECT_FALSE(vocab.LookupId("", &id));
+  ASSERT_TRUE(vocab.LookupId("question", &id));
+  EXPECT_EQ(id, 3);
+  ASSERT_TRUE(vocab.LookupId("##ask", &id));
+  EXPECT_EQ(id, 6);
+  EXPECT_EQ(vocab.size(), 10);
+}
+
+TEST(TrieVocabTest, LookupWord) {
+  const TrieVocab vocab = CreateVocab();
+
+  absl::string_view word;
+  EXPECT_FALSE(vocab.LookupWord(-1, &word));
+  EXPECT_FALSE(vocab.LookupWord(10, &word));
+  ASSERT_TRUE(vocab.LookupWord(4, &word));
+  EXPECT_EQ(word, "##ans");
+}
+
+TEST(TrieVocabTest, KeepsExplicitIds) {
+  const TrieVocab vocab({"good", "morning", "good", ""}, {52, 1972, 7, 3});
+
+  int id;
+  ASSERT_TRUE(vocab.LookupId("good", &id));
+  EXPECT_EQ(id, 7);
+  EXPECT_FALSE(vocab.LookupId("", &id));
+  absl::string_view word;
+  ASSERT_TRUE(vocab.LookupWord(1972, &word));
+  EXPECT_EQ(word, "morning");
+  ASSERT_TRUE(vocab.LookupWord(52, &word));
+  EXPECT_EQ(word, "good");
+  ASSERT_TRUE(vocab.LookupWord(3, &word));
+  EXPECT_EQ(word, "");
+  EXPECT_FALSE(vocab.LookupWord(0, &word));
+  EXPECT_FALSE(vocab.LookupWord(1973, &word));
+  EXPECT_EQ(vocab.size(), 1973);
+}
+
+TEST(TrieVocabTest, KeepsEveryIdOfDuplicateWords) {
+  const TrieVocab vocab({"a", "b", "a", ""});
+
+  int id;
+  ASSERT_TRUE(vocab.LookupId("a", &id));
+  EXPECT_EQ(id, 2);
+  absl::string_view word;
+  ASSERT_TRUE(vocab.LookupWord(0, &word));
+  EXPECT_EQ(word, "a");
+  ASSERT_TRUE(vocab.LookupWord(2, &word));
+  EXPECT_EQ(word, "a");
+  ASSERT_TRUE(vocab.LookupWord(3, &word));
+  EXPECT_EQ(word, "");
+  EXPECT_EQ(vocab.size(), 4);
+}
+
+TEST(TrieVocabTest, WordpieceMatchesLongestPieces) {
+  const TrieVocab vocab = CreateVocab();
+
+  std::vector<WordPiece> pieces;
+  vocab.Wordpiece("questionansweraskask", "##", /*max_chars_per_piece=*/100,
+                  /*split_unknown_chars=*/false, &pieces);
+
+  EXPECT_THAT(pieces, ElementsAre(FieldsAre(3, 0, 8), FieldsAre(4, 8, 11),
+                                  FieldsAre(5, 11, 14), FieldsAre(6, 14, 17),
+                                  FieldsAre(6, 17, 20)));
+}
+
+TEST(TrieVocabTest, WordpieceLimitsCharsPerPiece) {
+  const TrieVocab vocab = CreateVocab();
+
+  std::vector<WordPiece> pieces;
+  vocab.Wordpiece("\xc3\xa9t\xc3\xa9", "##", /*max_chars_per_piece=*/3,
+                  /*split_unknown_chars=*/false, &pieces);
+  vocab.Wordpiece("\xc3\xa9t\xc3\xa9", "##", /*max_chars_per_piece=*/2,
+                  /*split_unknown_chars=*/false, &pieces);
+
+  EXPECT_THAT(pieces, ElementsAre(FieldsAre(8, 0, 5), FieldsAre(-1, 0, 5)));
+}
+
+TEST(TrieVocabTest, WordpieceUnknownPieces) {
+  const TrieVocab vocab = CreateVocab();
+
+  std::vector<WordPiece> pieces;
+  vocab.Wordpiece("iaxa", "##", /*max_chars_per_piece=*/100,
+                  /*split_unknown_chars=*/false, &pieces);
+  vocab.Wordpiece("iaxa", "##", /*max_chars_per_piece=*/100,
+                  /*split_unknown_chars=*/true, &pieces);
+
+  EXPECT_THAT(pieces,
+              ElementsAre(FieldsAre(-1, 0, 4), FieldsAre(0, 0, 1),
+                          FieldsAre(7, 1, 2), FieldsAre(-1, 2, 3),
+                          FieldsAre(7, 3, 4)));
+}
+
+TEST(TrieVocabTest, FromBuffer) {
+  const TrieVocab vocab = CreateVocab();
+  // Copies the buffer, as it would be saved to a file and mapped.
+  const std::string saved(vocab.buffer());
+  std::vector<uint32_t> buffer(saved.size() / sizeof(uint32_t));
+  std::memcpy(buffer.data(), saved.data(), saved.size());
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      const TrieVocab loaded_vocab,
+      TrieVocab::FromBuffer(absl::string_view(
+          reinterpret_cast<const char*>(buffer.data()), saved.size())));
+
+  int id;
+  ASSERT_TRUE(loaded_vocab.LookupId("##wer", &id));
+  EXPECT_EQ(id, 5);
+  absl::string_view word;
+  ASSERT_TRUE(loaded_vocab.LookupWord(9, &word));
+  EXPECT_EQ(word, "[UNK]");
+  EXPECT_EQ(loaded_vocab.size(), 10);
+}
+
+TEST(TrieVocabTest, CopyFromUnalignedBuffer) {
+  const TrieVocab vocab = CreateVocab();
+  // Saved after a byte, as strings are allocated at aligned addresses.
+  const std::string saved = absl::StrCat(" ", vocab.buffer());
+  const absl::string_view unaligned_buffer = absl::string_view(saved).substr(1);
+
+  MP_ASSERT_OK_AND_ASSIGN(const TrieVocab loaded_vocab,
+                          TrieVocab::CopyFromBuffer(unaligned_buffer));
+
+  int id;
+  ASSERT_TRUE(loaded_vocab.LookupId("##wer", &id));
+  EXPECT_EQ(id, 5);
+  absl::string_view word;
+  ASSERT_TRUE(loaded_vocab.LookupWord(8, &word));
+  EXPECT_EQ(word, "\xc3\xa9t\xc3\xa9");
+  EXPECT_EQ(loaded_vocab.size(), 10);
+}
+
+TEST(TrieVocabTest, IsBuffer) {
+  const TrieVocab vocab = CreateVocab();
+
+  EXPECT_TRUE(TrieVocab::IsBuffer(vocab.buffer()));
+  EXPECT_FALSE(TrieVocab::IsBuffer("[PAD]\n[UNK]\n"));
+  EXPECT_FALSE(TrieVocab::IsBuffer(""));
+}
+
+TEST(TrieVocabTest, FromBufferFailsWithTruncatedBuffer) {
+  const TrieVocab vocab = CreateVocab();
+
+  EXPECT_EQ(TrieVocab::FromBuffer(vocab.buffer().substr(0, 16)).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace tokenizers
+}  // namespace text
+}  // namespace tasks
+}  // namespace mediapipe
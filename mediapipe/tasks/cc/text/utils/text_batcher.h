@@ -0,0 +1,120 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_TEXT_UTILS_TEXT_BATCHER_H_
+#define MEDIAPIPE_TASKS_CC_TEXT_UTILS_TEXT_BATCHER_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/core/task_replica_pool.h"
+
+namespace mediapipe::tasks::text::utils {
+
+// Processes batches of texts, e.g. for bulk embedding or classification jobs,
+// by running them through several replicas of a text task in parallel, e.g.
+// several TextEmbedder or TextClassifier instances:
+//
+//   std::vector<TextBatcher<TextEmbedderResult>::ProcessFn> embed_fns;
+//   for (const auto& embedder : embedders) {
+//     embed_fns.push_back([&embedder](absl::string_view text) {
+//       return embedder->Embed(text);
+//     });
+//   }
+//   MP_ASSIGN_OR_RETURN(auto batcher,
+//                       TextBatcher<TextEmbedderResult>::Create(embed_fns));
+//   MP_ASSIGN_OR_RETURN(auto results, batcher->Process(texts));
+//
+// The text tasks run one text per inference, as their preprocessing graphs
+// require models with a batch size of 1, so the texts are spread across the
+// replicas rather than packed into a padded batch.
+template <typename ResultT>
+class TextBatcher {
+ public:
+  using ProcessFn = std::function<absl::StatusOr<ResultT>(absl::string_view)>;
+
+  // Creates a TextBatcher running each of `process_fns` on its own thread, on
+  // one text at a time.
+  static absl::StatusOr<std::unique_ptr<TextBatcher>> Create(
+      std::vector<ProcessFn> process_fns);
+
+  // Waits for the pending texts to be processed.
+  ~TextBatcher();
+
+  // Processes each of `texts`, and returns the results in the same order.
+  // Must not be called concurrently.
+  absl::StatusOr<std::vector<ResultT>> Process(
+      absl::Span<const absl::string_view> texts);
+
+ private:
+  explicit TextBatcher(std::vector<ProcessFn> process_fns);
+
+  const std::vector<ProcessFn> process_fns_;
+
+  // Destroyed first, so that the pending texts are processed before the state
+  // they use is destroyed.
+  core::TaskReplicaPool replica_pool_;
+};
+
+template <typename ResultT>
+absl::StatusOr<std::unique_ptr<TextBatcher<ResultT>>>
+TextBatcher<ResultT>::Create(std::vector<ProcessFn> process_fns) {
+  if (process_fns.empty()) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "At least one task replica is required.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  return absl::WrapUnique(new TextBatcher(std::move(process_fns)));
+}
+
+template <typename ResultT>
+TextBatcher<ResultT>::TextBatcher(std::vector<ProcessFn> process_fns)
+    : process_fns_(std::move(process_fns)),
+      replica_pool_("text_batcher", process_fns_.size()) {}
+
+template <typename ResultT>
+TextBatcher<ResultT>::~TextBatcher() = default;
+
+template <typename ResultT>
+absl::StatusOr<std::vector<ResultT>> TextBatcher<ResultT>::Process(
+    absl::Span<const absl::string_view> texts) {
+  std::vector<ResultT> results(texts.size());
+  for (size_t i = 0; i < texts.size(); ++i) {
+    const absl::Status status = replica_pool_.Schedule(
+        [this, text = texts[i],
+         result = &results[i]](int replica) -> absl::Status {
+          MP_ASSIGN_OR_RETURN(*result, process_fns_[replica](text));
+          return absl::OkStatus();
+        });
+    // Wait() returns the error.
+    if (!status.ok()) break;
+  }
+  MP_RETURN_IF_ERROR(replica_pool_.Wait());
+  return results;
+}
+
+}  // namespace mediapipe::tasks::text::utils
+
+#endif  // MEDIAPIPE_TASKS_CC_TEXT_UTILS_TEXT_BATCHER_H_
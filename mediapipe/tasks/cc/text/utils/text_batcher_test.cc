@@ -0,0 +1,96 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/utils/text_batcher.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/barrier.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe::tasks::text::utils {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(TextBatcherTest, ReturnsResultsInInputOrder) {
+  std::vector<TextBatcher<size_t>::ProcessFn> process_fns(
+      3, [](absl::string_view text) -> absl::StatusOr<size_t> {
+        return text.size();
+      });
+  MP_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TextBatcher<size_t>> batcher,
+                          TextBatcher<size_t>::Create(process_fns));
+  const std::vector<absl::string_view> texts = {"a", "abcd", "", "abc", "ab"};
+
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<size_t> results,
+                          batcher->Process(texts));
+  EXPECT_THAT(results, ElementsAre(1, 4, 0, 3, 2));
+  MP_ASSERT_OK_AND_ASSIGN(results, batcher->Process({}));
+  EXPECT_THAT(results, ElementsAre());
+}
+
+TEST(TextBatcherTest, ProcessesTextsInParallel) {
+  // Each replica waits for the other one to process a text, so processing
+  // two texts one at a time would never return.
+  absl::Barrier barrier(2);
+  std::vector<TextBatcher<std::string>::ProcessFn> process_fns(
+      2, [&barrier](absl::string_view text) -> absl::StatusOr<std::string> {
+        barrier.Block();
+        return std::string(text);
+      });
+  MP_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TextBatcher<std::string>> batcher,
+                          TextBatcher<std::string>::Create(process_fns));
+
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<std::string> results,
+                          batcher->Process({"first", "second"}));
+  EXPECT_THAT(results, ElementsAre("first", "second"));
+}
+
+TEST(TextBatcherTest, ReturnsReplicaErrors) {
+  std::atomic<int> num_calls = 0;
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TextBatcher<size_t>> batcher,
+      TextBatcher<size_t>::Create(
+          {[&num_calls](absl::string_view text) -> absl::StatusOr<size_t> {
+            if (++num_calls == 2) return absl::InternalError("failed");
+            return text.size();
+          }}));
+
+  EXPECT_EQ(batcher->Process({"a", "b", "c"}).status().code(),
+            absl::StatusCode::kInternal);
+  // Skips the texts after the error.
+  EXPECT_EQ(num_calls, 2);
+  // Processes the next batch.
+  MP_ASSERT_OK_AND_ASSIGN(std::vector<size_t> results,
+                          batcher->Process({"abc"}));
+  EXPECT_THAT(results, ElementsAre(3));
+}
+
+TEST(TextBatcherTest, CreateFailsWithoutReplicas) {
+  EXPECT_EQ(TextBatcher<size_t>::Create({}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::text::utils
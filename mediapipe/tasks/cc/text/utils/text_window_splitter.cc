@@ -0,0 +1,112 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/utils/text_window_splitter.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe::tasks::text::utils {
+namespace {
+
+// Whether `c` is a UTF-8 continuation byte, i.e. not the first byte of a
+// character.
+bool IsContinuationByte(char c) { return (c & 0xC0) == 0x80; }
+
+// Whether a window can start at `pos` of `text`, i.e. after a whitespace.
+bool IsWordStart(absl::string_view text, size_t pos) {
+  return pos == 0 || absl::ascii_isspace(text[pos - 1]);
+}
+
+// Returns the end of the last complete UTF-8 character of `text`, or 0 if
+// there is none.
+size_t CompleteCharsEnd(absl::string_view text) {
+  size_t begin = text.size();
+  while (begin > 0 && IsContinuationByte(text[begin - 1])) --begin;
+  if (begin == 0) return 0;
+  --begin;
+  const unsigned char first_byte = text[begin];
+  const size_t size = first_byte < 0x80   ? 1
+                      : first_byte >= 0xF0 ? 4
+                      : first_byte >= 0xE0 ? 3
+                                           : 2;
+  return begin + size <= text.size() ? text.size() : begin;
+}
+
+}  // namespace
+
+TextWindowSplitter::TextWindowSplitter(size_t window_size,
+                                       size_t window_overlap)
+    : window_size_(window_size), window_overlap_(window_overlap) {
+  buffer_.reserve(window_size_);
+}
+
+absl::Status TextWindowSplitter::Append(absl::string_view chunk,
+                                        const WindowFn& on_window) {
+  while (!chunk.empty()) {
+    const size_t size = std::min(chunk.size(), window_size_ - buffer_.size());
+    buffer_.append(chunk.data(), size);
+    chunk.remove_prefix(size);
+    if (buffer_.size() == window_size_) {
+      MP_RETURN_IF_ERROR(EmitWindow(on_window));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TextWindowSplitter::Finish(const WindowFn& on_window) {
+  absl::Status status;
+  if (!emitted_ || buffer_.size() > overlap_size_) {
+    status = on_window(buffer_);
+  }
+  buffer_.clear();
+  overlap_size_ = 0;
+  emitted_ = false;
+  return status;
+}
+
+absl::Status TextWindowSplitter::EmitWindow(const WindowFn& on_window) {
+  const absl::string_view text = buffer_;
+  size_t end = text.size();
+  while (end > text.size() / 2 && !IsWordStart(text, end)) --end;
+  if (end <= text.size() / 2) {
+    end = CompleteCharsEnd(text);
+    // Cuts invalid UTF-8 text anywhere.
+    if (end == 0) end = text.size();
+  }
+  MP_RETURN_IF_ERROR(on_window(text.substr(0, end)));
+  emitted_ = true;
+
+  const size_t overlap_begin = end - std::min(end, window_overlap_);
+  size_t begin = overlap_begin;
+  while (begin < end && !IsWordStart(text, begin)) ++begin;
+  if (begin == end) {
+    begin = overlap_begin;
+    while (begin < end && IsContinuationByte(text[begin])) ++begin;
+  }
+  // The next window must start after this one, which only the overlap of
+  // windows cut at a multi-byte character can prevent.
+  if (begin == 0) begin = end;
+  overlap_size_ = end - begin;
+  buffer_.erase(0, begin);
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe::tasks::text::utils
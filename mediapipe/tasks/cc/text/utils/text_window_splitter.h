@@ -0,0 +1,68 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_TEXT_UTILS_TEXT_WINDOW_SPLITTER_H_
+#define MEDIAPIPE_TASKS_CC_TEXT_UTILS_TEXT_WINDOW_SPLITTER_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace mediapipe::tasks::text::utils {
+
+// Splits text streamed in chunks into overlapping windows of at most
+// `window_size` bytes, holding no more than one window of text at a time.
+//
+// Windows end after the last whitespace in their second half if there is one,
+// else at the last UTF-8 character boundary, so that words and characters are
+// not cut. Consecutive windows overlap by at most `window_overlap` bytes,
+// starting after a whitespace too if possible.
+class TextWindowSplitter {
+ public:
+  using WindowFn = std::function<absl::Status(absl::string_view window)>;
+
+  // `window_overlap` must be non-negative and at most half of `window_size`.
+  TextWindowSplitter(size_t window_size, size_t window_overlap);
+
+  // Appends `chunk` to the text, and calls `on_window` with each window it
+  // completes. Returns the first error of `on_window`.
+  absl::Status Append(absl::string_view chunk, const WindowFn& on_window);
+
+  // Calls `on_window` with the rest of the text, or with the whole text if no
+  // window was completed yet, even if empty. The next appended chunk starts a
+  // new text.
+  absl::Status Finish(const WindowFn& on_window);
+
+ private:
+  // Calls `on_window` with the window at the start of the full `buffer_`, and
+  // keeps the text after it, and its overlap, in `buffer_`.
+  absl::Status EmitWindow(const WindowFn& on_window);
+
+  const size_t window_size_;
+  const size_t window_overlap_;
+  // The text after the last window, preceded by its overlap with it.
+  std::string buffer_;
+  // The size of the overlap at the start of `buffer_`.
+  size_t overlap_size_ = 0;
+  // Whether a window of the current text was emitted.
+  bool emitted_ = false;
+};
+
+}  // namespace mediapipe::tasks::text::utils
+
+#endif  // MEDIAPIPE_TASKS_CC_TEXT_UTILS_TEXT_WINDOW_SPLITTER_H_
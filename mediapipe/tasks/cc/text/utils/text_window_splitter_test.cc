@@ -0,0 +1,108 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/utils/text_window_splitter.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe::tasks::text::utils {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr absl::string_view kText =
+    "the quick brown fox jumps over the lazy dog";
+
+// Splits `text` appended in chunks of `chunk_size` bytes.
+std::vector<std::string> Split(absl::string_view text, size_t chunk_size,
+                               size_t window_size, size_t window_overlap) {
+  TextWindowSplitter splitter(window_size, window_overlap);
+  std::vector<std::string> windows;
+  const auto on_window = [&windows](absl::string_view window) {
+    windows.emplace_back(window);
+    return absl::OkStatus();
+  };
+  for (size_t i = 0; i < text.size(); i += chunk_size) {
+    MP_EXPECT_OK(splitter.Append(text.substr(i, chunk_size), on_window));
+  }
+  MP_EXPECT_OK(splitter.Finish(on_window));
+  return windows;
+}
+
+TEST(TextWindowSplitterTest, KeepsShortTextInOneWindow) {
+  EXPECT_THAT(Split(kText, /*chunk_size=*/4, /*window_size=*/64,
+                    /*window_overlap=*/8),
+              ElementsAre(kText));
+  EXPECT_THAT(Split("", /*chunk_size=*/4, /*window_size=*/64,
+                    /*window_overlap=*/8),
+              ElementsAre(""));
+}
+
+TEST(TextWindowSplitterTest, SplitsAfterWhitespaces) {
+  EXPECT_THAT(Split(kText, /*chunk_size=*/kText.size(), /*window_size=*/16,
+                    /*window_overlap=*/6),
+              ElementsAre("the quick brown ", "brown fox jumps ",
+                          "jumps over the ", "the lazy dog"));
+}
+
+TEST(TextWindowSplitterTest, SplitsWithoutOverlap) {
+  EXPECT_THAT(Split(kText, /*chunk_size=*/kText.size(), /*window_size=*/16,
+                    /*window_overlap=*/0),
+              ElementsAre("the quick brown ", "fox jumps over ",
+                          "the lazy dog"));
+}
+
+TEST(TextWindowSplitterTest, SplitsTextWithoutWhitespacesAtCharacters) {
+  // 8 characters of 3 bytes each.
+  EXPECT_THAT(Split("日本語のテキスト", /*chunk_size=*/5,
+                    /*window_size=*/10, /*window_overlap=*/4),
+              ElementsAre("日本語", "語のテ", "テキス", "スト"));
+}
+
+TEST(TextWindowSplitterTest, WindowsDoNotDependOnChunks) {
+  const std::vector<std::string> windows =
+      Split(kText, /*chunk_size=*/kText.size(), /*window_size=*/12,
+            /*window_overlap=*/5);
+  for (size_t chunk_size : {1, 2, 7, 12, 13}) {
+    EXPECT_EQ(Split(kText, chunk_size, /*window_size=*/12,
+                    /*window_overlap=*/5),
+              windows);
+  }
+}
+
+TEST(TextWindowSplitterTest, ReturnsWindowErrors) {
+  TextWindowSplitter splitter(/*window_size=*/16, /*window_overlap=*/0);
+  int num_windows = 0;
+  const auto on_window = [&num_windows](absl::string_view window) {
+    ++num_windows;
+    return absl::InternalError("error");
+  };
+
+  EXPECT_EQ(splitter.Append(kText, on_window).code(),
+            absl::StatusCode::kInternal);
+  EXPECT_EQ(num_windows, 1);
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::text::utils
@@ -0,0 +1,157 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/utils/windowed_text_classifier.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/components/containers/category.h"
+#include "mediapipe/tasks/cc/components/containers/classification_result.h"
+
+namespace mediapipe::tasks::text::utils {
+
+using ::mediapipe::tasks::components::containers::Category;
+using ::mediapipe::tasks::components::containers::Classifications;
+
+absl::StatusOr<std::unique_ptr<WindowedTextClassifier>>
+WindowedTextClassifier::Create(std::vector<ClassifyFn> classify_fns,
+                               const WindowedClassificationOptions& options) {
+  if (classify_fns.empty()) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "At least one classifier is required.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  if (options.window_size <= 0 || options.window_overlap < 0 ||
+      2 * options.window_overlap > options.window_size) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "The window size must be positive, and the window overlap between 0 "
+        "and half of the window size.",
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  if (options.max_results == 0) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "Invalid `max_results` option: value must "
+                                   "be != 0.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  return absl::WrapUnique(
+      new WindowedTextClassifier(std::move(classify_fns), options));
+}
+
+WindowedTextClassifier::WindowedTextClassifier(
+    std::vector<ClassifyFn> classify_fns,
+    const WindowedClassificationOptions& options)
+    : classify_fns_(std::move(classify_fns)),
+      options_(options),
+      splitter_(options.window_size, options.window_overlap),
+      classifier_pool_("windowed_text_classifier", classify_fns_.size()) {}
+
+WindowedTextClassifier::~WindowedTextClassifier() = default;
+
+absl::Status WindowedTextClassifier::Append(absl::string_view chunk) {
+  return splitter_.Append(
+      chunk, [this](absl::string_view window) { return Submit(window); });
+}
+
+absl::StatusOr<WindowedTextClassifier::ClassificationResult>
+WindowedTextClassifier::Finish() {
+  absl::Status status = splitter_.Finish(
+      [this](absl::string_view window) { return Submit(window); });
+  absl::Status classify_status = classifier_pool_.Wait();
+  if (status.ok()) status = std::move(classify_status);
+
+  absl::MutexLock lock(&mutex_);
+  ClassificationResult result = TakeResult();
+  MP_RETURN_IF_ERROR(status);
+  return result;
+}
+
+absl::Status WindowedTextClassifier::Submit(absl::string_view window) {
+  return classifier_pool_.Schedule(
+      [this, window = std::string(window)](int classifier) -> absl::Status {
+        MP_ASSIGN_OR_RETURN(const ClassificationResult result,
+                            classify_fns_[classifier](window));
+        absl::MutexLock lock(&mutex_);
+        Aggregate(result, window.size());
+        return absl::OkStatus();
+      },
+      /*max_pending_items=*/2 * classify_fns_.size());
+}
+
+void WindowedTextClassifier::Aggregate(const ClassificationResult& result,
+                                       size_t size) {
+  // Windows of empty texts still count.
+  const double weight = std::max<size_t>(size, 1);
+  for (const Classifications& classifications : result.classifications) {
+    HeadScores& head = heads_[classifications.head_index];
+    head.head_name = classifications.head_name;
+    for (const Category& category : classifications.categories) {
+      CategoryScores& scores = head.categories[{
+          category.index, category.category_name.value_or("")}];
+      scores.category = category;
+      scores.weighted_score_sum += category.score * weight;
+    }
+  }
+  total_weight_ += weight;
+}
+
+WindowedTextClassifier::ClassificationResult
+WindowedTextClassifier::TakeResult() {
+  ClassificationResult result;
+  for (auto& [head_index, head] : heads_) {
+    Classifications& classifications = result.classifications.emplace_back();
+    classifications.head_index = head_index;
+    classifications.head_name = std::move(head.head_name);
+    for (auto& [key, scores] : head.categories) {
+      const float score = scores.weighted_score_sum / total_weight_;
+      if (score < options_.score_threshold) continue;
+      scores.category.score = score;
+      classifications.categories.push_back(std::move(scores.category));
+    }
+    std::sort(classifications.categories.begin(),
+              classifications.categories.end(),
+              [](const Category& a, const Category& b) {
+                return a.score > b.score ||
+                       (a.score == b.score && a.index < b.index);
+              });
+    if (options_.max_results >= 0 &&
+        classifications.categories.size() >
+            static_cast<size_t>(options_.max_results)) {
+      classifications.categories.resize(options_.max_results);
+    }
+  }
+  std::sort(result.classifications.begin(), result.classifications.end(),
+            [](const Classifications& a, const Classifications& b) {
+              return a.head_index < b.head_index;
+            });
+  heads_.clear();
+  total_weight_ = 0.0;
+  return result;
+}
+
+}  // namespace mediapipe::tasks::text::utils
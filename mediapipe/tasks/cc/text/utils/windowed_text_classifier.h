@@ -0,0 +1,138 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_TEXT_UTILS_WINDOWED_TEXT_CLASSIFIER_H_
+#define MEDIAPIPE_TASKS_CC_TEXT_UTILS_WINDOWED_TEXT_CLASSIFIER_H_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/tasks/cc/components/containers/classification_result.h"
+#include "mediapipe/tasks/cc/core/task_replica_pool.h"
+#include "mediapipe/tasks/cc/text/utils/text_window_splitter.h"
+
+namespace mediapipe::tasks::text::utils {
+
+// The options for classifying text streamed in chunks as overlapping windows.
+struct WindowedClassificationOptions {
+  // The maximum size in bytes of the windows, which should fit the sequence
+  // length of the model once tokenized.
+  int window_size = 512;
+
+  // The maximum size in bytes of the overlap of consecutive windows, at most
+  // half of `window_size`.
+  int window_overlap = 64;
+
+  // The maximum number of top-scored categories per head of the aggregated
+  // results. If < 0, all the categories are returned.
+  int max_results = -1;
+
+  // The minimum aggregated score of the returned categories.
+  float score_threshold = 0.0f;
+};
+
+// Classifies text streamed in chunks, e.g. documents far longer than the
+// sequence length of a model, by splitting it into overlapping windows with
+// a TextWindowSplitter and classifying them in parallel.
+//
+// The score of each category in the aggregated results is the mean of its
+// scores in the windows, weighted by their sizes, and is 0 in the windows
+// whose results miss it. The classifiers should thus return all categories,
+// and leave `max_results` and `score_threshold` to the aggregation.
+// Categories are identified by their head index, index and name.
+//
+// At most twice as many windows as there are classifiers are pending at a
+// time, and Append() blocks until one is classified to submit more, so that
+// memory stays bounded by the window size rather than by the text size.
+class WindowedTextClassifier {
+ public:
+  using ClassificationResult = components::containers::ClassificationResult;
+  using ClassifyFn =
+      std::function<absl::StatusOr<ClassificationResult>(absl::string_view)>;
+
+  // Creates a WindowedTextClassifier running each of `classify_fns` on its own
+  // thread, on one window at a time.
+  static absl::StatusOr<std::unique_ptr<WindowedTextClassifier>> Create(
+      std::vector<ClassifyFn> classify_fns,
+      const WindowedClassificationOptions& options);
+
+  // Waits for the pending windows to be classified.
+  ~WindowedTextClassifier();
+
+  // Appends `chunk` to the text, and submits the windows it completes.
+  // Returns the first error of the classifiers, if any, after which Finish()
+  // must be called to start a new text.
+  absl::Status Append(absl::string_view chunk);
+
+  // Submits the rest of the text, and returns the aggregated results of its
+  // windows once they are classified. The next appended chunk starts a new
+  // text.
+  absl::StatusOr<ClassificationResult> Finish();
+
+ private:
+  // The aggregated scores of a category.
+  struct CategoryScores {
+    components::containers::Category category;
+    double weighted_score_sum = 0.0;
+  };
+
+  // The aggregated scores of a classifier head.
+  struct HeadScores {
+    std::optional<std::string> head_name;
+    absl::flat_hash_map<std::pair<int, std::string>, CategoryScores>
+        categories;
+  };
+
+  WindowedTextClassifier(std::vector<ClassifyFn> classify_fns,
+                         const WindowedClassificationOptions& options);
+
+  // Schedules the classification of `window` with a free classifier, and the
+  // aggregation of its results, once fewer than the maximum number of windows
+  // are pending.
+  absl::Status Submit(absl::string_view window);
+
+  // Adds `result` of a window of `size` bytes to the aggregated scores.
+  void Aggregate(const ClassificationResult& result, size_t size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns the aggregated results, and resets them.
+  ClassificationResult TakeResult() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::vector<ClassifyFn> classify_fns_;
+  const WindowedClassificationOptions options_;
+  TextWindowSplitter splitter_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<int, HeadScores> heads_ ABSL_GUARDED_BY(mutex_);
+  double total_weight_ ABSL_GUARDED_BY(mutex_) = 0.0;
+
+  // Destroyed first, so that the pending windows are classified before the
+  // state they use is destroyed.
+  core::TaskReplicaPool classifier_pool_;
+};
+
+}  // namespace mediapipe::tasks::text::utils
+
+#endif  // MEDIAPIPE_TASKS_CC_TEXT_UTILS_WINDOWED_TEXT_CLASSIFIER_H_
@@ -0,0 +1,227 @@
+/* Copyright 2024 The MediaPipe Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/text/utils/windowed_text_classifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/components/containers/category.h"
+#include "mediapipe/tasks/cc/components/containers/classification_result.h"
+
+namespace mediapipe::tasks::text::utils {
+namespace {
+
+using ::mediapipe::tasks::components::containers::Category;
+using ::mediapipe::tasks::components::containers::ClassificationResult;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::FloatNear;
+using ::testing::IsEmpty;
+
+constexpr float kTolerance = 1e-5;
+
+// Scores "a" and "b" with the fractions of these letters in the text.
+absl::StatusOr<ClassificationResult> ClassifyLetters(absl::string_view text) {
+  if (absl::StrContains(text, "x")) {
+    return absl::InvalidArgumentError("Unexpected letter");
+  }
+  const float size = std::max<size_t>(text.size(), 1);
+  return ClassificationResult{
+      .classifications = {
+          {.categories = {{.index = 0,
+                           .score = std::count(text.begin(), text.end(), 'a') /
+                                    size,
+                           .category_name = "a"},
+                          {.index = 1,
+                           .score = std::count(text.begin(), text.end(), 'b') /
+                                    size,
+                           .category_name = "b"}},
+           .head_index = 0,
+           .head_name = "letters"}}};
+}
+
+// Returns the text of `num_words` words of "aaa" or "b", and some spaces.
+std::string CreateText(int num_words) {
+  std::string text;
+  for (int i = 0; i < num_words; ++i) {
+    text += i % 3 == 0 ? "b " : "aaa  ";
+  }
+  return text;
+}
+
+absl::StatusOr<ClassificationResult> Classify(
+    WindowedTextClassifier& classifier, absl::string_view text,
+    size_t chunk_size) {
+  for (size_t i = 0; i < text.size(); i += chunk_size) {
+    if (absl::Status status = classifier.Append(text.substr(i, chunk_size));
+        !status.ok()) {
+      // Starts a new text.
+      classifier.Finish().IgnoreError();
+      return status;
+    }
+  }
+  return classifier.Finish();
+}
+
+TEST(WindowedTextClassifierTest, AveragesScoresWeightedByWindowSizes) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<WindowedTextClassifier> classifier,
+      WindowedTextClassifier::Create(
+          {ClassifyLetters, ClassifyLetters, ClassifyLetters},
+          {.window_size = 64, .window_overlap = 0}));
+  const std::string text = CreateText(/*num_words=*/1000);
+  const float size = text.size();
+
+  MP_ASSERT_OK_AND_ASSIGN(const ClassificationResult result,
+                          Classify(*classifier, text, /*chunk_size=*/100));
+
+  // The windows do not overlap, so the scores are the fractions of the
+  // letters in the whole text.
+  ASSERT_EQ(result.classifications.size(), 1);
+  EXPECT_EQ(result.classifications[0].head_index, 0);
+  EXPECT_EQ(result.classifications[0].head_name, "letters");
+  const auto& categories = result.classifications[0].categories;
+  ASSERT_EQ(categories.size(), 2);
+  EXPECT_EQ(categories[0].category_name, "a");
+  EXPECT_THAT(categories[0].score,
+              FloatNear(std::count(text.begin(), text.end(), 'a') / size,
+                        kTolerance));
+  EXPECT_EQ(categories[1].category_name, "b");
+  EXPECT_THAT(categories[1].score,
+              FloatNear(std::count(text.begin(), text.end(), 'b') / size,
+                        kTolerance));
+}
+
+TEST(WindowedTextClassifierTest, AppliesMaxResultsAndScoreThreshold) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<WindowedTextClassifier> classifier,
+      WindowedTextClassifier::Create(
+          {ClassifyLetters, ClassifyLetters},
+          {.window_size = 32, .window_overlap = 8, .max_results = 1}));
+  MP_ASSERT_OK_AND_ASSIGN(
+      ClassificationResult result,
+      Classify(*classifier, CreateText(/*num_words=*/100), /*chunk_size=*/7));
+  ASSERT_EQ(result.classifications.size(), 1);
+  ASSERT_EQ(result.classifications[0].categories.size(), 1);
+  EXPECT_EQ(result.classifications[0].categories[0].category_name, "a");
+
+  MP_ASSERT_OK_AND_ASSIGN(
+      classifier,
+      WindowedTextClassifier::Create(
+          {ClassifyLetters, ClassifyLetters},
+          {.window_size = 32, .window_overlap = 8, .score_threshold = 0.9}));
+  MP_ASSERT_OK_AND_ASSIGN(
+      result,
+      Classify(*classifier, CreateText(/*num_words=*/100), /*chunk_size=*/7));
+  ASSERT_EQ(result.classifications.size(), 1);
+  EXPECT_THAT(result.classifications[0].categories, IsEmpty());
+}
+
+TEST(WindowedTextClassifierTest, RunsEachClassifierOnOneWindowAtATime) {
+  constexpr int kNumClassifiers = 4;
+  std::atomic<bool> busy[kNumClassifiers] = {};
+  std::atomic<int> num_running = 0;
+  std::atomic<int> max_num_running = 0;
+  std::atomic<int> num_windows = 0;
+  std::vector<WindowedTextClassifier::ClassifyFn> classify_fns;
+  for (int i = 0; i < kNumClassifiers; ++i) {
+    classify_fns.push_back([&, i](absl::string_view text) {
+      EXPECT_FALSE(busy[i].exchange(true));
+      const int running = ++num_running;
+      int max_running = max_num_running;
+      while (running > max_running &&
+             !max_num_running.compare_exchange_weak(max_running, running)) {
+      }
+      ++num_windows;
+      absl::StatusOr<ClassificationResult> result = ClassifyLetters(text);
+      --num_running;
+      busy[i] = false;
+      return result;
+    });
+  }
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<WindowedTextClassifier> classifier,
+      WindowedTextClassifier::Create(std::move(classify_fns),
+                                     {.window_size = 16, .window_overlap = 4}));
+
+  MP_ASSERT_OK(Classify(*classifier, CreateText(/*num_words=*/1000),
+                        /*chunk_size=*/1000));
+
+  EXPECT_GT(num_windows, 100);
+  EXPECT_LE(max_num_running, kNumClassifiers);
+}
+
+TEST(WindowedTextClassifierTest, ReturnsClassifierErrorsAndRecovers) {
+  MP_ASSERT_OK_AND_ASSIGN(std::unique_ptr<WindowedTextClassifier> classifier,
+                          WindowedTextClassifier::Create(
+                              {ClassifyLetters, ClassifyLetters},
+                              {.window_size = 16, .window_overlap = 4}));
+
+  EXPECT_EQ(Classify(*classifier, "x" + CreateText(/*num_words=*/100),
+                     /*chunk_size=*/10)
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+
+  MP_ASSERT_OK_AND_ASSIGN(const ClassificationResult result,
+                          Classify(*classifier, "aaa b", /*chunk_size=*/10));
+  ASSERT_EQ(result.classifications.size(), 1);
+  EXPECT_THAT(result.classifications[0].categories[0].score,
+              FloatNear(0.6, kTolerance));
+}
+
+TEST(WindowedTextClassifierTest, ClassifiesEmptyText) {
+  MP_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<WindowedTextClassifier> classifier,
+      WindowedTextClassifier::Create({ClassifyLetters}, {}));
+
+  MP_ASSERT_OK_AND_ASSIGN(const ClassificationResult result,
+                          classifier->Finish());
+
+  ASSERT_EQ(result.classifications.size(), 1);
+  EXPECT_THAT(result.classifications[0].categories,
+              ElementsAre(Field(&Category::score, 0),
+                          Field(&Category::score, 0)));
+}
+
+TEST(WindowedTextClassifierTest, CreateFailsWithInvalidOptions) {
+  EXPECT_EQ(WindowedTextClassifier::Create({}, {}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(WindowedTextClassifier::Create(
+                {ClassifyLetters}, {.window_size = 16, .window_overlap = 9})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(
+      WindowedTextClassifier::Create({ClassifyLetters}, {.max_results = 0})
+          .status()
+          .code(),
+      absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace mediapipe::tasks::text::utils
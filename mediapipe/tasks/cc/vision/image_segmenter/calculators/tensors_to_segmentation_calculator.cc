@@ -13,10 +13,6 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#include <algorithm>
-#include <cmath>
-#include <cstdint>
-#include <limits>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -25,7 +21,7 @@ limitations under the License.
 
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
-#include "absl/types/span.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_cpu_utils.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/api2/packet.h"
 #include "mediapipe/framework/api2/port.h"
@@ -69,113 +65,38 @@ using ::mediapipe::tasks::TensorsToSegmentationCalculatorOptions;
 using ::mediapipe::tasks::vision::GetImageLikeTensorShape;
 using ::mediapipe::tasks::vision::Shape;
 using ::mediapipe::tasks::vision::image_segmenter::proto::SegmenterOptions;
+using ::mediapipe::tensors_to_segmentation_utils::ActivateChannels;
+using ::mediapipe::tensors_to_segmentation_utils::ComputeCategoryMask;
+using ::mediapipe::tensors_to_segmentation_utils::SegmentationActivation;
 
-constexpr uint8_t kUnLabeledPixelValue = 255;
-
-void StableSoftmax(absl::Span<const float> values,
-                   absl::Span<float> activated_values) {
-  float max_value = *std::max_element(values.begin(), values.end());
-  float denominator = 0.f;
-  std::transform(values.begin(), values.end(), activated_values.begin(),
-                 [&](float val) {
-                   float exp_val = std::exp(val - max_value);
-                   denominator += exp_val;
-                   return exp_val;
-                 });
-  std::transform(activated_values.begin(), activated_values.end(),
-                 activated_values.begin(),
-                 [&denominator](float val) { return val / denominator; });
-}
-
-void Sigmoid(absl::Span<const float> values,
-             absl::Span<float> activated_values) {
-  std::transform(values.begin(), values.end(), activated_values.begin(),
-                 [](float value) { return 1. / (1 + std::exp(-value)); });
-}
-
-// Linearly interpolate the value between v0 and v1. Assume 0 <= t <= 1.
-float LinearInterpolate(float v0, float v1, float t) {
-  return v0 + (v1 - v0) * t;
-}
-
-// Bilinearly interpolate the value between 4 points. Assume 0 <= t0, t1 <= 1.
-float BilinearInterpolate(float v00, float v10, float v01, float v11, float t0,
-                          float t1) {
-  return LinearInterpolate(LinearInterpolate(v00, v10, t0),
-                           LinearInterpolate(v01, v11, t0), t1);
-}
-
-float GetTensorElement(const Shape& input_shape, const float* tensors_buffer,
-                       int x, int y, int c) {
-  return tensors_buffer[y * input_shape.channels * input_shape.width +
-                        x * input_shape.channels + c];
+SegmentationActivation GetActivation(const SegmenterOptions& options) {
+  switch (options.activation()) {
+    case SegmenterOptions::SIGMOID:
+      return SegmentationActivation::kSigmoid;
+    case SegmenterOptions::SOFTMAX:
+      return SegmentationActivation::kSoftmax;
+    default:
+      return SegmentationActivation::kNone;
+  }
 }
 
 Image ProcessForCategoryMaskCpu(const Shape& input_shape,
                                 const Shape& output_shape,
                                 const SegmenterOptions& options,
                                 const float* tensors_buffer) {
-  const float width_scale =
-      (input_shape.width - 1) / static_cast<float>(output_shape.width - 1);
-  const float height_scale =
-      (input_shape.height - 1) / static_cast<float>(output_shape.height - 1);
-
   // Category mask Image.
   ImageFrameSharedPtr image_frame_ptr = std::make_shared<ImageFrame>(
       ImageFormat::GRAY8, output_shape.width, output_shape.height, 1);
   Image category_mask(image_frame_ptr);
 
-  // Fill in the maximum category in the category mask image.
-  cv::Mat category_mask_mat_view =
-      mediapipe::formats::MatView(image_frame_ptr.get());
-  const int input_channels = input_shape.channels;
-  category_mask_mat_view.forEach<uint8_t>([&tensors_buffer, &input_shape,
-                                           &width_scale, &height_scale,
-                                           &input_channels,
-                                           &options](uint8_t& pixel,
-                                                     const int position[]) {
-    std::vector<float> confidence_scores(input_channels);
-    int y0 =
-        static_cast<int>(std::max(std::floor(position[0] * height_scale), 0.f));
-    int x0 =
-        static_cast<int>(std::max(std::floor(position[1] * width_scale), 0.f));
-    int y1 = static_cast<int>(std::min(std::ceil(position[0] * height_scale),
-                                       input_shape.height - 1.f));
-    int x1 = static_cast<int>(std ::min(std::ceil(position[1] * width_scale),
-                                        input_shape.width - 1.f));
-    float t0 = std::max(std::min(position[0] * height_scale - y0, 1.f), 0.f);
-    float t1 = std::max(std::min(position[1] * width_scale - x0, 1.f), 0.f);
-    for (int i = 0; i < input_channels; ++i) {
-      confidence_scores[i] = BilinearInterpolate(
-          GetTensorElement(input_shape, tensors_buffer, x0, y0, i),
-          GetTensorElement(input_shape, tensors_buffer, x0, y1, i),
-          GetTensorElement(input_shape, tensors_buffer, x1, y0, i),
-          GetTensorElement(input_shape, tensors_buffer, x1, y1, i), t0, t1);
-    }
-    absl::Span<float> confidence_scores_span(confidence_scores.data(),
-                                             confidence_scores.size());
-
-    // Only process the activation function if it is SIGMOID. If NONE,
-    // we do nothing for activation, If SOFTMAX, it is required
-    // to have input_channels > 1, and for input_channels > 1, we don't need
-    // activation to find the maximum value.
-    if (options.activation() == SegmenterOptions::SIGMOID) {
-      Sigmoid(confidence_scores_span, confidence_scores_span);
-    }
-    if (input_channels == 1) {
-      // if the input tensor is a single mask, it is assumed to be a binary
-      // foreground segmentation mask. For such a mask, instead of a true
-      // argmax, we simply use 0.5 as the cutoff, assigning 0 (foreground) or
-      // 255 (background) based on whether the confidence value reaches this
-      // cutoff or not, respectively.
-      pixel = confidence_scores[0] > 0.5f ? 0 : kUnLabeledPixelValue;
-    } else {
-      const int maximum_category_idx =
-          std::max_element(confidence_scores.begin(), confidence_scores.end()) -
-          confidence_scores.begin();
-      pixel = maximum_category_idx;
-    }
-  });
+  // Fill in the maximum category in the category mask image. Scores are
+  // upsampled and reduced to a category in a single pass, without
+  // materializing per channel masks.
+  ComputeCategoryMask(
+      {tensors_buffer, input_shape.height, input_shape.width,
+       input_shape.channels},
+      GetActivation(options), output_shape.width, output_shape.height,
+      image_frame_ptr->MutablePixelData(), image_frame_ptr->WidthStep());
   return category_mask;
 }
 
@@ -183,50 +104,27 @@ std::vector<Image> ProcessForConfidenceMaskCpu(const Shape& input_shape,
                                                const Shape& output_shape,
                                                const SegmenterOptions& options,
                                                const float* tensors_buffer) {
-  std::function<void(absl::Span<const float> values,
-                     absl::Span<float> activated_values)>
-      activation_fn;
-  switch (options.activation()) {
-    case SegmenterOptions::SIGMOID:
-      activation_fn = &Sigmoid;
-      break;
-    case SegmenterOptions::SOFTMAX:
-      activation_fn = &StableSoftmax;
-      break;
-    case SegmenterOptions::NONE:
-      // Just copying for NONE activation.
-      activation_fn = [](absl::Span<const float> values,
-                         absl::Span<float> activated_values) {
-        std::copy(values.begin(), values.end(), activated_values.begin());
-      };
-      break;
-  }
-
   // TODO Use libyuv for resizing instead.
   std::vector<Image> confidence_masks;
   std::vector<cv::Mat> confidence_mask_mats;
+  std::vector<float*> confidence_mask_buffers;
   confidence_masks.reserve(input_shape.channels);
   confidence_mask_mats.reserve(input_shape.channels);
+  confidence_mask_buffers.reserve(input_shape.channels);
   for (int i = 0; i < input_shape.channels; ++i) {
     confidence_masks.push_back(Image(std::make_shared<ImageFrame>(
         ImageFormat::VEC32F1, input_shape.width, input_shape.height, 1)));
     confidence_mask_mats.push_back(mediapipe::formats::MatView(
         confidence_masks.back().GetImageFrameSharedPtr().get()));
+    confidence_mask_buffers.push_back(
+        confidence_mask_mats.back().ptr<float>());
   }
 
   // Applies activation function.
-  const int tensor_size = input_shape.height * input_shape.width;
-  std::vector<float> activated_values(input_shape.channels);
-  absl::Span<float> activated_values_span(activated_values);
-  for (int i = 0; i < tensor_size; ++i) {
-    activation_fn(absl::MakeConstSpan(&tensors_buffer[i * input_shape.channels],
-                                      input_shape.channels),
-                  activated_values_span);
-    for (int j = 0; j < input_shape.channels; ++j) {
-      confidence_mask_mats[j].at<float>(
-          i / input_shape.width, i % input_shape.width) = activated_values[j];
-    }
-  }
+  ActivateChannels({tensors_buffer, input_shape.height, input_shape.width,
+                    input_shape.channels},
+                   GetActivation(options), confidence_mask_buffers,
+                   confidence_mask_mats[0].step1());
   if (output_shape.height == input_shape.height &&
       output_shape.width == input_shape.width) {
     return confidence_masks;
@@ -0,0 +1,140 @@
+# Copyright 2024 The MediaPipe Authors.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Batched cosine similarity and top-k search over embeddings."""
+
+import dataclasses
+from typing import List, Sequence
+
+import numpy as np
+
+from mediapipe.tasks.python.components.containers import embedding_result
+
+_Embedding = embedding_result.Embedding
+
+
+@dataclasses.dataclass
+class SimilarityMatch:
+  """A row of an `EmbeddingMatrix` and its cosine similarity to a query.
+
+  Attributes:
+    index: The index of the row, i.e. of the embedding the matrix was created
+      from.
+    similarity: The cosine similarity between the row and the query.
+  """
+
+  index: int
+  similarity: float
+
+
+def _is_quantized(embedding: _Embedding) -> bool:
+  return embedding.embedding.dtype == np.uint8
+
+
+def _float_values(embedding: _Embedding) -> np.ndarray:
+  if _is_quantized(embedding):
+    return embedding.embedding.view("int8").astype(np.float32)
+  return embedding.embedding.astype(np.float32)
+
+
+def _normalize(values: np.ndarray) -> np.ndarray:
+  norm = np.linalg.norm(values, axis=-1, keepdims=True)
+  if np.any(norm <= 0):
+    raise ValueError(
+        "Cannot compute cosine similarity on embedding with 0 norm.")
+  return values / norm
+
+
+class EmbeddingMatrix:
+  """Ranks queries against a set of embeddings by cosine similarity.
+
+  Unlike `cosine_similarity`, which compares two embeddings, the embeddings
+  are L2-normalized once into a contiguous matrix, and each query is compared
+  to all of them with a single matrix-vector product.
+  """
+
+  def __init__(self, embeddings: Sequence[_Embedding]):
+    """Creates a matrix from `embeddings`.
+
+    Args:
+      embeddings: The embeddings to rank queries against, either all float or
+        all quantized, of the same size.
+
+    Raises:
+      ValueError: If `embeddings` is empty, mixes quantized and float
+        embeddings, has embeddings of different sizes, or with an L2-norm of 0.
+    """
+    if not embeddings:
+      raise ValueError("Cannot create an empty embedding matrix.")
+    self._quantized = _is_quantized(embeddings[0])
+    self._dimension = len(embeddings[0].embedding)
+    for embedding in embeddings:
+      self._check_embedding(embedding)
+    self._rows = _normalize(
+        np.stack([_float_values(embedding) for embedding in embeddings]))
+
+  def __len__(self) -> int:
+    return self._rows.shape[0]
+
+  def _check_embedding(self, embedding: _Embedding) -> None:
+    if _is_quantized(embedding) != self._quantized:
+      raise ValueError("Cannot compute cosine similarity between quantized "
+                       "and float embeddings.")
+    if len(embedding.embedding) != self._dimension:
+      raise ValueError(f"Cannot compute cosine similarity between embeddings "
+                       f"of different sizes "
+                       f"({len(embedding.embedding)} vs. {self._dimension}).")
+
+  def cosine_similarities(self, query: _Embedding) -> np.ndarray:
+    """Computes the cosine similarities between `query` and each row.
+
+    Args:
+      query: An embedding of the type and size of the rows.
+
+    Returns:
+      The cosine similarity with each row, in row order.
+
+    Raises:
+      ValueError: If `query` is not of the type and size of the rows, or has
+        an L2-norm of 0.
+    """
+    self._check_embedding(query)
+    return self._rows @ _normalize(_float_values(query))
+
+  def top_k(self, query: _Embedding, k: int) -> List[SimilarityMatch]:
+    """Finds the `k` rows most similar to `query`.
+
+    Args:
+      query: An embedding of the type and size of the rows.
+      k: The number of rows to return.
+
+    Returns:
+      The `k` most similar rows, or all of them if there are fewer, by
+      decreasing similarity, with ties by increasing index.
+
+    Raises:
+      ValueError: If `query` is not of the type and size of the rows, or has
+        an L2-norm of 0.
+    """
+    similarities = self.cosine_similarities(query)
+    k = max(0, min(k, len(similarities)))
+    if k == 0:
+      return []
+    # Keeps every row tied with the k-th one, then sorts them.
+    threshold = np.partition(similarities, -k)[-k]
+    indices = np.flatnonzero(similarities >= threshold)
+    indices = indices[np.lexsort((indices, -similarities[indices]))][:k]
+    return [
+        SimilarityMatch(index=int(index), similarity=float(similarities[index]))
+        for index in indices
+    ]
@@ -21,6 +21,7 @@ from absl.testing import parameterized
 import numpy as np
 
 from mediapipe.tasks.python.components.containers import embedding_result as embedding_result_module
+from mediapipe.tasks.python.components.utils import embedding_matrix
 from mediapipe.tasks.python.core import base_options as base_options_module
 from mediapipe.tasks.python.test import test_utils
 from mediapipe.tasks.python.text import text_embedder
@@ -101,6 +102,14 @@ class TextEmbedderTest(parameterized.TestCase):
                                                  result1.embeddings[0])
     self.assertAlmostEqual(
         similarity, expected_similarity, delta=_SIMILARITY_TOLERANCE)
+    # Checks that an embedding matrix ranks them the same way.
+    matrix = embedding_matrix.EmbeddingMatrix(
+        [result0.embeddings[0], result1.embeddings[0]])
+    matches = matrix.top_k(result1.embeddings[0], k=2)
+    self.assertEqual([match.index for match in matches], [1, 0])
+    self.assertAlmostEqual(
+        matches[1].similarity, expected_similarity,
+        delta=_SIMILARITY_TOLERANCE)
 
   @parameterized.parameters(
       (